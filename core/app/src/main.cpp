@@ -1,4 +1,5 @@
 #include "assembler/assembler.h"
+#include "assembler/batch_runner.h"
 #include "assembler/build.h"
 #include "assembler/linker.h"
 #include "assembler/load_executable.h"
@@ -9,6 +10,11 @@
 #include "util/file.h"
 #include "util/logger.h"
 
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
 /*
     TODO:
     * CLEAN UP CODE
@@ -107,8 +113,79 @@ const static std::string build_long_loop =
 
 constexpr U64 kMaxCycles = 0x0;
 
+/*
+    Run every job of a file on a pool of threads, one machine per thread. Each line of the file is
+    a job, the path of an executable followed by its instruction budget (0 for no limit) and up to
+    8 inputs passed in x0 to x7.
+*/
+static int run_batch (const std::string &jobs_path, word nworkers)
+{
+    std::ifstream jobs_file (jobs_path);
+    if (!jobs_file)
+    {
+        printf ("Could not open job file %s\n", jobs_path.c_str ());
+        return 1;
+    }
+
+    std::vector<BatchRunner::Job> jobs;
+    std::string line;
+    while (std::getline (jobs_file, line))
+    {
+        std::istringstream fields (line);
+        std::string exe_path;
+        BatchRunner::Job job;
+        if (!(fields >> exe_path >> job.budget))
+        {
+            continue;
+        }
+
+        job.exe_file = File (exe_path);
+        for (word input; fields >> input;)
+        {
+            job.input.push_back (input);
+        }
+        jobs.push_back (job);
+    }
+
+    BatchRunner runner (nworkers);
+    std::vector<BatchRunner::Result> results = runner.run (jobs);
+    for (size_t i = 0; i < results.size (); i++)
+    {
+        const BatchRunner::Result &result = results[i];
+        printf ("job %zu: %s status %u after %llu instructions in %.6f s on worker %u%s, x0 = %u\n",
+                i, jobs[i].exe_file.get_path ().c_str (), (unsigned) result.reason.status,
+                (unsigned long long) result.reason.instructions, result.seconds, result.worker,
+                result.stolen ? " (stolen)" : "", result.context.x[0]);
+        if (result.reason.status == Emulator32bit::RunStatus::FAULT)
+        {
+            printf ("    %s\n", result.reason.fault.c_str ());
+        }
+    }
+    return 0;
+}
+
 int main (int argc, char *argv[])
 {
+    /* -batch <job file> [number of threads] */
+    if (argc > 2 && std::string (argv[1]) == "-batch")
+    {
+        word nworkers = 0;
+        if (argc > 3)
+        {
+            char *end = nullptr;
+            const unsigned long value = std::strtoul (argv[3], &end, 10);
+            if (end == argv[3] || *end != '\0' || argv[3][0] == '-'
+                || value > std::numeric_limits<word>::max ())
+            {
+                printf ("Invalid number of threads %s\n", argv[3]);
+                printf ("Usage: -batch <job file> [number of threads]\n");
+                return 1;
+            }
+            nworkers = value;
+        }
+        return run_batch (argv[2], nworkers);
+    }
+
     PROFILE_START
 
     CLOCK_START ("Parsing command arguments")
@@ -140,6 +217,10 @@ int main (int argc, char *argv[])
         Disk *disk = new Disk (File ("../tests/disk.bin", true), 32, 32);
 
         Emulator32bit emulator (ram, rom, disk);
+        /* memory mapped devices sit right above the disk */
+        emulator.system_bus->map_device (new ConsoleDevice (64));
+        emulator.system_bus->map_device (new TimerDevice (65, emulator.timer));
+        emulator.system_bus->map_device (new DMADevice (66, emulator.system_bus->dma));
         long long pid = emulator.system_bus->mmu->begin_process ();
         LoadExecutable loader (emulator, process.get_exe_file ());
         CLOCK_END
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit.h"
+#include "util/file.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief           Runs a list of jobs, each an executable with its own input, on a pool of
+ *                  threads.
+ *
+ * @details         Every worker owns one machine, so jobs never share memory or registers. A
+ *                  worker loads each executable once into a @ref ForkServer and runs every job
+ *                  of it as a forked instance. Jobs are dealt round robin to the queues of the
+ *                  workers. A worker takes jobs from the front of its own queue, and once it is
+ *                  empty steals from the back of the queues of the others, so a worker that
+ *                  drew short jobs helps with the long ones.
+ */
+class BatchRunner
+{
+  public:
+    /* inputs are passed in the parameter registers x0 to x7 */
+    static constexpr word kMaxInputs = 8;
+
+    /* pages of RAM of the machines created by default, 1 MB */
+    static constexpr word kDefaultRAMPages = 256;
+
+    /**
+     * @brief       An executable to run with one input.
+     *
+     */
+    struct Job
+    {
+        File exe_file;
+        std::vector<word> input;
+
+        /* maximum number of instructions to run, 0 for no limit */
+        U64 budget = 0;
+    };
+
+    /**
+     * @brief       How a job ran.
+     *
+     */
+    struct Result
+    {
+        /* why the job stopped, a job that failed to load stops with a fault */
+        Emulator32bit::StopReason reason;
+
+        /* registers the job stopped with */
+        Emulator32bit::Context context = {};
+
+        /* wall time spent forking, running and releasing the job */
+        double seconds = 0;
+
+        /* worker that ran the job, and whether it took it from another worker */
+        word worker = 0;
+        bool stolen = false;
+    };
+
+    /**
+     * @brief       Create a pool of workers.
+     *
+     * @param nworkers Number of threads, 0 for one per hardware thread.
+     * @param create_machine Creates the machine of a worker, called on the thread of the
+     *              worker. By default a machine with @ref kDefaultRAMPages of RAM and no disk.
+     */
+    BatchRunner (word nworkers = 0, std::function<Emulator32bit *()> create_machine = nullptr);
+
+    /**
+     * @brief       Run jobs until all of them have stopped.
+     *
+     * @throws      std::invalid_argument if a job has more than @ref kMaxInputs inputs.
+     * @param jobs  Jobs to run.
+     * @return      Result of every job, in the order of the jobs.
+     */
+    std::vector<Result> run (const std::vector<Job> &jobs);
+
+    inline word nworkers () const
+    {
+        return m_nworkers;
+    }
+
+  private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    word m_nworkers;
+    std::function<Emulator32bit *()> m_create_machine;
+
+    bool next_job (std::vector<WorkQueue> &queues, word worker, size_t &job, bool &stolen);
+    void run_worker (const std::vector<Job> &jobs, std::vector<WorkQueue> &queues,
+                     std::vector<Result> &results, word worker);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit.h"
+#include "util/file.h"
+
+#include <unordered_map>
+
+/**
+ * @brief           Runs many instances of one executable without loading it again for each.
+ *
+ * @details         The executable is loaded and relocated once by @ref LoadExecutable into a
+ *                  template process. Every instance is a process forked from it with
+ *                  @ref VirtualMemory::fork_process, so it shares the pages of the template
+ *                  until it writes them. Text pages are never written and stay shared by all
+ *                  instances. Each instance has its own registers, saved while another one is
+ *                  entered.
+ */
+class ForkServer
+{
+  public:
+    /**
+     * @brief       Load an executable into a new template process of a machine.
+     *
+     * @param emu   Machine to run the instances on.
+     * @param exe_file Executable to load.
+     */
+    ForkServer (Emulator32bit &emu, File exe_file);
+
+    /**
+     * @brief       Start an instance with the registers and memory of the template, ready to
+     *              run from the entry point once entered.
+     *
+     * @return      Process id of the instance.
+     */
+    long long fork ();
+
+    /**
+     * @brief       Make an instance the one the machine runs, saving the registers of the
+     *              instance entered before.
+     *
+     * @throws      VirtualMemory::InvalidPIDException if the process is not a running instance.
+     * @param pid   Process id returned by @ref fork.
+     */
+    void enter (long long pid);
+
+    /**
+     * @brief       End an instance, freeing the pages it did not share.
+     *
+     * @throws      VirtualMemory::InvalidPIDException if the process is not a running instance.
+     * @param pid   Process id returned by @ref fork.
+     */
+    void release (long long pid);
+
+    inline long long template_process () const
+    {
+        return m_template_pid;
+    }
+
+  private:
+    Emulator32bit &m_emu;
+
+    long long m_template_pid;
+    Emulator32bit::Context m_template_context;
+
+    /* saved registers of every instance, stale for the entered one */
+    std::unordered_map<long long, Emulator32bit::Context> m_contexts;
+    long long m_entered_pid = -1;
+};
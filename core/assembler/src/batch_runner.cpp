@@ -0,0 +1,138 @@
+#include "assembler/batch_runner.h"
+#include "assembler/fork_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+BatchRunner::BatchRunner (word nworkers, std::function<Emulator32bit *()> create_machine) :
+    m_nworkers (nworkers == 0 ? std::max<word> (std::thread::hardware_concurrency (), 1)
+                              : nworkers),
+    m_create_machine (std::move (create_machine))
+{
+    if (!m_create_machine)
+    {
+        m_create_machine = [] ()
+        { return new Emulator32bit (kDefaultRAMPages, 0, {}, 0, kDefaultRAMPages); };
+    }
+}
+
+std::vector<BatchRunner::Result> BatchRunner::run (const std::vector<Job> &jobs)
+{
+    for (const Job &job : jobs)
+    {
+        if (job.input.size () > kMaxInputs)
+        {
+            throw std::invalid_argument ("Job of " + job.exe_file.get_path () + " has "
+                                         + std::to_string (job.input.size ())
+                                         + " inputs, at most "
+                                         + std::to_string (kMaxInputs) + " are supported.");
+        }
+    }
+
+    const word nworkers = std::min<size_t> (m_nworkers, std::max<size_t> (jobs.size (), 1));
+    std::vector<WorkQueue> queues (nworkers);
+    for (size_t job = 0; job < jobs.size (); job++)
+    {
+        queues[job % nworkers].jobs.push_back (job);
+    }
+
+    std::vector<Result> results (jobs.size ());
+    std::vector<std::thread> threads;
+    threads.reserve (nworkers - 1);
+    for (word worker = 1; worker < nworkers; worker++)
+    {
+        threads.emplace_back ([&, worker] () { run_worker (jobs, queues, results, worker); });
+    }
+    run_worker (jobs, queues, results, 0);
+
+    for (std::thread &thread : threads)
+    {
+        thread.join ();
+    }
+    return results;
+}
+
+bool BatchRunner::next_job (std::vector<WorkQueue> &queues, word worker, size_t &job,
+                            bool &stolen)
+{
+    {
+        std::lock_guard<std::mutex> lock (queues[worker].mutex);
+        if (!queues[worker].jobs.empty ())
+        {
+            job = queues[worker].jobs.front ();
+            queues[worker].jobs.pop_front ();
+            stolen = false;
+            return true;
+        }
+    }
+
+    /* no job is ever added back, so a worker is done once every queue was seen empty */
+    for (word offset = 1; offset < queues.size (); offset++)
+    {
+        WorkQueue &victim = queues[(worker + offset) % queues.size ()];
+        std::lock_guard<std::mutex> lock (victim.mutex);
+        if (!victim.jobs.empty ())
+        {
+            job = victim.jobs.back ();
+            victim.jobs.pop_back ();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchRunner::run_worker (const std::vector<Job> &jobs, std::vector<WorkQueue> &queues,
+                              std::vector<Result> &results, word worker)
+{
+    std::unique_ptr<Emulator32bit> machine (m_create_machine ());
+    std::unordered_map<std::string, std::unique_ptr<ForkServer>> servers;
+
+    size_t index;
+    bool stolen;
+    while (next_job (queues, worker, index, stolen))
+    {
+        const Job &job = jobs[index];
+        Result &result = results[index];
+        result.worker = worker;
+        result.stolen = stolen;
+
+        const auto start = std::chrono::steady_clock::now ();
+        try
+        {
+            std::unique_ptr<ForkServer> &server = servers[job.exe_file.get_path ()];
+            if (!server)
+            {
+                /* reading a missing file is fatal to the whole batch */
+                if (!job.exe_file.exists ())
+                {
+                    throw std::runtime_error ("Executable " + job.exe_file.get_path ()
+                                              + " does not exist.");
+                }
+                server = std::make_unique<ForkServer> (*machine, job.exe_file);
+            }
+
+            const long long pid = server->fork ();
+            server->enter (pid);
+            for (word reg = 0; reg < job.input.size (); reg++)
+            {
+                machine->write_reg (reg, job.input[reg]);
+            }
+            machine->run_until (job.budget, result.reason);
+            result.context = machine->save_context ();
+            server->release (pid);
+        }
+        catch (const std::exception &e)
+        {
+            result.reason.status = Emulator32bit::RunStatus::FAULT;
+            result.reason.fault = e.what ();
+        }
+        result.seconds =
+            std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+    }
+}
@@ -0,0 +1,55 @@
+#include "assembler/fork_server.h"
+#include "assembler/load_executable.h"
+
+#include "emulator32bit/system_bus.h"
+
+ForkServer::ForkServer (Emulator32bit &emu, File exe_file) :
+    m_emu (emu)
+{
+    m_template_pid = m_emu.system_bus->mmu->begin_process ();
+    LoadExecutable loader (m_emu, exe_file);
+    m_template_context = m_emu.save_context ();
+}
+
+long long ForkServer::fork ()
+{
+    long long pid = m_emu.system_bus->mmu->fork_process (m_template_pid);
+    m_contexts.insert (std::make_pair (pid, m_template_context));
+    return pid;
+}
+
+void ForkServer::enter (long long pid)
+{
+    if (m_contexts.find (pid) == m_contexts.end ())
+    {
+        throw VirtualMemory::InvalidPIDException ("Cannot enter process " + std::to_string (pid)
+                                                      + " since it is not a forked instance.",
+                                                  pid);
+    }
+
+    if (m_entered_pid != -1)
+    {
+        m_contexts.at (m_entered_pid) = m_emu.save_context ();
+    }
+
+    m_emu.system_bus->mmu->set_process (pid);
+    m_emu.load_context (m_contexts.at (pid));
+    m_entered_pid = pid;
+}
+
+void ForkServer::release (long long pid)
+{
+    if (m_contexts.find (pid) == m_contexts.end ())
+    {
+        throw VirtualMemory::InvalidPIDException ("Cannot release process " + std::to_string (pid)
+                                                      + " since it is not a forked instance.",
+                                                  pid);
+    }
+
+    m_emu.system_bus->mmu->end_process (pid);
+    m_contexts.erase (pid);
+    if (m_entered_pid == pid)
+    {
+        m_entered_pid = -1;
+    }
+}
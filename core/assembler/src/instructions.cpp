@@ -12,6 +12,10 @@ byte Assembler::parse_sysreg ()
     {
         return Emulator32bit::kSysregId_pstate;
     }
+    else if (sysreg == "CORE")
+    {
+        return Emulator32bit::kSysregId_core;
+    }
 
     ERROR ("Assembler::parse_sysreg() - Invalid System Register {}.", sysreg.c_str ());
     return 0;
@@ -75,18 +75,14 @@ void LoadExecutable::load ()
                                           end - start + 1, false, true);
     }
 
-    for (word instr : obj.text_section)
+    const byte *text = (const byte *) obj.text_section.data ();
+    if (!physical)
     {
-        if (!physical)
-        {
-            m_emu.system_bus->write_word (cur_addr, instr);
-        }
-        else
-        {
-            m_emu.system_bus->write_unmapped_word (cur_addr, instr);
-        }
-
-        cur_addr += 4;
+        m_emu.system_bus->write_block (cur_addr, text, 4 * obj.text_section.size ());
+    }
+    else
+    {
+        m_emu.system_bus->write_unmapped_block (cur_addr, text, 4 * obj.text_section.size ());
     }
 
     cur_addr = obj.sections[obj.section_table.at (".data")].address;
@@ -100,17 +96,15 @@ void LoadExecutable::load ()
                                           end - start + 1, true, false);
     }
 
-    for (byte data : obj.data_section)
+    if (!physical)
     {
-        if (!physical)
-        {
-            m_emu.system_bus->write_byte (cur_addr, data);
-        }
-        else
-        {
-            m_emu.system_bus->write_unmapped_byte (cur_addr, data);
-        }
-        cur_addr++;
+        m_emu.system_bus->write_block (cur_addr, obj.data_section.data (),
+                                       obj.data_section.size ());
+    }
+    else
+    {
+        m_emu.system_bus->write_unmapped_block (cur_addr, obj.data_section.data (),
+                                                obj.data_section.size ());
     }
 
     cur_addr = obj.sections[obj.section_table.at (".bss")].address;
@@ -123,17 +117,13 @@ void LoadExecutable::load ()
                                           end - start + 1, true, false);
     }
 
-    for (word i = 0; i < obj.bss_section; i++)
+    if (!physical)
     {
-        if (!physical)
-        {
-            m_emu.system_bus->write_byte (cur_addr, 0);
-        }
-        else
-        {
-            m_emu.system_bus->write_unmapped_byte (cur_addr, 0);
-        }
-        cur_addr++;
+        m_emu.system_bus->fill (cur_addr, 0, obj.bss_section);
+    }
+    else
+    {
+        m_emu.system_bus->fill_unmapped (cur_addr, 0, obj.bss_section);
     }
 
     /* start program at _start label */
@@ -142,11 +132,9 @@ void LoadExecutable::load ()
         ERROR ("LoadExecutable::load() - Missing required _start entry point of program.");
     }
 
-    VirtualMemory::Exception vm_exception;
+    /* the pc is a virtual address, instruction fetches are translated */
     word entry_point = obj.symbol_table.at (obj.string_table.at ("_start")).symbol_value;
-    m_emu.set_pc (m_emu.system_bus->mmu->translate_address (entry_point, vm_exception));
+    m_emu.set_pc (entry_point);
 
-    INFO ("Starting emulator at entry point _start at virtual address {:x} mapped to physical "
-          "address {:x}",
-          entry_point, m_emu.get_pc ());
+    INFO ("Starting emulator at entry point _start at virtual address {:x}", entry_point);
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #define AEMU_ONLY_CRITICAL_LOG
 #include "util/logger.h"
 
+#include <atomic>
 #include <regex>
 #include <utility>
 
@@ -372,7 +373,7 @@ std::vector<Tokenizer::Token> Tokenizer::tokenize (File src_file, Options option
  */
 std::vector<Tokenizer::Token> Tokenizer::tokenize (std::string source_code, Options option)
 {
-    static int TOKENIZE_IDS = 0;
+    static std::atomic<int> TOKENIZE_IDS = 0;
     int tokenize_id = TOKENIZE_IDS++;
     int cur_line = 0;
 
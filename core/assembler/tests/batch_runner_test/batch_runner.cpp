@@ -0,0 +1,108 @@
+#include "assembler_test/assembler_test.h"
+
+#include <assembler/batch_runner.h>
+
+#include <stdexcept>
+
+static File build (const std::string &source, const std::string &name)
+{
+    const std::string outdir =
+        AEMU_PROJECT_ROOT_DIR + "core/assembler/tests/batch_runner_test/build";
+    Process p ("-o " + outdir + "/" + name + " " + AEMU_PROJECT_ROOT_DIR + source + " -outdir "
+               + outdir);
+    if (!p.does_create_exe ())
+    {
+        ADD_FAILURE () << source << " should assemble into an executable";
+    }
+    return p.get_exe_file ();
+}
+
+static File build_fork_counter ()
+{
+    return build ("core/assembler/tests/fork_server_test/src/fork_counter.basm", "fork_counter");
+}
+
+static File build_count_down ()
+{
+    return build ("core/assembler/tests/batch_runner_test/src/count_down.basm", "count_down");
+}
+
+TEST (batch_runner, runs_every_job_with_its_input)
+{
+    const File fork_counter = build_fork_counter ();
+    const File count_down = build_count_down ();
+
+    std::vector<BatchRunner::Job> jobs;
+    for (word i = 0; i < 16; i++)
+    {
+        if (i % 2 == 0)
+        {
+            jobs.push_back ({fork_counter, {0, i}, MAX_INSTRUCTIONS});
+        }
+        else
+        {
+            jobs.push_back ({count_down, {i}, MAX_INSTRUCTIONS});
+        }
+    }
+
+    BatchRunner runner (4);
+    std::vector<BatchRunner::Result> results = runner.run (jobs);
+    ASSERT_EQ (results.size (), jobs.size ());
+    for (word i = 0; i < 16; i++)
+    {
+        const BatchRunner::Result &result = results[i];
+        ASSERT_EQ (result.reason.status, Emulator32bit::RunStatus::HALTED) << result.reason.fault;
+        EXPECT_LT (result.worker, runner.nworkers ());
+        if (i % 2 == 0)
+        {
+            EXPECT_EQ (result.context.x[0], 100 + i)
+                << "instances on one machine should not see the writes of each other";
+        }
+        else
+        {
+            EXPECT_EQ (result.context.x[1], i);
+        }
+    }
+}
+
+TEST (batch_runner, stops_jobs_at_their_budget)
+{
+    const File count_down = build_count_down ();
+    BatchRunner runner (2);
+    std::vector<BatchRunner::Result> results =
+        runner.run ({{count_down, {1000000}, 100}, {count_down, {3}, 0}});
+
+    EXPECT_EQ (results[0].reason.status, Emulator32bit::RunStatus::BUDGET_EXHAUSTED);
+    EXPECT_EQ (results[0].reason.instructions, 100);
+    EXPECT_EQ (results[1].reason.status, Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (results[1].context.x[1], 3);
+}
+
+TEST (batch_runner, steals_jobs_from_busy_workers)
+{
+    const File count_down = build_count_down ();
+
+    /* the first worker draws the long job and half of the short ones */
+    std::vector<BatchRunner::Job> jobs = {{count_down, {4000000}, 0}};
+    for (word i = 1; i < 64; i++)
+    {
+        jobs.push_back ({count_down, {i}, 0});
+    }
+
+    std::vector<BatchRunner::Result> results = BatchRunner (2).run (jobs);
+    word stolen = 0;
+    for (word i = 0; i < jobs.size (); i++)
+    {
+        ASSERT_EQ (results[i].reason.status, Emulator32bit::RunStatus::HALTED);
+        EXPECT_EQ (results[i].context.x[1], jobs[i].input[0]);
+        stolen += results[i].stolen;
+    }
+    EXPECT_GT (stolen, 0);
+}
+
+TEST (batch_runner, rejects_too_many_inputs)
+{
+    BatchRunner runner (1);
+    EXPECT_THROW (runner.run ({{File ("missing.bexe"), std::vector<word> (9), 0}}),
+                  std::invalid_argument);
+}
@@ -0,0 +1,80 @@
+#include "assembler_test/assembler_test.h"
+
+#include <assembler/fork_server.h>
+
+static File build_fork_counter ()
+{
+    Process p ("-kp " + AEMU_PROJECT_ROOT_DIR
+               + "core/assembler/tests/fork_server_test/src/fork_counter.basm "
+                 "-outdir "
+               + AEMU_PROJECT_ROOT_DIR + "core/assembler/tests/fork_server_test/build");
+    if (!p.does_create_exe ())
+    {
+        ADD_FAILURE () << "fork_counter.basm should assemble into an executable";
+    }
+    return p.get_exe_file ();
+}
+
+/**
+ * @brief               Run an instance with an input, returning its result.
+ *
+ */
+static word run_instance (Emulator32bit &machine, ForkServer &server, long long pid, word input)
+{
+    server.enter (pid);
+    machine.write_reg (1, input);
+    machine.run (MAX_INSTRUCTIONS);
+    return machine.read_reg (0);
+}
+
+TEST_F (EmulatorFixture, fork_server_instances_have_own_data)
+{
+    ForkServer server (*machine, build_fork_counter ());
+    const long long a = server.fork ();
+    const long long b = server.fork ();
+
+    EXPECT_EQ (run_instance (*machine, server, a, 1), 101);
+    EXPECT_EQ (run_instance (*machine, server, b, 2), 102);
+
+    server.enter (a);
+    EXPECT_EQ (machine->read_reg (0), 101) << "entering should restore the registers";
+
+    const long long c = server.fork ();
+    EXPECT_EQ (run_instance (*machine, server, c, 0), 100)
+        << "writes of instances should not reach the template";
+}
+
+TEST_F (EmulatorFixture, fork_server_shares_text)
+{
+    ForkServer server (*machine, build_fork_counter ());
+    const long long a = server.fork ();
+    const long long b = server.fork ();
+    run_instance (*machine, server, a, 1);
+    run_instance (*machine, server, b, 2);
+
+    VirtualMemory *mmu = machine->system_bus->mmu;
+    VirtualMemory::Exception exception;
+    const word text = 0;
+    const word data = machine->read_reg (2);
+    EXPECT_EQ (mmu->translate_address (a, text, exception),
+               mmu->translate_address (server.template_process (), text, exception));
+    EXPECT_EQ (mmu->translate_address (a, text, exception),
+               mmu->translate_address (b, text, exception));
+    EXPECT_NE (mmu->translate_address (a, data, exception),
+               mmu->translate_address (b, data, exception));
+}
+
+TEST_F (EmulatorFixture, fork_server_release_keeps_shared_pages)
+{
+    ForkServer server (*machine, build_fork_counter ());
+    const long long a = server.fork ();
+    const long long b = server.fork ();
+    EXPECT_EQ (run_instance (*machine, server, a, 1), 101);
+
+    server.release (a);
+    EXPECT_THROW (server.enter (a), VirtualMemory::InvalidPIDException);
+    EXPECT_EQ (run_instance (*machine, server, b, 2), 102);
+
+    const long long c = server.fork ();
+    EXPECT_EQ (run_instance (*machine, server, c, 3), 103);
+}
@@ -0,0 +1,85 @@
+#include <emulator32bit/emulator32bit.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+/// @brief                  Number of times the program is run, its loop counter only has 19 bits.
+static constexpr int kRepeats = 16;
+
+/**
+ * @brief                   Loop of register only data processing, including a result discarded
+ *                          into xzr, 10 instructions per iteration.
+ *
+ */
+static void write_program (Emulator32bit &cpu, word iterations)
+{
+    const word program[] = {
+        // mov x1, #iterations; mov x2, #1; mov x3, #3
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, iterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, 1),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 3, 3),
+        // loop: add x2, x2, x3; eor x3, x3, x2, lsl #5; mul x4, x2, x3; sub x5, x4, x1, lsr #2
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 2, 2, 3,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_eor, false, 3, 3, 2,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 5),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_mul, false, 4, 2, 3,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, false, 5, 4, 1,
+                                     Emulator32bit::ShiftType::SHIFT_LSR, 2),
+        // orr xzr, x5, x2; ror x6, x5, #13; and x7, x6, xzr; add x2, x2, x6
+        Emulator32bit::asm_format_o (Emulator32bit::_op_orr, false, 31, 5, 2,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o1 (Emulator32bit::_op_ror, 6, 5, true, 0, 13),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_and, false, 7, 6, 31,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 2, 2, 6,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        // subs x1, x1, #1; b.ne loop
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -10),
+        Emulator32bit::asm_hlt (),
+    };
+
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cpu.system_bus->write_word (i * 4, program[i]);
+    }
+    cpu.set_pc (0);
+}
+
+/**
+ * @brief                   Time @ref kRepeats runs of the program until it halts.
+ *
+ * @return                  Seconds taken.
+ *
+ */
+static double time_run (word iterations, Emulator32bit::Backend backend)
+{
+    Emulator32bit cpu (1, 0, {}, 0, 1, backend);
+    write_program (cpu, iterations);
+
+    const auto start = std::chrono::steady_clock::now ();
+    for (int i = 0; i < kRepeats; i++)
+    {
+        cpu.set_pc (0);
+        cpu.run (0);
+    }
+    const auto end = std::chrono::steady_clock::now ();
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const word iterations = argc > 1 ? std::strtoul (argv[1], nullptr, 0) : 1 << 18;
+    const double ninstrs = kRepeats * (3 + 10.0 * iterations);
+
+    const double interpreter = time_run (iterations, Emulator32bit::Backend::INTERPRETER);
+    const double jit = time_run (iterations, Emulator32bit::Backend::JIT);
+
+    std::printf ("interpreter: %8.3f s %8.2f MIPS\n", interpreter, ninstrs / interpreter / 1e6);
+    std::printf ("jit:         %8.3f s %8.2f MIPS\n", jit, ninstrs / jit / 1e6);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <emulator32bit/emulator32bit.h>
+#include <emulator32bit/system_bus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/// @brief                  Pages of RAM of the emulated machine.
+static constexpr word kRAMPages = 256;
+
+/// @brief                  Pages each process touches between switches.
+static constexpr word kPagesPerProcess = 8;
+
+/// @brief                  First virtual page of every process, they all use the same addresses.
+static constexpr word kFirstVPage = 0x10;
+
+/**
+ * @brief                   Time switching between processes round robin, reading and writing a
+ *                          word of each of their pages after every switch.
+ *
+ * @return                  Seconds taken.
+ *
+ */
+static double time_switches (int switches, word nprocesses)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    std::vector<long long> pids;
+    for (word i = 0; i < nprocesses; i++)
+    {
+        pids.push_back (mmu->begin_process ());
+        mmu->add_vpage (pids.back (), kFirstVPage, kPagesPerProcess, true, false);
+    }
+    mmu->reset_tlb_stats ();
+
+    const auto start = std::chrono::steady_clock::now ();
+    for (int i = 0; i < switches; i++)
+    {
+        mmu->set_process (pids[i % nprocesses]);
+        for (word page = 0; page < kPagesPerProcess; page++)
+        {
+            const word address = (kFirstVPage + page) << kNumPageOffsetBits;
+            cpu.system_bus->write_word (address, cpu.system_bus->read_word (address) + 1);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now ();
+
+    const VirtualMemory::TLBStats &stats = mmu->tlb_stats ();
+    std::printf ("%3u processes: mmu tlb %llu hits, %llu misses, %llu evictions, ", nprocesses,
+                 (unsigned long long) stats.hits, (unsigned long long) stats.misses,
+                 (unsigned long long) stats.evictions);
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const int switches = argc > 1 ? std::atoi (argv[1]) : 1000000;
+
+    for (word nprocesses : {2u, 8u, 24u})
+    {
+        const double seconds = time_switches (switches, nprocesses);
+        std::printf ("%10.0f switches/s\n", switches / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <emulator32bit/emulator32bit.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+/**
+ * @brief                   Loop mixing data processing, memory accesses and a conditional branch,
+ *                          8 instructions per iteration.
+ *
+ */
+static void write_program (Emulator32bit &cpu, word iterations)
+{
+    const word program[] = {
+        // mov x0, #0x1000; mov x1, #iterations; mov x2, #0
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 0, 0x1000),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, iterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, 0),
+        // loop: ldr x3, [x0, #0]; add x3, x3, x1; eor x2, x2, x3, lsl #3; str x3, [x0, #0]
+        Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 3, 0, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 3, 3, 1,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_eor, false, 2, 2, 3,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 3),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 3, 0, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        // lsr x4, x2, #7; orr x4, x4, x1; subs x1, x1, #1; b.ne loop
+        Emulator32bit::asm_format_o1 (Emulator32bit::_op_lsr, 4, 2, true, 0, 7),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_orr, false, 4, 4, 1,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -8),
+        Emulator32bit::asm_hlt (),
+    };
+
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cpu.system_bus->write_word (i * 4, program[i]);
+    }
+    cpu.set_pc (0);
+}
+
+/**
+ * @brief                   Time one run of the program until it halts.
+ *
+ * @return                  Seconds taken.
+ *
+ */
+template <typename Run>
+static double time_run (word iterations, Run run)
+{
+    /* data is on its own page, a store next to the code would invalidate its decodes */
+    Emulator32bit cpu (2, 0, {}, 0, 2);
+    write_program (cpu, iterations);
+
+    const auto start = std::chrono::steady_clock::now ();
+    run (cpu);
+    const auto end = std::chrono::steady_clock::now ();
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const word iterations = argc > 1 ? std::strtoul (argv[1], nullptr, 0) : 1 << 18;
+    const double ninstrs = 3 + 8.0 * iterations;
+
+    Emulator32bit::StopReason reason;
+    const double table =
+        time_run (iterations, [&] (Emulator32bit &cpu) { cpu.run_until (0, reason); });
+    const double threaded =
+        time_run (iterations, [&] (Emulator32bit &cpu) { cpu.run_threaded (0, reason); });
+
+    std::printf ("table dispatch:    %8.3f s %8.2f MIPS\n", table, ninstrs / table / 1e6);
+    std::printf ("threaded dispatch: %8.3f s %8.2f MIPS\n", threaded, ninstrs / threaded / 1e6);
+    std::printf ("speedup:           %8.2fx\n", table / threaded);
+    return 0;
+}
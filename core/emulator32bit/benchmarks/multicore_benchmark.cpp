@@ -0,0 +1,119 @@
+#include <emulator32bit/multicore.h>
+#include <emulator32bit/system_bus.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <thread>
+
+/// @brief                  Address of the counter every core adds its iterations to.
+static constexpr word kCounterAddr = 0x1000;
+
+/// @brief                  Address of the words each core stores its progress to, one per core.
+static constexpr word kSlotsAddr = 0x1100;
+
+/// @brief                  Instructions per quantum of the deterministic runs.
+static constexpr U64 kQuantum = 4096;
+
+/**
+ * @brief                   Loop of register only data processing storing to a word of the core,
+ *                          6 instructions per iteration, then one atomic add of the iterations to
+ *                          a shared counter. Every core runs the same code.
+ *
+ */
+static void write_program (Multicore &cores, word iterations)
+{
+    const word program[] = {
+        // mrs x8, core; mov x1, #iterations; mov x2, #kCounterAddr; mov x7, #iterations
+        Emulator32bit::asm_mrs (8, Emulator32bit::kSysregId_core),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, iterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, kCounterAddr),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 7, iterations),
+        // mov x9, #kSlotsAddr; add x9, x9, x8, lsl #2
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 9, kSlotsAddr),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 9, 9, 8,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 2),
+        // loop: add x4, x4, x1; eor x5, x5, x4, lsl #3; str x5, [x9]; mul x6, x4, x5
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 4, 4, 1,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_eor, false, 5, 5, 4,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 3),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 5, 9, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_mul, false, 6, 4, 5,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        // subs x1, x1, #1; b.ne loop
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -5),
+        // ldadd xzr, x7, [x2]; hlt
+        Emulator32bit::asm_atomic (31, 7, 2, Emulator32bit::kAtomicWidth_word,
+                                   Emulator32bit::kAtomicId_ldadd),
+        Emulator32bit::asm_hlt (),
+    };
+
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cores.system_bus->write_word (i * 4, program[i]);
+    }
+}
+
+/**
+ * @brief                   Time every core running the program once until it halts.
+ *
+ * @param deterministic     Whether to run in quanta on one worker per core instead of freely.
+ * @return                  Seconds taken.
+ *
+ */
+static double time_run (word ncores, word iterations, bool deterministic)
+{
+    Multicore cores (new SystemBus (new RAM (2, 0), new ROM ({}, 0, 2)), ncores);
+    write_program (cores, iterations);
+
+    const auto start = std::chrono::steady_clock::now ();
+    if (deterministic)
+    {
+        cores.run_quanta (0, kQuantum, ncores);
+    }
+    else
+    {
+        cores.run (0);
+    }
+    const auto end = std::chrono::steady_clock::now ();
+
+    if (cores.system_bus->read_word (kCounterAddr) != ncores * iterations)
+    {
+        std::fprintf (stderr, "lost updates to the shared counter with %u cores: %u\n", ncores,
+                      cores.system_bus->read_word (kCounterAddr));
+        std::exit (1);
+    }
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const word iterations = argc > 1 ? std::strtoul (argv[1], nullptr, 0) : 1 << 18;
+    const word max_cores = argc > 2 ? std::strtoul (argv[2], nullptr, 0)
+                                    : std::max (1u, std::thread::hardware_concurrency ());
+    const double ninstrs = 8 + 6.0 * iterations;
+
+    for (const bool deterministic : {false, true})
+    {
+        std::printf ("%s\n", deterministic ? "quanta:" : "threads:");
+
+        double single = 0;
+        for (word ncores = 1; ncores <= max_cores; ncores *= 2)
+        {
+            const double seconds = time_run (ncores, iterations, deterministic);
+            if (ncores == 1)
+            {
+                single = seconds;
+            }
+
+            std::printf ("%3u cores: %8.3f s %8.2f MIPS %6.2fx\n", ncores, seconds,
+                         ncores * ninstrs / seconds / 1e6, ncores * single / seconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <emulator32bit/emulator32bit.h>
+#include <emulator32bit/system_bus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/// @brief                  Pages of RAM of the emulated machine.
+static constexpr word kRAMPages = 64;
+
+/// @brief                  Pages written over and over, they fit in RAM but not with the
+///                         scanned pages read in between.
+static constexpr word kHotPages = 56;
+
+/// @brief                  Pages read once per pass of a scan, far more than fit in RAM.
+static constexpr word kScanPages = 1024;
+
+/// @brief                  First virtual page of the hot pages, the scanned pages follow.
+static constexpr word kFirstVPage = 0x10;
+
+/**
+ * @brief                   Time a process that writes its hot pages in turn while reading the
+ *                          next page of a scan every few writes, with the given replacement
+ *                          policy picking the pages to evict.
+ *
+ * @return                  Seconds taken.
+ *
+ */
+static double time_paging (int accesses, ReplacementPolicy *policy)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    mmu->set_replacement_policy (policy);
+
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, kFirstVPage, kHotPages + kScanPages, true, false);
+    mmu->set_process (pid);
+
+    const auto start = std::chrono::steady_clock::now ();
+    for (int i = 0; i < accesses; i++)
+    {
+        const word hot = (kFirstVPage + i % kHotPages) << kNumPageOffsetBits;
+        cpu.system_bus->write_word (hot, cpu.system_bus->read_word (hot) + 1);
+        if (i % 4 == 0)
+        {
+            const word scan = (kFirstVPage + kHotPages + (i / 4) % kScanPages)
+                              << kNumPageOffsetBits;
+            cpu.system_bus->read_word (scan);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now ();
+
+    const ReplacementPolicy::Stats &stats = policy->stats ();
+    std::printf ("%-9s: %8llu faults, %8llu evictions, %8llu dirty write-backs, ", policy->name (),
+                 (unsigned long long) stats.faults, (unsigned long long) stats.evictions,
+                 (unsigned long long) stats.dirty_writebacks);
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const int accesses = argc > 1 ? std::atoi (argv[1]) : 1000000;
+
+    for (ReplacementPolicy *policy :
+         {(ReplacementPolicy *) new LRUPolicy (), (ReplacementPolicy *) new ClockPolicy (),
+          (ReplacementPolicy *) new ClockProPolicy ()})
+    {
+        const double seconds = time_paging (accesses, policy);
+        std::printf ("%10.0f accesses/s\n", accesses / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <emulator32bit/emulator32bit.h>
+#include <emulator32bit/system_bus.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+/// @brief                  Pages of RAM of the emulated machine.
+static constexpr word kRAMPages = 64;
+
+/**
+ * @brief                   Store a word in each of a number of pages after the code, then halt.
+ *
+ */
+static void write_program (Emulator32bit &cpu, word dirty_pages)
+{
+    const word program[] = {
+        // mov x1, #dirty_pages; mov x2, #kPageSize
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, dirty_pages),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, kPageSize),
+        // loop: str x1, [x2]; add x2, x2, #kPageSize; subs x1, x1, #1; b.ne loop; hlt
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 1, 2, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 2, 2, kPageSize),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -3),
+        Emulator32bit::asm_hlt (),
+    };
+
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cpu.system_bus->write_word (i * 4, program[i]);
+    }
+    cpu.set_pc (0);
+}
+
+/**
+ * @brief                   Time running the program from a fresh state a number of times, either
+ *                          restoring a snapshot or constructing a new processor each time.
+ *
+ * @return                  Seconds taken.
+ *
+ */
+static double time_resets (int resets, word dirty_pages, bool restore)
+{
+    Emulator32bit::StopReason reason;
+    const auto start = std::chrono::steady_clock::now ();
+    if (restore)
+    {
+        Emulator32bit cpu (kRAMPages, 0, {}, 0, 1);
+        write_program (cpu, dirty_pages);
+        cpu.snapshot ();
+        for (int i = 0; i < resets; i++)
+        {
+            cpu.run_until (0, reason);
+            cpu.restore ();
+        }
+    }
+    else
+    {
+        for (int i = 0; i < resets; i++)
+        {
+            Emulator32bit cpu (kRAMPages, 0, {}, 0, 1);
+            write_program (cpu, dirty_pages);
+            cpu.run_until (0, reason);
+        }
+    }
+    const auto end = std::chrono::steady_clock::now ();
+    return std::chrono::duration<double> (end - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+    const int resets = argc > 1 ? std::atoi (argv[1]) : 100;
+
+    const double construct = time_resets (resets, 1, false);
+    std::printf ("construct:         %10.0f resets/s\n", resets / construct);
+
+    for (word dirty_pages : {1u, 8u, 32u})
+    {
+        const double restore = time_resets (resets, dirty_pages, true);
+        std::printf ("restore %2u pages:  %10.0f resets/s\n", dirty_pages, resets / restore);
+    }
+    return 0;
+}
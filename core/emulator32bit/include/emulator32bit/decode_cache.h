@@ -0,0 +1,145 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit.h"
+
+#include <vector>
+
+///
+/// @brief              Decoded instructions of the RAM pages that have been executed, indexed by
+///                     physical address, grouped into basic blocks.
+///
+/// @details            Pages are allocated the first time a block in them is fetched. A block is
+///                     a run of decoded instructions ending at a branch, software interrupt,
+///                     special instruction or the end of the page. Blocks are spans into the
+///                     page's decoded instructions, so overlapping blocks share their decodes.
+///
+///                     The @ref SystemBus is told which pages hold decoded instructions, a write
+///                     to one of them marks the page stale and bumps @ref epoch. A stale page is
+///                     cleared on its next fetch, so the block being executed stays valid even if
+///                     it overwrites its own page. Clearing it frees its blocks and bumps
+///                     @ref epoch again, so a block from it is never linked to afterwards.
+///
+class DecodeCache
+{
+  public:
+    struct Block;
+
+    ///
+    /// @brief              Cached successor of a block.
+    ///
+    struct Link
+    {
+        /// @brief          Virtual address of the successor.
+        word pc = 0;
+
+        /// @brief          @ref epoch, translation generation and address space the link was
+        ///                 made in.
+        U64 epoch = 0;
+        U64 generation = 0;
+        word asid = 0;
+
+        Block *block = nullptr;
+    };
+
+    struct Block
+    {
+        /// @brief          Decoded instructions of the block.
+        const Emulator32bit::DecodedInstr *instrs = nullptr;
+
+        /// @brief          Number of instructions in the block.
+        word ninstrs = 0;
+
+        /// @brief          Sum of the cycles of the instructions in the block.
+        word cycles = 0;
+
+        /// @brief          Successors chained to this block, most recent in the first slot.
+        Link links[2];
+
+        /// @brief          Host code compiled by the @ref JIT for the first @ref jit_ninstrs
+        ///                 instructions, and the number of times the block ran before that.
+        void (*jit_code) (word *regs, word *pstate) = nullptr;
+        word jit_ninstrs = 0;
+        word hotness = 0;
+    };
+
+    DecodeCache (Emulator32bit *processor);
+    ~DecodeCache ();
+
+    ///
+    /// @brief              Get the block starting at a virtual address.
+    ///
+    /// @details            Follows the links of the previous block first, otherwise translates
+    ///                     the address and looks up (or builds) the block, chaining it to the
+    ///                     previous block.
+    ///
+    /// @param prev         Block executed before, nullptr if none or not fully executed.
+    /// @param pc           Virtual address of the block.
+    /// @return             Block at pc, valid until the next call.
+    ///
+    inline Block *next_block (Block *prev, word pc)
+    {
+        if (LIKELY (prev != nullptr))
+        {
+            const U64 generation = m_system_bus->mmu->generation ();
+            const word asid = m_system_bus->mmu->current_asid ();
+            for (const Link &link : prev->links)
+            {
+                if (LIKELY (link.pc == pc && link.epoch == m_epoch
+                            && link.generation == generation && link.asid == asid))
+                {
+                    return link.block;
+                }
+            }
+        }
+
+        return next_block_slow (prev, pc);
+    }
+
+    ///
+    /// @brief              Counter bumped whenever decoded instructions are invalidated.
+    ///
+    inline U64 epoch () const
+    {
+        return m_epoch;
+    }
+
+    ///
+    /// @brief              Mark the decoded instructions of a physical page as stale.
+    ///
+    /// @param ppage        Physical page that was written to.
+    ///
+    void invalidate_page (word ppage);
+
+    ///
+    /// @brief              Mark every decoded page as stale.
+    ///
+    void invalidate_all ();
+
+  private:
+    static constexpr word kInstrsPerPage = kPageSize / sizeof (word);
+
+    struct DecodedPage
+    {
+        Emulator32bit::DecodedInstr instrs[kInstrsPerPage];
+
+        /// @brief          Block starting at each instruction, nullptr if not built.
+        Block *blocks[kInstrsPerPage] = {};
+
+        bool stale = false;
+    };
+
+    Emulator32bit *m_processor;
+    SystemBus *m_system_bus;
+    word m_lo_page;
+    std::vector<DecodedPage *> m_pages;
+    U64 m_epoch = 0;
+
+    /// @brief              Block of a single instruction fetched from outside of RAM, which is
+    ///                     not cached or chained.
+    Emulator32bit::DecodedInstr m_uncached_instr;
+    Block m_uncached;
+
+    Block *next_block_slow (Block *prev, word pc);
+    Block *fetch_block (word paddr);
+    void clear_page (DecodedPage *page);
+};
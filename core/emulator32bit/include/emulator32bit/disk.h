@@ -51,6 +51,12 @@ class Disk : public BaseMemory
          */
     Disk (File diskfile, word npages, word lo_page);
     Disk ();
+
+    /**
+         * @brief             Construct a disk over the same file with a cache and free page list
+         *                     of its own.
+         */
+    Disk (const Disk &other);
     virtual ~Disk ();
 
     class DiskReadException : public std::exception
@@ -125,6 +131,22 @@ class Disk : public BaseMemory
          */
     virtual void return_pages (word page_lo, word page_hi);
 
+    /**
+         * @brief             Get the free disk pages.
+         *
+         * @return             Free blocks of pages in ascending order, the first element is the
+         *                     first page, and the second the number of pages.
+         */
+    virtual std::vector<std::pair<word, word>> get_free_pages ();
+
+    /**
+         * @brief             Make exactly the given pages free, as returned by
+         *                     @ref get_free_pages.
+         *
+         * @param blocks     Free blocks of pages in ascending order.
+         */
+    virtual void restore_free_pages (const std::vector<std::pair<word, word>> &blocks);
+
     /**
          * @brief             Reads a disk page.
          *
@@ -136,7 +158,15 @@ class Disk : public BaseMemory
          *                     occur.
          * @return             Page data corresponding to the page address.
          */
-    virtual std::vector<byte> read_page (word page);
+    std::vector<byte> read_page (word page);
+
+    /**
+         * @brief             Copies a disk page out of the disk cache.
+         *
+         * @param page         Disk page address to read.
+         * @param data         Destination of the @ref kPageSize bytes of the page.
+         */
+    virtual void read_page (word page, byte *data);
 
     /**
          * @brief             Reads a byte from disk.
@@ -178,7 +208,15 @@ class Disk : public BaseMemory
          * @param exception WriteException if the write fails. TODO: specify what exceptions can
          *                     occur.
          */
-    virtual void write_page (word page, std::vector<byte>);
+    void write_page (word page, std::vector<byte>);
+
+    /**
+         * @brief             Copies a page into the disk cache, marking it dirty.
+         *
+         * @param page         Page address to write to.
+         * @param data         The @ref kPageSize bytes of the page.
+         */
+    virtual void write_page (word page, const byte *data);
 
     /**
          * @brief             Writes a byte to disk.
@@ -288,10 +326,10 @@ class Disk : public BaseMemory
          *                     Fetches the corresponding cache page of the disk page requested,
          *                     evicting a page from cache to make room when necessary.
          *
-         * @param addr        Address to fetch the page of.
+         * @param page        Disk page to fetch.
          * @return             Reference to the cache page.
          */
-    CachePage &get_cpage (word addr);
+    CachePage &get_cpage (word page);
 
     /**
          * @brief             Writes a cache page to disk.
@@ -333,13 +371,15 @@ class MockDisk : public Disk
     void return_page (word page) override;
     void return_all_pages () override;
     void return_pages (word p_addr_lo, word p_addr_hi) override;
+    std::vector<std::pair<word, word>> get_free_pages () override;
+    void restore_free_pages (const std::vector<std::pair<word, word>> &blocks) override;
 
-    std::vector<byte> read_page (word page) override;
+    void read_page (word page, byte *data) override;
     byte read_byte (word address) override;
     hword read_hword (word addressn) override;
     word read_word (word address) override;
 
-    void write_page (word page, std::vector<byte>) override;
+    void write_page (word page, const byte *data) override;
     void write_byte (word address, byte data) override;
     void write_hword (word address, hword data) override;
     void write_word (word address, word data) override;
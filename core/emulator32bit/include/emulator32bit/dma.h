@@ -0,0 +1,147 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit_util.h"
+#include "emulator32bit/mmio.h"
+
+#include <deque>
+#include <functional>
+
+class SystemBus;
+
+/**
+ * @brief           Moves whole pages between physical memory and the @ref Disk.
+ *
+ * @details         A transfer is described by a @ref Descriptor. Pages backed by RAM or ROM are
+ *                  copied straight between their host memory and the disk cache, other pages go
+ *                  through @ref SystemBus::read_physical_block and
+ *                  @ref SystemBus::write_physical_block. Writes to memory invalidate the decoded
+ *                  instructions they overwrite and every page charges the @ref Timer
+ *                  @ref Timer::kDiskPageCycles.
+ *
+ *                  The MMU paging path calls @ref transfer directly. Drivers queue descriptors
+ *                  with @ref submit and start them with @ref run, guests through a
+ *                  @ref DMADevice. The completion handler is called on the host after every
+ *                  descriptor, nothing interrupts the guest.
+ */
+class DMAController
+{
+  public:
+    enum class Direction : U8
+    {
+        DISK_TO_MEMORY,
+        MEMORY_TO_DISK,
+    };
+
+    struct Descriptor
+    {
+        Direction direction;
+
+        /// @brief      Physical address of the first memory page, page aligned.
+        word paddr;
+
+        /// @brief      First disk page.
+        word disk_page;
+
+        /// @brief      Number of consecutive pages.
+        word npages;
+    };
+
+    using CompletionHandler = std::function<void (const Descriptor &descriptor)>;
+
+    DMAController (SystemBus *bus);
+
+    /**
+     * @brief       Copy the pages of a descriptor now, without queueing it or signalling its
+     *              completion.
+     *
+     * @throws      SystemBus::Exception if the address is not page aligned.
+     */
+    void transfer (const Descriptor &descriptor);
+
+    /**
+     * @brief       Queue a descriptor until the next @ref run.
+     *
+     * @throws      SystemBus::Exception if the address is not page aligned.
+     */
+    void submit (const Descriptor &descriptor);
+
+    /**
+     * @brief       Transfer every queued descriptor in order, signalling each completion.
+     */
+    void run ();
+
+    inline size_t pending () const
+    {
+        return m_queue.size ();
+    }
+
+    /**
+     * @brief       Number of descriptors completed by @ref run since construction.
+     */
+    inline U64 completed () const
+    {
+        return m_completed;
+    }
+
+    inline void set_completion_handler (CompletionHandler handler)
+    {
+        m_on_complete = handler;
+    }
+
+    static inline bool is_aligned (const Descriptor &descriptor)
+    {
+        return (descriptor.paddr & (kPageSize - 1)) == 0;
+    }
+
+  private:
+    SystemBus *m_bus;
+    std::deque<Descriptor> m_queue;
+    U64 m_completed = 0;
+    CompletionHandler m_on_complete;
+};
+
+/**
+ * @brief           Registers of the @ref SystemBus::dma controller for guest drivers.
+ *
+ * @details         A driver fills in @ref kAddressRegister, @ref kDiskPageRegister and
+ *                  @ref kPageCountRegister, then writes @ref kControlRegister to queue the
+ *                  descriptor and run the queue. Bit @ref kControlToDisk of the control value
+ *                  selects a transfer from memory to disk. The transfer completes before the next
+ *                  instruction. @ref kStatusRegister counts the completions not yet acknowledged,
+ *                  writing it acknowledges them.
+ *
+ *                  There is no completion interrupt, drivers poll @ref kStatusRegister. A
+ *                  descriptor whose address is not page aligned is dropped and sets
+ *                  @ref kStatusError until the status is acknowledged.
+ */
+class DMADevice : public MMIODevice
+{
+  public:
+    static constexpr word kAddressRegister = 0;
+    static constexpr word kDiskPageRegister = 4;
+    static constexpr word kPageCountRegister = 8;
+    static constexpr word kControlRegister = 12;
+    static constexpr word kStatusRegister = 16;
+
+    static constexpr word kControlToDisk = 1;
+
+    static constexpr word kStatusError = 1U << 31;
+
+    /**
+     * @brief       Map the registers over one page. Takes over the completion handler of the
+     *              controller.
+     *
+     * @param start_page Physical page of the registers.
+     * @param dma   Controller started by the registers.
+     */
+    DMADevice (word start_page, DMAController *dma);
+
+    word read_register (word offset) override;
+    void write_register (word offset, word value) override;
+
+  private:
+    DMAController *m_dma;
+    DMAController::Descriptor m_descriptor = {};
+    word m_unacknowledged = 0;
+    bool m_error = false;
+};
@@ -5,12 +5,17 @@
 #include "emulator32bit/memory.h"
 #include "emulator32bit/system_bus.h"
 
+#include <atomic>
 #include <string>
+#include <unordered_set>
 
 // TODO: I think we can get rid of these forward declarations. They should not
 // need to know about this emulator class.
 class MMU;
 class Timer;
+class DecodeCache;
+class JIT;
+class TraceBuffer;
 
 ///
 /// @brief              32 bit Emulator
@@ -36,12 +41,63 @@ class Emulator32bit
     ///                     @ref ROM_NPAGES.
     static constexpr byte ROM_DATA[ROM_NPAGES << kNumPageOffsetBits] = {};
 
+    ///
+    /// @brief              How guest instructions are executed.
+    ///
+    enum class Backend : U8
+    {
+        /// @brief          Interpret decoded instructions.
+        INTERPRETER,
+
+        /// @brief          Compile hot blocks to host code, falls back to the interpreter if the
+        ///                 host is not supported. See @ref JIT.
+        JIT,
+    };
+
+    ///
+    /// @brief              How virtual addresses are translated.
+    ///
+    enum class Paging : U8
+    {
+        /// @brief          Processes and their page tables are kept by the host, see
+        ///                 @ref VirtualMemory.
+        VIRTUAL_MEMORY,
+
+        /// @brief          Page tables are kept in guest RAM and walked through @ref pagedir, see
+        ///                 @ref MMU. The first RAM page is left to the guest, a quarter of the
+        ///                 rest holds the tables and the other pages are given to virtual pages.
+        PAGE_TABLE_WALK,
+    };
+
     Emulator32bit ();
     Emulator32bit (word ram_npages, word ram_start_page, const byte rom_data[], word rom_npages,
-                   word rom_start_page);
-    Emulator32bit (RAM *ram, ROM *rom, Disk *disk);
+                   word rom_start_page, Backend backend = Backend::INTERPRETER);
+    Emulator32bit (RAM *ram, ROM *rom, Disk *disk, Backend backend = Backend::INTERPRETER,
+                   Paging paging = Paging::VIRTUAL_MEMORY);
+
+    ///
+    /// @brief              Create one core of a multi-core system, see
+    ///                     @ref SystemBus::SystemBus(SystemBus *).
+    ///
+    /// @param shared_bus   Bus owning the memories shared by every core.
+    /// @param core_id      Number of the core, read by the core system register.
+    ///
+    Emulator32bit (SystemBus *shared_bus, word core_id, Backend backend = Backend::INTERPRETER);
     ~Emulator32bit ();
 
+    ///
+    /// @brief              Number of executions before the @ref Backend::JIT backend compiles a
+    ///                     block, 0 to compile blocks the first time they execute, see
+    ///                     @ref JIT::set_hot_threshold. Ignored when interpreting.
+    ///
+    void set_jit_threshold (word executions);
+
+    ///
+    /// @brief              Bytes of code buffer the @ref Backend::JIT backend uses before starting
+    ///                     over, see @ref JIT::set_code_buffer_size. Ignored when interpreting.
+    ///
+    void set_jit_code_buffer_size (word bytes);
+
     enum class Register : U8
     {
         X0 = 0,
@@ -112,6 +168,10 @@ class Emulator32bit
     static constexpr U8 kNumReg = 32;
     static_assert (static_cast<U8> (Register::XZR) + 1 == kNumReg);
 
+    /// @brief              Register slot that writes to xzr are redirected to by @ref decode, so
+    ///                     xzr itself always reads as zero.
+    static constexpr U8 kDiscardReg = kNumReg;
+
     static constexpr inline U8 register_to_U8 (Register reg)
     {
         return static_cast<U8> (reg);
@@ -245,23 +305,217 @@ class Emulator32bit
         ADDR_POST_INC
     };
 
+    struct DecodedInstr;
+    using DecodedHandler = void (Emulator32bit::*) (const DecodedInstr &);
+
+    /// @brief              Bit of @ref DecodedInstr::flags holding the instruction's S bit. Set
+    ///                     flags for data processing instructions, sign extend for loads/stores.
+    static constexpr U8 kDecodedUpdateFlagBit = 0;
+    static constexpr U8 kDecodedSignBit = 0;
+
+    /// @brief              Bit of @ref DecodedInstr::flags set when the operand is an immediate.
+    static constexpr U8 kDecodedImmBit = 1;
+
+    ///
+    /// @brief              Instruction with its operand fields already extracted.
+    ///
+    /// @details            Built once by @ref decode and kept in the @ref DecodeCache so the run
+    ///                     loop does not redo the bitfield extraction every time it executes the
+    ///                     same word. Which fields are meaningful depends on the instruction
+    ///                     format.
+    ///
+    struct DecodedInstr
+    {
+        /// @brief          Handler executing the instruction, nullptr if not decoded yet.
+        DecodedHandler handler = nullptr;
+
+        /// @brief          Raw instruction word.
+        word raw = 0;
+
+        /// @brief          Immediate operand, already sign extended or shifted into place.
+        word imm = 0;
+
+        /// @brief          Destination register (xt for loads/stores, xlo for long multiplies).
+        ///                 @ref kDiscardReg if the instruction writes to xzr.
+        U8 xd = 0;
+
+        /// @brief          First operand register (base register for loads/stores).
+        U8 xn = 0;
+
+        /// @brief          Second operand register.
+        U8 xm = 0;
+
+        /// @brief          Additional destination register (xhi for long multiplies), redirected
+        ///                 like @ref xd.
+        U8 xa = 0;
+
+        /// @brief          Cycles the instruction takes, see @ref Timer::instruction_cycles.
+        U8 cycles = 0;
+
+        /// @brief          Shift type and amount applied to the value of @ref xm.
+        U8 shift = 0;
+        U8 shift_amt = 0;
+
+        union
+        {
+            /// @brief      Condition code for branches and software interrupts.
+            U8 cond = 0;
+
+            /// @brief      Address mode for loads and stores.
+            U8 addr_mode;
+        };
+
+        /// @brief          Decoded S bit and immediate bit, see @ref kDecodedUpdateFlagBit.
+        U8 flags = 0;
+
+        /// @brief          Handler executing this and the next instruction as one, nullptr if
+        ///                 the pair is not fused. See @ref fuse.
+        DecodedHandler fused = nullptr;
+    };
+
     SystemBus *const system_bus = nullptr;
 
+    /// @brief              Cycle clock advanced by @ref run_until, see @ref Timer.
     Timer *const timer = nullptr;
 
     /// @brief              Pointer to the page directory for the virtual address space of the
-    ///                     process.
-    word pagedir;
+    ///                     process, 0 for none.
+    word pagedir = 0;
 
     ///
-    /// @brief                  Run the emulator for a given number of instructions.
+    /// @brief              Why @ref run_until returned.
+    ///
+    enum class RunStatus : U8
+    {
+        /// @brief          Reached a HLT instruction, the pc points at it.
+        HALTED,
+
+        /// @brief          Executed the whole instruction budget.
+        BUDGET_EXHAUSTED,
+
+        /// @brief          An instruction raised an exception, the pc points at it.
+        FAULT,
+
+        /// @brief          Reached a breakpoint, the instruction at the pc has not executed.
+        BREAKPOINT,
+
+        /// @brief          The program made the emu_exit system call.
+        EXIT,
+
+        /// @brief          The @ref Timer expired and was acknowledged.
+        TIMER,
+
+        /// @brief          Another core sent an inter-processor interrupt, see @ref raise_ipi.
+        IPI,
+    };
+
+    ///
+    /// @brief              Details of why @ref run_until returned.
+    ///
+    struct StopReason
+    {
+        RunStatus status = RunStatus::BUDGET_EXHAUSTED;
+
+        /// @brief          Number of instructions executed by the call.
+        U64 instructions = 0;
+
+        /// @brief          Code passed to emu_exit, for @ref RunStatus::EXIT.
+        word exit_code = 0;
+
+        /// @brief          Message of the exception, for @ref RunStatus::FAULT.
+        std::string fault;
+
+        /// @brief          Interrupts received, for @ref RunStatus::IPI.
+        word ipi = 0;
+    };
+
+    ///
+    /// @brief                  Run the emulator until it stops or executes a number of
+    ///                         instructions.
+    ///
+    /// @details                The @ref timer is advanced by the cycles of the instructions run,
+    ///                         and checked for expiry after every block.
+    ///
+    ///                         Halting, breakpoints, exit and the budget stop the run loop without
+    ///                         unwinding, and nothing is printed, so it is cheap to call in short
+    ///                         time slices. Faults are still raised as exceptions by the
+    ///                         instruction and caught here.
+    ///
+    /// @param budget           Maximum number of instructions to run, 0 for no limit.
+    /// @param reason           Filled with why the run stopped.
+    /// @return                 reason.status.
+    ///
+    RunStatus run_until (U64 budget, StopReason &reason);
+
+    ///
+    /// @brief                  Run the emulator for a given number of instructions, printing why
+    ///                         it stopped.
     ///
     /// @param instructions     Number of instructions to run, if 0 run until HLT instruction or
     ///                         exception is thrown.
-    /// @throws                 Exception
     ///
     void run (U64 instructions);
 
+    ///
+    /// @brief                  Same as @ref run, also recording every executed instruction.
+    ///
+    /// @details                Instructions are executed one at a time, without fused pairs or
+    ///                         the JIT, so each one gets its own record.
+    ///
+    /// @param instructions     Number of instructions to run, if 0 run until HLT instruction or
+    ///                         exception is thrown.
+    /// @param trace            Ring buffer the records are written to.
+    ///
+    void run (U64 instructions, TraceBuffer &trace);
+
+    ///
+    /// @brief                  Same as @ref run_until, but dispatches with computed gotos: each
+    ///                         handler jumps straight to the handler of the next instruction
+    ///                         instead of returning to a loop that calls through
+    ///                         @ref m_instruction_handler.
+    ///
+    /// @details                Always interprets, even with the @ref Backend::JIT backend, and
+    ///                         does not stop at breakpoints, advance the @ref timer or check for
+    ///                         interrupts, so it only returns @ref RunStatus::HALTED,
+    ///                         @ref RunStatus::EXIT, @ref RunStatus::FAULT or
+    ///                         @ref RunStatus::BUDGET_EXHAUSTED. Falls back to @ref run_until on
+    ///                         compilers without labels as values.
+    ///
+    /// @param instructions     Maximum number of instructions to run, 0 for no limit.
+    /// @param reason           Filled with why the run stopped.
+    /// @return                 reason.status.
+    ///
+    RunStatus run_threaded (U64 instructions, StopReason &reason);
+
+    ///
+    /// @brief              Stop @ref run_until before executing the instruction at a virtual
+    ///                     address. The instruction a run starts at is executed even if it has a
+    ///                     breakpoint, so a run stopped at a breakpoint can be resumed.
+    ///
+    /// @param addr         Virtual address of the instruction.
+    ///
+    void add_breakpoint (word addr);
+
+    void remove_breakpoint (word addr);
+    void clear_breakpoints ();
+
+    ///
+    /// @brief              Send inter-processor interrupts to this core. Safe to call from any
+    ///                     thread, @ref run_until returns @ref RunStatus::IPI at the end of its
+    ///                     current block and the interrupts are cleared.
+    ///
+    /// @param bits         Interrupts to raise, or-ed into the pending ones.
+    ///
+    inline void raise_ipi (word bits)
+    {
+        m_pending_ipi.fetch_or (bits, std::memory_order_release);
+    }
+
+    inline word get_core_id () const
+    {
+        return m_core_id;
+    }
+
     void print ();
 
     ///
@@ -270,6 +524,49 @@ class Emulator32bit
     ///
     void reset ();
 
+    ///
+    /// @brief              Save the registers, pstate, timer, the mappings of @ref VirtualMemory
+    ///                     and RAM so @ref restore can return to them, replacing the previous
+    ///                     snapshot.
+    ///
+    /// @details            RAM is copy on write per page, see @ref SystemBus::snapshot_memory, so
+    ///                     taking a snapshot copies no memory and restoring one copies back only
+    ///                     the pages written since. Devices and the disk are not saved.
+    ///
+    /// @throws             SystemBus::Exception for a core of a @ref Multicore, and with
+    ///                     @ref Paging::PAGE_TABLE_WALK since the page tables in RAM and the
+    ///                     state of their MMU are not saved.
+    ///
+    void snapshot ();
+
+    ///
+    /// @brief              Return to the last @ref snapshot, which is kept for the next restore.
+    ///                     Breakpoints are left as they are.
+    ///
+    void restore ();
+
+    inline bool has_snapshot () const
+    {
+        return m_snapshot != nullptr;
+    }
+
+    ///
+    /// @brief              Registers of a guest program, to switch between programs sharing the
+    ///                     processor.
+    ///
+    struct Context
+    {
+        word x[kNumReg];
+        word pc;
+        word pstate;
+    };
+
+    /// @brief              Copy the registers, pc and pstate.
+    Context save_context ();
+
+    /// @brief              Continue from registers saved by @ref save_context.
+    void load_context (const Context &context);
+
     inline void set_pc (word pc)
     {
         m_pc = pc;
@@ -282,34 +579,31 @@ class Emulator32bit
 
     inline word read_reg (Register reg)
     {
-        const U8 r = register_to_U8 (reg);
-        // The lower 32 bits is the register mask, upper 32 bits contains the value.
-        return word (m_x[r]) & word (m_x[r] >> 32);
+        return m_x[register_to_U8 (reg)];
     }
 
     inline word read_reg (U8 reg)
     {
         if (LIKELY (reg < kNumReg))
         {
-            // The lower 32 bits is the register mask, upper 32 bits contains the value.
-            return word (m_x[reg]) & word (m_x[reg] >> 32);
+            return m_x[reg];
         }
         return 0;
     }
 
     inline void write_reg (Register reg, word val)
     {
-        const U8 r = register_to_U8 (reg);
-        // The lower 32 bits is the register mask, upper 32 bits contains the value.
-        m_x[r] = word (m_x[r]) ^ dword (val) << 32;
+        if (LIKELY (reg != Register::XZR))
+        {
+            m_x[register_to_U8 (reg)] = val;
+        }
     }
 
     inline void write_reg (U8 reg, word val)
     {
-        if (LIKELY (reg < kNumReg))
+        if (LIKELY (reg < register_to_U8 (Register::XZR)))
         {
-            // The lower 32 bits is the register mask, upper 32 bits contains the value.
-            m_x[reg] = word (m_x[reg]) ^ dword (val) << 32;
+            m_x[reg] = val;
         }
     }
 
@@ -323,6 +617,7 @@ class Emulator32bit
     ///
     inline void set_NZCV (bool N, bool Z, bool C, bool V)
     {
+        m_flag_op = FlagOp::NONE;
         m_pstate = set_bit (m_pstate, kNFlagBit, N);
         m_pstate = set_bit (m_pstate, kZFlagBit, Z);
         m_pstate = set_bit (m_pstate, kCFlagBit, C);
@@ -337,14 +632,55 @@ class Emulator32bit
     ///
     inline void set_flag (U8 flag, bool value)
     {
-        m_pstate = set_bit (m_pstate, flag, value);
+        if (flag <= kVFlagBit)
+        {
+            materialize_flags ();
+            m_pstate = set_bit (m_pstate, flag, value);
+            return;
+        }
+        write_pstate (set_bit (m_pstate, flag, value));
     }
 
     inline bool get_flag (U8 flag)
     {
+        if (flag <= kVFlagBit)
+        {
+            materialize_flags ();
+        }
         return test_bit (m_pstate, flag);
     }
 
+    ///
+    /// @brief              Get the process state register with up to date NZCV flags.
+    ///
+    inline word get_pstate ()
+    {
+        materialize_flags ();
+        return m_pstate;
+    }
+
+    ///
+    /// @brief              Extracts the operand fields of an instruction and resolves its handler.
+    ///
+    /// @param raw          Instruction word.
+    /// @param instr        Decoded instruction to fill out.
+    ///
+    void decode (word raw, DecodedInstr &instr);
+
+    ///
+    /// @brief              Fuses a pair of adjacent decoded instructions if it is a common one,
+    ///                     such as a compare followed by a conditional branch.
+    ///
+    /// @details            The fused handler runs both instructions back to back, advancing the
+    ///                     pc in between, so flags and the pc on a fault are the same as if they
+    ///                     were executed one at a time. The second instruction keeps its own
+    ///                     decode for blocks that start at it.
+    ///
+    /// @param first        Decoded instruction, @ref DecodedInstr::fused is set or cleared.
+    /// @param second       Decoded instruction right after it in memory.
+    ///
+    void fuse (DecodedInstr &first, const DecodedInstr &second);
+
     /// @todo               TODO: determine if fp registers are needed
     // word fpcr;
     // word fpsr;
@@ -353,27 +689,220 @@ class Emulator32bit
     ///
     /// @brief              General purpose registers, x0-x29, xzr, and SP. x29 is the link register.
     ///
-    ///                     Format: top 32 bits register value, bottom 32 bits mask value (for xzr
-    ///                     register)
+    ///                     The xzr slot is never written and stays zero. The extra slot at
+    ///                     @ref kDiscardReg absorbs writes to xzr from decoded instructions.
     ///
-    dword m_x[kNumReg];
+    word m_x[kNumReg + 1];
 
     /// @brief              Program counter.
     word m_pc;
 
     /// @brief              Program state. Bits 0-3 are NZCV flags. Rest are TODO
+    ///
+    ///                     The NZCV bits are stale while @ref m_flag_op is not NONE, read them
+    ///                     through @ref get_flag, @ref get_pstate or @ref check_cond.
     word m_pstate;
 
-    using InstructionFunction = void (Emulator32bit::*) (word);
-    InstructionFunction m_instruction_handler[kMaxInstructions];
+    ///
+    /// @brief              Last flag setting operation whose NZCV flags have not been computed.
+    ///
+    /// @details            Flags are mostly overwritten before a condition reads them, so flag
+    ///                     setting instructions only record their operands and result. ADD and SUB
+    ///                     produce all four flags, LOGIC only N and Z, keeping C and V.
+    ///
+    enum class FlagOp : U8
+    {
+        NONE,
+        ADD,
+        SUB,
+        LOGIC,
+    };
+
+    FlagOp m_flag_op = FlagOp::NONE;
+    word m_flag_op1 = 0;
+    word m_flag_op2 = 0;
+    word m_flag_res = 0;
+
+    DecodedHandler m_instruction_handler[kMaxInstructions];
+
+    /// @brief              Decoded instructions of the physical pages executed so far.
+    DecodeCache *m_decode_cache = nullptr;
+
+    /// @brief              Compiler of hot blocks, nullptr when interpreting only.
+    JIT *m_jit = nullptr;
+
+    /// @brief              Set by an instruction that stops the run loop, checked at the end of
+    ///                     each block. Such instructions always end their block.
+    bool m_stop = false;
+    RunStatus m_stop_status = RunStatus::HALTED;
+    word m_exit_code = 0;
+
+    /// @brief              Addresses of the breakpoints, see @ref add_breakpoint.
+    std::unordered_set<word> m_breakpoints;
+
+    /// @brief              Number of the core in a multi-core system, 0 otherwise.
+    word m_core_id = 0;
+
+    /// @brief              Interrupts raised by @ref raise_ipi, not yet reported by the run loop.
+    std::atomic<word> m_pending_ipi = 0;
+
+    /// @brief              State saved by @ref snapshot, nullptr before the first one.
+    struct Snapshot;
+    Snapshot *m_snapshot = nullptr;
+
+    friend class JIT;
 
     void fill_out_instructions ();
 
+    ///
+    /// @brief              Run loop shared by @ref run with a compile time trace policy, see
+    ///                     @ref NoTrace and @ref TraceBuffer.
+    ///
+    template <typename Trace>
+    RunStatus run_blocks (U64 instructions, Trace &trace, StopReason &reason);
+
+    ///
+    /// @brief              Number of instructions of a block that can run before reaching a
+    ///                     breakpoint.
+    ///
+    /// @param pc           Address of the block.
+    /// @param ninstrs      Number of instructions about to run.
+    /// @param resume       Whether the first instruction is where the run started.
+    ///
+    word instrs_before_breakpoint (word pc, word ninstrs, bool resume) const;
+
+    ///
+    /// @brief              Address a load or store is about to access, 0 for other
+    ///                     instructions. Has no side effects, unlike @ref calc_mem_addr.
+    ///
+    word trace_mem_addr (const DecodedInstr &instr);
+
     word calc_mem_addr (word xn, sword offset, U8 addr_mode);
 
-    inline void execute (word instr)
+    ///
+    /// @brief              Access a register of a @ref DecodedInstr. Destinations were already
+    ///                     redirected away from xzr by @ref decode, so unlike @ref read_reg and
+    ///                     @ref write_reg these are plain loads and stores.
+    ///
+    inline word get_reg (U8 reg) const
+    {
+        return m_x[reg];
+    }
+
+    inline void set_reg (U8 reg, word val)
+    {
+        m_x[reg] = val;
+    }
+
+    inline void execute (const DecodedInstr &instr)
     {
-        (this->*m_instruction_handler[bitfield_unsigned (instr, 26, 6)]) (instr);
+        (this->*instr.handler) (instr);
+    }
+
+    inline void set_flags_add (word op1, word op2, word res)
+    {
+        m_flag_op = FlagOp::ADD;
+        m_flag_op1 = op1;
+        m_flag_op2 = op2;
+        m_flag_res = res;
+    }
+
+    inline void set_flags_sub (word op1, word op2, word res)
+    {
+        m_flag_op = FlagOp::SUB;
+        m_flag_op1 = op1;
+        m_flag_op2 = op2;
+        m_flag_res = res;
+    }
+
+    inline void set_flags_logic (word res)
+    {
+        /* C and V are kept, so they have to be computed for the previous operation */
+        materialize_flags ();
+        m_flag_op = FlagOp::LOGIC;
+        m_flag_res = res;
+    }
+
+    ///
+    /// @brief              Set @ref m_pstate, dropping the translations cached by the bus if the
+    ///                     user or real mode flag changes, since they were checked in the old
+    ///                     mode.
+    ///
+    void write_pstate (word pstate);
+
+    ///
+    /// @brief              Compute the NZCV flags of @ref m_flag_op into @ref m_pstate.
+    ///
+    /// @details            Carry of a subtraction is the borrow, same as get_c_flag_sub.
+    ///
+    inline void materialize_flags ()
+    {
+        if (LIKELY (m_flag_op == FlagOp::NONE))
+        {
+            return;
+        }
+
+        const word op1 = m_flag_op1;
+        const word op2 = m_flag_op2;
+        const word res = m_flag_res;
+        word nzcv = (res >> 31) << kNFlagBit | word (res == 0) << kZFlagBit;
+        switch (m_flag_op)
+        {
+        case FlagOp::ADD:
+            nzcv |= word (res < op1) << kCFlagBit;
+            nzcv |= ((~(op1 ^ op2) & (op1 ^ res)) >> 31) << kVFlagBit;
+            break;
+        case FlagOp::SUB:
+            nzcv |= word (op1 < op2) << kCFlagBit;
+            nzcv |= (((op1 ^ op2) & (op1 ^ res)) >> 31) << kVFlagBit;
+            break;
+        case FlagOp::LOGIC:
+            nzcv |= m_pstate & (1U << kCFlagBit | 1U << kVFlagBit);
+            break;
+        case FlagOp::NONE:
+            break;
+        }
+
+        m_pstate = (m_pstate & ~word (0b1111)) | nzcv;
+        m_flag_op = FlagOp::NONE;
+    }
+
+    ///
+    /// @brief              Evaluate a condition code against the current flags. Conditions after
+    ///                     a compare are answered from its operands without computing the flags.
+    ///
+    inline bool check_cond (U8 cond)
+    {
+        if (m_flag_op == FlagOp::SUB)
+        {
+            const word op1 = m_flag_op1;
+            const word op2 = m_flag_op2;
+            switch (static_cast<ConditionCode> (cond))
+            {
+            case ConditionCode::EQ:
+                return op1 == op2;
+            case ConditionCode::NE:
+                return op1 != op2;
+            case ConditionCode::CS:
+            case ConditionCode::HI:
+                return op1 < op2;
+            case ConditionCode::CC:
+            case ConditionCode::LS:
+                return op1 >= op2;
+            case ConditionCode::GE:
+                return sword (op1) >= sword (op2);
+            case ConditionCode::LT:
+                return sword (op1) < sword (op2);
+            case ConditionCode::GT:
+                return sword (op1) > sword (op2);
+            case ConditionCode::LE:
+                return sword (op1) <= sword (op2);
+            default:
+                break;
+            }
+        }
+
+        return check_cond (get_pstate (), cond);
     }
 
     inline bool check_cond (word pstate, U8 cond)
@@ -424,9 +953,16 @@ class Emulator32bit
         return false;
     }
 
+    ///
+    /// @brief              Handler of a fused pair, the second instruction is the one following
+    ///                     instr in memory.
+    ///
+    template <DecodedHandler first, DecodedHandler second>
+    void _fused (const DecodedInstr &instr);
+
 #define _INSTR(func_name, opcode)                                                                  \
   private:                                                                                         \
-    void _##func_name (word instr);                                                                \
+    void _##func_name (const DecodedInstr &instr);                                                 \
                                                                                                    \
   public:                                                                                          \
     static constexpr word _op_##func_name = opcode;
@@ -434,16 +970,17 @@ class Emulator32bit
     // Instruction handling.
     _INSTR (special_instructions, 0b000000)
 
-    void _hlt (const word instr);
-    void _nop (const word instr);
-    void _msr (const word instr);
-    void _mrs (const word instr);
-    void _tlbi (const word instr);
-    void _atomic (const word instr);
-    void _swp (const word instr);
-    void _ldadd (const word instr);
-    void _ldclr (const word instr);
-    void _ldset (const word instr);
+    void _undefined (const DecodedInstr &instr);
+    void _hlt (const DecodedInstr &instr);
+    void _nop (const DecodedInstr &instr);
+    void _msr (const DecodedInstr &instr);
+    void _mrs (const DecodedInstr &instr);
+    void _tlbi (const DecodedInstr &instr);
+    void _atomic (const DecodedInstr &instr);
+    void _swp (const DecodedInstr &instr);
+    void _ldadd (const DecodedInstr &instr);
+    void _ldclr (const DecodedInstr &instr);
+    void _ldset (const DecodedInstr &instr);
 
     _INSTR (add, 0b000001)
     _INSTR (sub, 0b000010)
@@ -528,6 +1065,7 @@ class Emulator32bit
     void _emu_assertp (U8 p_state_id, bool expected_value);
     void _emu_log (word str);
     void _emu_err (word err);
+    void _emu_exit (word code);
 
   public:
     // Helpers to assemble instructions.
@@ -562,6 +1100,10 @@ class Emulator32bit
     static constexpr word kSpecialOpId_tlbi = 0b0011;
     static constexpr word kSpecialOpId_atomic = 0b0100;
 
+    /* operand of tlbi without a register, which translations to drop */
+    static constexpr word kTLBIAll = 0;
+    static constexpr word kTLBIProcess = 1;
+
     static constexpr word kAtomicId_swp = 0b0000;
     static constexpr word kAtomicId_ldadd = 0b0001;
     static constexpr word kAtomicId_ldclr = 0b0010;
@@ -572,4 +1114,5 @@ class Emulator32bit
     static constexpr word kAtomicWidth_hword = 0b10;
 
     static constexpr word kSysregId_pstate = 1;
+    static constexpr word kSysregId_core = 2;
 };
@@ -28,6 +28,13 @@ class FreeBlockList
      */
     FreeBlockList (word begin, word len, bool init = true);
 
+    /**
+     * @brief             Construct a copy of another list with blocks of its own.
+     *
+     * @param other        List to copy.
+     */
+    FreeBlockList (const FreeBlockList &other);
+
     /**
      * @brief             Destroy the Free Block List object and cleans up resources used.
      */
@@ -115,6 +122,13 @@ class FreeBlockList
      */
     std::vector<std::pair<word, word>> get_blocks ();
 
+    /**
+     * @brief             Make the list hold exactly the given free blocks.
+     *
+     * @param blocks    Free blocks in ascending order, as returned by @ref get_blocks.
+     */
+    void restore_blocks (const std::vector<std::pair<word, word>> &blocks);
+
     /**
      * @brief            Prints all free blocks in the list.
      */
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "emulator32bit/decode_cache.h"
+#include "emulator32bit/emulator32bit.h"
+
+#include <algorithm>
+#include <vector>
+
+///
+/// @brief              Dynamic binary translator from guest basic blocks to host x86-64 code.
+///
+/// @details            Once a block has been executed @ref hot_threshold times, the longest
+///                     prefix of it made of register-only data processing instructions is
+///                     compiled. The guest registers it uses more than once are loaded into
+///                     callee saved host registers on entry and written back on exit, the others
+///                     are loaded from and stored to @ref Emulator32bit::m_x per instruction.
+///                     Guest NZCV flags are taken from the host flags of the equivalent x86
+///                     instruction. Flags overwritten later in the same prefix are not written
+///                     back.
+///
+///                     The code buffer is never writable and executable at once, pages are made
+///                     writable only while a block is copied into them.
+///
+///                     Compiled code cannot fault, so the interpreter runs the rest of the block
+///                     (memory accesses, branches, software interrupts, atomics) with the pc
+///                     already advanced past the compiled prefix.
+///
+///                     Only available on x86-64 Linux, see @ref supported.
+///
+class JIT
+{
+  public:
+    /// @brief              Default number of executions before a block is compiled.
+    static constexpr word kHotThreshold = 16;
+
+    /// @brief              Size of the executable code buffer in bytes.
+    static constexpr word kCodeBufferSize = 16 << 20;
+
+    JIT (Emulator32bit *processor);
+    ~JIT ();
+
+    ///
+    /// @brief              Whether the host can run compiled code.
+    ///
+    static bool supported ();
+
+    ///
+    /// @brief              Number of executions before a block is compiled, 0 to compile blocks
+    ///                     the first time they execute. Blocks that already reached the previous
+    ///                     threshold without being compiled are not compiled.
+    ///
+    inline void set_hot_threshold (word executions)
+    {
+        m_hot_threshold = executions;
+    }
+
+    ///
+    /// @brief              Only use the first bytes of the code buffer, at most
+    ///                     @ref kCodeBufferSize. Compiling a block that does not fit in the rest
+    ///                     starts over from the beginning of the buffer.
+    ///
+    inline void set_code_buffer_size (word bytes)
+    {
+        m_code_size = std::min (bytes, kCodeBufferSize);
+    }
+
+    ///
+    /// @brief              Run the compiled prefix of a block, compiling it if it became hot.
+    ///
+    /// @param block        Block about to be executed from its first instruction.
+    /// @param budget       Maximum number of instructions to execute, the compiled prefix only
+    ///                     runs if it fits.
+    /// @return             Number of instructions executed, 0 if the block has no compiled code.
+    ///
+    inline word run (DecodeCache::Block *block, word budget)
+    {
+        if (LIKELY (block->jit_code != nullptr))
+        {
+            if (UNLIKELY (block->jit_ninstrs > budget))
+            {
+                return 0;
+            }
+
+            /* compiled code reads and writes the flags in m_pstate */
+            m_processor->materialize_flags ();
+            block->jit_code (m_processor->m_x, &m_processor->m_pstate);
+            return block->jit_ninstrs;
+        }
+
+        if (block->hotness <= m_hot_threshold && ++block->hotness > m_hot_threshold)
+        {
+            compile (block);
+            return run (block, budget);
+        }
+
+        return 0;
+    }
+
+  private:
+    Emulator32bit *m_processor;
+    word m_hot_threshold = kHotThreshold;
+
+    /// @brief              Executable code buffer and the amount of it in use.
+    byte *m_code = nullptr;
+    word m_code_used = 0;
+    word m_code_size = kCodeBufferSize;
+
+    /// @brief              Code of the block being compiled.
+    std::vector<byte> m_emit;
+
+    /// @brief              Host register holding each guest register in the block being compiled,
+    ///                     @ref kNotCached for the ones read and written in @ref m_processor.
+    U8 m_host_reg[Emulator32bit::kNumReg + 1];
+    static constexpr U8 kNotCached = 0xFF;
+
+    ///
+    /// @brief              Make the pages holding a range of the code buffer writable and not
+    ///                     executable, or executable and not writable.
+    ///
+    /// @return             Whether the protection could be changed.
+    ///
+    static bool set_writable (byte *code, word n, bool writable);
+
+    void compile (DecodeCache::Block *block);
+    void emit_instr (const Emulator32bit::DecodedInstr &instr, U8 flags);
+
+    void emit_load_reg (U8 host_reg, U8 reg);
+    void emit_store_reg (U8 reg, U8 host_reg);
+    void emit_push_pop (U8 opcode, U8 host_reg);
+    void emit_rex (U8 reg, U8 rm);
+    void emit_load_arg (const Emulator32bit::DecodedInstr &instr);
+    void emit_write_flags (U8 flags);
+    void emit_rr (U8 opcode, U8 reg, U8 rm);
+    void emit_imm32 (word imm);
+};
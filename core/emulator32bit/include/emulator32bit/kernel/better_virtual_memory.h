@@ -3,20 +3,42 @@
 #include "emulator32bit/emulator32bit.h"
 #include "emulator32bit/emulator32bit_util.h"
 #include "emulator32bit/kernel/fbl_inmemory.h"
+#include "emulator32bit/system_bus.h"
 
-#include "util/logger.h"
-
-#include <string>
-#include <cstring>
-
-#define N_VPAGES (1 << 20)
-
-// todo, figure out how to implement shared pages. might have to use
-// dynamically allocated memory on kernel heap to do so.
+#include <unordered_map>
+#include <vector>
 
+/**
+ * @brief               Translates addresses by walking page tables kept in guest RAM, the way a
+ *                      hardware MMU walks the tables set up by a kernel.
+ *
+ * @details             A page directory is a page of kPageTableSize entries, one per
+ *                      kPageTableSize virtual pages, each pointing to the second level table of
+ *                      those pages. @ref Emulator32bit::pagedir holds the physical address of the
+ *                      current directory. Directories and tables live in the kernel pages, which
+ *                      are mapped to themselves and only accessible in kernel mode. Virtual pages
+ *                      get physical pages from the user pages, and once those run out the clock
+ *                      hand picks one that was not accessed since it last passed to move to disk.
+ *
+ *                      Translations are cached in the software TLB of the bus. Like the TLB of a
+ *                      processor it is not told about changes the kernel makes to the tables
+ *                      itself, or to the pagedir and the real mode flag, which have to be
+ *                      followed by a tlbi. Changes made through this class drop the cached
+ *                      translations themselves.
+ */
 class MMU
 {
   public:
+    /**
+     * @brief           Construct an MMU over the RAM of a processor.
+     *
+     * @param processor Processor whose page directory and mode flags are used.
+     * @param user_low_page First physical page given to virtual pages.
+     * @param user_high_page Last physical page given to virtual pages.
+     * @param kernel_low_page First physical page for the page tables, not 0 since a pagedir of 0
+     *                  means no translation.
+     * @param kernel_high_page Last physical page for the page tables.
+     */
     MMU (Emulator32bit *processor, word user_low_page, word user_high_page, word kernel_low_page,
          word kernel_high_page);
 
@@ -27,62 +49,158 @@ class MMU
         EXECUTE_ACCESSMODE,
     };
 
-    void create_pagedir ();
-    void add_vpage (word vpage, bool kernel, bool write, bool execute, bool copy_on_write);
+    /**
+     * @brief           Entry of a page directory or page table, packed in a word. Only valid and
+     *                  frame are used in a page directory, unless it maps a superpage.
+     */
+    struct PageTableEntry
+    {
+        word valid : 1;         /* Valid entry in table */
+        word disk : 1;          /* Page is stored on disk */
+        word dirty : 1;         /* Page has been written to */
+        word clock : 1;         /* Page was accessed since the clock hand last passed */
+        word kernel : 1;        /* Kernel page */
+        word write : 1;         /* Write access */
+        word execute : 1;       /* Execute access */
+        word copy_on_write : 1; /* Copies and maps new page on write */
+        word superpage : 1;     /* Directory entry mapping kSuperpagePages pages from frame */
+        word : kNumPageOffsetBits - 9;
+        word frame : 8 * sizeof (word) - kNumPageOffsetBits; /* Physical page of the page or of
+                                                                 the table, disk page if on disk */
+    };
+    static_assert (sizeof (PageTableEntry) == sizeof (word));
+
+    struct Stats
+    {
+        U64 page_ins = 0;  /* pages brought back from disk */
+        U64 evictions = 0; /* pages moved to disk to free a physical page */
+    };
 
+    inline const Stats &stats () const
+    {
+        return m_stats;
+    }
+
+    /**
+     * @brief           Allocate an empty page directory and make it the current one.
+     *
+     * @return          Physical address of the page directory.
+     */
+    word create_pagedir ();
+
+    /**
+     * @brief           Switch to another page directory.
+     *
+     * @param pagedir   Physical address of the page directory, 0 for no translation.
+     */
+    void set_pagedir (word pagedir);
+
+    /**
+     * @brief           Give a virtual page of the current page directory a zeroed physical page.
+     *
+     * @details         A superpage maps the kSuperpagePages virtual pages from vpage to
+     *                  consecutive physical pages with a single directory entry, and is never
+     *                  moved to disk.
+     *
+     * @throws          Emulator32bit::Exception if there is no page directory, or the virtual
+     *                  page is a kernel page or already added.
+     * @throws          FBL_InMemory::Exception if no consecutive user pages are free for a
+     *                  superpage.
+     * @param superpage Whether to add the superpage starting at vpage, which has to be a multiple
+     *                  of kSuperpagePages.
+     */
+    void add_vpage (word vpage, bool kernel, bool write, bool execute, bool copy_on_write,
+                    bool superpage = false);
+
+    /**
+     * @brief           Map a virtual page of the current page directory to the physical page of
+     *                  the same virtual page of another directory, copy on write in both. The
+     *                  page is brought back from disk first if it is there.
+     *
+     * @details         Pages shared by several entries stay in memory until all but one have
+     *                  written to them, since eviction only updates the entry it moves to disk.
+     *
+     * @throws          Emulator32bit::Exception if there is no current page directory, the page
+     *                  is not added in the other one, is in a superpage, or is already added in
+     *                  the current one.
+     * @param pagedir   Physical address of the page directory to share the page of.
+     * @param vpage     Virtual page.
+     */
+    void share_vpage (word pagedir, word vpage);
+
+    /**
+     * @brief           Remove a virtual page of the current page directory, returning its
+     *                  physical or disk page. Removes the whole superpage of a page in one.
+     *
+     * @throws          Emulator32bit::Exception if the virtual page was not added.
+     */
     void remove_vpage (word vpage);
+
+    /**
+     * @brief           Remove every virtual page and table of the current page directory, then
+     *                  the directory itself.
+     */
     void remove_pagedir ();
 
-    inline word map_address (word address, AccessMode mode)
+    /**
+     * @brief           Forget every page directory after RAM was cleared, which also cleared the
+     *                  free lists kept in it.
+     */
+    void reset ();
+
+    /**
+     * @brief           Translate a virtual address of the current page directory.
+     *
+     * @throws          Emulator32bit::Exception with BAD_PAGEDIR if the tables are not in the
+     *                  kernel pages, and PAGEFAULT if the access is not allowed.
+     * @param address   Virtual address.
+     * @param mode      Kind of access.
+     * @param cacheable Set to whether the translation can be cached for any mode, false for
+     *                  pages that need kernel privilege.
+     * @return          Physical address.
+     */
+    inline word map_address (word address, AccessMode mode, bool &cacheable)
     {
+        cacheable = true;
+
         /*
-                Null page directory or processor in real more implies no virtual
-                memory.
-            */
-        if (UNLIKELY (!m_processor->pagedir
-                      || m_processor->get_flag (Emulator32bit::kRealModeFlagBit)))
+            Null page directory or processor in real mode implies no virtual
+            memory.
+        */
+        const word pagedir = m_processor->pagedir;
+        if (UNLIKELY (pagedir == 0 || m_processor->get_flag (Emulator32bit::kRealModeFlagBit)))
         {
             return address;
         }
 
-        /* Check for valid page directory. */
-        RAM *ram = m_processor->system_bus->ram;
-        if (UNLIKELY (!ram->in_bounds (m_processor->pagedir))
-            || !ram->in_bounds (m_processor->pagedir + (kPageSize * sizeof (struct PageTableEntry))
-                                - 1))
-        {
-            throw Emulator32bit::Exception (Emulator32bit::InterruptType::BAD_PAGEDIR,
-                                            "Page directory is not in RAM.");
-        }
-
-        word vpage = address >> kNumPageOffsetBits;
+        const word vpage = address >> kNumPageOffsetBits;
+        const bool user = m_processor->get_flag (Emulator32bit::kUserModeFlagBit);
 
         /*
-                Kernel memory is directly mapped, not rerouting. Just check
-                for permissions of process accessing.
-            */
-        if (UNLIKELY (vpage >= m_kernel_low_page && vpage <= m_kernel_high_page))
+            Kernel memory is directly mapped, not rerouting. Just check
+            for permissions of process accessing.
+        */
+        if (UNLIKELY (is_kernel_page (vpage)))
         {
-            if (UNLIKELY (m_processor->get_flag (Emulator32bit::kUserModeFlagBit)))
+            if (UNLIKELY (user))
             {
                 throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
                                                 "User tried accessing kernel page.");
             }
+            cacheable = false;
             return address;
         }
 
-        struct PageTableEntry *pagetable =
-            (struct PageTableEntry *) &ram->m_data[m_processor->pagedir];
-        struct PageTableEntry *entry = &pagetable[vpage];
+        word entry_address;
+        PageTableEntry *entry = walk (pagedir, vpage, entry_address);
 
         /* Check for access permissions. */
-        if (UNLIKELY (!entry->valid))
+        if (UNLIKELY (entry == nullptr || !entry->valid))
         {
             throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
                                             "Unmapped memory accessed.");
         }
-        else if (UNLIKELY (entry->kernel
-                           && m_processor->get_flag (Emulator32bit::kUserModeFlagBit)))
+        else if (UNLIKELY (entry->kernel && user))
         {
             throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
                                             "User tried accessing kernel page.");
@@ -103,43 +221,31 @@ class MMU
         /* Read from disk and write to memory. */
         if (UNLIKELY (entry->disk))
         {
-            Disk *disk = m_processor->system_bus->disk;
-            std::vector<byte> disk_page = disk->read_page (entry->disk);
-            disk->return_page (entry->disk);
-
-            EXPECT_TRUE (disk_page.size () == kPageSize, "Page size does not match.");
-
-            word free_ppage = get_free_ppage ();
+            page_in (entry, entry_address);
+        }
 
-            entry->disk = false;
-            entry->ppage = free_ppage;
+        if (mode == WRITE_ACCESSMODE)
+        {
+            if (UNLIKELY (entry->copy_on_write))
+            {
+                copy_on_write (entry, entry_address);
+            }
+            entry->dirty = 1;
+        }
 
-            word mapped_address = (free_ppage << kNumPageOffsetBits) + (address & (kPageSize - 1));
-            std::memcpy (&ram->m_data[mapped_address], disk_page.data (), kPageSize);
-            return mapped_address;
+        word frame = entry->frame;
+        if (UNLIKELY (entry->superpage))
+        {
+            frame += vpage & (kSuperpagePages - 1);
         }
 
-        return (entry->ppage << kNumPageOffsetBits) + (address & (kPageSize - 1));
+        cacheable = !entry->kernel;
+        return (frame << kNumPageOffsetBits) + (address & (kPageSize - 1));
     }
 
   private:
-    struct PageTableEntry
-    {
-        word ppage;           /* Physical page mapped to */
-        word reference_count; /* How many virtual pages map to this */
-        word diskpage;        /* Disk page stored in */
-        bool valid;           /* Valid entry in table */
-        bool disk;            /* Page is stored on disk */
-        bool dirty;           /* Page has been written to */
-        bool clock;           /* Clock based LRU replacement */
-
-        bool kernel;          /* Kernel page */
-        bool write;           /* Write access */
-        bool execute;         /* Execute access */
-        bool copy_on_write;   /* Copies and maps new page on write */
-    };
-
     Emulator32bit *m_processor;
+    RAM *m_ram;
     word m_user_low_page;
     word m_user_high_page;
     word m_kernel_low_page;
@@ -148,19 +254,128 @@ class MMU
     FBL_InMemory m_free_user_ppages;
     FBL_InMemory m_free_kernel_ppages;
     word m_clock_hand = 0;
+    Stats m_stats;
+
+    /**
+     * @brief           Physical address of the entry mapping each user page, 0 if the page is
+     *                  free. Entries are in the kernel pages, which do not start at 0.
+     */
+    std::vector<word> m_owners;
+
+    /**
+     * @brief           Addresses of the entries other than the owner that map a shared user
+     *                  page, by physical page. Pages mapped by one entry are not in it.
+     */
+    std::unordered_map<word, std::vector<word>> m_sharers;
 
-    inline word get_free_ppage ()
+    /**
+     * @brief           Free list of a range of physical pages, kept in the pages themselves.
+     */
+    FBL_InMemory free_list (word low_page, word high_page);
+
+    inline bool is_kernel_page (word page)
     {
-        if (UNLIKELY (m_free_user_ppages.empty ()))
-        {
-            return evict_ppage ();
-        }
+        return page >= m_kernel_low_page && page <= m_kernel_high_page;
+    }
 
-        return m_free_user_ppages.get_free_block () >> kNumPageOffsetBits;
+    inline PageTableEntry *entry_at (word address)
+    {
+        return (PageTableEntry *) m_ram->host_address (address);
     }
 
-    inline word evict_ppage ()
+    /**
+     * @brief           Look up the entry of a virtual page, reading the page directory and the
+     *                  table of the page.
+     *
+     * @param pagedir   Physical address of the page directory.
+     * @param vpage     Virtual page.
+     * @param entry_address Set to the physical address of the entry.
+     * @return          Entry of the page, the directory entry if the page is in a superpage,
+     *                  nullptr if its table does not exist.
+     */
+    inline PageTableEntry *walk (word pagedir, word vpage, word &entry_address)
     {
-        return 0;
+        if (UNLIKELY (!is_kernel_page (pagedir >> kNumPageOffsetBits)
+                      || (pagedir & (kPageSize - 1)) != 0))
+        {
+            throw Emulator32bit::Exception (Emulator32bit::InterruptType::BAD_PAGEDIR,
+                                            "Page directory is not in kernel memory.");
+        }
+
+        const word dir_address = pagedir + (vpage >> kNumPageTableBits) * sizeof (PageTableEntry);
+        const PageTableEntry dir = *entry_at (dir_address);
+        if (UNLIKELY (!dir.valid))
+        {
+            return nullptr;
+        }
+
+        if (UNLIKELY (dir.superpage))
+        {
+            entry_address = dir_address;
+            return entry_at (dir_address);
+        }
+
+        if (UNLIKELY (!is_kernel_page (dir.frame)))
+        {
+            throw Emulator32bit::Exception (Emulator32bit::InterruptType::BAD_PAGEDIR,
+                                            "Page table is not in kernel memory.");
+        }
+
+        entry_address = (dir.frame << kNumPageOffsetBits)
+                        + (vpage & (kPageTableSize - 1)) * sizeof (PageTableEntry);
+        return entry_at (entry_address);
     }
+
+    /**
+     * @brief           Bring a page back from disk into a user page.
+     */
+    void page_in (PageTableEntry *entry, word entry_address);
+
+    /**
+     * @brief           Give a page shared copy on write a physical page of its own, unless no
+     *                  other entry maps the page anymore.
+     */
+    void copy_on_write (PageTableEntry *entry, word entry_address);
+
+    /**
+     * @brief           Take a free kernel page for a table, zeroed.
+     */
+    word get_table_page ();
+
+    /**
+     * @brief           Take a free user page, evicting one if there are none.
+     */
+    word get_free_ppage ();
+
+    /**
+     * @brief           Give the superpage at a virtual page of the current page directory
+     *                  zeroed consecutive physical pages.
+     */
+    void add_superpage (word vpage, bool kernel, bool write, bool execute);
+
+    /**
+     * @brief           Return the pages mapped by an entry that is being removed, unless other
+     *                  entries still map them.
+     */
+    void release_ppage (const PageTableEntry &entry, word entry_address);
+
+    /**
+     * @brief           Drop an entry from the entries mapping a shared page, the last one left
+     *                  becomes its only owner.
+     */
+    void unshare_ppage (word ppage, word entry_address);
+
+    /**
+     * @brief           Move the user page after the clock hand that was not accessed since the
+     *                  hand last passed to disk, clearing the clock bit of the pages it passes.
+     *                  Shared pages and superpages stay in memory.
+     *
+     * @return          Freed physical page.
+     */
+    word evict_ppage ();
+
+    /**
+     * @brief           Drop the translations cached by the bus and decoded instruction links.
+     */
+    void invalidate_translations ();
 };
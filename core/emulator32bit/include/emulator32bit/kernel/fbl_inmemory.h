@@ -30,6 +30,15 @@ class FBL_InMemory
     };
 
     word get_free_block ();
+
+    /**
+     * @brief           Take consecutive free blocks.
+     *
+     * @throws          FBL_InMemory::Exception if no n blocks in a row are free.
+     * @param n         Number of blocks.
+     * @return          Address of the first block.
+     */
+    word get_free_blocks (word n);
     void return_block (word block_addr);
 
     bool empty ();
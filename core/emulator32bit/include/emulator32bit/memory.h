@@ -18,6 +18,25 @@ class BaseMemory
     virtual inline void write_hword (word address, hword value) = 0;
     virtual inline void write_word (word address, word value) = 0;
 
+    ///
+    /// @brief              Read consecutive bytes, one @ref read_byte at a time unless overridden.
+    ///
+    /// @param address      Address of the first byte.
+    /// @param data         Destination of the bytes.
+    /// @param n            Number of bytes.
+    ///
+    virtual void read_block (word address, byte *data, word n);
+
+    ///
+    /// @brief              Write consecutive bytes, one @ref write_byte at a time unless
+    ///                     overridden.
+    ///
+    /// @param address      Address of the first byte.
+    /// @param data         Bytes to write.
+    /// @param n            Number of bytes.
+    ///
+    virtual void write_block (word address, const byte *data, word n);
+
     inline word get_mem_pages ()
     {
         return m_npages;
@@ -93,8 +112,19 @@ class Memory : public BaseMemory
         ((word *) (m_data + (address & 0b11)))[address >> 2] = value;
     }
 
+    void read_block (word address, byte *data, word n) override;
+    void write_block (word address, const byte *data, word n) override;
+
     void reset ();
 
+    ///
+    /// @brief              Host address of the byte at a physical address in this memory.
+    ///
+    inline byte *host_address (word address)
+    {
+        return m_data + (address - m_start_addr);
+    }
+
   protected:
     byte *m_data;
 
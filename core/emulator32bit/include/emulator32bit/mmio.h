@@ -0,0 +1,130 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit_util.h"
+#include "emulator32bit/memory.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+class Timer;
+
+/**
+ * @brief           Device whose registers are mapped into physical pages of the @ref SystemBus.
+ *
+ * @details         Registers are words at word aligned offsets from the first byte of the
+ *                  device. Narrower reads return the addressed bytes of the register and narrower
+ *                  writes are zero extended into it, so a byte store to a data register writes
+ *                  exactly that byte. Wide transfers can override @ref read_block and
+ *                  @ref write_block to handle a whole buffer in one call.
+ *
+ *                  Devices are registered with @ref SystemBus::map_device, which routes every
+ *                  access to their pages through its physical page map. They are never cached by
+ *                  the software TLB, so each access reaches the device.
+ */
+class MMIODevice : public BaseMemory
+{
+  public:
+    MMIODevice (word npages, word start_page);
+
+    /**
+     * @brief       Read a register.
+     *
+     * @param offset Word aligned offset of the register from the start of the device.
+     */
+    virtual word read_register (word offset) = 0;
+
+    /**
+     * @brief       Write a register.
+     *
+     * @param offset Word aligned offset of the register from the start of the device.
+     * @param value Value written, zero extended for narrow writes.
+     */
+    virtual void write_register (word offset, word value) = 0;
+
+    byte read_byte (word address) override final;
+    hword read_hword (word address) override final;
+    word read_word (word address) override final;
+    void write_byte (word address, byte value) override final;
+    void write_hword (word address, hword value) override final;
+    void write_word (word address, word value) override final;
+};
+
+/**
+ * @brief           UART style console that transmits bytes to a host sink.
+ *
+ * @details         Bytes written to @ref kDataRegister are buffered and handed to the sink when a
+ *                  newline is written, when the buffer fills up, on @ref flush and on destruction.
+ *                  A block write to the data register appends the whole block at once.
+ *                  @ref kStatusRegister always reports the transmitter as ready. There is no
+ *                  input, reading the data register returns 0.
+ */
+class ConsoleDevice : public MMIODevice
+{
+  public:
+    /// @brief          Receives the bytes transmitted by the guest.
+    using Sink = std::function<void (const char *data, size_t n)>;
+
+    static constexpr word kDataRegister = 0;
+    static constexpr word kStatusRegister = 4;
+
+    /// @brief          Bit of @ref kStatusRegister set when a byte can be transmitted.
+    static constexpr word kStatusTxReady = 1;
+
+    /// @brief          Number of buffered bytes that forces a flush to the sink.
+    static constexpr size_t kBufferSize = 256;
+
+    /**
+     * @brief       Map a console over one page.
+     *
+     * @param start_page Physical page of the registers.
+     * @param sink  Host sink, standard output if empty.
+     */
+    ConsoleDevice (word start_page, Sink sink = Sink ());
+    ~ConsoleDevice () override;
+
+    word read_register (word offset) override;
+    void write_register (word offset, word value) override;
+    void write_block (word address, const byte *data, word n) override;
+
+    /**
+     * @brief       Hand the buffered bytes to the sink.
+     */
+    void flush ();
+
+  private:
+    Sink m_sink;
+    std::string m_buffer;
+};
+
+/**
+ * @brief           Exposes the processor @ref Timer to the guest.
+ *
+ * @details         The 64 bit clock is read through @ref kTimeLowRegister and
+ *                  @ref kTimeHighRegister. Writing @ref kIntervalRegister starts a periodic timer,
+ *                  or disables it when 0. @ref kStatusRegister reads 1 when the timer expired and
+ *                  writing it acknowledges the expiry.
+ */
+class TimerDevice : public MMIODevice
+{
+  public:
+    static constexpr word kTimeLowRegister = 0;
+    static constexpr word kTimeHighRegister = 4;
+    static constexpr word kIntervalRegister = 8;
+    static constexpr word kStatusRegister = 12;
+
+    /**
+     * @brief       Map the timer registers over one page.
+     *
+     * @param start_page Physical page of the registers.
+     * @param timer Timer of the processor.
+     */
+    TimerDevice (word start_page, Timer *timer);
+
+    word read_register (word offset) override;
+    void write_register (word offset, word value) override;
+
+  private:
+    Timer *m_timer;
+    word m_interval = 0;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit.h"
+#include "emulator32bit/emulator32bit_util.h"
+#include "emulator32bit/mmio.h"
+
+#include <atomic>
+#include <vector>
+
+class SystemBus;
+
+/**
+ * @brief           Several cores sharing the memories of one @ref SystemBus.
+ *
+ * @details         Every core is an @ref Emulator32bit with its own registers, software TLB,
+ *                  decoded instructions and @ref Timer, on a bus created with
+ *                  @ref SystemBus::SystemBus(SystemBus *). @ref run runs each core on a host
+ *                  thread of its own until it stops, so guest code has to synchronize through the
+ *                  atomic instructions.
+ *
+ *                  @ref run_quanta is the deterministic alternative. It runs the cores in fixed
+ *                  instruction quanta on a set of worker threads that wait for each other at the
+ *                  end of every quantum, with each core isolated from the writes of the others
+ *                  until then.
+ *
+ *                  The shared memory is cleared and cores start with their pc at 0, like a single
+ *                  processor after a reset. Set them up through @ref core before running them.
+ */
+class Multicore
+{
+  public:
+    /**
+     * @brief       Create the cores of a shared bus.
+     *
+     * @param system_bus Bus owning the memories, taken over and deleted with the cores.
+     * @param ncores Number of cores, numbered from 0.
+     * @param backend How each core executes instructions.
+     */
+    Multicore (SystemBus *system_bus, word ncores,
+               Emulator32bit::Backend backend = Emulator32bit::Backend::INTERPRETER);
+    ~Multicore ();
+
+    Multicore (const Multicore &) = delete;
+    Multicore &operator= (const Multicore &) = delete;
+
+    SystemBus *const system_bus;
+
+    inline word ncores () const
+    {
+        return m_cores.size ();
+    }
+
+    inline Emulator32bit &core (word id)
+    {
+        return *m_cores.at (id);
+    }
+
+    /**
+     * @brief       Run every core on its own thread with @ref Emulator32bit::run_until and wait
+     *              for all of them to stop.
+     *
+     * @param budget Instruction budget of each core, 0 for no limit.
+     * @return      Why each core stopped, indexed by core.
+     */
+    std::vector<Emulator32bit::StopReason> run (U64 budget);
+
+    /**
+     * @brief       Run the cores in lockstep quanta of instructions until all of them stop.
+     *
+     * @details     Every quantum, each running core executes up to @p quantum instructions on
+     *              the worker thread it is assigned to, core i on worker i modulo the number of
+     *              workers, isolated with @ref SystemBus::begin_isolation. Once every worker
+     *              finished, the cores take their turn in order of their number on a single
+     *              thread: the bytes a core wrote are copied to the shared memory, so where cores
+     *              wrote the same byte the highest numbered one wins. A core that needed state
+     *              the cores share, an atomic instruction, a device, a system call or the MMU of
+     *              a process, instead runs its quantum again from its start at its turn, seeing
+     *              the writes of the cores before it. Then the global clock advances by the
+     *              quantum and interrupts sent with @ref send_ipi during the quantum are raised,
+     *              in order of the target core.
+     *
+     *              A core that stops for any reason other than the end of its quantum is left
+     *              stopped. Cores only see each other's plain writes at the end of a quantum, and
+     *              what each core reads, writes and executes only depends on the guest, so the
+     *              results are the same for any number of workers. The atomic instructions stay
+     *              atomic, but a quantum using them runs on one thread.
+     *
+     * @param budget Instruction budget of each core, 0 for no limit.
+     * @param quantum Instructions per quantum, not 0.
+     * @param nworkers Number of host threads including the calling one, at most one per core.
+     *              0 for one per host thread.
+     * @return      Why each core stopped, indexed by core. The instruction counts are totals over
+     *              all quanta.
+     */
+    std::vector<Emulator32bit::StopReason> run_quanta (U64 budget, U64 quantum, word nworkers = 1);
+
+    /**
+     * @brief       Global clock, the number of instructions given to every core by the quanta of
+     *              @ref run_quanta since construction.
+     */
+    inline U64 time () const
+    {
+        return m_time;
+    }
+
+    /**
+     * @brief       Raise inter-processor interrupts on a core, see
+     *              @ref Emulator32bit::raise_ipi. Ignored for cores that do not exist. During
+     *              @ref run_quanta they are held until the end of the current quantum.
+     */
+    void send_ipi (word core_id, word bits);
+
+  private:
+    std::vector<Emulator32bit *> m_cores;
+
+    /// @brief      Whether @ref run_quanta is running.
+    std::atomic<bool> m_in_quanta = false;
+
+    /// @brief      Interrupts sent to each core during the current quantum.
+    std::vector<std::atomic<word>> m_deferred_ipi;
+
+    U64 m_time = 0;
+
+    /**
+     * @brief       Raise the interrupts held during a quantum, in order of the target core.
+     */
+    void deliver_deferred_ipis ();
+};
+
+/**
+ * @brief           Lets guest code interrupt other cores of a @ref Multicore.
+ *
+ * @details         Writing @ref kSendRegister raises the interrupts in bits 8 to 31 of the value
+ *                  on the core in bits 0 to 7. The target stops at the end of its current block
+ *                  with @ref Emulator32bit::RunStatus::IPI. Reading any register returns 0.
+ */
+class IPIDevice : public MMIODevice
+{
+  public:
+    static constexpr word kSendRegister = 0;
+
+    /**
+     * @brief       Map the registers over one page.
+     *
+     * @param start_page Physical page of the registers.
+     * @param multicore Cores the interrupts are sent to.
+     */
+    IPIDevice (word start_page, Multicore *multicore);
+
+    word read_register (word offset) override;
+    void write_register (word offset, word value) override;
+
+  private:
+    Multicore *m_multicore;
+};
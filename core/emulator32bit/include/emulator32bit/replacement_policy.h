@@ -0,0 +1,296 @@
+#pragma once
+
+#include "emulator32bit/emulator32bit_util.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * @brief             Circular doubly linked list of physical pages. The links are kept in an
+ *                     array indexed by the physical page instead of in allocated nodes, so
+ *                     every operation is O(1) and only the first insert of a page past the end
+ *                     of the array allocates.
+ */
+class PageRing
+{
+  public:
+    static constexpr word kNone = ~word (0);
+
+    inline bool contains (word ppage) const
+    {
+        return ppage < m_links.size () && m_links[ppage].next != kNone;
+    }
+
+    inline word size () const
+    {
+        return m_size;
+    }
+
+    /**
+     * @brief         First page of the ring, kNone if it is empty.
+     */
+    inline word front () const
+    {
+        return m_front;
+    }
+
+    inline word next (word ppage) const
+    {
+        return m_links[ppage].next;
+    }
+
+    inline word prev (word ppage) const
+    {
+        return m_links[ppage].prev;
+    }
+
+    /**
+     * @brief         Insert a page that is not in the ring just before another, which makes it
+     *                 the last page when that is the front. Only the first page inserted into
+     *                 an empty ring becomes the front.
+     *
+     * @param         ppage: Page to insert.
+     * @param         before: Page of the ring, ignored if it is empty.
+     */
+    void insert_before (word ppage, word before);
+
+    inline void push_back (word ppage)
+    {
+        insert_before (ppage, m_front);
+    }
+
+    /**
+     * @brief         Remove a page of the ring, the next one becomes the front if it was.
+     */
+    void erase (word ppage);
+
+    void clear ();
+
+  private:
+    struct Link
+    {
+        word prev = kNone;
+        word next = kNone; /* kNone if the page is not in the ring */
+    };
+
+    std::vector<Link> m_links;
+    word m_front = kNone;
+    word m_size = 0;
+};
+
+/**
+ * @brief             Picks the physical page to move to disk once every physical page is in
+ *                     use. Implementations keep their state per page in arrays indexed by the
+ *                     physical page, like @ref PageRing.
+ *
+ * @details            The owner of the policy tells it about the pages brought into memory,
+ *                     accessed and freed, and counts the faults and evictions in @ref stats,
+ *                     so policies can be compared on the disk traffic of the same workload.
+ */
+class ReplacementPolicy
+{
+  public:
+    struct Stats
+    {
+        U64 faults = 0;           /* pages read from disk */
+        U64 evictions = 0;        /* pages moved to disk to free a physical page */
+        U64 dirty_writebacks = 0; /* evicted pages written to since they were read */
+    };
+
+    virtual ~ReplacementPolicy () = default;
+
+    virtual const char *name () const = 0;
+
+    /**
+     * @brief         Start tracking a page that was brought into memory, as if it was just
+     *                 accessed.
+     *
+     * @param         ppage: Physical page.
+     * @param         key: Identifies the contents of the page across evictions, so a policy
+     *                 can tell when a page it evicted is brought back.
+     */
+    virtual void insert (word ppage, U64 key) = 0;
+
+    /**
+     * @brief         Note an access of a page. Pages that are not tracked are ignored.
+     */
+    virtual void access (word ppage) = 0;
+
+    /**
+     * @brief         Stop tracking a page that was freed. Pages that are not tracked are
+     *                 ignored.
+     */
+    virtual void remove (word ppage) = 0;
+
+    /**
+     * @brief         Pick a page to evict and stop tracking it.
+     *
+     * @param         evictable: Whether a page can be evicted, rejected pages stay tracked.
+     * @param         ppage: Set to the page to evict.
+     * @return        Whether a page was picked, false if every tracked page was rejected.
+     */
+    virtual bool select_victim (const std::function<bool (word)> &evictable, word &ppage) = 0;
+
+    /**
+     * @brief         Tracked pages, in the order they are considered for eviction.
+     */
+    virtual std::vector<word> pages () const = 0;
+
+    /**
+     * @brief         Copy of the state of the policy, excluding the statistics.
+     */
+    virtual std::vector<U64> save () const = 0;
+
+    /**
+     * @brief         Return to a state returned by @ref save of a policy of the same kind.
+     */
+    virtual void restore (const std::vector<U64> &state) = 0;
+
+    inline const Stats &stats () const
+    {
+        return m_stats;
+    }
+
+    inline void reset_stats ()
+    {
+        m_stats = Stats ();
+    }
+
+    inline void count_fault ()
+    {
+        m_stats.faults++;
+    }
+
+    inline void count_eviction (bool dirty)
+    {
+        m_stats.evictions++;
+        m_stats.dirty_writebacks += dirty;
+    }
+
+  protected:
+    Stats m_stats;
+};
+
+/**
+ * @brief             Evicts the least recently used page. Accesses move a page to the back of
+ *                     the ring, eviction takes the first evictable page from the front.
+ */
+class LRUPolicy : public ReplacementPolicy
+{
+  public:
+    const char *name () const override;
+    void insert (word ppage, U64 key) override;
+    void access (word ppage) override;
+    void remove (word ppage) override;
+    bool select_victim (const std::function<bool (word)> &evictable, word &ppage) override;
+    std::vector<word> pages () const override;
+    std::vector<U64> save () const override;
+    void restore (const std::vector<U64> &state) override;
+
+  private:
+    PageRing m_pages; /* least recently used first */
+};
+
+/**
+ * @brief             Evicts the first page after the clock hand that was not accessed since
+ *                     the hand last passed, clearing the reference bit of the pages it passes.
+ *                     Accesses only set a bit, which is cheaper than reordering the pages.
+ */
+class ClockPolicy : public ReplacementPolicy
+{
+  public:
+    const char *name () const override;
+    void insert (word ppage, U64 key) override;
+    void access (word ppage) override;
+    void remove (word ppage) override;
+    bool select_victim (const std::function<bool (word)> &evictable, word &ppage) override;
+    std::vector<word> pages () const override;
+    std::vector<U64> save () const override;
+    void restore (const std::vector<U64> &state) override;
+
+  private:
+    PageRing m_pages;
+    word m_hand = PageRing::kNone;
+    std::vector<U8> m_referenced;
+};
+
+/**
+ * @brief             CLOCK-Pro, which tells apart hot pages, accessed again soon after being
+ *                     brought in, from cold ones, which are evicted first. Unlike LRU and
+ *                     CLOCK a scan of many pages accessed once does not push out the hot ones.
+ *
+ * @details            A cold page starts a test period when it is brought in. If it is
+ *                     accessed again during it, it becomes hot. If it is evicted during it, its
+ *                     key is remembered, and it becomes hot when brought back before as many
+ *                     pages as are in memory were evicted since, which also gives cold pages
+ *                     more room. The cold hand evicts unreferenced cold pages, and the hot hand
+ *                     turns unreferenced hot pages cold once there are more hot pages than
+ *                     the room left for cold ones, ending the test periods it passes.
+ *
+ *                     The remembered keys of evicted pages are kept in a table with one key
+ *                     per slot, instead of in the ring as in the paper, so the physical page
+ *                     can be reused. A key that is pushed out of the table is simply forgotten.
+ */
+class ClockProPolicy : public ReplacementPolicy
+{
+  public:
+    /**
+     * @param         ghost_bits: Log2 of the number of evicted pages remembered.
+     */
+    explicit ClockProPolicy (U8 ghost_bits = 12);
+
+    const char *name () const override;
+    void insert (word ppage, U64 key) override;
+    void access (word ppage) override;
+    void remove (word ppage) override;
+    bool select_victim (const std::function<bool (word)> &evictable, word &ppage) override;
+    std::vector<word> pages () const override;
+    std::vector<U64> save () const override;
+    void restore (const std::vector<U64> &state) override;
+
+    inline word hot_pages () const
+    {
+        return m_hot;
+    }
+
+    /**
+     * @brief         Number of pages the policy tries to keep cold.
+     */
+    inline word cold_target () const
+    {
+        return m_cold_target;
+    }
+
+  private:
+    static constexpr U8 kReferenced = 1 << 0;
+    static constexpr U8 kHot = 1 << 1;
+    static constexpr U8 kTest = 1 << 2;
+
+    struct Ghost
+    {
+        U64 key = 0;
+        U64 evicted = 0; /* value of m_evicted when the page was evicted, 0 if the slot is free */
+    };
+
+    PageRing m_pages;
+    word m_hand_cold = PageRing::kNone;
+    word m_hand_hot = PageRing::kNone;
+    std::vector<U8> m_flags;
+    std::vector<U64> m_keys;
+    word m_hot = 0;
+    word m_cold_target = 1;
+
+    U8 m_ghost_bits;
+    std::vector<Ghost> m_ghosts;
+    U64 m_evicted = 0;
+
+    inline Ghost &ghost (U64 key)
+    {
+        return m_ghosts[(key * 0x9E3779B97F4A7C15ULL) >> (64 - m_ghost_bits)];
+    }
+
+    /**
+     * @brief         Turn the first unreferenced hot page after the hot hand cold.
+     */
+    void run_hand_hot ();
+};
@@ -1,17 +1,45 @@
 #pragma once
 
 #include "emulator32bit/disk.h"
+#include "emulator32bit/dma.h"
 #include "emulator32bit/emulator32bit_util.h"
 #include "emulator32bit/memory.h"
+#include "emulator32bit/mmio.h"
 #include "emulator32bit/virtual_memory.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+class DecodeCache;
+class MMU;
+class Timer;
+
 class SystemBus
 {
   public:
     SystemBus (RAM *ram, ROM *rom);
     SystemBus (RAM *ram, ROM *rom, Disk *disk, VirtualMemory *mmu);
+
+    ///
+    /// @brief              Create the bus of one core of a multi-core system.
+    ///
+    /// @details            It shares the memories, MMU, DMA controller and devices of another bus,
+    ///                     which keeps owning them, but has its own software TLB, @ref decode_cache
+    ///                     and @ref timer. Devices can only be mapped while no core is running.
+    ///
+    ///                     Once a bus has cores, the MMU and devices are only used under a lock and
+    ///                     a write to a page holding code of any core invalidates it in every
+    ///                     core. The other cores drop their decoded instructions at their next
+    ///                     block, see @ref drain_invalidations. Such pages stay on the slow write
+    ///                     path for good.
+    ///
+    /// @param shared       Bus owning the memories, not a core bus itself.
+    ///
+    SystemBus (SystemBus *shared);
     ~SystemBus ();
 
     /* expose for now */
@@ -20,6 +48,20 @@ class SystemBus
     Disk *disk;
     VirtualMemory *mmu;
 
+    /// @brief              Moves pages between memory and @ref disk, for paging and for drivers.
+    DMAController *dma;
+
+    /// @brief              Decoded instruction cache told about writes to pages holding code.
+    DecodeCache *decode_cache = nullptr;
+
+    /// @brief              Timer charged for the pages moved to and from disk.
+    Timer *timer = nullptr;
+
+    /// @brief              MMU walking page tables in guest RAM, which translates addresses in
+    ///                     place of @ref mmu when set. Owned by the bus, only supported by a bus
+    ///                     without cores.
+    MMU *page_table_mmu = nullptr;
+
     class Exception : public std::exception
     {
       private:
@@ -33,20 +75,62 @@ class SystemBus
 
     inline dword read_val (word address, int n_bytes)
     {
+        byte bytes[sizeof (dword)];
+        read_block (address, bytes, n_bytes);
+
         dword val = 0;
-        for (int i = 0; i < n_bytes; i++)
+        for (int i = n_bytes - 1; i >= 0; i--)
         {
-            val <<= 8;
-            word real_adr = address;
-            real_adr = translate_address (address + n_bytes - i - 1);
-            BaseMemory *target = route_memory (real_adr);
-            val += target->read_byte (real_adr);
+            val = (val << 8) | bytes[i];
         }
         return val;
     }
 
+    ///
+    /// @brief              Read consecutive bytes, translating once per page.
+    ///
+    /// @param address      Virtual address of the first byte.
+    /// @param data         Destination of the bytes.
+    /// @param n            Number of bytes.
+    ///
+    void read_block (word address, byte *data, word n);
+
+    ///
+    /// @brief              Write consecutive bytes, translating once per page.
+    ///
+    /// @param address      Virtual address of the first byte.
+    /// @param data         Bytes to write.
+    /// @param n            Number of bytes.
+    ///
+    void write_block (word address, const byte *data, word n);
+
+    ///
+    /// @brief              Set consecutive bytes to a value, translating once per page.
+    ///
+    /// @param address      Virtual address of the first byte.
+    /// @param value        Value of every byte.
+    /// @param n            Number of bytes.
+    ///
+    void fill (word address, byte value, word n);
+
+    /// @brief              @ref read_block by physical address, mapping each page to itself.
+    void read_unmapped_block (word address, byte *data, word n);
+
+    /// @brief              @ref write_block by physical address, mapping each page to itself.
+    void write_unmapped_block (word address, const byte *data, word n);
+
+    /// @brief              @ref fill by physical address, mapping each page to itself.
+    void fill_unmapped (word address, byte value, word n);
+
     inline void ensure_unmapped_mapping (word address)
     {
+        /* the page table walker maps nothing to reach physical pages */
+        if (page_table_mmu != nullptr)
+        {
+            return;
+        }
+
+        const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
         VirtualMemory::Exception exception;
         word ppage = address >> kNumPageOffsetBits;
         mmu->ensure_physical_page_mapping (mmu->current_process (), ppage, ppage, exception);
@@ -65,22 +149,32 @@ class SystemBus
      */
     inline byte read_byte (word address)
     {
-        address = translate_address (address);
-        return route_memory (address)->read_byte (address);
+        if (const byte *host = lookup_tlb (m_read_tlb, address); LIKELY (host != nullptr))
+        {
+            return *host;
+        }
+
+        address = translate_and_fill_tlb (address, false);
+        return read_physical<byte> (address);
     }
 
     inline byte read_unmapped_byte (word address)
     {
         ensure_unmapped_mapping (address);
-        return route_memory (address)->read_byte (address);
+        return read_physical<byte> (address);
     }
 
     inline hword read_hword (word address)
     {
         if ((address >> kNumPageOffsetBits) == ((address + 1) >> kNumPageOffsetBits))
         {
-            address = translate_address (address);
-            return route_memory (address)->read_hword (address);
+            if (const byte *host = lookup_tlb (m_read_tlb, address); LIKELY (host != nullptr))
+            {
+                return load<hword> (host);
+            }
+
+            address = translate_and_fill_tlb (address, false);
+            return read_physical<hword> (address);
         }
 
         return read_val (address, 2);
@@ -89,15 +183,20 @@ class SystemBus
     inline hword read_unmapped_hword (word address)
     {
         ensure_unmapped_mapping (address);
-        return route_memory (address)->read_word (address);
+        return read_physical<hword> (address);
     }
 
     inline word read_word (word address)
     {
         if ((address >> kNumPageOffsetBits) == ((address + 3) >> kNumPageOffsetBits))
         {
-            address = translate_address (address);
-            return route_memory (address)->read_word (address);
+            if (const byte *host = lookup_tlb (m_read_tlb, address); LIKELY (host != nullptr))
+            {
+                return load<word> (host);
+            }
+
+            address = translate_and_fill_tlb (address, false);
+            return read_physical<word> (address);
         }
 
         return read_val (address, 4);
@@ -106,7 +205,7 @@ class SystemBus
     inline word read_unmapped_word (word address)
     {
         ensure_unmapped_mapping (address);
-        return route_memory (address)->read_word (address);
+        return read_physical<word> (address);
     }
 
     inline word read_word_aligned_ram (word address)
@@ -128,22 +227,37 @@ class SystemBus
      */
     inline void write_byte (word address, byte data)
     {
-        address = translate_address (address);
-        route_memory (address)->write_byte (address, data);
+        if (byte *host = lookup_tlb (m_write_tlb, address); LIKELY (host != nullptr))
+        {
+            *host = data;
+            return;
+        }
+
+        address = translate_and_fill_tlb (address, true);
+        notify_write (address, 1);
+        write_physical<byte> (address, data);
     }
 
     inline void write_unmapped_byte (word address, byte data)
     {
         ensure_unmapped_mapping (address);
-        route_memory (address)->write_byte (address, data);
+        notify_write (address, 1);
+        write_physical<byte> (address, data);
     }
 
     inline void write_hword (word address, hword data)
     {
         if ((address >> kNumPageOffsetBits) == ((address + 1) >> kNumPageOffsetBits))
         {
-            address = translate_address (address);
-            route_memory (address)->write_hword (address, data);
+            if (byte *host = lookup_tlb (m_write_tlb, address); LIKELY (host != nullptr))
+            {
+                store<hword> (host, data);
+                return;
+            }
+
+            address = translate_and_fill_tlb (address, true);
+            notify_write (address, 2);
+            write_physical<hword> (address, data);
         }
         else
         {
@@ -154,15 +268,23 @@ class SystemBus
     inline void write_unmapped_hword (word address, hword data)
     {
         ensure_unmapped_mapping (address);
-        route_memory (address)->write_hword (address, data);
+        notify_write (address, 2);
+        write_physical<hword> (address, data);
     }
 
     inline void write_word (word address, word data)
     {
         if ((address >> kNumPageOffsetBits) == ((address + 3) >> kNumPageOffsetBits))
         {
-            address = translate_address (address);
-            route_memory (address)->write_word (address, data);
+            if (byte *host = lookup_tlb (m_write_tlb, address); LIKELY (host != nullptr))
+            {
+                store<word> (host, data);
+                return;
+            }
+
+            address = translate_and_fill_tlb (address, true);
+            notify_write (address, 4);
+            write_physical<word> (address, data);
         }
         else
         {
@@ -173,65 +295,563 @@ class SystemBus
     inline void write_unmapped_word (word address, word data)
     {
         ensure_unmapped_mapping (address);
-        route_memory (address)->write_word (address, data);
+        notify_write (address, 4);
+        write_physical<word> (address, data);
     }
 
     inline void write_val (word address, dword val, int n_bytes)
     {
+        byte bytes[sizeof (dword)];
         for (int i = 0; i < n_bytes; i++)
         {
-            word real_adr = address;
-            real_adr = translate_address (address + i);
-            BaseMemory *target = route_memory (real_adr);
-            target->write_byte (real_adr, val & 0xFF);
+            bytes[i] = val & 0xFF;
             val >>= 8;
         }
+        write_block (address, bytes, n_bytes);
     }
 
+    ///
+    /// @brief              Read a word by its physical address.
+    ///
+    /// @param address      Physical address.
+    /// @return             Word read.
+    ///
+    inline word read_physical_word (word address)
+    {
+        return read_physical<word> (address);
+    }
+
+    ///
+    /// @brief              Copy bytes out of physical memory, a page at a time so RAM and ROM are
+    ///                     copied directly and a device gets one @ref BaseMemory::read_block call
+    ///                     per page.
+    ///
+    /// @param address      Physical address of the first byte.
+    /// @param data         Destination of the bytes.
+    /// @param n            Number of bytes.
+    ///
+    void read_physical_block (word address, byte *data, word n);
+
+    ///
+    /// @brief              Copy bytes into physical memory, counterpart of
+    ///                     @ref read_physical_block. Invalidates the decoded instructions it
+    ///                     overwrites.
+    ///
+    void write_physical_block (word address, const byte *data, word n);
+
+    ///
+    /// @brief              Map a device over its physical pages. The bus owns it from then on.
+    ///
+    /// @throws             SystemBus::Exception if one of the pages is already backed by memory or
+    ///                     another device.
+    ///
+    /// @param device       Device to map.
+    ///
+    void map_device (MMIODevice *device);
+
+    ///
+    /// @brief              Translate the address of an instruction fetch.
+    ///
+    /// @param address      Virtual address of the instruction.
+    /// @return             Physical address of the instruction.
+    ///
+    inline word translate_fetch_address (word address)
+    {
+        if (page_table_mmu != nullptr)
+        {
+            bool cacheable;
+            return walk_page_table (address, false, true, cacheable);
+        }
+        return translate_address (address);
+    }
+
+    ///
+    /// @brief              Mark a physical page as holding decoded instructions so the next write
+    ///                     to it invalidates them in @ref decode_cache.
+    ///
+    /// @param ppage        Physical page.
+    ///
+    void watch_code_page (word ppage);
+
     void reset ();
 
+    ///
+    /// @brief              Drop every cached translation of the software TLB.
+    ///
+    void flush_tlb ();
+
+    ///
+    /// @brief              Drop cached translations of pages of the current process, from the
+    ///                     software TLB and the MMU TLB.
+    ///
+    /// @param address      Virtual address in the first page.
+    /// @param npages       Number of pages.
+    ///
+    void invalidate_tlb_pages (word address, word npages);
+
+    ///
+    /// @brief              Drop every cached translation of the current process, from the
+    ///                     software TLB and the MMU TLB.
+    ///
+    void invalidate_tlb_process ();
+
+    ///
+    /// @brief              Drop every cached translation, from the software TLB and the MMU TLB.
+    ///
+    void invalidate_tlb_all ();
+
+    ///
+    /// @brief              Read-modify-write operations of the atomic instructions.
+    ///
+    enum class AtomicOp : U8
+    {
+        SWAP,
+        ADD,
+        CLEAR,
+        SET,
+    };
+
+    ///
+    /// @brief              Atomically apply an operation to a value in memory.
+    ///
+    /// @details            Aligned values in RAM or ROM are updated with a host atomic, so they
+    ///                     stay correct while other cores run on other threads. Unaligned values
+    ///                     and device registers are only atomic with respect to each other.
+    ///
+    /// @param address      Virtual address of the value.
+    /// @param op           Operation.
+    /// @param operand      Right hand side of the operation, the new value for a swap.
+    /// @return             Value before the operation.
+    ///
+    template <typename T>
+    T atomic (word address, AtomicOp op, T operand);
+
+    ///
+    /// @brief              Whether another core wrote over instructions this core decoded.
+    ///
+    inline bool has_pending_invalidations () const
+    {
+        return m_has_invalidations.load (std::memory_order_relaxed);
+    }
+
+    ///
+    /// @brief              Drop the decoded instructions other cores wrote over. Must be called by
+    ///                     the thread running the core.
+    ///
+    void drain_invalidations ();
+
+    ///
+    /// @brief              Run the core alone until @ref commit_isolation or
+    ///                     @ref discard_isolation, so cores running on other threads cannot see
+    ///                     its writes or change what it reads.
+    ///
+    /// @details            The first write to a page of @ref ram copies it, and the core reads and
+    ///                     writes its copy from then on. Anything else shared with the other cores
+    ///                     breaks isolation, see @ref require_shared: the MMU once a process is
+    ///                     active, devices, atomics, the DMA controller and other memories. Code
+    ///                     pages the core writes only invalidate its own decoded instructions.
+    ///
+    ///                     Must be called by the thread running the core, on a core bus.
+    ///
+    void begin_isolation ();
+
+    ///
+    /// @brief              Whether the core needed shared state since @ref begin_isolation.
+    ///
+    inline bool isolation_broken () const
+    {
+        return m_isolation_broken;
+    }
+
+    ///
+    /// @brief              Stop the core if it is isolated, for work that needs state shared with
+    ///                     the other cores. Does nothing otherwise.
+    ///
+    /// @throws             SystemBus::Exception if the core is isolated, after which
+    ///                     @ref isolation_broken is true.
+    ///
+    inline void require_shared ()
+    {
+        if (UNLIKELY (m_isolated))
+        {
+            break_isolation ();
+        }
+    }
+
+    ///
+    /// @brief              Write the bytes the core changed in its copies to the shared memory,
+    ///                     which invalidates them in the decoded instructions of every core, and
+    ///                     end isolation. Must be called while no other core runs.
+    ///
+    void commit_isolation ();
+
+    ///
+    /// @brief              Drop the copies of the core, with the instructions it decoded from
+    ///                     them, and end isolation. Must be called while no other core runs.
+    ///
+    void discard_isolation ();
+
+    ///
+    /// @brief              Start tracking the contents of @ref ram so @ref restore_memory can
+    ///                     return to them, replacing the previous snapshot.
+    ///
+    /// @details            Nothing is copied up front. Every page of RAM is write protected in
+    ///                     the software TLB and its contents are saved on the first write since
+    ///                     the snapshot, after which it is written at full speed again. Writes
+    ///                     made straight to @ref ram instead of through the bus are not seen.
+    ///
+    /// @throws             SystemBus::Exception for a bus with cores or the bus of a core, their
+    ///                     memory is shared, and for a bus with a @ref page_table_mmu, which
+    ///                     writes its tables straight to @ref ram.
+    ///
+    void snapshot_memory ();
+
+    ///
+    /// @brief              Return @ref ram to its contents at the last @ref snapshot_memory,
+    ///                     copying back only the pages written since, and keep the snapshot.
+    ///
+    void restore_memory ();
+
+    ///
+    /// @brief              Number of pages saved since the last snapshot or restore, the pages the
+    ///                     next @ref restore_memory copies back.
+    ///
+    inline size_t snapshot_dirty_pages () const
+    {
+        return m_snapshot_dirty.size ();
+    }
+
+    /// @brief              Number of entries of each software TLB, a power of 2.
+    static constexpr word kSoftTLBSize = 256;
+
   private:
-    inline void handle_mmu_exception (VirtualMemory::Exception &exception)
+    ///
+    /// @brief              Where the accesses to a physical page go.
+    ///
+    struct PhysicalPage
+    {
+        /// @brief          Host address of the first byte of the page if it is in @ref ram or
+        ///                 @ref rom, nullptr if the page belongs to a device.
+        byte *host = nullptr;
+
+        /// @brief          Memory backing the page, nullptr if nothing does.
+        BaseMemory *memory = nullptr;
+    };
+
+    ///
+    /// @brief              Flat table indexed by physical page, built once from the bounds of the
+    ///                     memories so routing an access is an index instead of a bounds check per
+    ///                     memory and a virtual call.
+    ///
+    std::vector<PhysicalPage> m_page_map;
+
+    /// @brief              Devices mapped with @ref map_device.
+    std::vector<MMIODevice *> m_devices;
+
+    /// @brief              Bus owning the memories, this bus unless it is the bus of a core.
+    SystemBus *const m_root = this;
+
+    /// @brief              Buses of the cores sharing this bus, empty for a single core.
+    std::vector<SystemBus *> m_cores;
+
+    /// @brief              Serializes the MMU and device accesses of the cores.
+    std::recursive_mutex m_lock;
+
+    /// @brief              Code pages other cores wrote over, see @ref drain_invalidations.
+    std::mutex m_invalidation_lock;
+    std::vector<word> m_invalidations;
+    std::atomic<bool> m_has_invalidations = false;
+
+    ///
+    /// @brief              Take @ref m_lock of the owning bus if it has cores.
+    ///
+    inline std::unique_lock<std::recursive_mutex> lock_shared ()
     {
-        if (exception.type == VirtualMemory::Exception::Type::DISK_RETURN_AND_FETCH_SUCCESS)
+        if (LIKELY (m_root->m_cores.empty ()))
         {
-            exception.type =
-                VirtualMemory::Exception::Type::DISK_FETCH_SUCCESS; /* so the next conditional can
-                                                                       handle */
+            return {};
+        }
+        require_shared ();
+        return std::unique_lock<std::recursive_mutex> (m_root->m_lock);
+    }
+
+    ///
+    /// @brief              Whether a physical page holds decoded instructions of this core, or
+    ///                     of any core if there are several and this one is not isolated.
+    ///
+    inline bool is_code_page (word ppage)
+    {
+        if (ppage >= m_code_pages.size ())
+        {
+            return false;
+        }
+        if (m_code_pages[ppage])
+        {
+            return true;
+        }
+        return m_root != this && !m_isolated
+               && std::atomic_ref<byte> (m_root->m_code_pages[ppage]).load (
+                   std::memory_order_relaxed);
+    }
 
-            std::vector<byte> bytes (kPageSize);
+    /// @brief              Fill @ref m_page_map, where memories overlap @ref ram wins over
+    ///                     @ref rom which wins over @ref disk.
+    void map_physical_pages ();
 
-            // EXPECTS page to be part of single memory target
-            word p_addr = exception.ppage_return << kNumPageOffsetBits;
-            BaseMemory *target = route_memory (p_addr);
+    /// @brief              Per physical page flag, set if the page holds decoded instructions.
+    std::vector<byte> m_code_pages;
 
-            for (word i = 0; i < kPageSize; i++)
-            {
-                bytes.at (i) = target->read_byte (p_addr + i);
-            }
+    /// @brief              Per physical page flag, set if the page is part of the memory snapshot
+    ///                     and was not saved yet. Empty without a snapshot.
+    std::vector<byte> m_snapshot_pages;
+
+    /// @brief              Pages saved since the snapshot, in order of @ref m_snapshot_data.
+    std::vector<word> m_snapshot_dirty;
+
+    /// @brief              Contents of the pages of @ref m_snapshot_dirty at the snapshot.
+    std::vector<byte> m_snapshot_data;
+
+    inline bool is_snapshot_page (word ppage) const
+    {
+        return ppage < m_snapshot_pages.size () && m_snapshot_pages[ppage];
+    }
+
+    ///
+    /// @brief              Save a page of the memory snapshot before it is first written.
+    ///
+    void save_snapshot_page (word ppage);
+
+    ///
+    /// @brief              Translation of a virtual page straight to the host memory backing it.
+    ///
+    struct SoftTLBEntry
+    {
+        /// @brief          Virtual page and address space, see @ref soft_tlb_tag,
+        ///                 @ref kInvalidTag if the entry is empty.
+        word tag = kInvalidTag;
+
+        /// @brief          Physical page and the host address of its first byte.
+        word ppage = 0;
+        byte *host = nullptr;
+    };
+
+    /// @brief              Never a tag, address space ids are below @ref kMaxProcesses.
+    static constexpr word kInvalidTag = ~word (0);
+    static_assert (VirtualMemory::kNoASID < (1 << kNumPageOffsetBits) - 1);
+
+    /// @brief              Virtual page of an address space, with the address space id above
+    ///                     the 32 - kNumPageOffsetBits bits of the page.
+    static inline word soft_tlb_tag (word asid, word vpage)
+    {
+        return (asid << (32 - kNumPageOffsetBits)) | vpage;
+    }
+
+    static inline word soft_tlb_index (word asid, word vpage)
+    {
+        return VirtualMemory::tlb_hash (asid, vpage) & (kSoftTLBSize - 1);
+    }
+
+    ///
+    /// @brief              Direct mapped software TLBs for reads and writes, indexed by the low
+    ///                     bits of @ref VirtualMemory::tlb_hash.
+    ///
+    /// @details            Only pages backed by @ref ram (and @ref rom for reads) are cached, so a
+    ///                     hit is a compare and a pointer add, without the MMU or
+    ///                     @ref m_page_map. Write entries are never made for pages holding
+    ///                     decoded instructions or not yet saved for the memory snapshot, so those
+    ///                     writes still reach @ref notify_write.
+    ///
+    ///                     Entries are tagged with the address space id of the process, so
+    ///                     switching process keeps them. Every change of the MMU mappings bumps
+    ///                     its generation, which flushes both TLBs on the next access. The tlbi
+    ///                     instruction drops them explicitly.
+    ///
+    SoftTLBEntry m_read_tlb[kSoftTLBSize];
+    SoftTLBEntry m_write_tlb[kSoftTLBSize];
 
-            mmu->m_disk->write_page (exception.disk_page_return, bytes);
+    /// @brief              MMU generation the TLBs were filled in.
+    U64 m_tlb_generation = 0;
+
+    inline byte *lookup_tlb (SoftTLBEntry (&tlb)[kSoftTLBSize], word address)
+    {
+        if (UNLIKELY (m_tlb_generation != mmu->generation ()))
+        {
+            flush_tlb ();
         }
 
-        if (exception.type == VirtualMemory::Exception::Type::DISK_FETCH_SUCCESS)
+        const word vpage = address >> kNumPageOffsetBits;
+        const word asid = mmu->current_asid ();
+        const SoftTLBEntry &entry = tlb[soft_tlb_index (asid, vpage)];
+        if (LIKELY (entry.tag == soft_tlb_tag (asid, vpage)))
         {
-            /* handle exception by writing page fetched from disk to memory */
-            word paddr = exception.ppage_fetch << kNumPageOffsetBits;
+            return entry.host + (address & (kPageSize - 1));
+        }
+        return nullptr;
+    }
 
-            // EXPECTS page to be part of single memory target
-            BaseMemory *target = route_memory (paddr);
+    ///
+    /// @brief              Translate an address that missed the software TLB and cache the
+    ///                     translation if the page can be accessed through a host pointer.
+    ///
+    /// @param address      Virtual address.
+    /// @param write        Whether to fill the write TLB instead of the read TLB.
+    /// @return             Physical address.
+    ///
+    word translate_and_fill_tlb (word address, bool write);
 
-            for (word i = 0; i < kPageSize; i++)
+    template <typename T>
+    static inline T load (const byte *host)
+    {
+        T val;
+        std::memcpy (&val, host, sizeof (T));
+        return val;
+    }
+
+    template <typename T>
+    static inline void store (byte *host, T val)
+    {
+        std::memcpy (host, &val, sizeof (T));
+    }
+
+    inline void notify_write (word address, word n_bytes)
+    {
+        const word first = address >> kNumPageOffsetBits;
+        const word last = (address + n_bytes - 1) >> kNumPageOffsetBits;
+        if (UNLIKELY (m_isolated))
+        {
+            isolate_write (first);
+            if (last != first)
             {
-                target->write_byte (paddr + i, exception.disk_fetch.at (i));
+                isolate_write (last);
             }
+            return;
+        }
+
+        if (UNLIKELY (is_code_page (first)))
+        {
+            invalidate_code_page (first);
+        }
+        if (UNLIKELY (last != first && is_code_page (last)))
+        {
+            invalidate_code_page (last);
+        }
+        if (UNLIKELY (is_snapshot_page (first)))
+        {
+            save_snapshot_page (first);
+        }
+        if (UNLIKELY (last != first && is_snapshot_page (last)))
+        {
+            save_snapshot_page (last);
+        }
+    }
+
+    void invalidate_code_page (word ppage);
+
+    /// @brief              Whether the core runs alone, see @ref begin_isolation.
+    bool m_isolated = false;
+    bool m_isolation_broken = false;
+
+    /// @brief              Whether the core was the first to decode a page while isolated, the
+    ///                     MMU generation is bumped once isolation ends.
+    bool m_watched_while_isolated = false;
+
+    ///
+    /// @brief              Copy of a page of @ref ram written by an isolated core.
+    ///
+    struct PrivatePage
+    {
+        word ppage;
+        byte data[kPageSize];
+
+        /// @brief          Contents of the page when it was copied, to find the bytes written.
+        byte twin[kPageSize];
+    };
+
+    /// @brief              Copies of the pages written since @ref begin_isolation, the first
+    ///                     @ref m_nprivate are in use. Kept across isolations to reuse them.
+    std::vector<std::unique_ptr<PrivatePage>> m_private_pages;
+    word m_nprivate = 0;
+
+    /// @brief              Per physical page index in @ref m_private_pages, @ref kNotPrivate if
+    ///                     the core has no copy of the page.
+    std::vector<word> m_private_index;
+    static constexpr word kNotPrivate = ~word (0);
+
+    /// @brief              Throw from an isolated core that needs shared state.
+    [[noreturn]] void break_isolation ();
+
+    /// @brief              Give an isolated core its own copy of a page before writing it.
+    void isolate_write (word ppage);
+
+    /// @brief              Point the core back at the shared pages and leave isolation.
+    void end_isolation ();
+
+    /// @brief              Set bytes of a single physical page, notifying the writes.
+    void fill_physical_page (word address, byte value, word n);
+
+    ///
+    /// @brief              Call a function for every page touched by a range of bytes.
+    ///
+    /// @param fn           Called with the address of the first byte in the page, the offset of
+    ///                     that byte in the range and the number of bytes in the page.
+    ///
+    template <typename Fn>
+    static inline void for_each_page (word address, word n, Fn &&fn)
+    {
+        word done = 0;
+        while (done < n)
+        {
+            const word chunk = std::min (n - done, kPageSize - (address & (kPageSize - 1)));
+            fn (address, done, chunk);
+            address += chunk;
+            done += chunk;
         }
     }
 
-    inline word translate_address (word address)
+    /// @brief              Advance the @ref timer by the cost of a disk page transfer.
+    void charge_disk_page ();
+
+    friend class DMAController;
+
+    ///
+    /// @brief              Move the pages the MMU swapped with @ref dma and copy the pages it
+    ///                     unshared on write.
+    ///
+    void handle_mmu_exception (VirtualMemory::Exception &exception);
+
+    ///
+    /// @brief              Translate an address with @ref page_table_mmu.
+    ///
+    /// @param cacheable    Set to whether the translation can be kept in the software TLB.
+    ///
+    word walk_page_table (word address, bool write, bool execute, bool &cacheable);
+
+    ///
+    /// @param write        Whether the address is written, which gives pages shared copy on
+    ///                     write a copy of their own.
+    ///
+    inline word translate_address (word address, bool write = false)
     {
+        if (page_table_mmu != nullptr)
+        {
+            bool cacheable;
+            return walk_page_table (address, write, false, cacheable);
+        }
+
+        /* an isolated core only translates addresses without looking at the shared MMU */
+        if (UNLIKELY (m_isolated))
+        {
+            if (mmu->enabled && mmu->current_asid () != VirtualMemory::kNoASID)
+            {
+                break_isolation ();
+            }
+            return address;
+        }
+
+        const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
         VirtualMemory::Exception exception;
-        word addr = mmu->translate_address (address, exception);
+        word addr = write ? mmu->translate_write_address (address, exception)
+                          : mmu->translate_address (address, exception);
 
         if (exception.type != VirtualMemory::Exception::Type::AOK)
         {
@@ -241,23 +861,186 @@ class SystemBus
         return addr;
     }
 
-    inline BaseMemory *route_memory (const word address)
+    ///
+    /// @brief              Look up the page holding a physical address.
+    ///
+    /// @throws             SystemBus::Exception if no memory backs the address.
+    ///
+    inline const PhysicalPage &route_page (word address)
     {
-        if (ram->in_bounds (address))
+        const word ppage = address >> kNumPageOffsetBits;
+        if (UNLIKELY (ppage >= m_page_map.size () || m_page_map[ppage].memory == nullptr))
         {
-            return ram;
+            throw Exception ("Could not route address " + std::to_string (address) + " to memory.");
         }
-        else if (rom->in_bounds (address))
+        return m_page_map[ppage];
+    }
+
+    ///
+    /// @brief              Read a value by its physical address, little endian.
+    ///
+    /// @details            RAM and ROM are read through their host pointer, only devices are
+    ///                     called through @ref BaseMemory. A value crossing into the next page is
+    ///                     read a byte at a time since the two pages may belong to different
+    ///                     memories.
+    ///
+    template <typename T>
+    inline T read_physical (word address)
+    {
+        const word offset = address & (kPageSize - 1);
+        if (UNLIKELY (offset > kPageSize - sizeof (T)))
         {
-            return rom;
+            T val = 0;
+            for (word i = 0; i < sizeof (T); i++)
+            {
+                val |= T (read_physical<byte> (address + i)) << (i * 8);
+            }
+            return val;
+        }
+
+        const PhysicalPage &page = route_page (address);
+        if (LIKELY (page.host != nullptr))
+        {
+            return load<T> (page.host + offset);
         }
-        else if (disk->in_bounds (address))
+
+        const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+        if constexpr (sizeof (T) == 1)
+        {
+            return page.memory->read_byte (address);
+        }
+        else if constexpr (sizeof (T) == 2)
         {
-            return disk;
+            return page.memory->read_hword (address);
         }
         else
         {
-            throw Exception ("Could not route address " + std::to_string (address) + " to memory.");
+            return page.memory->read_word (address);
+        }
+    }
+
+    ///
+    /// @brief              Write a value by its physical address, little endian.
+    ///
+    /// @details            Counterpart of @ref read_physical, does not notify the
+    ///                     @ref decode_cache.
+    ///
+    template <typename T>
+    inline void write_physical (word address, T val)
+    {
+        const word offset = address & (kPageSize - 1);
+        if (UNLIKELY (offset > kPageSize - sizeof (T)))
+        {
+            for (word i = 0; i < sizeof (T); i++)
+            {
+                write_physical<byte> (address + i, byte (val >> (i * 8)));
+            }
+            return;
+        }
+
+        const PhysicalPage &page = route_page (address);
+        if (LIKELY (page.host != nullptr))
+        {
+            store<T> (page.host + offset, val);
+            return;
+        }
+
+        const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+        if constexpr (sizeof (T) == 1)
+        {
+            page.memory->write_byte (address, val);
+        }
+        else if constexpr (sizeof (T) == 2)
+        {
+            page.memory->write_hword (address, val);
+        }
+        else
+        {
+            page.memory->write_word (address, val);
         }
     }
 };
+
+template <typename T>
+T SystemBus::atomic (word address, AtomicOp op, T operand)
+{
+    /* other cores would not see the update of a private copy */
+    require_shared ();
+
+    byte *host = nullptr;
+    if ((address & (sizeof (T) - 1)) == 0)
+    {
+        host = lookup_tlb (m_write_tlb, address);
+        if (host == nullptr)
+        {
+            const word paddr = translate_and_fill_tlb (address, true);
+            const PhysicalPage &page = route_page (paddr);
+            if (page.host != nullptr)
+            {
+                notify_write (paddr, sizeof (T));
+                host = page.host + (paddr & (kPageSize - 1));
+            }
+        }
+    }
+
+    if (LIKELY (host != nullptr))
+    {
+        std::atomic_ref<T> ref (*(T *) host);
+        switch (op)
+        {
+        case AtomicOp::SWAP:
+            return ref.exchange (operand);
+        case AtomicOp::ADD:
+            return ref.fetch_add (operand);
+        case AtomicOp::CLEAR:
+            return ref.fetch_and (~operand);
+        case AtomicOp::SET:
+            return ref.fetch_or (operand);
+        }
+    }
+
+    const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+    T val;
+    if constexpr (sizeof (T) == 1)
+    {
+        val = read_byte (address);
+    }
+    else if constexpr (sizeof (T) == 2)
+    {
+        val = read_hword (address);
+    }
+    else
+    {
+        val = read_word (address);
+    }
+
+    T result = operand;
+    switch (op)
+    {
+    case AtomicOp::SWAP:
+        break;
+    case AtomicOp::ADD:
+        result = val + operand;
+        break;
+    case AtomicOp::CLEAR:
+        result = val & ~operand;
+        break;
+    case AtomicOp::SET:
+        result = val | operand;
+        break;
+    }
+
+    if constexpr (sizeof (T) == 1)
+    {
+        write_byte (address, result);
+    }
+    else if constexpr (sizeof (T) == 2)
+    {
+        write_hword (address, result);
+    }
+    else
+    {
+        write_word (address, result);
+    }
+    return val;
+}
@@ -5,26 +5,93 @@
 /**
  * @brief           Simulates a hardware timer
  *
- * todo, goal of this is to generate timer interrupts every so often
- * in order to do this, we need a way of stopping processor execution to handle
- * this interrupt.
+ * The clock counts processor cycles. Every decoded instruction carries its cost from
+ * @ref instruction_cycles, which the run loop adds up per block, and the @ref SystemBus adds
+ * @ref kDiskPageCycles for every page it moves to or from disk. The same program therefore always
+ * takes the same number of cycles.
+ *
+ * A deadline is checked by the run loop after every block. Once the clock passes it,
+ * @ref Emulator32bit::run_until returns @ref Emulator32bit::RunStatus::TIMER so whoever drives the
+ * processor can preempt it.
  */
 class Timer
 {
   public:
+    /// @brief          Cost of an instruction that does not touch memory.
+    static constexpr U8 kBaseCycles = 1;
+
+    /// @brief          Extra cost of each memory access made by an instruction.
+    static constexpr U8 kMemoryAccessCycles = 3;
+
+    /// @brief          Extra cost of a taken or not taken branch refilling the pipeline.
+    static constexpr U8 kBranchCycles = 2;
+
+    /// @brief          Cost of reading or writing a page of disk when paging.
+    static constexpr U64 kDiskPageCycles = 10000;
+
+    /// @brief          Deadline that is never reached.
+    static constexpr U64 kNoDeadline = ~U64 (0);
+
     Timer (Emulator32bit *processor);
 
+    /**
+     * @brief       Number of cycles an instruction takes, excluding paging.
+     *
+     * @param raw   Instruction word.
+     */
+    static U8 instruction_cycles (word raw);
+
     inline void tick ()
     {
         m_clock++;
     }
 
-    inline unsigned long long time ()
+    inline void advance (U64 cycles)
+    {
+        m_clock += cycles;
+    }
+
+    inline U64 time ()
     {
         return m_clock;
     }
 
+    /**
+     * @brief           Expire the timer once the clock reaches a cycle. Disables the interval.
+     */
+    void set_deadline (U64 cycle);
+
+    /**
+     * @brief           Expire the timer every number of cycles, starting from now.
+     *
+     * @param cycles    Length of a time slice, 0 to disable the timer.
+     */
+    void set_interval (U64 cycles);
+
+    inline U64 deadline () const
+    {
+        return m_deadline;
+    }
+
+    inline bool expired () const
+    {
+        return m_clock >= m_deadline;
+    }
+
+    /**
+     * @brief           Acknowledge an expired timer, moving the deadline to the next interval
+     *                  after the current time or disabling it.
+     */
+    void acknowledge ();
+
+    /**
+     * @brief           Reset the clock and disable the timer.
+     */
+    void reset ();
+
   private:
     Emulator32bit *m_processor;
-    unsigned long long m_clock = 0;
-};
\ No newline at end of file
+    U64 m_clock = 0;
+    U64 m_deadline = kNoDeadline;
+    U64 m_interval = 0;
+};
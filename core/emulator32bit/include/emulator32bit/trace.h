@@ -0,0 +1,95 @@
+#pragma once
+
+#include "util/types.h"
+
+#include <vector>
+
+///
+/// @brief              Binary record of one executed instruction.
+///
+struct TraceRecord
+{
+    /// @brief          Address of the instruction.
+    word pc;
+
+    /// @brief          Raw instruction word.
+    word instr;
+
+    /// @brief          Value of the destination register after the instruction.
+    word rd_value;
+
+    /// @brief          Address accessed by a load or store, 0 for other instructions.
+    word mem_addr;
+};
+
+///
+/// @brief              Trace policy of the run loop that records nothing. The run loop checks
+///                     @ref kEnabled at compile time, so no tracing code is generated.
+///
+struct NoTrace
+{
+    static constexpr bool kEnabled = false;
+
+    inline void record (const TraceRecord &record)
+    {
+        (void) (record);
+    }
+};
+
+///
+/// @brief              Trace policy keeping the most recent records in a ring buffer.
+///
+class TraceBuffer
+{
+  public:
+    static constexpr bool kEnabled = true;
+
+    ///
+    /// @param capacity_log2    Log 2 of the number of records kept.
+    ///
+    explicit TraceBuffer (word capacity_log2 = 16) :
+        m_records (word (1) << capacity_log2),
+        m_mask ((word (1) << capacity_log2) - 1)
+    {
+    }
+
+    inline void record (const TraceRecord &record)
+    {
+        m_records[m_count++ & m_mask] = record;
+    }
+
+    ///
+    /// @brief              Number of records written since the last @ref clear, including the
+    ///                     ones that were overwritten.
+    ///
+    inline U64 count () const
+    {
+        return m_count;
+    }
+
+    ///
+    /// @brief              Number of records kept.
+    ///
+    inline word size () const
+    {
+        return m_count < m_records.size () ? word (m_count) : word (m_records.size ());
+    }
+
+    ///
+    /// @brief              Get a kept record, 0 is the oldest.
+    ///
+    inline const TraceRecord &operator[] (word i) const
+    {
+        return m_records[(m_count - size () + i) & m_mask];
+    }
+
+    inline void clear ()
+    {
+        m_count = 0;
+    }
+
+  private:
+    std::vector<TraceRecord> m_records;
+    word m_mask;
+    U64 m_count = 0;
+};
@@ -3,14 +3,32 @@
 #include "emulator32bit/disk.h"
 #include "emulator32bit/emulator32bit_util.h"
 #include "emulator32bit/fbl.h"
+#include "emulator32bit/replacement_policy.h"
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 constexpr U32 kMaxVMPages = 1024;
 constexpr U8 kNumTLBBits = 12;
 constexpr U32 kMaxTLBSize = 1 << kNumTLBBits;
+constexpr U32 kNumTLBWays = 4;
+constexpr U32 kNumTLBSets = kMaxTLBSize / kNumTLBWays;
+constexpr U32 kNumSuperTLBSets = 16;
+constexpr U32 kMaxSuperTLBSize = kNumSuperTLBSets * kNumTLBWays;
 constexpr U32 kMaxProcesses = 1024;
 constexpr U32 kMaxPhysicalPages = 1 << (8 * sizeof (word) - kNumPageOffsetBits);
+constexpr U32 kNumVPages = 1 << (8 * sizeof (word) - kNumPageOffsetBits);
+
+/* Virtual page bits resolved by each of the two levels of a page table. */
+constexpr U8 kNumPageTableBits = 10;
+constexpr U32 kPageTableSize = 1 << kNumPageTableBits;
+static_assert (2 * kNumPageTableBits + kNumPageOffsetBits == 8 * sizeof (word),
+               "The two levels of a page table should cover every virtual page");
+
+/* Pages of a superpage, mapped by a single first level entry to consecutive physical pages. */
+constexpr U32 kSuperpagePages = kPageTableSize;
 
 /*
     idea
@@ -107,22 +125,28 @@ class VirtualMemory
             DISK_FETCH_SUCCESS,
             DISK_RETURN_AND_FETCH_SUCCESS,
             DISK_FETCH_FAILED,
+            COPY_ON_WRITE,
+            DISK_RETURN_AND_COPY,
         };
 
         Type type = Type::AOK;
         word address = 0; /* Address accessed */
 
         /*
-         * Result of the fetched disk if DISK_FETCH_SUCCESS or DISK_RETURN_AND_FETCH_SUCCESS
-         * to be written to memory at the physical ppage_fetch.
-         *
-         * Note: perhaps instead of supplying the disk data, just give the disk page to read
-         * and write to the specified physical memory page.
+         * Disk page to copy to memory at the physical ppage_fetch if DISK_FETCH_SUCCESS or
+         * DISK_RETURN_AND_FETCH_SUCCESS. The disk page is already returned to the free list, so
+         * it has to be copied before another disk page is requested.
          */
-        std::vector<byte> disk_fetch;
+        word disk_page_fetch;
         word ppage_fetch;  /* physical page to write disk fetch results to. */
         word ppage_return; /* physical page to read from and write to disk at disk_page_return. */
         word disk_page_return; /* disk page to write the read physical page to. */
+
+        /*
+         * Physical page to copy to ppage_fetch if COPY_ON_WRITE or DISK_RETURN_AND_COPY, after
+         * ppage_return is written to disk.
+         */
+        word ppage_copy;
     };
 
     /**
@@ -143,6 +167,21 @@ class VirtualMemory
      */
     long long begin_process (bool kernel_privilege = false);
 
+    /**
+     * @brief             Starts a new process with a copy of the address space of another.
+     *
+     * @details            Pages in memory are shared copy on write, both processes map the same
+     *                     physical page until one of them writes to it through
+     *                     @ref translate_write_address. Pages on disk are copied to new disk
+     *                     pages straight away. The current process is left as it is.
+     *
+     * @throws            InvalidPIDException when the pid is not a valid process.
+     * @throws             VirtualMemoryException when MAX_PROCESSES limit is reached.
+     * @param pid         Process to copy.
+     * @return            New process id, with the privilege of the copied process.
+     */
+    long long fork_process (long long pid);
+
     /**
      * @brief             Ends a specified process.
      *
@@ -171,6 +210,15 @@ class VirtualMemory
     void set_ppage_permissions (word ppage_begin, word ppage_end, word swappable,
                                 word kernel_locked);
 
+    /**
+     * @brief             Only give virtual pages the physical pages in a range, the ones backed
+     *                     by RAM. Once those run out, pages are evicted to disk.
+     *
+     * @param             ppage_begin: First physical page that can be used.
+     * @param             ppage_end: Last physical page that can be used.
+     */
+    void restrict_ppages (word ppage_begin, word ppage_end);
+
     /**
      * @brief             Set the access permissions of virtual memory specific to a process.
      *
@@ -220,10 +268,18 @@ class VirtualMemory
      * @throws            InvalidPIDException when pid is invalid.
      * @throws            InvalidVPageException when the virtual page has already been mapped to
      *                     the process.
+     * @throws            VirtualMemoryException when no consecutive physical pages are free for
+     *                     a superpage.
      * @param             pid: ID of the process to add a virtual page to.
      * @param             vpage: Virtual page to add.
+     * @param             superpages: Whether to add the pages as superpages of kSuperpagePages
+     *                     pages, translated by a single TLB entry each. vpage and length then
+     *                     have to be multiples of kSuperpagePages. Superpages get consecutive
+     *                     physical pages straight away, which keep what they held. They are
+     *                     never evicted and forks share them instead of copying them on write.
      */
-    void add_vpage (long long pid, word vpage, word length, bool write, bool execute);
+    void add_vpage (long long pid, word vpage, word length, bool write, bool execute,
+                    bool superpages = false);
 
     /**
      * @brief             Converts a virtual address into a physical address of the process
@@ -270,6 +326,41 @@ class VirtualMemory
         return translate_address (m_cur_ptable, address, exception);
     }
 
+    /**
+     * @brief             @ref translate_address for a write of the currently active process.
+     *                     A page shared copy on write is first given a physical page of its own.
+     *
+     * @param             address: Virtual address to translate.
+     * @param             exception: Exception is thrown whenever a page fault or page copy
+     *                     should be handled.
+     * @return             Physical address corresponding to the virtual address.
+     */
+    inline word translate_write_address (word address, Exception &exception)
+    {
+        if (UNLIKELY (m_cur_ptable == nullptr || !enabled))
+        {
+            return address;
+        }
+
+        word vpage = address >> kNumPageOffsetBits;
+        word ppage = access_vpage (m_cur_ptable, vpage, exception);
+
+        /*
+         * Unlikely that any page is shared, which saves looking up the entry again.
+         */
+        if (UNLIKELY (m_cow_entries > 0))
+        {
+            PageTableEntry *entry = find_entry (m_cur_ptable, vpage);
+            if (entry != nullptr && entry->cow)
+            {
+                ppage = copy_on_write (m_cur_ptable->pid, vpage, entry, exception);
+            }
+        }
+
+        m_physical_memory_map[ppage].dirty = true;
+        return (ppage << kNumPageOffsetBits) + (address & (kPageSize - 1));
+    }
+
     /**
      * @brief             Makes a force mapping of the virtual page to the physical page if it
      *                     is not yet mapped.
@@ -282,46 +373,207 @@ class VirtualMemory
      */
     void ensure_physical_page_mapping (long long pid, word vpage, word ppage, Exception &exception);
 
+    /**
+     * @brief             Counter that changes whenever a virtual to physical translation may
+     *                     have changed, so cached translations can be checked for staleness.
+     *                     Switching process does not change it, cached translations are tagged
+     *                     with @ref current_asid instead.
+     *
+     * @return             Current translation generation.
+     */
+    inline U64 generation ()
+    {
+        return m_generation.load (std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief             Change the generation without changing any mapping, so every cached
+     *                     translation is dropped and filled again, for example after the
+     *                     permissions of the caches changed.
+     */
+    inline void bump_generation ()
+    {
+        m_generation++;
+    }
+
+    /**
+     * @brief             Address space id of the current process, @ref kNoASID if there is
+     *                     none. Translations cached in the TLBs are tagged with it, so they
+     *                     are kept when switching between processes.
+     */
+    inline word current_asid () const
+    {
+        return m_cur_asid.load (std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief             Address space id while no process is active, addresses then map to
+     *                     themselves. The address space id of a process is its pid.
+     */
+    static constexpr word kNoASID = kMaxProcesses;
+
+    /**
+     * @brief             Hash of a virtual page of an address space that picks the set of a
+     *                     TLB it is cached in. Spreads the same pages of different address
+     *                     spaces, like those of forked processes, over different sets.
+     */
+    static inline word tlb_hash (word asid, word vpage)
+    {
+        return vpage ^ (asid << 4);
+    }
+
+    struct TLBStats
+    {
+        U64 hits = 0;
+        U64 misses = 0;
+        U64 evictions = 0;      /* valid translations replaced to make room for a new one */
+        U64 superpage_hits = 0; /* hits on translations of superpages, also counted in hits */
+    };
+
+    inline const TLBStats &tlb_stats () const
+    {
+        return m_tlb_stats;
+    }
+
+    inline void reset_tlb_stats ()
+    {
+        m_tlb_stats = TLBStats ();
+    }
+
+    inline ReplacementPolicy *replacement_policy () const
+    {
+        return m_replacement;
+    }
+
+    /**
+     * @brief             Pick the physical pages to evict with another policy, which is given
+     *                     the pages in memory in the order the current one would evict them.
+     *
+     * @param             policy: Policy to use, owned by this object from now on.
+     */
+    void set_replacement_policy (ReplacementPolicy *policy);
+
+    /**
+     * @brief             Drop the cached translations of a range of virtual pages of a process.
+     *
+     * @param             pid: Process of the pages.
+     * @param             vpage_begin: First virtual page to drop.
+     * @param             vpage_end: Last virtual page to drop.
+     */
+    void invalidate_tlb (long long pid, word vpage_begin, word vpage_end);
+
+    /**
+     * @brief             Drop every cached translation of a process.
+     *
+     * @param             pid: Process of the translations.
+     */
+    void invalidate_tlb (long long pid);
+
+    /**
+     * @brief             Drop every cached translation.
+     */
+    void flush_tlb ();
+
+    /**
+     * @brief             Number of second level tables in use by the page tables of every
+     *                     process, each the size of a page.
+     */
+    word page_table_pages () const;
+
   private:
     /**
-     * @brief            Contains information about a physical page and what virtual pages
-     *                     map to it.
+     * @brief            Incremented on every change to the page tables. Atomic so cores on
+     *                    other threads can check their cached translations.
+     */
+    std::atomic<U64> m_generation = 0;
+
+    /**
+     * @brief            Address space id of @ref m_cur_ptable, read by the cores on other
+     *                    threads on every access to their software TLBs.
+     */
+    std::atomic<word> m_cur_asid = kNoASID;
+
+    /**
+     * @brief            Identifies the contents of the page tables, excluding the current
+     *                    process. Every change takes a new value from @ref m_last_version, so
+     *                    equal versions mean equal tables.
+     */
+    U64 m_version = 0;
+    U64 m_last_version = 0;
+
+    inline void touch_tables ()
+    {
+        m_version = ++m_last_version;
+    }
+
+    /**
+     * @brief            Physical page permissions set by @ref set_ppage_permissions, in order.
+     */
+    struct PermissionRange
+    {
+        word ppage_begin;
+        word ppage_end;
+        word swappable;
+        word kernel_locked;
+    };
+
+    std::vector<PermissionRange> m_permissions;
+
+    /**
+     * @brief            Mapping of a virtual page of a process, packed in a word. A zeroed
+     *                     entry is a virtual page that was not added.
      */
     struct PageTableEntry
     {
-        /**
-         * @brief         Construct a new Page Table Entry object.
-         *
-         * @param        pid: Process ID.
-         * @param         vpage: Virtual page of this mapping.
-         * @param         diskpage: Disk page where the virtual page resides.
-         * @param        write: Whether virtual page can be written to.
-         * @param        execute: Whether code can be executed from the virtual page.
-         */
-        PageTableEntry (long long pid, word vpage, word diskpage, bool write, bool execute);
-
-        long long pid; /* Process that has this mapping. */
-        word vpage;    /* Virtual page. */
-        word ppage;    /* Mapped physical page if not on disk. */
-        bool disk;     /* Whether the virtual page is on disk. */
-        word diskpage; /* Corresponding disk page where the virtual page resides. */
-        bool mapped;   /* Whether this is a mapped virtual page with a permanent physical page. */
-        word mapped_ppage; /* Corresponding physical page as mentioned above. */
-
-        bool write;        /* Whether this virtual page can be written to. */
-        bool execute;      /* Whether this virtual page contains code to execute. */
+        word valid : 1;   /* Whether the virtual page was added to the process. */
+        word disk : 1;    /* Whether the virtual page is on disk. */
+        word mapped : 1;  /* Whether this is a mapped virtual page with a permanent physical
+                             page, kept in PageTable::mapped_ppages. */
+        word write : 1;   /* Whether this virtual page can be written to. */
+        word execute : 1; /* Whether this virtual page contains code to execute. */
+        word cow : 1;     /* Whether the physical page may be shared until written. */
+        word : kNumPageOffsetBits - 6;
+        word frame : 8 * sizeof (word) - kNumPageOffsetBits; /* Physical page if in memory,
+                                                                 disk page if on disk. */
+    };
+    static_assert (sizeof (PageTableEntry) == sizeof (word));
+
+    /**
+     * @brief            Number of page table entries marked copy on write.
+     */
+    U64 m_cow_entries = 0;
+
+    /**
+     * @brief            Number of superpage entries in the page tables, the superpage TLB is
+     *                    only searched while there are any.
+     */
+    U64 m_superpages = 0;
+
+    /**
+     * @brief            Virtual page of a process that maps a physical page.
+     */
+    struct MappedVPage
+    {
+        long long pid;
+        word vpage;
+
+        bool operator== (const MappedVPage &other) const = default;
     };
 
     struct PhysicalPage
     {
         PhysicalPage ();
 
-        std::vector<PageTableEntry *> mapped_vpages;
+        std::vector<MappedVPage> mapped_vpages;
         word ppage;
 
         bool used;
 
         bool swappable;    /* Whether this physical page can be evicted/swapped. */
+        bool superpage;    /* Whether this physical page belongs to a superpage, which stays in
+                              memory. */
+        bool dirty;        /* Whether this physical page was written to since it was read from
+                              disk. */
         bool
             kernel_locked; /* Whether this physical page requires kernel level permission to access. */
     };
@@ -332,33 +584,315 @@ class VirtualMemory
     struct PageTable
     {
         long long pid = 0; /* Process ID. */
+        bool kernel_privilege;
 
-        /* Mapping of virtual page address to the corresponding PageTableEntry. */
-        std::unordered_map<word, PageTableEntry *> entries =
-            std::unordered_map<word, PageTableEntry *> ();
+        /*
+         * First level of the table, indexed by the upper kNumPageTableBits of the virtual page.
+         * Each points to the entries of kPageTableSize virtual pages, nullptr if none of them
+         * were added.
+         */
+        PageTableEntry *directory[kPageTableSize] = {};
 
-        bool kernel_privilege;
+        /*
+         * First level entries of superpages, a valid one maps all kSuperpagePages virtual pages
+         * of its directory slot to the consecutive physical pages from its frame. The slot then
+         * has no second level table.
+         */
+        PageTableEntry superpages[kPageTableSize] = {};
+
+        /* Physical page of each virtual page with a permanent mapping. */
+        std::unordered_map<word, word> mapped_ppages = std::unordered_map<word, word> ();
     };
 
+    /**
+     * @brief            Hands out the second level tables of the page tables. Tables are
+     *                    allocated a chunk at a time and kept for reuse once released, so ending
+     *                    a process only returns its tables to the pool.
+     */
+    class PageTablePool
+    {
+      public:
+        /**
+         * @brief         Get a table with every entry zeroed.
+         */
+        PageTableEntry *allocate ();
+
+        /**
+         * @brief         Return a table taken by @ref allocate.
+         */
+        void release (PageTableEntry *table);
+
+        inline word in_use () const
+        {
+            return m_in_use;
+        }
+
+      private:
+        static constexpr word kTablesPerChunk = 16;
+
+        std::vector<std::unique_ptr<PageTableEntry[]>> m_chunks;
+        std::vector<PageTableEntry *> m_free;
+        word m_in_use = 0;
+    };
+
+    PageTablePool m_ptable_pool;
+
+    /**
+     * @brief             Walk a page table to the entry of a virtual page.
+     *
+     * @param             ptable: Page table of the process.
+     * @param             vpage: Virtual page.
+     * @return             Entry of the virtual page, nullptr if it was not added.
+     */
+    inline PageTableEntry *find_entry (PageTable *ptable, word vpage)
+    {
+        if (UNLIKELY (vpage >= kNumVPages))
+        {
+            return nullptr;
+        }
+
+        PageTableEntry *table = ptable->directory[vpage >> kNumPageTableBits];
+        if (UNLIKELY (table == nullptr))
+        {
+            return nullptr;
+        }
+
+        PageTableEntry *entry = &table[vpage & (kPageTableSize - 1)];
+        return LIKELY (entry->valid) ? entry : nullptr;
+    }
+
+    /**
+     * @brief             Find the superpage holding a virtual page.
+     *
+     * @param             ptable: Page table of the process.
+     * @param             vpage: Virtual page.
+     * @return             First level entry of the superpage, nullptr if the virtual page is not
+     *                     in one.
+     */
+    inline PageTableEntry *find_superpage (PageTable *ptable, word vpage)
+    {
+        if (UNLIKELY (vpage >= kNumVPages))
+        {
+            return nullptr;
+        }
+
+        PageTableEntry *entry = &ptable->superpages[vpage >> kNumPageTableBits];
+        return entry->valid ? entry : nullptr;
+    }
+
+    /**
+     * @brief             Get the slot of a virtual page in a page table, allocating the second
+     *                     level table if it has none yet.
+     *
+     * @param             ptable: Page table of the process.
+     * @param             vpage: Virtual page, below kNumVPages.
+     * @return             Entry of the virtual page.
+     */
+    PageTableEntry *insert_entry (PageTable *ptable, word vpage);
+
+    /**
+     * @brief             Call a function with the virtual page and entry of every virtual page
+     *                     added to a page table, in order of the virtual pages.
+     */
+    template <typename Function>
+    void for_each_entry (PageTable *ptable, Function function)
+    {
+        for (word dir = 0; dir < kPageTableSize; dir++)
+        {
+            PageTableEntry *table = ptable->directory[dir];
+            if (table == nullptr)
+            {
+                continue;
+            }
+
+            for (word i = 0; i < kPageTableSize; i++)
+            {
+                if (table[i].valid)
+                {
+                    function ((dir << kNumPageTableBits) | i, table[i]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief             Call a function with the first virtual page and entry of every
+     *                     superpage of a page table, in order of the virtual pages.
+     */
+    template <typename Function>
+    void for_each_superpage (PageTable *ptable, Function function)
+    {
+        for (word dir = 0; dir < kPageTableSize; dir++)
+        {
+            if (ptable->superpages[dir].valid)
+            {
+                function (dir << kNumPageTableBits, ptable->superpages[dir]);
+            }
+        }
+    }
+
+    /**
+     * @brief             Entry of a virtual page, or of the superpage holding it.
+     *
+     * @return             nullptr if the virtual page was not added.
+     */
+    inline PageTableEntry *find_mapping (PageTable *ptable, word vpage)
+    {
+        PageTableEntry *entry = find_entry (ptable, vpage);
+        return entry != nullptr ? entry : find_superpage (ptable, vpage);
+    }
+
+    /**
+     * @brief             Return the second level tables of a page table to the pool.
+     */
+    void release_tables (PageTable *ptable);
+
+    /**
+     * @brief             Return the disk or physical page of a virtual page. The entry itself is
+     *                     left as it is.
+     *
+     * @param             pid: Process of the virtual page.
+     * @param             vpage: Virtual page.
+     * @param             entry: Entry of the virtual page.
+     */
+    void release_vpage (long long pid, word vpage, PageTableEntry &entry);
+
+    /**
+     * @brief             Give superpages of a process their physical pages.
+     *
+     * @throws            InvalidVPageException when the pages are not superpage aligned or
+     *                     overlap pages that were already added.
+     * @throws            VirtualMemoryException when no consecutive physical pages are free.
+     */
+    void add_superpages (PageTable *ptable, word vpage, word length, bool write, bool execute);
+
+    /**
+     * @brief             Return the physical pages of a superpage once no process maps it. The
+     *                     entry itself is left as it is.
+     *
+     * @param             pid: Process of the superpage.
+     * @param             vpage: First virtual page of the superpage.
+     * @param             entry: First level entry of the superpage.
+     */
+    void release_superpage (long long pid, word vpage, const PageTableEntry &entry);
+
+    /**
+     * @brief             Mark the physical pages of a superpage as used by it, or as free.
+     */
+    void mark_superpage (word ppage, bool used);
+
     /**
      * @brief            TBL Entry.
      */
     struct TLB_Entry
     {
         bool valid = false; /* Whether the TLB_Entry is a valid translation. */
-        long long pid = -1; /* Corresponding process of the translation. */
-        word vpage;         /* Virtual page address of the translation. */
-        word ppage;         /* Resulting physical page address of the translation. */
+        word asid = 0;      /* Address space (pid) of the translation. */
+        word vpage = 0;     /* Virtual page address of the translation, the virtual page shifted
+                               by kNumPageTableBits for a superpage. */
+        word ppage = 0;     /* Resulting physical page address of the translation. */
+        U64 last_use = 0;   /* Value of m_tlb_clock when the translation was last used. */
     };
 
     /**
      * @brief             Translation Lookaside Buffer. Contains the recently translated virtual
      *                     page address to physical page address.
-     * @note            Keys are the hash of the virtual page address.
-     * @todo            Change so that the hash is of the virtual page address and the pid to
-     *                     avoid collisions between processes.
+     * @note            kNumTLBSets sets of kNumTLBWays entries, the set picked by
+     *                     @ref tlb_hash. Entries are tagged with the address space id, and the
+     *                     least recently used entry of a full set is replaced.
      */
     TLB_Entry m_tlb[kMaxTLBSize];
+    U64 m_tlb_clock = 0;
+    TLBStats m_tlb_stats;
+
+    /**
+     * @brief             Translations of superpages, kept apart like the large page TLB of a
+     *                     processor so they are found without knowing the page size. Holds
+     *                     kNumSuperTLBSets sets of kNumTLBWays entries.
+     */
+    TLB_Entry m_super_tlb[kMaxSuperTLBSize];
+
+    inline TLB_Entry *tlb_set (word asid, word vpage)
+    {
+        return &m_tlb[(tlb_hash (asid, vpage) & (kNumTLBSets - 1)) * kNumTLBWays];
+    }
+
+    inline TLB_Entry *super_tlb_set (word asid, word superpage)
+    {
+        return &m_super_tlb[(tlb_hash (asid, superpage) & (kNumSuperTLBSets - 1)) * kNumTLBWays];
+    }
+
+    /**
+     * @brief             Find the entry tagged with an address space and page in a set.
+     */
+    inline TLB_Entry *lookup_tlb_set (TLB_Entry *set, word asid, word vpage)
+    {
+        for (word way = 0; way < kNumTLBWays; way++)
+        {
+            if (LIKELY (set[way].valid && set[way].vpage == vpage && set[way].asid == asid))
+            {
+                set[way].last_use = ++m_tlb_clock;
+                return &set[way];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief             Find the cached translation of a virtual page, in the superpage TLB if
+     *                     it is not in the TLB.
+     *
+     * @param             asid: Address space of the page.
+     * @param             vpage: Virtual page.
+     * @param             ppage: Set to the physical page if the translation is cached.
+     * @return             Whether the translation is cached.
+     */
+    inline bool lookup_tlb (word asid, word vpage, word &ppage)
+    {
+        if (const TLB_Entry *entry = lookup_tlb_set (tlb_set (asid, vpage), asid, vpage);
+            LIKELY (entry != nullptr))
+        {
+            m_tlb_stats.hits++;
+            ppage = entry->ppage;
+            return true;
+        }
+
+        if (UNLIKELY (m_superpages > 0))
+        {
+            const word superpage = vpage >> kNumPageTableBits;
+            if (const TLB_Entry *entry =
+                    lookup_tlb_set (super_tlb_set (asid, superpage), asid, superpage);
+                entry != nullptr)
+            {
+                m_tlb_stats.hits++;
+                m_tlb_stats.superpage_hits++;
+                ppage = entry->ppage + (vpage & (kSuperpagePages - 1));
+                return true;
+            }
+        }
+
+        m_tlb_stats.misses++;
+        return false;
+    }
+
+    /**
+     * @brief             Cache the translation of a virtual page, replacing the least recently
+     *                     used one of its set if the set is full.
+     *
+     * @param             asid: Address space of the page.
+     * @param             vpage: Virtual page.
+     * @param             ppage: Physical page it maps to.
+     * @param             superpage: Whether the page is in a superpage, whose translation is
+     *                     cached instead.
+     */
+    void fill_tlb (word asid, word vpage, word ppage, bool superpage = false);
+
+    /**
+     * @brief             Make a page table the one of the current process.
+     *
+     * @param             ptable: Page table, nullptr for no current process.
+     */
+    void switch_table (PageTable *ptable);
 
     /**
      * @brief            Free PIDs not in use by any process.
@@ -388,34 +922,10 @@ class VirtualMemory
     PageTable *m_cur_ptable = nullptr;
 
     /**
-     * @brief             LRU_Node keeps track of the corresponding physical page and maintains
-     *                     linkages to the next and previous nodes in the LRU list.
+     * @brief             Picks the physical page to evict, told about every page brought into
+     *                     memory, accessed through a translation and freed.
      */
-    struct LRU_Node
-    {
-        word ppage;     /* Corresponding physical page. */
-        LRU_Node *next; /* Next node in the list. */
-        LRU_Node *prev; /* Previous node in the list. */
-    };
-
-    /**
-     * @brief            Beginning of the LRU list. Points to the least recently used physical
-     *                     page.
-     *
-     */
-    LRU_Node *m_lru_head = nullptr;
-
-    /**
-     * @brief            End of the LRU list. Points to the most recently used physical page.
-     *
-     */
-    LRU_Node *m_lru_tail = nullptr;
-
-    /**
-     * @brief            Maps a physical page address to the LRU_Node corresponding to it in the
-     *                     LRU list.
-     */
-    std::unordered_map<word, LRU_Node *> m_lru_map;
+    ReplacementPolicy *m_replacement = new LRUPolicy ();
 
     /**
      * @brief             Ensures that the virtual memory page tables memory mappings are valid.
@@ -423,24 +933,24 @@ class VirtualMemory
     void check_vm ();
 
     /**
-     * @brief             Adds a physical page that was just used to the list.
-     *
-     * @param             ppage: Physical page address.
+     * @brief             Key of the contents of a physical page for the replacement policy,
+     *                     the first virtual page that maps it.
      */
-    void add_lru (word ppage);
+    inline U64 replacement_key (const PhysicalPage &page)
+    {
+        const MappedVPage &first = page.mapped_vpages.at (0);
+        return (U64 (first.pid) << (8 * sizeof (word))) | first.vpage;
+    }
 
     /**
-     * @brief             Removes the least recently used physical page from the list.
+     * @brief             Picks the physical page to evict with the replacement policy among
+     *                     the pages mapped by at most one virtual page. Shared pages stay in
+     *                     memory, since eviction writes back a single disk page.
      *
-     * @return             Physical page address that was least recently used.
+     * @throws            VirtualMemoryException when every page in use is shared.
+     * @return             Physical page address to evict.
      */
-    word remove_lru ();
-
-    /**
-     * @brief            Ensures the LRU (least recently used) of the in use physical pages
-     *                     are valid.
-     */
-    void check_lru ();
+    word select_victim ();
 
     /**
      * @brief             Removes the physical page and writes it back to disk, freeing up a
@@ -453,16 +963,27 @@ class VirtualMemory
     void evict_ppage (word ppage, Exception &exception);
 
     /**
-     * @brief             Maps a virtual page to a specific physical page of the process
-     *                     corresponding to the given pid.
+     * @brief             Gives a copy on write virtual page a physical page of its own, unless
+     *                     no other virtual page maps its physical page anymore.
      *
-     * @throw             InvalidPIDException is pid is invalid.
-     * @param             pid: ID of the process to map a virtual page.
-     * @param             vpage: Virtual page to map.
+     * @param             pid: Process of the virtual page.
+     * @param             vpage: Virtual page.
+     * @param             entry: Entry of the virtual page, in memory.
+     * @param             exception: Exception is thrown since the page has to be copied by the
+     *                     caller.
+     * @return             Physical page the virtual page now maps to.
+     */
+    word copy_on_write (long long pid, word vpage, PageTableEntry *entry, Exception &exception);
+
+    /**
+     * @brief             Brings a virtual page on disk into a specific physical page.
+     *
+     * @param             ptable: Page table of the process to map a virtual page.
+     * @param             vpage: Virtual page to map, on disk.
      * @param             ppage: Physical page to map to.
      * @param             exception: Exception is thrown whenever there is a page fault to handle.
      */
-    void map_vpage_to_ppage (long long pid, word vpage, word ppage, Exception &exception);
+    void map_vpage_to_ppage (PageTable *ptable, word vpage, word ppage, Exception &exception);
 
     /**
      * @brief             Maps a new virtual page to a physical page of the specified process.
@@ -523,43 +1044,35 @@ class VirtualMemory
     {
         // check_vm();
 
-        word tlb_addr = vpage & (kMaxTLBSize - 1);
-
         /*
-         * Unlikely that the virtual page has not been accessed recently.
+         * Likely that the virtual page has been accessed recently.
          *
          * The TLB (Translation Lookaside Buffer) helps avoid expensive calls to the entry
          * mapping. Recently accessed virtual pages will have the translation stored in the
          * buffer.
          */
-        if (UNLIKELY (!m_tlb[tlb_addr].valid || m_tlb[tlb_addr].pid != ptable->pid
-                      || m_tlb[tlb_addr].vpage != vpage))
+        const word asid = ptable->pid;
+        if (word ppage; LIKELY (lookup_tlb (asid, vpage, ppage)))
         {
-            /*
-             * Unlikely that the virtual page accesses is an unmapped virtual page.
-             */
-            if (UNLIKELY (ptable->entries.find (vpage) == ptable->entries.end ()))
-            {
-                throw VirtualMemoryException ("SIGSEGV");
-            }
-            else if (!ptable->entries.at (vpage)->disk)
-            {
-                /*
-                 * Update the TLB with the result of the translation of virtual page to
-                 * physical page.
-                 */
-                m_tlb[tlb_addr].valid = true;
-                m_tlb[tlb_addr].pid = ptable->pid;
-                m_tlb[tlb_addr].vpage = vpage;
-                m_tlb[tlb_addr].ppage = ptable->entries.at (vpage)->ppage;
-            }
+            m_replacement->access (ppage);
+            return ppage; // translation exists in the buffer.
         }
-        else
+
+        /*
+         * Unlikely that the virtual page accesses is an unmapped virtual page.
+         */
+        PageTableEntry *entry = find_entry (ptable, vpage);
+        if (UNLIKELY (entry == nullptr))
         {
-            return m_tlb[tlb_addr].ppage; // translation exists in the buffer.
-        }
+            if (const PageTableEntry *super = find_superpage (ptable, vpage); super != nullptr)
+            {
+                const word ppage = super->frame + (vpage & (kSuperpagePages - 1));
+                fill_tlb (asid, vpage, ppage, true);
+                return ppage;
+            }
 
-        PageTableEntry *entry = ptable->entries.at (vpage);
+            throw VirtualMemoryException ("SIGSEGV");
+        }
 
         /*
          * Likely that the virtual page being accessed has not been evicted to the disk.
@@ -567,8 +1080,10 @@ class VirtualMemory
         if (LIKELY (!entry->disk))
         {
             // DEBUG("accessing virtual page (NOT ON DISK) {} (maps to {}) of process {}",
-            // vpage, entry->ppage, ptable->pid);
-            return entry->ppage;
+            // vpage, entry->frame, ptable->pid);
+            fill_tlb (asid, vpage, entry->frame);
+            m_replacement->access (entry->frame);
+            return entry->frame;
         }
 
         // DEBUG("BRINGING PAGE ONTO RAM");
@@ -585,12 +1100,13 @@ class VirtualMemory
              * Since the virtual page is mapped to a physical page on disk, we can assume it was
              * evicted and some other page is in use at the spot.
              */
-            if (LIKELY (m_physical_memory_map[entry->mapped_ppage].used))
+            const word mapped_ppage = ptable->mapped_ppages.at (vpage);
+            if (LIKELY (m_physical_memory_map[mapped_ppage].used))
             {
-                evict_ppage (entry->mapped_ppage, exception);
+                evict_ppage (mapped_ppage, exception);
             }
 
-            map_vpage_to_ppage (ptable->pid, vpage, entry->mapped_ppage, exception);
+            map_vpage_to_ppage (ptable, vpage, mapped_ppage, exception);
         }
         else
         {
@@ -599,17 +1115,18 @@ class VirtualMemory
              */
             if (UNLIKELY (!m_freelist.can_fit (1)))
             {
-                evict_ppage (remove_lru (), exception);
+                evict_ppage (select_victim (), exception);
             }
 
             word ppage = m_freelist.get_free_block (1);
-            map_vpage_to_ppage (ptable->pid, vpage, ppage, exception);
+            map_vpage_to_ppage (ptable, vpage, ppage, exception);
         }
 
         // DEBUG("Accessing virtual page {} (maps to {}) of process {}.",
-        // vpage, entry->ppage, ptable->pid);
+        // vpage, entry->frame, ptable->pid);
 
-        return entry->ppage;
+        fill_tlb (asid, vpage, entry->frame);
+        return entry->frame;
     }
 
     /**
@@ -646,4 +1163,70 @@ class VirtualMemory
 
         return access_vpage (m_cur_ptable, vpage, exception);
     }
+
+  public:
+    /**
+     * @brief            Copy of the processes, their page tables, the bookkeeping of the
+     *                    physical pages and the disk pages the tables refer to, taken by
+     *                    @ref save_state.
+     */
+    struct State
+    {
+        struct Table
+        {
+            long long pid;
+            bool kernel_privilege;
+            std::vector<std::pair<word, PageTableEntry>> entries; /* vpage and its entry */
+            std::unordered_map<word, word> mapped_ppages;
+            std::vector<std::pair<word, PageTableEntry>> superpages; /* first vpage and entry */
+        };
+
+        struct MappedPage
+        {
+            word ppage;
+            bool used;
+            bool dirty;
+            std::vector<MappedVPage> vpages; /* in mapping order */
+        };
+
+        U64 version = 0;
+        bool enabled = true;
+        long long current_pid = -1;
+        std::vector<Table> tables;
+        std::vector<MappedPage> mapped_pages;
+        std::vector<U64> replacement; /* from ReplacementPolicy::save */
+        std::vector<std::pair<word, word>> free_pids;
+        std::vector<std::pair<word, word>> free_ppages;
+        std::vector<PermissionRange> permissions;
+        std::vector<std::pair<word, word>> free_disk_pages;
+        std::vector<std::pair<word, std::vector<byte>>> disk_pages; /* disk page and contents */
+    };
+
+    /**
+     * @brief             Copy the state of the virtual memory.
+     *
+     * @return             State to give to @ref restore_state.
+     */
+    State save_state ();
+
+    /**
+     * @brief             Return to a saved state.
+     *
+     * @details            If the page tables did not change since the state was saved, only the
+     *                     current process is switched back. Otherwise they are rebuilt from the
+     *                     copy, and the free disk pages and the contents of the disk pages they
+     *                     refer to are put back, since pages brought in since may have returned
+     *                     their disk pages to be reused. The replacement policy has to be of the
+     *                     kind in use when the state was saved, its statistics are kept.
+     *
+     * @param             state: State returned by @ref save_state of this object.
+     */
+    void restore_state (const State &state);
+
+  private:
+    /**
+     * @brief             Physical pages with bookkeeping that differs from a fresh
+     *                     @ref PhysicalPage, excluding the permissions.
+     */
+    std::vector<word> mapped_ppages ();
 };
@@ -0,0 +1,176 @@
+#include "emulator32bit/decode_cache.h"
+
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @internal
+ * @brief                   Whether an instruction ends a basic block. Branches and software
+ *                          interrupts change the pc, special instructions can change the
+ *                          processor state or halt.
+ *
+ */
+static bool ends_block (const word raw)
+{
+    switch (bitfield_unsigned (raw, 26, 6))
+    {
+    case Emulator32bit::_op_special_instructions:
+    case Emulator32bit::_op_b:
+    case Emulator32bit::_op_bl:
+    case Emulator32bit::_op_bx:
+    case Emulator32bit::_op_blx:
+    case Emulator32bit::_op_swi:
+        return true;
+    default:
+        return false;
+    }
+}
+
+DecodeCache::DecodeCache (Emulator32bit *processor) :
+    m_processor (processor),
+    m_system_bus (processor->system_bus),
+    m_lo_page (processor->system_bus->ram->get_lo_page ()),
+    m_pages (processor->system_bus->ram->get_mem_pages (), nullptr)
+{
+    m_uncached.instrs = &m_uncached_instr;
+    m_uncached.ninstrs = 1;
+    m_uncached.hotness = ~word (0); /* its instruction changes on every fetch, never compile it */
+}
+
+DecodeCache::~DecodeCache ()
+{
+    for (DecodedPage *page : m_pages)
+    {
+        if (page != nullptr)
+        {
+            clear_page (page);
+            delete page;
+        }
+    }
+}
+
+void DecodeCache::invalidate_page (word ppage)
+{
+    const word index = ppage - m_lo_page;
+    if (index < m_pages.size () && m_pages[index] != nullptr)
+    {
+        m_pages[index]->stale = true;
+        m_epoch++;
+    }
+}
+
+void DecodeCache::invalidate_all ()
+{
+    for (DecodedPage *page : m_pages)
+    {
+        if (page != nullptr)
+        {
+            page->stale = true;
+        }
+    }
+    m_epoch++;
+}
+
+DecodeCache::Block *DecodeCache::next_block_slow (Block *prev, word pc)
+{
+    const U64 epoch = m_epoch;
+    Block *block = fetch_block (m_system_bus->translate_fetch_address (pc));
+
+    /*
+     * Translating the pc can page in over decoded instructions, which may have freed the
+     * previous block.
+     */
+    if (prev == nullptr || block == &m_uncached || epoch != m_epoch)
+    {
+        return block;
+    }
+
+    prev->links[1] = prev->links[0];
+    prev->links[0] = Link{
+        .pc = pc,
+        .epoch = m_epoch,
+        .generation = m_system_bus->mmu->generation (),
+        .asid = m_system_bus->mmu->current_asid (),
+        .block = block,
+    };
+    return block;
+}
+
+DecodeCache::Block *DecodeCache::fetch_block (word paddr)
+{
+    const word ppage = paddr >> kNumPageOffsetBits;
+    const word index = ppage - m_lo_page;
+
+    if (UNLIKELY (index >= m_pages.size ()))
+    {
+        m_processor->decode (m_system_bus->read_physical_word (paddr), m_uncached_instr);
+        m_uncached.cycles = m_uncached_instr.cycles;
+        return &m_uncached;
+    }
+
+    DecodedPage *&page = m_pages[index];
+    if (UNLIKELY (page == nullptr))
+    {
+        page = new DecodedPage ();
+        m_system_bus->watch_code_page (ppage);
+    }
+    else if (UNLIKELY (page->stale))
+    {
+        clear_page (page);
+        m_system_bus->watch_code_page (ppage);
+    }
+
+    const word first = (paddr & (kPageSize - 1)) >> 2;
+    if (LIKELY (page->blocks[first] != nullptr))
+    {
+        return page->blocks[first];
+    }
+
+    word last = first;
+    while (true)
+    {
+        Emulator32bit::DecodedInstr &instr = page->instrs[last];
+        if (instr.handler == nullptr)
+        {
+            const word raw = m_system_bus->ram->read_word_aligned (
+                (ppage << kNumPageOffsetBits) + (last << 2));
+            m_processor->decode (raw, instr);
+        }
+
+        if (ends_block (instr.raw) || last + 1 == kInstrsPerPage)
+        {
+            break;
+        }
+        last++;
+    }
+
+    for (word i = first; i < last; i++)
+    {
+        m_processor->fuse (page->instrs[i], page->instrs[i + 1]);
+    }
+
+    Block *block = new Block ();
+    block->instrs = &page->instrs[first];
+    block->ninstrs = last - first + 1;
+    for (word i = first; i <= last; i++)
+    {
+        block->cycles += page->instrs[i].cycles;
+    }
+    page->blocks[first] = block;
+    return block;
+}
+
+void DecodeCache::clear_page (DecodedPage *page)
+{
+    for (Block *&block : page->blocks)
+    {
+        delete block;
+        block = nullptr;
+    }
+
+    std::fill (std::begin (page->instrs), std::end (page->instrs), Emulator32bit::DecodedInstr ());
+    page->stale = false;
+
+    /* the blocks are gone, including any the caller is about to link from */
+    m_epoch++;
+}
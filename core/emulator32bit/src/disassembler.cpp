@@ -2,6 +2,8 @@
 #include "util/common.h"
 #include "util/logger.h"
 
+#include <mutex>
+
 static std::string disassemble_gpr (word instruction, U8 offset)
 {
     const U8 gpr = bitfield_unsigned (instruction, offset, 5);
@@ -672,15 +674,8 @@ static std::string disassemble_adrp (word instruction)
 using DisassemblerFunction = std::string (*) (word);
 static DisassemblerFunction _disassembler_instructions[Emulator32bit::kMaxInstructions];
 
-static void disassembler_init ()
+static void fill_disassembler_instructions ()
 {
-    static bool init = false;
-    if (init)
-    {
-        return;
-    }
-    init = true;
-
     for (U8 i = 0; i < Emulator32bit::kMaxInstructions; i++)
     {
         _disassembler_instructions[i] = disassemble_nop;
@@ -739,6 +734,12 @@ static void disassembler_init ()
     _INSTR (adrp)
 }
 
+static void disassembler_init ()
+{
+    static std::once_flag init;
+    std::call_once (init, fill_disassembler_instructions);
+}
+
 std::string Emulator32bit::disassemble_instr (word instr)
 {
     disassembler_init ();
@@ -5,6 +5,9 @@
 #define AEMU_ONLY_CRITICAL_LOG
 #include "util/logger.h"
 
+#include <algorithm>
+#include <cstring>
+
 /*
  * Located at the beginning of disk and the disk page management files
  * to detect invlaid disk/disk management files.
@@ -31,6 +34,18 @@ Disk::Disk () :
     this->m_cache = new CachePage[AEMU_DISK_CACHE_SIZE]; /* so destructor can work. */
 }
 
+Disk::Disk (const Disk &other) :
+    BaseMemory (other),
+    m_diskfile (other.m_diskfile),
+    m_diskfile_manager (other.m_diskfile_manager),
+    m_npages (other.m_npages),
+    m_cache (new CachePage[AEMU_DISK_CACHE_SIZE]),
+    n_acc (other.n_acc),
+    m_free_list (other.m_free_list)
+{
+    std::copy (other.m_cache, other.m_cache + AEMU_DISK_CACHE_SIZE, m_cache);
+}
+
 void Disk::read_disk_files ()
 {
     /*
@@ -176,18 +191,31 @@ void Disk::return_pages (word page_lo, word page_hi)
     DEBUG ("Returned all disk pages from {} to {} back to disk.", page_lo, page_hi);
 }
 
-std::vector<byte> Disk::read_page (word page)
+std::vector<std::pair<word, word>> Disk::get_free_pages ()
 {
-    CachePage &cpage = get_cpage (page);
+    return m_free_list.get_blocks ();
+}
 
+void Disk::restore_free_pages (const std::vector<std::pair<word, word>> &blocks)
+{
+    m_free_list.restore_blocks (blocks);
+
+    DEBUG ("Restored {} free disk page blocks.", blocks.size ());
+}
+
+std::vector<byte> Disk::read_page (word page)
+{
     std::vector<byte> data (kPageSize);
-    for (word i = 0; i < kPageSize; i++)
-    {
-        data.push_back (cpage.data[i]);
-    }
+    read_page (page, data.data ());
+    return data;
+}
+
+void Disk::read_page (word page, byte *data)
+{
+    CachePage &cpage = get_cpage (page);
+    std::memcpy (data, cpage.data, kPageSize);
 
     DEBUG ("Reading disk page {}.", page);
-    return data;
 }
 
 byte Disk::read_byte (word address)
@@ -213,7 +241,7 @@ dword Disk::read_val (word address, int n_bytes)
     address += n_bytes - 1;
     word page = address >> kNumPageOffsetBits; /* Get the page address (upper bits). */
     word offset = address & (kPageSize - 1);   /* Offset into the page (lower bits). */
-    CachePage &cpage = get_cpage (page);
+    CachePage *cpage = &get_cpage (page);
 
     dword val = 0;
     for (int i = 0; i < n_bytes; i++)
@@ -226,11 +254,11 @@ dword Disk::read_val (word address, int n_bytes)
              */
             offset = kPageSize - 1;
             page--;
-            cpage = get_cpage (page);
+            cpage = &get_cpage (page);
         }
 
         val <<= 8;
-        val += cpage.data[offset];
+        val += cpage->data[offset];
         offset--;
     }
     return val;
@@ -248,12 +276,14 @@ void Disk::write_page (word page, std::vector<byte> data)
         return;
     }
 
+    write_page (page, data.data ());
+}
+
+void Disk::write_page (word page, const byte *data)
+{
     CachePage &cpage = get_cpage (page);
     cpage.dirty = true; /* Mark as dirty since it is written to. */
-    for (word i = 0; i < kPageSize; i++)
-    {
-        cpage.data[i] = data.at (i);
-    }
+    std::memcpy (cpage.data, data, kPageSize);
 
     DEBUG ("Wrote to disk page {}.", cpage.page);
 }
@@ -279,8 +309,8 @@ void Disk::write_val (word address, dword val, int n_bytes)
 
     word page = address >> kNumPageOffsetBits; /* Get the page address (upper bits). */
     word offset = address & (kPageSize - 1);   /* Offset into the page (lower bits). */
-    CachePage &cpage = get_cpage (page);
-    cpage.dirty = true;
+    CachePage *cpage = &get_cpage (page);
+    cpage->dirty = true;
 
     /* Write the bytes in little endian. */
     for (int i = 0; i < n_bytes; i++)
@@ -294,29 +324,28 @@ void Disk::write_val (word address, dword val, int n_bytes)
 
             offset = 0;
             page++;
-            cpage = get_cpage (page);
-            cpage.dirty = true;
+            cpage = &get_cpage (page);
+            cpage->dirty = true;
         }
 
-        cpage.data[offset] = val & 0xFF; /* Get lower 8 bits. */
+        cpage->data[offset] = val & 0xFF; /* Get lower 8 bits. */
         val >>= 8;
         offset++;
     }
 }
 
-/* TODO: Perhaps the addr parameter should instead be the page address. It would make more sense. */
-Disk::CachePage &Disk::get_cpage (word addr)
+Disk::CachePage &Disk::get_cpage (word page)
 {
-    if (addr >= m_npages)
+    if (page >= m_npages)
     {
         /* TODO: Should handle case where page is invalid. */
     }
 
     /* Bitwise AND does the same as modulus to index into table since cache size is a power of 2. */
-    CachePage &cpage = m_cache[(addr >> kNumPageOffsetBits) & (AEMU_DISK_CACHE_SIZE - 1)];
+    CachePage &cpage = m_cache[page & (AEMU_DISK_CACHE_SIZE - 1)];
 
     cpage.last_acc = n_acc++; /* LRU information, but unused for now. */
-    if (cpage.valid && cpage.page == addr)
+    if (cpage.valid && cpage.page == page)
     {
         return cpage;
     }
@@ -327,7 +356,8 @@ Disk::CachePage &Disk::get_cpage (word addr)
     }
 
     cpage.valid = true;
-    cpage.page = addr;
+    cpage.dirty = false;
+    cpage.page = page;
     read_cpage (cpage);
 
     DEBUG ("Getting cached page {}.", cpage.page);
@@ -354,12 +384,7 @@ void Disk::write_cpage (CachePage &cpage)
         ERROR ("Error seeking position in disk file");
     }
 
-    std::vector<char> data;
-    for (word i = 0; i < kPageSize; i++)
-    {
-        data.push_back (cpage.data[i]);
-    }
-    file.write (data.data (), kPageSize);
+    file.write ((const char *) cpage.data, kPageSize);
 
     file.close ();
     DEBUG ("Successfully wrote page {} to disk.", cpage.page);
@@ -383,8 +408,7 @@ void Disk::read_cpage (CachePage &cpage)
         return;
     }
 
-    std::vector<char> buffer (kPageSize);
-    file.read (buffer.data (), kPageSize);
+    file.read ((char *) cpage.data, kPageSize);
 
     if (!file)
     {
@@ -393,10 +417,6 @@ void Disk::read_cpage (CachePage &cpage)
         return;
     }
 
-    for (word i = 0; i < kPageSize; i++)
-    {
-        cpage.data[i] = buffer[i];
-    }
     file.close ();
     DEBUG ("Successfully read page {} from disk.", cpage.page);
 }
@@ -487,10 +507,20 @@ void MockDisk::return_pages (word page_lo, word page_hi)
     UNUSED (page_hi);
 }
 
-std::vector<byte> MockDisk::read_page (word page)
+std::vector<std::pair<word, word>> MockDisk::get_free_pages ()
+{
+    return {};
+}
+
+void MockDisk::restore_free_pages (const std::vector<std::pair<word, word>> &blocks)
+{
+    UNUSED (blocks);
+}
+
+void MockDisk::read_page (word page, byte *data)
 {
     UNUSED (page);
-    return std::vector<byte> ();
+    std::memset (data, 0, kPageSize);
 }
 
 byte MockDisk::read_byte (word address)
@@ -511,7 +541,7 @@ word MockDisk::read_word (word address)
     return 0;
 }
 
-void MockDisk::write_page (word page, std::vector<byte> data)
+void MockDisk::write_page (word page, const byte *data)
 {
     UNUSED (page);
     UNUSED (data);
@@ -0,0 +1,143 @@
+#include "emulator32bit/dma.h"
+
+#include "emulator32bit/system_bus.h"
+
+#include <cstring>
+
+DMAController::DMAController (SystemBus *bus) :
+    m_bus (bus)
+{
+}
+
+void DMAController::transfer (const Descriptor &descriptor)
+{
+    /* a page of RAM and a device page would otherwise treat the offset differently */
+    if (!is_aligned (descriptor))
+    {
+        throw SystemBus::Exception ("DMA address is not page aligned.");
+    }
+
+    for (word i = 0; i < descriptor.npages; i++)
+    {
+        const word paddr = descriptor.paddr + (i << kNumPageOffsetBits);
+        const word disk_page = descriptor.disk_page + i;
+        const SystemBus::PhysicalPage &page = m_bus->route_page (paddr);
+
+        if (descriptor.direction == Direction::DISK_TO_MEMORY)
+        {
+            if (page.host != nullptr)
+            {
+                m_bus->notify_write (paddr, kPageSize);
+                m_bus->disk->read_page (disk_page, page.host);
+            }
+            else
+            {
+                byte data[kPageSize];
+                m_bus->disk->read_page (disk_page, data);
+                m_bus->write_physical_block (paddr, data, kPageSize);
+            }
+        }
+        else
+        {
+            if (page.host != nullptr)
+            {
+                m_bus->disk->write_page (disk_page, page.host);
+            }
+            else
+            {
+                byte data[kPageSize];
+                m_bus->read_physical_block (paddr, data, kPageSize);
+                m_bus->disk->write_page (disk_page, data);
+            }
+        }
+
+        m_bus->charge_disk_page ();
+    }
+}
+
+void DMAController::submit (const Descriptor &descriptor)
+{
+    if (!is_aligned (descriptor))
+    {
+        throw SystemBus::Exception ("DMA address is not page aligned.");
+    }
+    m_queue.push_back (descriptor);
+}
+
+void DMAController::run ()
+{
+    while (!m_queue.empty ())
+    {
+        const Descriptor descriptor = m_queue.front ();
+        m_queue.pop_front ();
+
+        transfer (descriptor);
+        m_completed++;
+        if (m_on_complete)
+        {
+            m_on_complete (descriptor);
+        }
+    }
+}
+
+/*
+    Guest registers
+*/
+DMADevice::DMADevice (word start_page, DMAController *dma) :
+    MMIODevice (1, start_page),
+    m_dma (dma)
+{
+    m_dma->set_completion_handler ([this] (const DMAController::Descriptor &)
+                                   { m_unacknowledged++; });
+}
+
+word DMADevice::read_register (word offset)
+{
+    switch (offset)
+    {
+    case kAddressRegister:
+        return m_descriptor.paddr;
+    case kDiskPageRegister:
+        return m_descriptor.disk_page;
+    case kPageCountRegister:
+        return m_descriptor.npages;
+    case kStatusRegister:
+        return m_unacknowledged | (m_error ? kStatusError : 0);
+    default:
+        return 0;
+    }
+}
+
+void DMADevice::write_register (word offset, word value)
+{
+    switch (offset)
+    {
+    case kAddressRegister:
+        m_descriptor.paddr = value;
+        break;
+    case kDiskPageRegister:
+        m_descriptor.disk_page = value;
+        break;
+    case kPageCountRegister:
+        m_descriptor.npages = value;
+        break;
+    case kControlRegister:
+        m_descriptor.direction = (value & kControlToDisk)
+                                     ? DMAController::Direction::MEMORY_TO_DISK
+                                     : DMAController::Direction::DISK_TO_MEMORY;
+        if (!DMAController::is_aligned (m_descriptor))
+        {
+            m_error = true;
+            break;
+        }
+        m_dma->submit (m_descriptor);
+        m_dma->run ();
+        break;
+    case kStatusRegister:
+        m_unacknowledged = 0;
+        m_error = false;
+        break;
+    default:
+        break;
+    }
+}
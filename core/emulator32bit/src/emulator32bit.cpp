@@ -1,18 +1,34 @@
 
 #include "emulator32bit/emulator32bit.h"
+#include "emulator32bit/decode_cache.h"
+#include "emulator32bit/jit.h"
 #include "emulator32bit/kernel/better_virtual_memory.h"
 #include "emulator32bit/timer.h"
+#include "emulator32bit/trace.h"
 #include "emulator32bit/virtual_memory.h"
 #include "util/types.h"
 
+#define AEMU_ONLY_CRITICAL_LOG
+#include "util/logger.h"
+
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 
 Emulator32bit::Emulator32bit (word ram_npages, word ram_start_page, const byte rom_data[],
-                              word rom_npages, word rom_start_page) :
+                              word rom_npages, word rom_start_page, Backend backend) :
     system_bus (new SystemBus (new RAM (ram_npages, ram_start_page),
-                               new ROM (rom_data, rom_npages, rom_start_page)))
+                               new ROM (rom_data, rom_npages, rom_start_page))),
+    timer (new Timer (this))
 {
     fill_out_instructions ();
+    system_bus->timer = timer;
+    m_decode_cache = new DecodeCache (this);
+    system_bus->decode_cache = m_decode_cache;
+    if (backend == Backend::JIT && JIT::supported ())
+    {
+        m_jit = new JIT (this);
+    }
     reset ();
 }
 
@@ -21,16 +37,78 @@ Emulator32bit::Emulator32bit () :
 {
 }
 
-Emulator32bit::Emulator32bit (RAM *ram, ROM *rom, Disk *disk) :
-    system_bus (new SystemBus (ram, rom, disk, new VirtualMemory (disk)))
+Emulator32bit::Emulator32bit (RAM *ram, ROM *rom, Disk *disk, Backend backend, Paging paging) :
+    system_bus (new SystemBus (ram, rom, disk, new VirtualMemory (disk))),
+    timer (new Timer (this))
 {
+    if (paging == Paging::PAGE_TABLE_WALK)
+    {
+        const word kernel_npages = std::max ((ram->get_mem_pages () - 1) / 4, word (1));
+        const word kernel_low_page = ram->get_lo_page () + 1;
+        system_bus->page_table_mmu = new MMU (this, kernel_low_page + kernel_npages,
+                                              ram->get_hi_page (), kernel_low_page,
+                                              kernel_low_page + kernel_npages - 1);
+    }
+
     fill_out_instructions ();
+    system_bus->timer = timer;
+    m_decode_cache = new DecodeCache (this);
+    system_bus->decode_cache = m_decode_cache;
+    if (backend == Backend::JIT && JIT::supported ())
+    {
+        m_jit = new JIT (this);
+    }
+    reset ();
+}
+
+Emulator32bit::Emulator32bit (SystemBus *shared_bus, word core_id, Backend backend) :
+    system_bus (new SystemBus (shared_bus)),
+    timer (new Timer (this)),
+    m_core_id (core_id)
+{
+    fill_out_instructions ();
+    system_bus->timer = timer;
+    m_decode_cache = new DecodeCache (this);
+    system_bus->decode_cache = m_decode_cache;
+    if (backend == Backend::JIT && JIT::supported ())
+    {
+        m_jit = new JIT (this);
+    }
     reset ();
 }
 
+struct Emulator32bit::Snapshot
+{
+    word x[kNumReg + 1];
+    word pc;
+    word pstate;
+    Timer timer;
+    VirtualMemory::State mmu;
+};
+
 Emulator32bit::~Emulator32bit ()
 {
     delete system_bus;
+    delete timer;
+    delete m_decode_cache;
+    delete m_jit;
+    delete m_snapshot;
+}
+
+void Emulator32bit::set_jit_threshold (word executions)
+{
+    if (m_jit != nullptr)
+    {
+        m_jit->set_hot_threshold (executions);
+    }
+}
+
+void Emulator32bit::set_jit_code_buffer_size (word bytes)
+{
+    if (m_jit != nullptr)
+    {
+        m_jit->set_code_buffer_size (bytes);
+    }
 }
 
 Emulator32bit::Exception::Exception (Emulator32bit::InterruptType type, const std::string &msg) :
@@ -48,7 +126,7 @@ void Emulator32bit::fill_out_instructions ()
 {
     for (int i = 0; i < kMaxInstructions; i++)
     {
-        m_instruction_handler[i] = &Emulator32bit::_hlt;
+        m_instruction_handler[i] = &Emulator32bit::_undefined;
     }
 
 /* fill out instruction functions and construct disassembler instruction mapping */
@@ -127,56 +205,304 @@ void Emulator32bit::print ()
     std::printf ("\nMemory Dump: TODO");
 }
 
+/**
+ * @internal
+ * @brief                   Print why a run stopped, for the runs that report to the console.
+ *
+ */
+static void print_stop (const Emulator32bit::StopReason &reason)
+{
+    if (reason.status == Emulator32bit::RunStatus::FAULT)
+    {
+        std::cerr << "Caught Emulator Exception: " << reason.fault << std::endl;
+    }
+    std::printf ("Ran %lu instructions\n", reason.instructions);
+}
+
+Emulator32bit::RunStatus Emulator32bit::run_until (U64 budget, StopReason &reason)
+{
+    NoTrace trace;
+    return run_blocks (budget, trace, reason);
+}
+
 void Emulator32bit::run (U64 instructions)
+{
+    NoTrace trace;
+    StopReason reason;
+    run_blocks (instructions, trace, reason);
+    print_stop (reason);
+}
+
+void Emulator32bit::run (U64 instructions, TraceBuffer &trace)
+{
+    StopReason reason;
+    run_blocks (instructions, trace, reason);
+    print_stop (reason);
+}
+
+void Emulator32bit::add_breakpoint (word addr)
+{
+    m_breakpoints.insert (addr);
+}
+
+void Emulator32bit::remove_breakpoint (word addr)
+{
+    m_breakpoints.erase (addr);
+}
+
+void Emulator32bit::clear_breakpoints ()
+{
+    m_breakpoints.clear ();
+}
+
+word Emulator32bit::instrs_before_breakpoint (word pc, word ninstrs, bool resume) const
+{
+    for (word i = resume ? 1 : 0; i < ninstrs; i++)
+    {
+        if (m_breakpoints.count (pc + (i << 2)) != 0)
+        {
+            return i;
+        }
+    }
+    return ninstrs;
+}
+
+template <typename Trace>
+Emulator32bit::RunStatus Emulator32bit::run_blocks (U64 instructions, Trace &trace,
+                                                    StopReason &reason)
 {
     U64 num_instructions_ran = 0;
+    m_stop = false;
+    reason.status = RunStatus::BUDGET_EXHAUSTED;
+
+    /* block being executed, until its instructions are charged */
+    const DecodeCache::Block *executing = nullptr;
+    U64 block_start = 0;
+    word block_pc = 0;
     try
     {
-        if (instructions == 0)
+        DecodeCache::Block *block = nullptr;
+        while (instructions == 0 || num_instructions_ran < instructions)
         {
-            while (true)
+            if (UNLIKELY (system_bus->has_pending_invalidations ()))
             {
-                const word instr = system_bus->read_word_aligned_ram (m_pc);
-                execute (instr);
+                system_bus->drain_invalidations ();
+                block = nullptr;
+            }
+
+            block = m_decode_cache->next_block (block, m_pc);
+
+            word ninstrs = block->ninstrs;
+            if (instructions != 0 && instructions - num_instructions_ran < ninstrs)
+            {
+                ninstrs = instructions - num_instructions_ran;
+            }
+
+            if (UNLIKELY (!m_breakpoints.empty ()))
+            {
+                ninstrs = instrs_before_breakpoint (m_pc, ninstrs, num_instructions_ran == 0);
+                if (ninstrs == 0)
+                {
+                    reason.status = RunStatus::BREAKPOINT;
+                    break;
+                }
+            }
+
+            /*
+             * m_pc is kept up to date for every instruction so that exceptions report the
+             * faulting instruction. If the block writes over decoded code, leave it and refetch.
+             * A fused pair only runs as one if both instructions fit in the budget.
+             */
+            executing = block;
+            block_start = num_instructions_ran;
+            block_pc = m_pc;
+            const U64 epoch = m_decode_cache->epoch ();
+            word i = 0;
+            if (!Trace::kEnabled && m_jit != nullptr)
+            {
+                /* compiling can run out of code buffer, which drops every decoded page */
+                i = m_jit->run (block, ninstrs);
+                m_pc += i << 2;
+                num_instructions_ran += i;
+                if (UNLIKELY (m_decode_cache->epoch () != epoch))
+                {
+                    block = nullptr;
+                }
+            }
+
+            for (; i < ninstrs; i++)
+            {
+                const DecodedInstr &instr = executing->instrs[i];
+                if constexpr (Trace::kEnabled)
+                {
+                    const word pc = m_pc;
+                    const word mem_addr = trace_mem_addr (instr);
+                    execute (instr);
+                    trace.record (TraceRecord{
+                        .pc = pc,
+                        .instr = instr.raw,
+                        .rd_value = read_reg (instr.xd),
+                        .mem_addr = mem_addr,
+                    });
+                }
+                else if (instr.fused != nullptr && i + 1 < ninstrs)
+                {
+                    (this->*instr.fused) (instr);
+                    i++;
+                    num_instructions_ran++;
+                }
+                else
+                {
+                    execute (instr);
+                }
                 m_pc += 4;
                 num_instructions_ran++;
+
+                if (UNLIKELY (m_decode_cache->epoch () != epoch))
+                {
+                    block = nullptr;
+                    break;
+                }
             }
-        }
-        else
-        {
-            const U64 start_instructions = instructions;
-            while (instructions > 0)
+
+            /* blocks usually run whole, with their cycles already summed up */
+            const word executed = num_instructions_ran - block_start;
+            if (LIKELY (executed == executing->ninstrs))
             {
-                const word instr = system_bus->read_word_aligned_ram (m_pc);
-                execute (instr);
-                m_pc += 4;
-                instructions--;
+                timer->advance (executing->cycles);
+            }
+            else
+            {
+                for (word k = 0; k < executed; k++)
+                {
+                    timer->advance (executing->instrs[k].cycles);
+                }
+            }
+            executing = nullptr;
+
+            if (UNLIKELY (m_stop))
+            {
+                reason.status = m_stop_status;
+                reason.exit_code = m_exit_code;
+                break;
+            }
+
+            if (UNLIKELY (timer->expired ()))
+            {
+                timer->acknowledge ();
+                reason.status = RunStatus::TIMER;
+                break;
+            }
+
+            if (UNLIKELY (m_pending_ipi.load (std::memory_order_relaxed) != 0))
+            {
+                reason.ipi = m_pending_ipi.exchange (0, std::memory_order_acquire);
+                reason.status = RunStatus::IPI;
+                break;
             }
-            num_instructions_ran = start_instructions - instructions;
         }
     }
     catch (const Exception &e)
     {
-        std::cerr << "Caught Emulator Exception: " << e.what () << std::endl;
+        reason.status = RunStatus::FAULT;
+        reason.fault = e.what ();
     }
     catch (const SystemBus::Exception &e)
     {
-        std::cerr << "Caught System Bus Exception: " << e.what () << std::endl;
+        reason.status = RunStatus::FAULT;
+        reason.fault = e.what ();
+    }
+
+    /*
+     * The pc is left at the faulting instruction, past the first instruction of a fused pair if
+     * the second one faulted, so the instructions before it count and are charged.
+     */
+    if (UNLIKELY (executing != nullptr))
+    {
+        const word executed = (m_pc - block_pc) >> 2;
+        num_instructions_ran = block_start + executed;
+        for (word k = 0; k < executed; k++)
+        {
+            timer->advance (executing->instrs[k].cycles);
+        }
     }
 
-    std::printf ("Ran %lu instructions\n", num_instructions_ran);
+    reason.instructions = num_instructions_ran;
+    return reason.status;
 }
 
-void Emulator32bit::reset ()
+void Emulator32bit::snapshot ()
 {
-    system_bus->reset ();
-    static_assert (sizeof (m_x) / sizeof (m_x[0]) == kNumReg);
-    // Set up the masks for registers.
-    for (U8 i = 0; i < kNumReg; i++)
+    system_bus->snapshot_memory ();
+
+    Snapshot *snapshot = new Snapshot{
+        .x = {},
+        .pc = m_pc,
+        .pstate = get_pstate (),
+        .timer = *timer,
+        .mmu = system_bus->mmu->save_state (),
+    };
+    std::copy (std::begin (m_x), std::end (m_x), snapshot->x);
+
+    delete m_snapshot;
+    m_snapshot = snapshot;
+}
+
+void Emulator32bit::restore ()
+{
+    if (m_snapshot == nullptr)
     {
-        m_x[i] = (1ULL << (8 * sizeof (word))) - 1;
+        ERROR ("No snapshot to restore.");
+        return;
     }
-    m_x[register_to_U8 (Register::XZR)] = 0;
+
+    system_bus->mmu->restore_state (m_snapshot->mmu);
+    system_bus->restore_memory ();
+
+    std::copy (std::begin (m_snapshot->x), std::end (m_snapshot->x), m_x);
+    m_pc = m_snapshot->pc;
+    write_pstate (m_snapshot->pstate);
+    m_flag_op = FlagOp::NONE;
+    *timer = m_snapshot->timer;
+    m_pending_ipi = 0;
+}
+
+Emulator32bit::Context Emulator32bit::save_context ()
+{
+    Context context{
+        .x = {},
+        .pc = m_pc,
+        .pstate = get_pstate (),
+    };
+    std::copy (m_x, m_x + kNumReg, context.x);
+    return context;
+}
+
+void Emulator32bit::load_context (const Context &context)
+{
+    std::copy (std::begin (context.x), std::end (context.x), m_x);
+    m_pc = context.pc;
+    m_flag_op = FlagOp::NONE;
+    write_pstate (context.pstate);
+}
+
+void Emulator32bit::write_pstate (word pstate)
+{
+    constexpr word kModeFlags = word (1) << kUserModeFlagBit | word (1) << kRealModeFlagBit;
+    if ((m_pstate ^ pstate) & kModeFlags)
+    {
+        system_bus->require_shared ();
+        system_bus->mmu->bump_generation ();
+    }
+    m_pstate = pstate;
+}
+
+void Emulator32bit::reset ()
+{
+    system_bus->reset ();
+    timer->reset ();
+    std::fill (std::begin (m_x), std::end (m_x), 0);
     m_pstate = 0;
+    m_flag_op = FlagOp::NONE;
     m_pc = 0;
 }
\ No newline at end of file
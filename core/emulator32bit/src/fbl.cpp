@@ -16,6 +16,31 @@ FreeBlockList::FreeBlockList (word begin, word len, bool init) :
     // DEBUG("Initializing Free Block List");
 }
 
+FreeBlockList::FreeBlockList (const FreeBlockList &other) :
+    m_begin (other.m_begin),
+    m_len (other.m_len)
+{
+    FreeBlock *tail = nullptr;
+    for (FreeBlock *cur = other.m_head; cur; cur = cur->next)
+    {
+        FreeBlock *block = new FreeBlock{
+            .addr = cur->addr,
+            .len = cur->len,
+            .prev = tail,
+        };
+
+        if (tail)
+        {
+            tail->next = block;
+        }
+        else
+        {
+            m_head = block;
+        }
+        tail = block;
+    }
+}
+
 FreeBlockList::~FreeBlockList ()
 {
     FreeBlock *cur = m_head;
@@ -80,6 +105,7 @@ void FreeBlockList::remove_block (word addr, word length)
         return;
     }
 
+    word block_addr = cur->addr;
     word remaining_before = addr - cur->addr;
     word remaining_after = cur->addr + cur->len - (addr + length);
 
@@ -87,7 +113,7 @@ void FreeBlockList::remove_block (word addr, word length)
 
     if (remaining_before > 0)
     {
-        return_block (addr, remaining_before);
+        return_block (block_addr, remaining_before);
     }
 
     if (remaining_after > 0)
@@ -122,7 +148,7 @@ FreeBlockList::FreeBlock *FreeBlockList::insert (word addr, word length)
 
     FreeBlock *next = new FreeBlock{
         .addr = addr,
-        .len = 1,
+        .len = length,
         .next = cur->next,
         .prev = cur,
     };
@@ -223,6 +249,25 @@ std::vector<std::pair<word, word>> FreeBlockList::get_blocks ()
     return blocks;
 }
 
+void FreeBlockList::restore_blocks (const std::vector<std::pair<word, word>> &blocks)
+{
+    return_all ();
+
+    word used = m_begin;
+    for (const std::pair<word, word> &block : blocks)
+    {
+        if (block.first > used)
+        {
+            remove_block (used, block.first - used);
+        }
+        used = block.first + block.second;
+    }
+    if (used < m_begin + m_len)
+    {
+        remove_block (used, m_begin + m_len - used);
+    }
+}
+
 void FreeBlockList::print_blocks ()
 {
     std::vector<std::pair<word, word>> blocks = get_blocks ();
@@ -1,9 +1,13 @@
+#include <emulator32bit/decode_cache.h>
 #include <emulator32bit/emulator32bit.h>
+#include <emulator32bit/timer.h>
 
 #include <util/common.h>
 #define AEMU_ONLY_CRITICAL_LOG
 #include <util/logger.h>
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 
 /**
@@ -137,11 +141,10 @@ static bool get_v_flag_sub (const word op1, const word op2)
  *
  */
 #define FORMAT_O__get_arg(instr)                                                                   \
-    (test_bit (instr, 14)                                                                          \
-         ? bitfield_unsigned (instr, 0, 14)                                                        \
-         : calc_shift (read_reg (_X3 (instr)),                                                     \
-                       (Emulator32bit::ShiftType) bitfield_unsigned (instr, 7, 2),                 \
-                       bitfield_unsigned (instr, 2, 2)))
+    (test_bit (instr.flags, kDecodedImmBit)                                                        \
+         ? instr.imm                                                                               \
+         : calc_shift (get_reg (instr.xm), (Emulator32bit::ShiftType) instr.shift,               \
+                       instr.shift_amt))
 
 /**
  * @internal
@@ -269,7 +272,7 @@ word Emulator32bit::asm_format_o3 (const U8 opcode, const bool s, const int xd,
 word Emulator32bit::asm_format_o3 (const U8 opcode, const bool s, const int xd, const int xn,
                                    const int imm14)
 {
-    return Joiner () << JPart (6, opcode) << JPart (1, s) << JPart (5, xd) << 0 << JPart (5, xn)
+    return Joiner () << JPart (6, opcode) << JPart (1, s) << JPart (5, xd) << 1 << JPart (5, xn)
                      << JPart (14, imm14);
 }
 
@@ -306,40 +309,314 @@ word Emulator32bit::asm_format_b2 (const U8 opcode, const ConditionCode cond, co
     return Joiner () << JPart (6, opcode) << JPart (4, word (cond)) << JPart (5, xd) << 17;
 }
 
-void Emulator32bit::_special_instructions (const word instr)
+/**
+ * @internal
+ * @brief                   Register a decoded instruction writes its result to. Writes to xzr go
+ *                          to a slot that is never read, so handlers need no xzr check.
+ *
+ */
+static U8 decode_dest_reg (const U8 reg)
+{
+    return reg == Emulator32bit::register_to_U8 (Emulator32bit::Register::XZR)
+               ? Emulator32bit::kDiscardReg
+               : reg;
+}
+
+/**
+ * @internal
+ * @brief                   Decode the operand of instruction format O, also shared by format M
+ *                          which has the same layout for its register operand
+ *
+ */
+static void decode_format_o_arg (const word raw, Emulator32bit::DecodedInstr &instr)
+{
+    instr.xm = _X3 (raw);
+    instr.shift = bitfield_unsigned (raw, 7, 2);
+    instr.shift_amt = bitfield_unsigned (raw, 2, 5);
+}
+
+void Emulator32bit::decode (const word raw, DecodedInstr &instr)
+{
+    const U8 opcode = bitfield_unsigned (raw, 26, 6);
+    instr = DecodedInstr ();
+    instr.handler = m_instruction_handler[opcode];
+    instr.raw = raw;
+    instr.cycles = Timer::instruction_cycles (raw);
+    instr.flags = set_bit (instr.flags, kDecodedUpdateFlagBit, test_bit (raw, 25));
+
+    switch (opcode)
+    {
+    case _op_special_instructions:
+        switch (bitfield_unsigned (raw, 22, 4))
+        {
+        case kSpecialOpId_hlt:
+            instr.handler = &Emulator32bit::_hlt;
+            break;
+        case kSpecialOpId_nop:
+            instr.handler = &Emulator32bit::_nop;
+            break;
+        case kSpecialOpId_msr:
+            instr.handler = &Emulator32bit::_msr;
+            instr.xd = _SX1 (raw);
+            instr.xn = _SX2 (raw);
+            instr.imm = bitfield_unsigned (raw, 0, 16);
+            instr.flags = set_bit (instr.flags, kDecodedImmBit, test_bit (raw, 16));
+            break;
+        case kSpecialOpId_mrs:
+            instr.handler = &Emulator32bit::_mrs;
+            instr.xd = decode_dest_reg (_SX1 (raw));
+            instr.xn = _SX2 (raw);
+            break;
+        case kSpecialOpId_tlbi:
+            instr.handler = &Emulator32bit::_tlbi;
+            instr.xd = _SX1 (raw);
+            instr.imm = bitfield_unsigned (raw, 0, 16);
+            instr.flags = set_bit (instr.flags, kDecodedImmBit, !test_bit (raw, 16));
+            break;
+        case kSpecialOpId_atomic:
+            instr.xd = decode_dest_reg (_SX1 (raw));
+            instr.xn = _SX2 (raw);
+            instr.xm = _SX3 (raw);
+            instr.imm = bitfield_unsigned (raw, 4, 2);
+            switch (bitfield_unsigned (raw, 0, 4))
+            {
+            case kAtomicId_swp:
+                instr.handler = &Emulator32bit::_swp;
+                break;
+            case kAtomicId_ldadd:
+                instr.handler = &Emulator32bit::_ldadd;
+                break;
+            case kAtomicId_ldclr:
+                instr.handler = &Emulator32bit::_ldclr;
+                break;
+            case kAtomicId_ldset:
+                instr.handler = &Emulator32bit::_ldset;
+                break;
+            default:
+                instr.handler = &Emulator32bit::_atomic;
+            }
+            break;
+        default:
+            break;
+        }
+        break;
+
+    /* format O */
+    case _op_add:
+    case _op_sub:
+    case _op_rsb:
+    case _op_adc:
+    case _op_sbc:
+    case _op_rsc:
+    case _op_mul:
+    case _op_and:
+    case _op_orr:
+    case _op_eor:
+    case _op_bic:
+    case _op_cmp:
+    case _op_cmn:
+    case _op_tst:
+    case _op_teq:
+        instr.xd = decode_dest_reg (_X1 (raw));
+        instr.xn = _X2 (raw);
+        instr.flags = set_bit (instr.flags, kDecodedImmBit, test_bit (raw, 14));
+        if (test_bit (raw, 14))
+        {
+            instr.imm = bitfield_unsigned (raw, 0, 14);
+        }
+        else
+        {
+            decode_format_o_arg (raw, instr);
+        }
+        break;
+
+    /* format O1 */
+    case _op_lsl:
+    case _op_lsr:
+    case _op_asr:
+    case _op_ror:
+        instr.xd = decode_dest_reg (_X1 (raw));
+        instr.xn = _X2 (raw);
+        instr.xm = _X3 (raw);
+        instr.imm = bitfield_unsigned (raw, 2, 5);
+        instr.flags = set_bit (instr.flags, kDecodedImmBit, test_bit (raw, 14));
+        break;
+
+    /* format O2 */
+    case _op_umull:
+    case _op_smull:
+        instr.xd = decode_dest_reg (_X1 (raw));
+        instr.xa = decode_dest_reg (_X2 (raw));
+        instr.xn = _X3 (raw);
+        instr.xm = _X4 (raw);
+        break;
+
+    /* format O3 */
+    case _op_mov:
+    case _op_mvn:
+        instr.xd = decode_dest_reg (_X1 (raw));
+        instr.flags = set_bit (instr.flags, kDecodedImmBit, test_bit (raw, 19));
+        if (test_bit (raw, 19))
+        {
+            instr.imm = bitfield_unsigned (raw, 0, 19);
+        }
+        else
+        {
+            instr.xn = bitfield_unsigned (raw, 14, 5);
+            instr.imm = bitfield_unsigned (raw, 0, 14);
+        }
+        break;
+
+    /* format M */
+    case _op_ldr:
+    case _op_ldrb:
+    case _op_ldrh:
+    case _op_str:
+    case _op_strb:
+    case _op_strh:
+        /* xt is the source of stores */
+        instr.xd = opcode == _op_ldr || opcode == _op_ldrb || opcode == _op_ldrh
+                       ? decode_dest_reg (_X1 (raw))
+                       : _X1 (raw);
+        instr.xn = _X2 (raw);
+        instr.addr_mode = bitfield_unsigned (raw, 0, 2);
+        instr.flags = set_bit (instr.flags, kDecodedImmBit, test_bit (raw, 14));
+        if (test_bit (raw, 14))
+        {
+            instr.imm = bitfield_signed (raw, 2, 12);
+        }
+        else
+        {
+            decode_format_o_arg (raw, instr);
+        }
+        break;
+
+    /* format M1 */
+    case _op_adrp:
+        instr.xd = decode_dest_reg (_X1 (raw));
+        instr.imm = bitfield_unsigned (raw, 0, 20) << 12;
+        if (test_bit (raw, kInstructionUpdateFlagBit))
+        {
+            instr.imm -= (1 << 20);
+        }
+        break;
+
+    /* format B1 */
+    case _op_b:
+    case _op_bl:
+        instr.cond = bitfield_unsigned (raw, 22, 4);
+        instr.imm = bitfield_signed (raw, 0, 22) << 2;
+        break;
+
+    /* format B2 */
+    case _op_bx:
+    case _op_blx:
+        instr.cond = bitfield_unsigned (raw, 22, 4);
+        instr.xn = bitfield_unsigned (raw, 17, 5);
+        break;
+
+    case _op_swi:
+        instr.cond = bitfield_unsigned (raw, 22, 4);
+        break;
+
+    default:
+        break;
+    }
+}
+
+template <Emulator32bit::DecodedHandler first, Emulator32bit::DecodedHandler second>
+void Emulator32bit::_fused (const DecodedInstr &instr)
 {
-    word opspec = bitfield_unsigned (instr, 22, 4);
+    (this->*first) (instr);
+    m_pc += 4;
+    (this->*second) ((&instr)[1]);
+}
 
-    switch (opspec)
+void Emulator32bit::fuse (DecodedInstr &first, const DecodedInstr &second)
+{
+    const word second_op = bitfield_unsigned (second.raw, 26, 6);
+
+    first.fused = nullptr;
+    switch (bitfield_unsigned (first.raw, 26, 6))
     {
-    case kSpecialOpId_hlt:
-        _hlt (instr);
+    /* compare and branch */
+    case _op_cmp:
+        if (second_op == _op_b)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_cmp, &Emulator32bit::_b>;
+        }
         break;
-    case kSpecialOpId_nop:
-        _nop (instr);
+    case _op_cmn:
+        if (second_op == _op_b)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_cmn, &Emulator32bit::_b>;
+        }
         break;
-    case kSpecialOpId_msr:
-        _msr (instr);
+    case _op_tst:
+        if (second_op == _op_b)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_tst, &Emulator32bit::_b>;
+        }
         break;
-    case kSpecialOpId_mrs:
-        _mrs (instr);
+    case _op_teq:
+        if (second_op == _op_b)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_teq, &Emulator32bit::_b>;
+        }
         break;
-    case kSpecialOpId_tlbi:
-        _tlbi (instr);
+
+    /* loop counters */
+    case _op_sub:
+        if (second_op == _op_cmp)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_sub, &Emulator32bit::_cmp>;
+        }
+        else if (second_op == _op_b)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_sub, &Emulator32bit::_b>;
+        }
         break;
-    case kSpecialOpId_atomic:
-        _atomic (instr);
+
+    /* addresses built by the adrp + add :lo12: and mov :lo19: + mov :hi13: relocation pairs */
+    case _op_adrp:
+        if (second_op == _op_add)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_adrp, &Emulator32bit::_add>;
+        }
+        break;
+    case _op_mov:
+        if (second_op == _op_mov)
+        {
+            first.fused = &Emulator32bit::_fused<&Emulator32bit::_mov, &Emulator32bit::_mov>;
+        }
         break;
     default:
-        throw Exception (Emulator32bit::InterruptType::BAD_INSTR,
-                         "Bad OPSPEC specifier " + std::to_string (opspec));
+        break;
     }
 }
 
-void Emulator32bit::_hlt (const word instr)
+void Emulator32bit::_special_instructions (const DecodedInstr &instr)
+{
+    // Valid specifiers are resolved to their own handler by decode.
+    throw Exception (Emulator32bit::InterruptType::BAD_INSTR,
+                     "Bad OPSPEC specifier "
+                         + std::to_string (bitfield_unsigned (instr.raw, 22, 4)));
+}
+
+void Emulator32bit::_undefined (const DecodedInstr &instr)
+{
+    throw Exception (Emulator32bit::InterruptType::BAD_INSTR,
+                     "Undefined opcode " + std::to_string (bitfield_unsigned (instr.raw, 26, 6)));
+}
+
+void Emulator32bit::_hlt (const DecodedInstr &instr)
 {
     UNUSED (instr);
-    throw Exception (InterruptType::HALT_INSTR, "HLT Exception");
+    m_stop = true;
+    m_stop_status = RunStatus::HALTED;
+
+    /* stay on the hlt instruction */
+    m_pc -= 4;
 }
 
 word Emulator32bit::asm_hlt ()
@@ -347,7 +624,7 @@ word Emulator32bit::asm_hlt ()
     return Joiner () << JPart (6, _op_special_instructions) << JPart (4, kSpecialOpId_hlt) << 22;
 }
 
-void Emulator32bit::_nop (const word instr)
+void Emulator32bit::_nop (const DecodedInstr &instr)
 {
     UNUSED (instr);
     return; // do nothing
@@ -358,17 +635,23 @@ word Emulator32bit::asm_nop ()
     return Joiner () << JPart (6, _op_special_instructions) << JPart (4, kSpecialOpId_nop) << 22;
 }
 
-void Emulator32bit::_msr (const word instr)
+void Emulator32bit::_msr (const DecodedInstr &instr)
 {
-    const word sysreg = _SX1 (instr);
-    const bool imm = test_bit (instr, 16);
-    word val = imm ? bitfield_unsigned (instr, 0, 16) : read_reg (_SX2 (instr));
-
-    (void) (val);
+    const word sysreg = instr.xd;
+    const bool imm = test_bit (instr.flags, kDecodedImmBit);
+    word val = imm ? instr.imm : get_reg (instr.xn);
 
     // TODO
     switch (sysreg)
     {
+    case kSysregId_pstate:
+    {
+        /* user mode can only change the flags */
+        const word writable = get_flag (kUserModeFlagBit) ? word (0b1111) : ~word (0);
+        m_flag_op = FlagOp::NONE;
+        write_pstate ((m_pstate & ~writable) | (val & writable));
+        break;
+    }
     default:
         throw Exception (Emulator32bit::InterruptType::BAD_REG,
                          "System register " + std::to_string (sysreg) + " unimplemented.");
@@ -389,16 +672,23 @@ word Emulator32bit::asm_msr (U8 sysreg, bool imm, word xn_or_imm16)
     }
 }
 
-void Emulator32bit::_mrs (const word instr)
+void Emulator32bit::_mrs (const DecodedInstr &instr)
 {
-    word xn = _SX1 (instr);
-    word sysreg = _SX2 (instr);
-
-    // todo
-    (void) (xn);
-    (void) (sysreg);
+    word xn = instr.xd;
+    word sysreg = instr.xn;
 
-    throw Exception (Emulator32bit::InterruptType::BAD_INSTR, "MRS unimplemented.");
+    switch (sysreg)
+    {
+    case kSysregId_pstate:
+        set_reg (xn, get_pstate ());
+        break;
+    case kSysregId_core:
+        set_reg (xn, m_core_id);
+        break;
+    default:
+        throw Exception (Emulator32bit::InterruptType::BAD_REG,
+                         "System register " + std::to_string (sysreg) + " unimplemented.");
+    }
 }
 
 word Emulator32bit::asm_mrs (U8 xn, U8 sysreg)
@@ -407,57 +697,75 @@ word Emulator32bit::asm_mrs (U8 xn, U8 sysreg)
                      << JPart (5, xn) << 1 << JPart (5, sysreg) << 11;
 }
 
-void Emulator32bit::_tlbi (const word instr)
+void Emulator32bit::_tlbi (const DecodedInstr &instr)
 {
-    word xt = _SX1 (instr);
-    bool isxt = test_bit (instr, 16);
-    word imm16 = bitfield_unsigned (instr, 0, 16);
-
-    // todo
-    (void) (xt);
-    (void) (isxt);
-    (void) (imm16);
+    const U8 xt = instr.xd;
+    const bool isxt = !test_bit (instr.flags, kDecodedImmBit);
 
-    throw Exception (Emulator32bit::InterruptType::BAD_INSTR, "TLBI unimplemented.");
+    /*
+     * tlbi xt, #n drops the translations of n pages (at least one) from the one holding the
+     * address in xt, tlbi #imm all of them or those of the current process
+     */
+    if (isxt)
+    {
+        system_bus->invalidate_tlb_pages (get_reg (xt), std::max<word> (instr.imm, 1));
+    }
+    else if (instr.imm == kTLBIProcess)
+    {
+        system_bus->invalidate_tlb_process ();
+    }
+    else
+    {
+        system_bus->invalidate_tlb_all ();
+    }
 }
 
 word Emulator32bit::asm_tlbi (U8 xt, bool isxt, word imm16)
 {
-    return Joiner () << JPart (6, _op_special_instructions) << JPart (4, kSpecialOpId_mrs)
+    return Joiner () << JPart (6, _op_special_instructions) << JPart (4, kSpecialOpId_tlbi)
                      << JPart (5, xt) << JPart (1, isxt) << JPart (16, imm16);
 }
 
-void Emulator32bit::_atomic (const word instr)
+void Emulator32bit::_atomic (const DecodedInstr &instr)
 {
-    U8 atop = bitfield_unsigned (instr, 0, 4);
+    // Valid atomic ops are resolved to their own handler by decode.
+    throw Exception (Emulator32bit::InterruptType::BAD_INSTR,
+                     "Atomic op " + std::to_string (bitfield_unsigned (instr.raw, 0, 4))
+                         + " unimplemented.");
+}
 
-    switch (atop)
+/**
+ * @internal
+ * @brief                   Apply the operation of an atomic instruction to memory at its width,
+ *                          atomically with respect to the other cores.
+ *
+ * @return                  Value in memory before the operation, zero extended.
+ *
+ */
+static word atomic_rmw (SystemBus *bus, U8 width, word address, SystemBus::AtomicOp op,
+                        word operand)
+{
+    switch (width)
     {
-    case kAtomicId_swp:
-        _swp (instr);
-        break;
-    case kAtomicId_ldadd:
-        _ldadd (instr);
-        break;
-    case kAtomicId_ldclr:
-        _ldclr (instr);
-        break;
-    case kAtomicId_ldset:
-        _ldset (instr);
-        break;
+    case Emulator32bit::kAtomicWidth_word:
+        return bus->atomic<word> (address, op, operand);
+    case Emulator32bit::kAtomicWidth_byte:
+        return bus->atomic<byte> (address, op, operand & 0xFF);
+    case Emulator32bit::kAtomicWidth_hword:
+        return bus->atomic<hword> (address, op, operand & 0xFFFF);
     default:
-        throw Exception (Emulator32bit::InterruptType::BAD_INSTR,
-                         "Atomic op " + std::to_string (atop) + " unimplemented.");
+        ERROR ("Invalid ATOMIC_WIDTH");
+        return 0;
     }
 }
 
-void Emulator32bit::_swp (const word instr)
+void Emulator32bit::_swp (const DecodedInstr &instr)
 {
-    const U8 xt = _SX1 (instr);
-    const U8 xn = _SX2 (instr);
-    const U8 xm = _SX3 (instr);
-    const word mem_adr = read_reg (xm);
-    const U8 width = bitfield_unsigned (instr, 0, 4);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const U8 xm = instr.xm;
+    const word mem_adr = get_reg (xm);
+    const U8 width = instr.imm;
 
     if (width == kAtomicWidth_word)
     {
@@ -478,40 +786,16 @@ void Emulator32bit::_swp (const word instr)
                   << std::to_string (xm) << "]");
     }
 
-    if (width == kAtomicWidth_word)
-    {
-        const word val_reg = read_reg (xn);
-        const word val_mem = system_bus->read_word (mem_adr);
-        write_reg (xt, val_mem);
-        system_bus->write_word (mem_adr, val_reg);
-    }
-    else if (width == kAtomicWidth_byte)
-    {
-        const word val_reg = read_reg (xn) & 0xFF;
-        const word val_mem = system_bus->read_byte (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFF)) + val_mem);
-        system_bus->write_byte (mem_adr, val_reg);
-    }
-    else if (width == kAtomicWidth_hword)
-    {
-        const word val_reg = read_reg (xn) & 0xFFFF;
-        const word val_mem = system_bus->read_hword (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFFFF)) + val_mem);
-        system_bus->write_hword (mem_adr, val_reg);
-    }
-    else
-    {
-        ERROR ("Invalid ATOMIC_WIDTH");
-    }
+    set_reg (xt, atomic_rmw (system_bus, width, mem_adr, SystemBus::AtomicOp::SWAP, get_reg (xn)));
 }
 
-void Emulator32bit::_ldadd (const word instr)
+void Emulator32bit::_ldadd (const DecodedInstr &instr)
 {
-    const U8 xt = _SX1 (instr);
-    const U8 xn = _SX2 (instr);
-    const U8 xm = _SX3 (instr);
-    const word mem_adr = read_reg (xm);
-    const U8 width = bitfield_unsigned (instr, 0, 4);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const U8 xm = instr.xm;
+    const word mem_adr = get_reg (xm);
+    const U8 width = instr.imm;
 
     if (width == kAtomicWidth_word)
     {
@@ -532,40 +816,16 @@ void Emulator32bit::_ldadd (const word instr)
                   << std::to_string (xm) << "]");
     }
 
-    if (width == kAtomicWidth_word)
-    {
-        const word val_reg = read_reg (xn);
-        const word val_mem = system_bus->read_word (mem_adr);
-        write_reg (xt, val_mem);
-        system_bus->write_word (mem_adr, val_mem + val_reg);
-    }
-    else if (width == kAtomicWidth_byte)
-    {
-        const word val_reg = read_reg (xn) & 0xFF;
-        const word val_mem = system_bus->read_byte (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFF)) + val_mem);
-        system_bus->write_byte (mem_adr, val_mem + val_reg);
-    }
-    else if (width == kAtomicWidth_hword)
-    {
-        const word val_reg = read_reg (xn) & 0xFFFF;
-        const word val_mem = system_bus->read_hword (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFFFF)) + val_mem);
-        system_bus->write_hword (mem_adr, val_mem + val_reg);
-    }
-    else
-    {
-        ERROR ("Invalid ATOMIC_WIDTH");
-    }
+    set_reg (xt, atomic_rmw (system_bus, width, mem_adr, SystemBus::AtomicOp::ADD, get_reg (xn)));
 }
 
-void Emulator32bit::_ldclr (const word instr)
+void Emulator32bit::_ldclr (const DecodedInstr &instr)
 {
-    const U8 xt = _SX1 (instr);
-    const U8 xn = _SX2 (instr);
-    const U8 xm = _SX3 (instr);
-    const word mem_adr = read_reg (xm);
-    const U8 width = bitfield_unsigned (instr, 0, 4);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const U8 xm = instr.xm;
+    const word mem_adr = get_reg (xm);
+    const U8 width = instr.imm;
 
     if (width == kAtomicWidth_word)
     {
@@ -586,40 +846,16 @@ void Emulator32bit::_ldclr (const word instr)
                   << std::to_string (xm) << "]");
     }
 
-    if (width == kAtomicWidth_word)
-    {
-        const word val_reg = read_reg (xn);
-        const word val_mem = system_bus->read_word (mem_adr);
-        write_reg (xt, val_mem);
-        system_bus->write_word (mem_adr, val_mem & (~val_reg));
-    }
-    else if (width == kAtomicWidth_byte)
-    {
-        const word val_reg = read_reg (xn) & 0xFF;
-        const word val_mem = system_bus->read_byte (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFF)) + val_mem);
-        system_bus->write_byte (mem_adr, val_mem & (~val_reg));
-    }
-    else if (width == kAtomicWidth_hword)
-    {
-        const word val_reg = read_reg (xn) & 0xFFFF;
-        const word val_mem = system_bus->read_hword (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFFFF)) + val_mem);
-        system_bus->write_hword (mem_adr, val_mem & (~val_reg));
-    }
-    else
-    {
-        ERROR ("Invalid ATOMIC_WIDTH");
-    }
+    set_reg (xt, atomic_rmw (system_bus, width, mem_adr, SystemBus::AtomicOp::CLEAR, get_reg (xn)));
 }
 
-void Emulator32bit::_ldset (const word instr)
+void Emulator32bit::_ldset (const DecodedInstr &instr)
 {
-    const U8 xt = _SX1 (instr);
-    const U8 xn = _SX2 (instr);
-    const U8 xm = _SX3 (instr);
-    const word mem_adr = read_reg (xm);
-    const U8 width = bitfield_unsigned (instr, 0, 4);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const U8 xm = instr.xm;
+    const word mem_adr = get_reg (xm);
+    const U8 width = instr.imm;
 
     if (width == kAtomicWidth_word)
     {
@@ -640,31 +876,7 @@ void Emulator32bit::_ldset (const word instr)
                   << std::to_string (xm) << "]");
     }
 
-    if (width == kAtomicWidth_word)
-    {
-        const word val_reg = read_reg (xn);
-        const word val_mem = system_bus->read_word (mem_adr);
-        write_reg (xt, val_mem);
-        system_bus->write_word (mem_adr, val_mem | val_reg);
-    }
-    else if (width == kAtomicWidth_byte)
-    {
-        const word val_reg = read_reg (xn) & 0xFF;
-        const word val_mem = system_bus->read_byte (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFF)) + val_mem);
-        system_bus->write_byte (mem_adr, val_mem | val_reg);
-    }
-    else if (width == kAtomicWidth_hword)
-    {
-        const word val_reg = read_reg (xn) & 0xFFFF;
-        const word val_mem = system_bus->read_hword (mem_adr);
-        write_reg (xt, (val_reg & ~(0xFFFF)) + val_mem);
-        system_bus->write_hword (mem_adr, val_mem | val_reg);
-    }
-    else
-    {
-        ERROR ("Invalid ATOMIC_WIDTH");
-    }
+    set_reg (xt, atomic_rmw (system_bus, width, mem_adr, SystemBus::AtomicOp::SET, get_reg (xn)));
 }
 
 word Emulator32bit::asm_atomic (word xt, word xn, word xm, U8 width, U8 atop)
@@ -674,74 +886,71 @@ word Emulator32bit::asm_atomic (word xt, word xn, word xm, U8 width, U8 atop)
                      << JPart (4, atop);
 }
 
-void Emulator32bit::_add (const word instr)
+void Emulator32bit::_add (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word add_val = FORMAT_O__get_arg (instr);
     const word dst_val = add_val + xn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_c_flag_add (xn_val, add_val),
-                  get_v_flag_add (xn_val, add_val));
+        set_flags_add (xn_val, add_val, dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "add " << std::to_string (add_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_sub (const word instr)
+void Emulator32bit::_sub (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word sub_val = FORMAT_O__get_arg (instr);
     const word dst_val = xn_val - sub_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_c_flag_sub (xn_val, sub_val),
-                  get_v_flag_sub (xn_val, sub_val));
+        set_flags_sub (xn_val, sub_val, dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "sub " << std::to_string (sub_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_rsb (const word instr)
+void Emulator32bit::_rsb (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word sub_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word sub_val = get_reg (instr.xn);
     const word xn_val = FORMAT_O__get_arg (instr);
     const word dst_val = xn_val - sub_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_c_flag_sub (xn_val, sub_val),
-                  get_v_flag_sub (xn_val, sub_val));
+        set_flags_sub (xn_val, sub_val, dst_val);
     }
 
     DEBUG_SS (std::stringstream ()
               << "rsb " << std::to_string (xn_val) << " " << std::to_string (sub_val) << " = "
               << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_adc (const word instr)
+void Emulator32bit::_adc (const DecodedInstr &instr)
 {
-    const bool c = test_bit (m_pstate, kCFlagBit);
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const bool c = get_flag (kCFlagBit);
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word add_val = FORMAT_O__get_arg (instr);
     const word dst_val = add_val + xn_val + c;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         set_NZCV (test_bit (dst_val, 31), dst_val == 0,
                   get_c_flag_add (xn_val + c, add_val) | get_c_flag_add (xn_val, c),
@@ -750,19 +959,19 @@ void Emulator32bit::_adc (const word instr)
 
     DEBUG_SS (std::stringstream () << "adc " << std::to_string (add_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_sbc (const word instr)
+void Emulator32bit::_sbc (const DecodedInstr &instr)
 {
-    const bool borrow = test_bit (m_pstate, kCFlagBit);
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const bool borrow = get_flag (kCFlagBit);
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word sub_val = FORMAT_O__get_arg (instr);
     const word dst_val = xn_val - sub_val - borrow;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         set_NZCV (test_bit (dst_val, 31), dst_val == 0,
                   get_c_flag_sub (xn_val - borrow, sub_val) | get_c_flag_sub (xn_val, borrow),
@@ -771,19 +980,19 @@ void Emulator32bit::_sbc (const word instr)
 
     DEBUG_SS (std::stringstream () << "sbc " << std::to_string (sub_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_rsc (const word instr)
+void Emulator32bit::_rsc (const DecodedInstr &instr)
 {
-    const bool borrow = test_bit (m_pstate, kCFlagBit);
-    const U8 xd = _X1 (instr);
-    const word sub_val = read_reg (_X2 (instr));
+    const bool borrow = get_flag (kCFlagBit);
+    const U8 xd = instr.xd;
+    const word sub_val = get_reg (instr.xn);
     const word xn_val = FORMAT_O__get_arg (instr);
     const word dst_val = xn_val - sub_val - borrow;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         set_NZCV (test_bit (dst_val, 31), dst_val == 0,
                   get_c_flag_sub (xn_val - borrow, sub_val) | get_c_flag_sub (xn_val, borrow),
@@ -793,394 +1002,384 @@ void Emulator32bit::_rsc (const word instr)
     DEBUG_SS (std::stringstream ()
               << "rsc " << std::to_string (xn_val) << " " << std::to_string (sub_val) << " = "
               << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_mul (const word instr)
+void Emulator32bit::_mul (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    dword xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    dword xn_val = get_reg (instr.xn);
     dword xm_val = FORMAT_O__get_arg (instr);
     dword dst_val = xn_val * xm_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // according to https://developer.arm.com/documentation/dui0473/m/arm-and-thumb-instructions/smull
         // arm's MUL instruction does not set carry or overflow flags
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_flag (kCFlagBit),
+                  get_flag (kVFlagBit));
     }
 
     DEBUG_SS (std::stringstream () << "mul " << std::to_string (xn_val) << " "
                                    << std::to_string (xm_val) << " = " << std::to_string (dst_val));
 
-    write_reg (xd, word (dst_val));
+    set_reg (xd, word (dst_val));
 }
 
-void Emulator32bit::_umull (const word instr)
+void Emulator32bit::_umull (const DecodedInstr &instr)
 {
-    const U8 xlo = _X1 (instr);
-    const U8 xhi = _X2 (instr);
-    dword xn_val = read_reg (_X3 (instr));
-    dword xm_val = read_reg (_X4 (instr));
+    const U8 xlo = instr.xd;
+    const U8 xhi = instr.xa;
+    dword xn_val = get_reg (instr.xn);
+    dword xm_val = get_reg (instr.xm);
     dword dst_val = xn_val * xm_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // according to https://developer.arm.com/documentation/dui0473/m/arm-and-thumb-instructions/umull
         // arm's UMULL instruction does not set carry or overflow flags
-        set_NZCV (test_bit (dst_val, 63), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_NZCV (test_bit (dst_val, 63), dst_val == 0, get_flag (kCFlagBit),
+                  get_flag (kVFlagBit));
     }
 
     DEBUG_SS (std::stringstream () << "mul " << std::to_string (xn_val) << " "
                                    << std::to_string (xm_val) << " = " << std::to_string (dst_val));
 
-    write_reg (xlo, word (dst_val));
-    write_reg (xhi, word (dst_val >> 32));
+    set_reg (xlo, word (dst_val));
+    set_reg (xhi, word (dst_val >> 32));
 }
 
-void Emulator32bit::_smull (const word instr)
+void Emulator32bit::_smull (const DecodedInstr &instr)
 {
-    const U8 xlo = _X1 (instr);
-    const U8 xhi = _X2 (instr);
-    const signed long long xn_val = S64 (read_reg (_X3 (instr))) << 32 >> 32;
-    const signed long long xm_val = S64 (read_reg (_X4 (instr))) << 32 >> 32;
+    const U8 xlo = instr.xd;
+    const U8 xhi = instr.xa;
+    const signed long long xn_val = S64 (get_reg (instr.xn)) << 32 >> 32;
+    const signed long long xm_val = S64 (get_reg (instr.xm)) << 32 >> 32;
     const signed long long dst_val = xn_val * xm_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // according to https://developer.arm.com/documentation/dui0489/c/arm-and-thumb-instructions/multiply-instructions/mul--mla--and-mls
         // arm's UMULL instruction does not set carry or overflow flags
-        set_NZCV (test_bit (dst_val, 63), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_NZCV (test_bit (dst_val, 63), dst_val == 0, get_flag (kCFlagBit),
+                  get_flag (kVFlagBit));
     }
 
     DEBUG_SS (std::stringstream () << "mul " << std::to_string (xn_val) << " "
                                    << std::to_string (xm_val) << " = " << std::to_string (dst_val));
 
-    write_reg (xlo, word (dst_val));
-    write_reg (xhi, word (dst_val >> 32));
+    set_reg (xlo, word (dst_val));
+    set_reg (xhi, word (dst_val >> 32));
 }
 
 // todo WILL DO LATER JUST NOT NOW
-void Emulator32bit::_vabs (const word instr)
+void Emulator32bit::_vabs (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vneg (const word instr)
+void Emulator32bit::_vneg (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vsqrt (const word instr)
+void Emulator32bit::_vsqrt (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vadd (const word instr)
+void Emulator32bit::_vadd (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vsub (const word instr)
+void Emulator32bit::_vsub (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vdiv (const word instr)
+void Emulator32bit::_vdiv (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vmul (const word instr)
+void Emulator32bit::_vmul (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vcmp (const word instr)
+void Emulator32bit::_vcmp (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vsel (const word instr)
+void Emulator32bit::_vsel (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vcint (const word instr)
+void Emulator32bit::_vcint (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vcflo (const word instr)
+void Emulator32bit::_vcflo (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_vmov (const word instr)
+void Emulator32bit::_vmov (const DecodedInstr &instr)
 {
     UNUSED (instr);
 }
 
-void Emulator32bit::_and (const word instr)
+void Emulator32bit::_and (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word and_val = FORMAT_O__get_arg (instr);
     const word dst_val = and_val & xn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // https://developer.arm.com/documentation/dui0489/h/arm-and-thumb-instructions/and--orr--eor--bic--and-orn
         // N and Z flags are set based of the result, C flag may be set based of the calculation for the second operand
         // but will ignore for now
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "and " << std::to_string (and_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_orr (const word instr)
+void Emulator32bit::_orr (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word or_val = FORMAT_O__get_arg (instr);
     const word dst_val = or_val | xn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // https://developer.arm.com/documentation/dui0489/h/arm-and-thumb-instructions/and--orr--eor--bic--and-orn
         // N and Z flags are set based of the result, C flag may be set based of the calculation for the second operand
         // but will ignore for now
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "orr " << std::to_string (or_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_eor (const word instr)
+void Emulator32bit::_eor (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word eor_val = FORMAT_O__get_arg (instr);
     const word dst_val = eor_val ^ xn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // https://developer.arm.com/documentation/dui0489/h/arm-and-thumb-instructions/and--orr--eor--bic--and-orn
         // N and Z flags are set based of the result, C flag may be set based of the calculation for the second operand
         // but will ignore for now
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "eor " << std::to_string (eor_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_bic (const word instr)
+void Emulator32bit::_bic (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word bic_val = FORMAT_O__get_arg (instr);
     const word dst_val = (~bic_val) & xn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
         // https://developer.arm.com/documentation/dui0489/h/arm-and-thumb-instructions/and--orr--eor--bic--and-orn
         // N and Z flags are set based of the result, C flag may be set based of the calculation for the second operand
         // but will ignore for now
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (dst_val);
     }
 
     DEBUG_SS (std::stringstream () << "bic " << std::to_string (bic_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_lsl (const word instr)
+void Emulator32bit::_lsl (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word lsl_val =
-        test_bit (instr, 14) ? bitfield_unsigned (instr, 2, 5) : 0xFF & read_reg (_X3 (instr));
+        test_bit (instr.flags, kDecodedImmBit) ? instr.imm : 0xFF & get_reg (instr.xm);
     const word dst_val = xn_val << lsl_val;
 
     DEBUG_SS (std::stringstream () << "lsl " << std::to_string (lsl_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_lsr (const word instr)
+void Emulator32bit::_lsr (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word lsl_val =
-        test_bit (instr, 14) ? bitfield_unsigned (instr, 2, 5) : 0xFF & read_reg (_X3 (instr));
+        test_bit (instr.flags, kDecodedImmBit) ? instr.imm : 0xFF & get_reg (instr.xm);
     const word dst_val = xn_val >> lsl_val;
 
     DEBUG_SS (std::stringstream () << "lsr " << std::to_string (lsl_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_asr (const word instr)
+void Emulator32bit::_asr (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word lsl_val =
-        test_bit (instr, 14) ? bitfield_unsigned (instr, 2, 5) : 0xFF & read_reg (_X3 (instr));
+        test_bit (instr.flags, kDecodedImmBit) ? instr.imm : 0xFF & get_reg (instr.xm);
     const word dst_val = sword (xn_val) >> lsl_val;
 
     DEBUG_SS (std::stringstream () << "asr " << std::to_string (lsl_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
-void Emulator32bit::_ror (const word instr)
+void Emulator32bit::_ror (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word xn_val = read_reg (_X2 (instr));
+    const U8 xd = instr.xd;
+    const word xn_val = get_reg (instr.xn);
     const word lsl_val =
-        test_bit (instr, 14) ? bitfield_unsigned (instr, 2, 5) : 0xFF & read_reg (_X3 (instr));
+        test_bit (instr.flags, kDecodedImmBit) ? instr.imm : 0xFF & get_reg (instr.xm);
     const word dst_val =
         (xn_val >> lsl_val) | (bitfield_unsigned (xn_val, 0, lsl_val) << (32 - lsl_val));
 
     DEBUG_SS (std::stringstream () << "ror " << std::to_string (lsl_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
 // alias to subs
-void Emulator32bit::_cmp (const word instr)
+void Emulator32bit::_cmp (const DecodedInstr &instr)
 {
-    const word xn_val = read_reg (_X2 (instr));
+    const word xn_val = get_reg (instr.xn);
     const word cmp_val = FORMAT_O__get_arg (instr);
     const word dst_val = xn_val - cmp_val;
 
-    set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_c_flag_sub (xn_val, cmp_val),
-              get_v_flag_sub (xn_val, cmp_val));
+    set_flags_sub (xn_val, cmp_val, dst_val);
 
     DEBUG_SS (std::stringstream () << "cmp " << std::to_string (cmp_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
 }
 
 // alias to adds
-void Emulator32bit::_cmn (const word instr)
+void Emulator32bit::_cmn (const DecodedInstr &instr)
 {
-    const word xn_val = read_reg (_X2 (instr));
+    const word xn_val = get_reg (instr.xn);
     const word cmn_val = FORMAT_O__get_arg (instr);
     const word dst_val = cmn_val + xn_val;
 
-    set_NZCV (test_bit (dst_val, 31), dst_val == 0, get_c_flag_add (xn_val, cmn_val),
-              get_v_flag_add (xn_val, cmn_val));
+    set_flags_add (xn_val, cmn_val, dst_val);
 
     DEBUG_SS (std::stringstream () << "cmn " << std::to_string (cmn_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
 }
 
 // alias to ands
-void Emulator32bit::_tst (const word instr)
+void Emulator32bit::_tst (const DecodedInstr &instr)
 {
-    const word xn_val = read_reg (_X2 (instr));
+    const word xn_val = get_reg (instr.xn);
     const word tst_val = FORMAT_O__get_arg (instr);
     const word dst_val = tst_val & xn_val;
 
-    set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-              test_bit (m_pstate, kVFlagBit));
+    set_flags_logic (dst_val);
 
     DEBUG_SS (std::stringstream () << "tst " << std::to_string (tst_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
 }
 
 // alias to eors
-void Emulator32bit::_teq (const word instr)
+void Emulator32bit::_teq (const DecodedInstr &instr)
 {
-    const word xn_val = read_reg (_X2 (instr));
+    const word xn_val = get_reg (instr.xn);
     const word teq_val = FORMAT_O__get_arg (instr);
     const word dst_val = teq_val ^ xn_val;
 
-    set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-              test_bit (m_pstate, kVFlagBit));
+    set_flags_logic (dst_val);
 
     DEBUG_SS (std::stringstream () << "teq " << std::to_string (teq_val) << " "
                                    << std::to_string (xn_val) << " = " << std::to_string (dst_val));
 }
 
-void Emulator32bit::_mov (const word instr)
+void Emulator32bit::_mov (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
+    const U8 xd = instr.xd;
     word mov_val = 0;
-    if (test_bit (instr, 19))
+    if (test_bit (instr.flags, kDecodedImmBit))
     {
-        mov_val = bitfield_unsigned (instr, 0, 19);
+        mov_val = instr.imm;
     }
     else
     {
-        mov_val = bitfield_unsigned (instr, 0, 14) + read_reg (bitfield_unsigned (instr, 14, 5));
+        mov_val = instr.imm + get_reg (instr.xn);
     }
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
-        set_NZCV (test_bit (mov_val, 31), mov_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (mov_val);
     }
 
     DEBUG_SS (std::stringstream ()
               << "mov " << std::to_string (xd) << " " << std::to_string (mov_val));
-    write_reg (xd, mov_val);
+    set_reg (xd, mov_val);
 }
 
-void Emulator32bit::_mvn (const word instr)
+void Emulator32bit::_mvn (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
+    const U8 xd = instr.xd;
     word mvn_val = 0;
-    if (test_bit (instr, 19))
+    if (test_bit (instr.flags, kDecodedImmBit))
     {
-        mvn_val = bitfield_unsigned (instr, 0, 19);
+        mvn_val = instr.imm;
     }
     else
     {
-        mvn_val = bitfield_unsigned (instr, 0, 14) + read_reg (bitfield_unsigned (instr, 14, 5));
+        mvn_val = instr.imm + get_reg (instr.xn);
     }
 
     const word dst_val = ~mvn_val;
 
     // check to update NZCV
-    if (test_bit (instr, kInstructionUpdateFlagBit))
+    if (test_bit (instr.flags, kDecodedUpdateFlagBit))
     {
-        set_NZCV (test_bit (dst_val, 31), dst_val == 0, test_bit (m_pstate, kCFlagBit),
-                  test_bit (m_pstate, kVFlagBit));
+        set_flags_logic (dst_val);
     }
 
     DEBUG_SS (std::stringstream ()
               << "mvn " << std::to_string (xd) << " " << std::to_string (mvn_val) << " = "
               << std::to_string (dst_val));
-    write_reg (xd, dst_val);
+    set_reg (xd, dst_val);
 }
 
 word Emulator32bit::calc_mem_addr (word xn, sword offset, U8 addr_mode)
 {
     word mem_addr = 0;
-    const word xn_val = read_reg (xn);
+    const word xn_val = get_reg (xn);
     if (addr_mode == 0)
     {
         mem_addr = xn_val + offset;
@@ -1203,17 +1402,34 @@ word Emulator32bit::calc_mem_addr (word xn, sword offset, U8 addr_mode)
     return mem_addr;
 }
 
-void Emulator32bit::_ldr (const word instr)
+word Emulator32bit::trace_mem_addr (const DecodedInstr &instr)
+{
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case _op_ldr:
+    case _op_ldrb:
+    case _op_ldrh:
+    case _op_str:
+    case _op_strb:
+    case _op_strh:
+    {
+        const word xn_val = get_reg (instr.xn);
+        const sword offset = FORMAT_O__get_arg (instr);
+        return instr.addr_mode == 2 ? xn_val : xn_val + offset;
+    }
+    default:
+        return 0;
+    }
+}
+
+void Emulator32bit::_ldr (const DecodedInstr &instr)
 {
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
-    printf ("OFFSET %d\n", offset);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
-    printf ("MEMORY ADDRESS %u\n", mem_addr);
     const word read_val = system_bus->read_word (mem_addr);
 
     if (address_mode == 0)
@@ -1237,18 +1453,17 @@ void Emulator32bit::_ldr (const word instr)
                   << std::to_string (offset) << " (" << std::to_string (mem_addr)
                   << ") = " << std::to_string (read_val));
     }
-    write_reg (xt, read_val);
+    set_reg (xt, read_val);
 }
 
-void Emulator32bit::_ldrb (const word instr)
+void Emulator32bit::_ldrb (const DecodedInstr &instr)
 {
-    const bool sign = test_bit (instr, 25);
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
+    const bool sign = test_bit (instr.flags, kDecodedSignBit);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
     word read_val = system_bus->read_byte (mem_addr);
     if (sign)
@@ -1277,18 +1492,17 @@ void Emulator32bit::_ldrb (const word instr)
                   << offset << " [" << std::to_string (mem_addr)
                   << "] = " << std::to_string (read_val));
     }
-    write_reg (xt, read_val);
+    set_reg (xt, read_val);
 }
 
-void Emulator32bit::_ldrh (const word instr)
+void Emulator32bit::_ldrh (const DecodedInstr &instr)
 {
-    const bool sign = test_bit (instr, 25);
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
+    const bool sign = test_bit (instr.flags, kDecodedSignBit);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
     word read_val = system_bus->read_hword (mem_addr);
     if (sign)
@@ -1317,19 +1531,18 @@ void Emulator32bit::_ldrh (const word instr)
                   << offset << " [" << std::to_string (mem_addr)
                   << "] = " << std::to_string (read_val));
     }
-    write_reg (xt, read_val);
+    set_reg (xt, read_val);
 }
 
-void Emulator32bit::_str (const word instr)
+void Emulator32bit::_str (const DecodedInstr &instr)
 {
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
-    const word write_val = read_reg (xt);
+    const word write_val = get_reg (xt);
 
     if (address_mode == 0)
     {
@@ -1355,17 +1568,16 @@ void Emulator32bit::_str (const word instr)
     system_bus->write_word (mem_addr, write_val);
 }
 
-void Emulator32bit::_strb (const word instr)
+void Emulator32bit::_strb (const DecodedInstr &instr)
 {
-    const bool sign = test_bit (instr, 25);
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
+    const bool sign = test_bit (instr.flags, kDecodedSignBit);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
-    word write_val = read_reg (xt);
+    word write_val = get_reg (xt);
     if (sign)
     {
         write_val = sword (byte (write_val));
@@ -1395,17 +1607,16 @@ void Emulator32bit::_strb (const word instr)
     system_bus->write_byte (mem_addr, write_val);
 }
 
-void Emulator32bit::_strh (const word instr)
+void Emulator32bit::_strh (const DecodedInstr &instr)
 {
-    const bool sign = test_bit (instr, 25);
-    const U8 xt = _X1 (instr);
-    const U8 xn = _X2 (instr);
-    const bool simm = test_bit (instr, 14);
-    sword offset = simm ? bitfield_signed (instr, 2, 12) : FORMAT_O__get_arg (instr);
+    const bool sign = test_bit (instr.flags, kDecodedSignBit);
+    const U8 xt = instr.xd;
+    const U8 xn = instr.xn;
+    const sword offset = FORMAT_O__get_arg (instr);
 
-    const U8 address_mode = bitfield_unsigned (instr, 0, 2);
+    const U8 address_mode = instr.addr_mode;
     const word mem_addr = calc_mem_addr (xn, offset, address_mode);
-    word write_val = read_reg (xt);
+    word write_val = get_reg (xt);
     if (sign)
     {
         write_val = sword (hword (write_val));
@@ -1435,66 +1646,273 @@ void Emulator32bit::_strh (const word instr)
     system_bus->write_hword (mem_addr, write_val);
 }
 
-void Emulator32bit::_b (const word instr)
+void Emulator32bit::_b (const DecodedInstr &instr)
 {
-    const U8 cond = bitfield_unsigned (instr, 22, 4);
-    if (check_cond (m_pstate, cond))
+    const U8 cond = instr.cond;
+    if (check_cond (cond))
     {
-        m_pc += (bitfield_signed (instr, 0, 22) << 2)
-                - 4; /* account for execution loop incrementing _pc by 4 */
+        m_pc += instr.imm - 4; /* account for execution loop incrementing _pc by 4 */
     }
     DEBUG_SS (std::stringstream () << "b " << std::to_string (cond));
 }
 
-void Emulator32bit::_bl (const word instr)
+void Emulator32bit::_bl (const DecodedInstr &instr)
 {
-    const U8 cond = bitfield_unsigned (instr, 22, 4);
-    if (check_cond (m_pstate, cond))
+    const U8 cond = instr.cond;
+    if (check_cond (cond))
     {
         write_reg (Register::LR, m_pc + 4);
-        m_pc += (bitfield_signed (instr, 0, 22) << 2) - 4;
+        m_pc += instr.imm - 4;
     }
     DEBUG_SS (std::stringstream () << "bl " << std::to_string (cond));
 }
 
-void Emulator32bit::_bx (const word instr)
+void Emulator32bit::_bx (const DecodedInstr &instr)
 {
-    const U8 cond = bitfield_unsigned (instr, 22, 4);
-    const U8 reg = bitfield_unsigned (instr, 17, 5);
-    if (check_cond (m_pstate, cond))
+    const U8 cond = instr.cond;
+    const U8 reg = instr.xn;
+    if (check_cond (cond))
     {
-        m_pc = sword (read_reg (reg)) - 4;
+        m_pc = sword (get_reg (reg)) - 4;
     }
     DEBUG_SS (std::stringstream ()
               << "bx " << std::to_string (reg) << " (" << std::to_string (cond) << ")");
 }
 
-void Emulator32bit::_blx (const word instr)
+void Emulator32bit::_blx (const DecodedInstr &instr)
 {
-    const U8 cond = bitfield_unsigned (instr, 22, 4);
-    const U8 reg = bitfield_unsigned (instr, 17, 5);
-    if (check_cond (m_pstate, cond))
+    const U8 cond = instr.cond;
+    const U8 reg = instr.xn;
+    if (check_cond (cond))
     {
         write_reg (Emulator32bit::Register::LR, m_pc + 4);
-        m_pc = sword (read_reg (reg)) - 4;
+        m_pc = sword (get_reg (reg)) - 4;
     }
     DEBUG_SS (std::stringstream ()
               << "blx " << std::to_string (reg) << "(" << std::to_string (cond) << ")");
 }
 
-void Emulator32bit::_adrp (const word instr)
+void Emulator32bit::_adrp (const DecodedInstr &instr)
 {
-    const U8 xd = _X1 (instr);
-    const word imm20 = bitfield_unsigned (instr, 0, 20) << 12;
-
-    signed int simm21 = imm20;
-    if (test_bit (instr, kInstructionUpdateFlagBit))
-    {
-        simm21 -= (1 << 20);
-    }
+    const U8 xd = instr.xd;
+    const signed int simm21 = instr.imm;
 
     word val = mask_0 (m_pc, 0, 12) + simm21;
-    write_reg (xd, val);
+    set_reg (xd, val);
     DEBUG_SS (std::stringstream ()
               << "adrp " << std::to_string (xd) << " " << std::to_string (simm21));
-}
\ No newline at end of file
+}
+
+/*
+ * The handlers above are called directly from a single function so the compiler can inline them
+ * into the dispatch loop, which is why this lives in this translation unit. Computed gotos are a
+ * GNU extension.
+ */
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+Emulator32bit::RunStatus Emulator32bit::run_threaded (U64 instructions, StopReason &reason)
+{
+    void *dispatch[kMaxInstructions];
+    std::fill (std::begin (dispatch), std::end (dispatch), &&op_undefined);
+
+#define _INSTR(op) dispatch[_op_##op] = &&op_##op;
+    _INSTR (special_instructions)
+
+    _INSTR (add)
+    _INSTR (sub)
+    _INSTR (rsb)
+    _INSTR (adc)
+    _INSTR (sbc)
+    _INSTR (rsc)
+    _INSTR (mul)
+    _INSTR (umull)
+    _INSTR (smull)
+
+    _INSTR (vabs)
+    _INSTR (vneg)
+    _INSTR (vsqrt)
+    _INSTR (vadd)
+    _INSTR (vsub)
+    _INSTR (vdiv)
+    _INSTR (vmul)
+    _INSTR (vcmp)
+    _INSTR (vsel)
+    _INSTR (vcint)
+    _INSTR (vcflo)
+    _INSTR (vmov)
+
+    _INSTR (and)
+    _INSTR (orr)
+    _INSTR (eor)
+    _INSTR (bic)
+    _INSTR (lsl)
+    _INSTR (lsr)
+    _INSTR (asr)
+    _INSTR (ror)
+
+    _INSTR (cmp)
+    _INSTR (cmn)
+    _INSTR (tst)
+    _INSTR (teq)
+
+    _INSTR (mov)
+    _INSTR (mvn)
+
+    _INSTR (ldr)
+    _INSTR (ldrb)
+    _INSTR (ldrh)
+    _INSTR (str)
+    _INSTR (strb)
+    _INSTR (strh)
+
+    _INSTR (b)
+    _INSTR (bl)
+    _INSTR (bx)
+    _INSTR (blx)
+    _INSTR (swi)
+
+    _INSTR (adrp)
+#undef _INSTR
+
+    U64 num_instructions_ran = 0;
+    m_stop = false;
+    reason.status = RunStatus::BUDGET_EXHAUSTED;
+    try
+    {
+        DecodeCache::Block *block = nullptr;
+        while (!m_stop && (instructions == 0 || num_instructions_ran < instructions))
+        {
+            /* code written by other cores, code written by this one bumps the epoch below */
+            if (UNLIKELY (system_bus->has_pending_invalidations ()))
+            {
+                system_bus->drain_invalidations ();
+                block = nullptr;
+            }
+
+            block = m_decode_cache->next_block (block, m_pc);
+
+            word ninstrs = block->ninstrs;
+            if (instructions != 0 && instructions - num_instructions_ran < ninstrs)
+            {
+                ninstrs = instructions - num_instructions_ran;
+            }
+
+            const DecodedInstr *instr = block->instrs;
+            const DecodedInstr *const end = instr + ninstrs;
+            const U64 epoch = m_decode_cache->epoch ();
+            goto *dispatch[instr->raw >> 26];
+
+/* Same bookkeeping as run (), then jump straight to the handler of the next instruction. */
+#define _DISPATCH()                                                                                \
+    m_pc += 4;                                                                                     \
+    num_instructions_ran++;                                                                        \
+    if (UNLIKELY (m_decode_cache->epoch () != epoch))                                              \
+    {                                                                                              \
+        block = nullptr;                                                                           \
+        continue;                                                                                  \
+    }                                                                                              \
+    if (UNLIKELY (++instr == end))                                                                 \
+    {                                                                                              \
+        continue;                                                                                  \
+    }                                                                                              \
+    goto *dispatch[instr->raw >> 26];
+
+#define _INSTR(op)                                                                                 \
+    op_##op : _##op (*instr);                                                                      \
+    _DISPATCH ()
+
+            /* Special instructions resolve their handler when decoded. */
+            op_special_instructions:
+            execute (*instr);
+            _DISPATCH ()
+
+            _INSTR (undefined)
+
+            _INSTR (add)
+            _INSTR (sub)
+            _INSTR (rsb)
+            _INSTR (adc)
+            _INSTR (sbc)
+            _INSTR (rsc)
+            _INSTR (mul)
+            _INSTR (umull)
+            _INSTR (smull)
+
+            _INSTR (vabs)
+            _INSTR (vneg)
+            _INSTR (vsqrt)
+            _INSTR (vadd)
+            _INSTR (vsub)
+            _INSTR (vdiv)
+            _INSTR (vmul)
+            _INSTR (vcmp)
+            _INSTR (vsel)
+            _INSTR (vcint)
+            _INSTR (vcflo)
+            _INSTR (vmov)
+
+            _INSTR (and)
+            _INSTR (orr)
+            _INSTR (eor)
+            _INSTR (bic)
+            _INSTR (lsl)
+            _INSTR (lsr)
+            _INSTR (asr)
+            _INSTR (ror)
+
+            _INSTR (cmp)
+            _INSTR (cmn)
+            _INSTR (tst)
+            _INSTR (teq)
+
+            _INSTR (mov)
+            _INSTR (mvn)
+
+            _INSTR (ldr)
+            _INSTR (ldrb)
+            _INSTR (ldrh)
+            _INSTR (str)
+            _INSTR (strb)
+            _INSTR (strh)
+
+            _INSTR (b)
+            _INSTR (bl)
+            _INSTR (bx)
+            _INSTR (blx)
+            _INSTR (swi)
+
+            _INSTR (adrp)
+#undef _INSTR
+#undef _DISPATCH
+        }
+
+        if (m_stop)
+        {
+            reason.status = m_stop_status;
+            reason.exit_code = m_exit_code;
+        }
+    }
+    catch (const Exception &e)
+    {
+        reason.status = RunStatus::FAULT;
+        reason.fault = e.what ();
+    }
+    catch (const SystemBus::Exception &e)
+    {
+        reason.status = RunStatus::FAULT;
+        reason.fault = e.what ();
+    }
+
+    reason.instructions = num_instructions_ran;
+    return reason.status;
+}
+
+#pragma GCC diagnostic pop
+#else
+Emulator32bit::RunStatus Emulator32bit::run_threaded (U64 instructions, StopReason &reason)
+{
+    return run_until (instructions, reason);
+}
+#endif
@@ -0,0 +1,556 @@
+#include "emulator32bit/jit.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define AEMU_JIT_SUPPORTED 1
+#else
+#define AEMU_JIT_SUPPORTED 0
+#endif
+
+/**
+ * @internal
+ * @brief                   x86 general purpose registers used by compiled code. The guest register
+ *                          file is passed in rdi and the pstate in rsi.
+ *
+ */
+enum HostReg : U8
+{
+    EAX = 0,
+    ECX = 1,
+    EDX = 2,
+    RBX = 3,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+};
+
+/**
+ * @internal
+ * @brief                   Callee saved registers given to the guest registers used most by a
+ *                          compiled prefix, pushed on entry and popped on exit.
+ *
+ */
+static constexpr U8 kCacheRegs[] = {RBX, RBP, R12, R13, R14, R15};
+
+/**
+ * @internal
+ * @brief                   Flags of an instruction in the @ref Emulator32bit::_pstate layout.
+ *
+ */
+static constexpr U8 kNZ = (1 << Emulator32bit::kNFlagBit) | (1 << Emulator32bit::kZFlagBit);
+static constexpr U8 kNZCV = kNZ | (1 << Emulator32bit::kCFlagBit) | (1 << Emulator32bit::kVFlagBit);
+
+/**
+ * @internal
+ * @brief                   Whether the second operand of a format O instruction can be compiled.
+ *                          A rotate by 0 is left to the interpreter, which does not treat it as a
+ *                          no-op.
+ *
+ */
+static bool can_compile_arg (const Emulator32bit::DecodedInstr &instr)
+{
+    return test_bit (instr.flags, Emulator32bit::kDecodedImmBit)
+           || Emulator32bit::ShiftType (instr.shift) != Emulator32bit::ShiftType::SHIFT_ROR
+           || instr.shift_amt != 0;
+}
+
+/**
+ * @internal
+ * @brief                   Whether an instruction can be compiled, only data processing
+ *                          instructions that do not read the flags or memory are.
+ *
+ */
+static bool can_compile (const Emulator32bit::DecodedInstr &instr)
+{
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_add:
+    case Emulator32bit::_op_sub:
+    case Emulator32bit::_op_rsb:
+    case Emulator32bit::_op_and:
+    case Emulator32bit::_op_orr:
+    case Emulator32bit::_op_eor:
+    case Emulator32bit::_op_bic:
+    case Emulator32bit::_op_cmp:
+    case Emulator32bit::_op_cmn:
+    case Emulator32bit::_op_tst:
+    case Emulator32bit::_op_teq:
+        return can_compile_arg (instr);
+    case Emulator32bit::_op_mul:
+        return !test_bit (instr.flags, Emulator32bit::kDecodedUpdateFlagBit)
+               && can_compile_arg (instr);
+    case Emulator32bit::_op_lsl:
+    case Emulator32bit::_op_lsr:
+    case Emulator32bit::_op_asr:
+        return test_bit (instr.flags, Emulator32bit::kDecodedImmBit);
+    case Emulator32bit::_op_ror:
+        return test_bit (instr.flags, Emulator32bit::kDecodedImmBit) && instr.imm != 0;
+    case Emulator32bit::_op_mov:
+    case Emulator32bit::_op_mvn:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @internal
+ * @brief                   Whether a compilable instruction reads its first operand register, its
+ *                          second operand register or writes its destination register.
+ *
+ */
+static bool reads_xn (const Emulator32bit::DecodedInstr &instr)
+{
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_mov:
+    case Emulator32bit::_op_mvn:
+        return !test_bit (instr.flags, Emulator32bit::kDecodedImmBit);
+    default:
+        return true;
+    }
+}
+
+static bool reads_xm (const Emulator32bit::DecodedInstr &instr)
+{
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_lsl:
+    case Emulator32bit::_op_lsr:
+    case Emulator32bit::_op_asr:
+    case Emulator32bit::_op_ror:
+    case Emulator32bit::_op_mov:
+    case Emulator32bit::_op_mvn:
+        return false;
+    default:
+        return !test_bit (instr.flags, Emulator32bit::kDecodedImmBit);
+    }
+}
+
+static bool writes_xd (const Emulator32bit::DecodedInstr &instr)
+{
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_cmp:
+    case Emulator32bit::_op_cmn:
+    case Emulator32bit::_op_tst:
+    case Emulator32bit::_op_teq:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/**
+ * @internal
+ * @brief                   Flags written by a compilable instruction.
+ *
+ */
+static U8 written_flags (const Emulator32bit::DecodedInstr &instr)
+{
+    const bool s = test_bit (instr.flags, Emulator32bit::kDecodedUpdateFlagBit);
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_add:
+    case Emulator32bit::_op_sub:
+    case Emulator32bit::_op_rsb:
+        return s ? kNZCV : 0;
+    case Emulator32bit::_op_cmp:
+    case Emulator32bit::_op_cmn:
+        return kNZCV;
+    case Emulator32bit::_op_and:
+    case Emulator32bit::_op_orr:
+    case Emulator32bit::_op_eor:
+    case Emulator32bit::_op_bic:
+    case Emulator32bit::_op_mov:
+    case Emulator32bit::_op_mvn:
+        return s ? kNZ : 0;
+    case Emulator32bit::_op_tst:
+    case Emulator32bit::_op_teq:
+        return kNZ;
+    default:
+        return 0;
+    }
+}
+
+JIT::JIT (Emulator32bit *processor) :
+    m_processor (processor)
+{
+#if AEMU_JIT_SUPPORTED
+    /* never writable and executable at once, see set_writable */
+    void *code = mmap (nullptr, kCodeBufferSize, PROT_READ | PROT_EXEC,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    m_code = code == MAP_FAILED ? nullptr : (byte *) code;
+#endif
+}
+
+JIT::~JIT ()
+{
+#if AEMU_JIT_SUPPORTED
+    if (m_code != nullptr)
+    {
+        munmap (m_code, kCodeBufferSize);
+    }
+#endif
+}
+
+bool JIT::supported ()
+{
+    return AEMU_JIT_SUPPORTED;
+}
+
+bool JIT::set_writable (byte *code, word n, bool writable)
+{
+#if AEMU_JIT_SUPPORTED
+    const uintptr_t page_size = sysconf (_SC_PAGESIZE);
+    const uintptr_t begin = uintptr_t (code) & ~(page_size - 1);
+    const uintptr_t end = (uintptr_t (code) + n + page_size - 1) & ~(page_size - 1);
+    return mprotect ((void *) begin, end - begin,
+                     writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC)
+           == 0;
+#else
+    UNUSED (code);
+    UNUSED (n);
+    UNUSED (writable);
+    return false;
+#endif
+}
+
+void JIT::compile (DecodeCache::Block *block)
+{
+    word ninstrs = 0;
+    while (ninstrs < block->ninstrs && can_compile (block->instrs[ninstrs]))
+    {
+        ninstrs++;
+    }
+
+    if (m_code == nullptr || ninstrs == 0)
+    {
+        return;
+    }
+
+    /* Only emit the flags that are not overwritten later on in the compiled instructions. */
+    std::vector<U8> flags (ninstrs);
+    U8 live = kNZCV;
+    for (word i = ninstrs; i-- > 0;)
+    {
+        const U8 written = written_flags (block->instrs[i]);
+        flags[i] = written & live;
+        live &= ~written;
+    }
+
+    /* The guest registers used more than once live in host registers for the whole prefix. */
+    word uses[Emulator32bit::kNumReg + 1] = {};
+    bool written[Emulator32bit::kNumReg + 1] = {};
+    for (word i = 0; i < ninstrs; i++)
+    {
+        const Emulator32bit::DecodedInstr &instr = block->instrs[i];
+        uses[instr.xn] += reads_xn (instr);
+        uses[instr.xm] += reads_xm (instr);
+        if (writes_xd (instr))
+        {
+            uses[instr.xd]++;
+            written[instr.xd] = true;
+        }
+    }
+
+    std::vector<U8> cached;
+    for (U8 reg = 0; reg <= Emulator32bit::kNumReg; reg++)
+    {
+        if (uses[reg] > 1)
+        {
+            cached.push_back (reg);
+        }
+    }
+    std::stable_sort (cached.begin (), cached.end (),
+                      [&uses] (U8 a, U8 b) { return uses[a] > uses[b]; });
+    cached.resize (std::min (cached.size (), std::size (kCacheRegs)));
+
+    std::fill (std::begin (m_host_reg), std::end (m_host_reg), kNotCached);
+    m_emit.clear ();
+    for (word i = 0; i < cached.size (); i++)
+    {
+        emit_push_pop (0x50, kCacheRegs[i]); /* push */
+    }
+    for (word i = 0; i < cached.size (); i++)
+    {
+        emit_load_reg (kCacheRegs[i], cached[i]);
+        m_host_reg[cached[i]] = kCacheRegs[i];
+    }
+
+    for (word i = 0; i < ninstrs; i++)
+    {
+        emit_instr (block->instrs[i], flags[i]);
+    }
+
+    for (word i = cached.size (); i-- > 0;)
+    {
+        m_host_reg[cached[i]] = kNotCached;
+        if (written[cached[i]])
+        {
+            emit_store_reg (cached[i], kCacheRegs[i]);
+        }
+        emit_push_pop (0x58, kCacheRegs[i]); /* pop */
+    }
+    m_emit.push_back (0xC3); /* ret */
+
+    /*
+     * Once the buffer is full, start over. Every block is decoded again so none of them keep
+     * code that is about to be overwritten, this one will be compiled when it gets hot again.
+     */
+    if (m_code_used + m_emit.size () > m_code_size)
+    {
+        m_code_used = 0;
+        m_processor->m_decode_cache->invalidate_all ();
+        return;
+    }
+
+    /* only this thread runs code from the buffer, so its pages can stop being executable */
+    byte *code = m_code + m_code_used;
+    if (!set_writable (code, m_emit.size (), true))
+    {
+        return;
+    }
+    std::memcpy (code, m_emit.data (), m_emit.size ());
+    if (!set_writable (code, m_emit.size (), false))
+    {
+        return;
+    }
+    m_code_used = (m_code_used + m_emit.size () + 15) & ~word (15);
+
+    block->jit_code = (void (*) (word *, word *)) code;
+    block->jit_ninstrs = ninstrs;
+}
+
+void JIT::emit_instr (const Emulator32bit::DecodedInstr &instr, const U8 flags)
+{
+    const bool imm = test_bit (instr.flags, Emulator32bit::kDecodedImmBit);
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_add:
+    case Emulator32bit::_op_cmn:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x01, ECX, EAX); /* add eax, ecx */
+        break;
+    case Emulator32bit::_op_sub:
+    case Emulator32bit::_op_cmp:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x29, ECX, EAX); /* sub eax, ecx */
+        break;
+    case Emulator32bit::_op_rsb:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x29, EAX, ECX); /* sub ecx, eax */
+        emit_rr (0x89, ECX, EAX); /* mov eax, ecx */
+        break;
+    case Emulator32bit::_op_and:
+    case Emulator32bit::_op_tst:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x21, ECX, EAX); /* and eax, ecx */
+        break;
+    case Emulator32bit::_op_orr:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x09, ECX, EAX); /* or eax, ecx */
+        break;
+    case Emulator32bit::_op_eor:
+    case Emulator32bit::_op_teq:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0x31, ECX, EAX); /* xor eax, ecx */
+        break;
+    case Emulator32bit::_op_bic:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        emit_rr (0xF7, 2, ECX);   /* not ecx */
+        emit_rr (0x21, ECX, EAX); /* and eax, ecx */
+        break;
+    case Emulator32bit::_op_mul:
+        emit_load_reg (EAX, instr.xn);
+        emit_load_arg (instr);
+        m_emit.push_back (0x0F);
+        emit_rr (0xAF, EAX, ECX); /* imul eax, ecx */
+        break;
+    case Emulator32bit::_op_lsl:
+    case Emulator32bit::_op_lsr:
+    case Emulator32bit::_op_asr:
+    case Emulator32bit::_op_ror:
+    {
+        static constexpr U8 kShiftOp[] = {4, 5, 7, 1}; /* shl, shr, sar, ror */
+        emit_load_reg (EAX, instr.xn);
+        if (instr.imm != 0)
+        {
+            emit_rr (0xC1, kShiftOp[bitfield_unsigned (instr.raw, 26, 6) - Emulator32bit::_op_lsl],
+                     EAX);
+            m_emit.push_back (instr.imm);
+        }
+        break;
+    }
+    case Emulator32bit::_op_mov:
+    case Emulator32bit::_op_mvn:
+        if (imm)
+        {
+            m_emit.push_back (0xB8 + EAX); /* mov eax, imm32 */
+            emit_imm32 (instr.imm);
+        }
+        else
+        {
+            emit_load_reg (EAX, instr.xn);
+            m_emit.push_back (0x05); /* add eax, imm32 */
+            emit_imm32 (instr.imm);
+        }
+
+        if (bitfield_unsigned (instr.raw, 26, 6) == Emulator32bit::_op_mvn)
+        {
+            emit_rr (0xF7, 2, EAX); /* not eax */
+        }
+        if (flags != 0)
+        {
+            emit_rr (0x85, EAX, EAX); /* test eax, eax */
+        }
+        break;
+    }
+
+    emit_write_flags (flags);
+
+    switch (bitfield_unsigned (instr.raw, 26, 6))
+    {
+    case Emulator32bit::_op_cmp:
+    case Emulator32bit::_op_cmn:
+    case Emulator32bit::_op_tst:
+    case Emulator32bit::_op_teq:
+        break;
+    default:
+        emit_store_reg (instr.xd, EAX);
+        break;
+    }
+}
+
+void JIT::emit_load_reg (const U8 host_reg, const U8 reg)
+{
+    if (m_host_reg[reg] != kNotCached)
+    {
+        emit_rr (0x89, m_host_reg[reg], host_reg); /* mov host_reg, cached */
+        return;
+    }
+
+    /* mov host_reg, [rdi + reg] */
+    emit_rex (host_reg, 0);
+    m_emit.insert (m_emit.end (), {0x8B, U8 (0x80 | (host_reg & 7) << 3 | RDI)});
+    emit_imm32 (reg * sizeof (word));
+}
+
+void JIT::emit_store_reg (const U8 reg, const U8 host_reg)
+{
+    if (m_host_reg[reg] != kNotCached)
+    {
+        emit_rr (0x89, host_reg, m_host_reg[reg]); /* mov cached, host_reg */
+        return;
+    }
+
+    /* mov [rdi + reg], host_reg */
+    emit_rex (host_reg, 0);
+    m_emit.insert (m_emit.end (), {0x89, U8 (0x80 | (host_reg & 7) << 3 | RDI)});
+    emit_imm32 (reg * sizeof (word));
+}
+
+void JIT::emit_push_pop (const U8 opcode, const U8 host_reg)
+{
+    emit_rex (0, host_reg);
+    m_emit.push_back (opcode + (host_reg & 7));
+}
+
+void JIT::emit_load_arg (const Emulator32bit::DecodedInstr &instr)
+{
+    if (test_bit (instr.flags, Emulator32bit::kDecodedImmBit))
+    {
+        m_emit.push_back (0xB8 + ECX); /* mov ecx, imm32 */
+        emit_imm32 (instr.imm);
+        return;
+    }
+
+    static constexpr U8 kShiftOp[] = {4, 5, 7, 1}; /* shl, shr, sar, ror */
+    emit_load_reg (ECX, instr.xm);
+    if (instr.shift_amt != 0)
+    {
+        emit_rr (0xC1, kShiftOp[instr.shift & 0b11], ECX);
+        m_emit.push_back (instr.shift_amt);
+    }
+}
+
+void JIT::emit_write_flags (const U8 flags)
+{
+    if (flags == 0)
+    {
+        return;
+    }
+
+    /* setcc r8b..r11b in the order of the pstate flag bits: sets, setz, setc, seto */
+    static constexpr U8 kSetcc[] = {0x98, 0x94, 0x92, 0x90};
+    for (U8 bit = 0; bit < 4; bit++)
+    {
+        if (test_bit (flags, bit))
+        {
+            m_emit.insert (m_emit.end (), {0x41, 0x0F, kSetcc[bit], U8 (0xC0 | bit)});
+        }
+    }
+
+    /* mov edx, [rsi]; and edx, ~flags */
+    m_emit.insert (m_emit.end (), {0x8B, U8 (EDX << 3 | RSI)});
+    emit_rr (0x81, 4, EDX);
+    emit_imm32 (~word (flags));
+
+    for (U8 bit = 0; bit < 4; bit++)
+    {
+        if (!test_bit (flags, bit))
+        {
+            continue;
+        }
+
+        /* movzx r8d+bit, r8b+bit; shl r8d+bit, bit; or edx, r8d+bit */
+        m_emit.insert (m_emit.end (), {0x45, 0x0F, 0xB6, U8 (0xC0 | bit << 3 | bit)});
+        if (bit != 0)
+        {
+            m_emit.insert (m_emit.end (), {0x41, 0xC1, U8 (0xE0 | bit), bit});
+        }
+        emit_rr (0x09, 8 + bit, EDX);
+    }
+
+    /* mov [rsi], edx */
+    m_emit.insert (m_emit.end (), {0x89, U8 (EDX << 3 | RSI)});
+}
+
+void JIT::emit_rr (const U8 opcode, const U8 reg, const U8 rm)
+{
+    emit_rex (reg, rm);
+    m_emit.insert (m_emit.end (), {opcode, U8 (0xC0 | (reg & 7) << 3 | (rm & 7))});
+}
+
+void JIT::emit_rex (const U8 reg, const U8 rm)
+{
+    /* REX.R and REX.B extend the register fields to r8 to r15 */
+    if ((reg | rm) & 8)
+    {
+        m_emit.push_back (0x40 | (reg >> 3) << 2 | rm >> 3);
+    }
+}
+
+void JIT::emit_imm32 (const word imm)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        m_emit.push_back (byte (imm >> (8 * i)));
+    }
+}
@@ -1,67 +1,397 @@
 #include "emulator32bit/kernel/better_virtual_memory.h"
 
+#include "util/logger.h"
+
+#include <algorithm>
+
 MMU::MMU (Emulator32bit *processor, word user_low_page, word user_high_page, word kernel_low_page,
           word kernel_high_page) :
     m_processor (processor),
+    m_ram (processor->system_bus->ram),
     m_user_low_page (user_low_page),
     m_user_high_page (user_high_page),
     m_kernel_low_page (kernel_low_page),
     m_kernel_high_page (kernel_high_page),
-    m_free_user_ppages (processor->system_bus->ram->m_data, user_low_page,
-                        user_high_page - user_low_page + 1, kPageSize),
-    m_free_kernel_ppages (processor->system_bus->ram->m_data, kernel_low_page,
-                          kernel_high_page - kernel_low_page + 1, kPageSize)
+    m_free_user_ppages (free_list (user_low_page, user_high_page)),
+    m_free_kernel_ppages (free_list (kernel_low_page, kernel_high_page)),
+    m_owners (user_high_page - user_low_page + 1, 0)
+{
+    EXPECT_TRUE (m_ram->in_bounds (user_low_page << kNumPageOffsetBits), "User page not in ram.");
+    EXPECT_TRUE (m_ram->in_bounds (user_high_page << kNumPageOffsetBits), "User page not in ram.");
+    EXPECT_TRUE (m_ram->in_bounds (kernel_low_page << kNumPageOffsetBits),
+                 "Kernel page not in ram.");
+    EXPECT_TRUE (m_ram->in_bounds (kernel_high_page << kNumPageOffsetBits),
+                 "Kernel page not in ram.");
+    EXPECT_TRUE (kernel_low_page != 0, "Kernel pages cannot start at 0, the null page directory.");
+}
+
+void MMU::reset ()
+{
+    m_free_user_ppages = free_list (m_user_low_page, m_user_high_page);
+    m_free_kernel_ppages = free_list (m_kernel_low_page, m_kernel_high_page);
+    std::fill (m_owners.begin (), m_owners.end (), 0);
+    m_sharers.clear ();
+    m_clock_hand = 0;
+    m_processor->pagedir = 0;
+}
+
+word MMU::create_pagedir ()
 {
-    RAM *ram = processor->system_bus->ram;
-    EXPECT_TRUE (ram->in_bounds (user_low_page), "User page not in ram.");
-    EXPECT_TRUE (ram->in_bounds (user_high_page), "User page not in ram.");
-    EXPECT_TRUE (ram->in_bounds (kernel_low_page), "Kernel page not in ram.");
-    EXPECT_TRUE (ram->in_bounds (kernel_high_page), "Kernel page not in ram.");
+    set_pagedir (get_table_page () << kNumPageOffsetBits);
+    return m_processor->pagedir;
 }
 
-void MMU::create_pagedir ()
+void MMU::set_pagedir (word pagedir)
 {
+    m_processor->pagedir = pagedir;
+    invalidate_translations ();
+}
+
+void MMU::add_vpage (word vpage, bool kernel, bool write, bool execute, bool copy_on_write,
+                     bool superpage)
+{
+    if (m_processor->pagedir == 0)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::BAD_PAGEDIR,
+                                        "Cannot add a virtual page without a page directory.");
+    }
+
+    if (superpage)
+    {
+        add_superpage (vpage, kernel, write, execute);
+        return;
+    }
+
+    if (is_kernel_page (vpage))
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot add virtual page " + std::to_string (vpage)
+                                            + " since kernel pages are mapped to themselves.");
+    }
+
+    PageTableEntry &dir = entry_at (m_processor->pagedir)[vpage >> kNumPageTableBits];
+    if (!dir.valid)
+    {
+        dir.frame = get_table_page ();
+        dir.valid = 1;
+    }
+
+    word entry_address;
+    PageTableEntry *entry = walk (m_processor->pagedir, vpage, entry_address);
+    if (entry->valid)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot add virtual page " + std::to_string (vpage)
+                                            + " since it is already mapped.");
+    }
+
+    const word ppage = get_free_ppage ();
+    m_processor->system_bus->fill_unmapped (ppage << kNumPageOffsetBits, 0, kPageSize);
+    m_owners[ppage - m_user_low_page] = entry_address;
+
+    *entry = PageTableEntry ();
+    entry->valid = 1;
+    entry->kernel = kernel;
+    entry->write = write;
+    entry->execute = execute;
+    entry->copy_on_write = copy_on_write;
+    entry->frame = ppage;
+}
+
+void MMU::add_superpage (word vpage, bool kernel, bool write, bool execute)
+{
+    if (vpage % kSuperpagePages != 0 || vpage >= kNumVPages
+        || (vpage <= m_kernel_high_page && vpage + kSuperpagePages > m_kernel_low_page))
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot add superpage " + std::to_string (vpage)
+                                            + " since it is not aligned or holds kernel pages.");
+    }
+
+    const word dir_address = m_processor->pagedir
+                             + (vpage >> kNumPageTableBits) * sizeof (PageTableEntry);
+    PageTableEntry *dir = entry_at (dir_address);
+    if (dir->valid)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot add superpage " + std::to_string (vpage)
+                                            + " since some of its pages are already mapped.");
+    }
+
+    const word ppage = (m_free_user_ppages.get_free_blocks (kSuperpagePages) >> kNumPageOffsetBits)
+                       + m_ram->get_lo_page ();
+    m_processor->system_bus->fill_unmapped (ppage << kNumPageOffsetBits, 0,
+                                            kSuperpagePages * kPageSize);
+    std::fill_n (m_owners.begin () + (ppage - m_user_low_page), kSuperpagePages, dir_address);
+
+    *dir = PageTableEntry ();
+    dir->valid = 1;
+    dir->superpage = 1;
+    dir->kernel = kernel;
+    dir->write = write;
+    dir->execute = execute;
+    dir->frame = ppage;
 }
 
-void MMU::add_vpage (word vpage, bool kernel, bool write, bool execute, bool copy_on_write)
+void MMU::share_vpage (word pagedir, word vpage)
 {
-    (void) (vpage);
-    (void) (kernel);
-    (void) (write);
-    (void) (execute);
-    (void) (copy_on_write);
+    if (m_processor->pagedir == 0)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::BAD_PAGEDIR,
+                                        "Cannot share a virtual page without a page directory.");
+    }
+
+    word source_address;
+    PageTableEntry *source = is_kernel_page (vpage) ? nullptr
+                                                    : walk (pagedir, vpage, source_address);
+    if (source == nullptr || !source->valid || source->superpage)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot share virtual page " + std::to_string (vpage)
+                                            + " since it is not mapped to a page of its own.");
+    }
+
+    PageTableEntry &dir = entry_at (m_processor->pagedir)[vpage >> kNumPageTableBits];
+    if (!dir.valid)
+    {
+        dir.frame = get_table_page ();
+        dir.valid = 1;
+    }
+
+    word entry_address;
+    PageTableEntry *entry = walk (m_processor->pagedir, vpage, entry_address);
+    if (entry->valid)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot share virtual page " + std::to_string (vpage)
+                                            + " since it is already mapped.");
+    }
+
+    if (source->disk)
+    {
+        page_in (source, source_address);
+    }
+
+    source->copy_on_write = 1;
+    *entry = *source;
+    entry->clock = 1;
+    m_sharers[source->frame].push_back (entry_address);
+    invalidate_translations ();
 }
 
 void MMU::remove_vpage (word vpage)
 {
-    (void) (vpage);
+    word entry_address;
+    PageTableEntry *entry = m_processor->pagedir == 0 || is_kernel_page (vpage)
+                                ? nullptr
+                                : walk (m_processor->pagedir, vpage, entry_address);
+    if (entry == nullptr || !entry->valid)
+    {
+        throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                        "Cannot remove virtual page " + std::to_string (vpage)
+                                            + " since it is not mapped.");
+    }
+
+    release_ppage (*entry, entry_address);
+    *entry = PageTableEntry ();
+    invalidate_translations ();
 }
 
-// todo fix for shared pages
 void MMU::remove_pagedir ()
 {
-    struct PageTableEntry *pagetable =
-        (struct PageTableEntry *) &m_processor->system_bus->ram->m_data[m_processor->pagedir];
+    if (m_processor->pagedir == 0)
+    {
+        return;
+    }
 
-    word end_page = N_VPAGES;
-    for (word page = 0; page <= end_page; page++)
+    PageTableEntry *pagedir = entry_at (m_processor->pagedir);
+    for (word dir = 0; dir < kPageTableSize; dir++)
     {
-        struct PageTableEntry *entry = &pagetable[page];
-        entry->reference_count--;
-        if (!entry->valid || entry->reference_count > 0)
+        if (!pagedir[dir].valid)
         {
             continue;
         }
 
-        if (entry->disk)
+        if (pagedir[dir].superpage)
         {
-            m_processor->system_bus->disk->return_page (entry->disk);
+            release_ppage (pagedir[dir], m_processor->pagedir + dir * sizeof (PageTableEntry));
+            continue;
         }
-        else
+
+        const word table_address = pagedir[dir].frame << kNumPageOffsetBits;
+        PageTableEntry *table = entry_at (table_address);
+        for (word page = 0; page < kPageTableSize; page++)
         {
-            m_free_user_ppages.return_block (entry->ppage);
+            if (table[page].valid)
+            {
+                release_ppage (table[page], table_address + page * sizeof (PageTableEntry));
+            }
         }
+        m_free_kernel_ppages.return_block ((pagedir[dir].frame - m_ram->get_lo_page ())
+                                           << kNumPageOffsetBits);
     }
 
-    m_processor->pagedir = 0;
-}
\ No newline at end of file
+    m_free_kernel_ppages.return_block (m_processor->pagedir
+                                       - (m_ram->get_lo_page () << kNumPageOffsetBits));
+    set_pagedir (0);
+}
+
+void MMU::page_in (PageTableEntry *entry, word entry_address)
+{
+    const word ppage = get_free_ppage ();
+    m_processor->system_bus->dma->transfer ({DMAController::Direction::DISK_TO_MEMORY,
+                                             ppage << kNumPageOffsetBits, entry->frame, 1});
+    m_processor->system_bus->disk->return_page (entry->frame);
+
+    entry->disk = 0;
+    entry->dirty = 0;
+    entry->frame = ppage;
+    m_owners[ppage - m_user_low_page] = entry_address;
+    m_stats.page_ins++;
+}
+
+void MMU::copy_on_write (PageTableEntry *entry, word entry_address)
+{
+    entry->copy_on_write = 0;
+
+    /* a page mapped by one entry only is written in place */
+    const word shared = entry->frame;
+    if (!m_sharers.contains (shared))
+    {
+        return;
+    }
+
+    /* shared pages are never evicted, so the copy gets another page */
+    const word ppage = get_free_ppage ();
+    byte data[kPageSize];
+    m_processor->system_bus->read_physical_block (shared << kNumPageOffsetBits, data, kPageSize);
+    m_processor->system_bus->write_physical_block (ppage << kNumPageOffsetBits, data, kPageSize);
+
+    unshare_ppage (shared, entry_address);
+    entry->frame = ppage;
+    m_owners[ppage - m_user_low_page] = entry_address;
+    invalidate_translations ();
+}
+
+FBL_InMemory MMU::free_list (word low_page, word high_page)
+{
+    return FBL_InMemory (m_ram->m_data, (low_page - m_ram->get_lo_page ()) << kNumPageOffsetBits,
+                         (high_page + 1 - m_ram->get_lo_page ()) << kNumPageOffsetBits,
+                         kPageSize);
+}
+
+word MMU::get_table_page ()
+{
+    const word page = (m_free_kernel_ppages.get_free_block () >> kNumPageOffsetBits)
+                      + m_ram->get_lo_page ();
+    m_processor->system_bus->fill_unmapped (page << kNumPageOffsetBits, 0, kPageSize);
+    return page;
+}
+
+word MMU::get_free_ppage ()
+{
+    if (UNLIKELY (m_free_user_ppages.empty ()))
+    {
+        return evict_ppage ();
+    }
+
+    return (m_free_user_ppages.get_free_block () >> kNumPageOffsetBits) + m_ram->get_lo_page ();
+}
+
+void MMU::release_ppage (const PageTableEntry &entry, word entry_address)
+{
+    if (entry.disk)
+    {
+        m_processor->system_bus->disk->return_page (entry.frame);
+        return;
+    }
+
+    if (!entry.superpage && m_sharers.contains (entry.frame))
+    {
+        unshare_ppage (entry.frame, entry_address);
+        return;
+    }
+
+    const word npages = entry.superpage ? kSuperpagePages : 1;
+    for (word ppage = entry.frame; ppage < entry.frame + npages; ppage++)
+    {
+        word &owner = m_owners[ppage - m_user_low_page];
+        if (owner == entry_address)
+        {
+            owner = 0;
+            m_free_user_ppages.return_block ((ppage - m_ram->get_lo_page ())
+                                             << kNumPageOffsetBits);
+        }
+    }
+}
+
+void MMU::unshare_ppage (word ppage, word entry_address)
+{
+    std::vector<word> &sharers = m_sharers.at (ppage);
+    word &owner = m_owners[ppage - m_user_low_page];
+    if (owner == entry_address)
+    {
+        owner = sharers.back ();
+        sharers.pop_back ();
+    }
+    else
+    {
+        std::erase (sharers, entry_address);
+    }
+
+    if (sharers.empty ())
+    {
+        m_sharers.erase (ppage);
+    }
+}
+
+word MMU::evict_ppage ()
+{
+    /* the second pass finds every page cleared by the first, unless all are in superpages */
+    const word npages = m_user_high_page - m_user_low_page + 1;
+    for (word step = 0; step < 2 * npages; step++)
+    {
+        const word index = m_clock_hand;
+        m_clock_hand = (m_clock_hand + 1) % npages;
+        if (m_owners[index] == 0 || m_sharers.contains (m_user_low_page + index))
+        {
+            continue;
+        }
+
+        PageTableEntry *entry = entry_at (m_owners[index]);
+        if (entry->superpage)
+        {
+            continue;
+        }
+
+        if (entry->clock)
+        {
+            entry->clock = 0;
+            continue;
+        }
+
+        const word ppage = m_user_low_page + index;
+        const word diskpage = m_processor->system_bus->disk->get_free_page ();
+        m_processor->system_bus->dma->transfer ({DMAController::Direction::MEMORY_TO_DISK,
+                                                 ppage << kNumPageOffsetBits, diskpage, 1});
+
+        entry->disk = 1;
+        entry->dirty = 0;
+        entry->frame = diskpage;
+        m_owners[index] = 0;
+        m_stats.evictions++;
+
+        /* cached translations skip the walk, which would set the clock bits cleared above */
+        invalidate_translations ();
+        return ppage;
+    }
+
+    throw Emulator32bit::Exception (Emulator32bit::InterruptType::PAGEFAULT,
+                                    "No user page can be moved to disk, all are shared or in "
+                                    "superpages.");
+}
+
+void MMU::invalidate_translations ()
+{
+    m_processor->system_bus->mmu->bump_generation ();
+}
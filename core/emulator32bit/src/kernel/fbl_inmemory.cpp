@@ -54,6 +54,49 @@ word FBL_InMemory::get_free_block ()
     return ptr_to_mem_index (free);
 }
 
+word FBL_InMemory::get_free_blocks (word n)
+{
+    struct FreeBlock *free = m_head;
+    while (free != nullptr && free->len < n)
+    {
+        free = free->next;
+    }
+
+    if (free == nullptr)
+    {
+        throw Exception ("No " + std::to_string (n) + " consecutive free blocks.");
+    }
+
+    /* the blocks after the taken ones stay in the list in place of the node */
+    struct FreeBlock *rest = free->next;
+    if (free->len > n)
+    {
+        rest = (struct FreeBlock *) ((byte *) free + n * m_block_size);
+        rest->len = free->len - n;
+        rest->next = free->next;
+        if (rest->next)
+        {
+            rest->next->prev = rest;
+        }
+    }
+
+    if (rest)
+    {
+        rest->prev = free->prev;
+    }
+
+    if (free->prev)
+    {
+        free->prev->next = rest;
+    }
+    else
+    {
+        m_head = rest;
+    }
+
+    return ptr_to_mem_index (free);
+}
+
 void FBL_InMemory::return_block (word block)
 {
     EXPECT_TRUE ((block - m_mem_start) % m_block_size == 0, "Block size must divide memory space.");
@@ -2,6 +2,8 @@
 
 #include "util/common.h"
 
+#include <cstring>
+
 BaseMemory::BaseMemory (word npages, word start_page) :
     m_npages (npages),
     m_start_page (start_page),
@@ -13,6 +15,22 @@ BaseMemory::~BaseMemory ()
 {
 }
 
+void BaseMemory::read_block (word address, byte *data, word n)
+{
+    for (word i = 0; i < n; i++)
+    {
+        data[i] = read_byte (address + i);
+    }
+}
+
+void BaseMemory::write_block (word address, const byte *data, word n)
+{
+    for (word i = 0; i < n; i++)
+    {
+        write_byte (address + i, data[i]);
+    }
+}
+
 Memory::Memory (word npages, word start_page) :
     BaseMemory (npages, start_page),
     m_data (new byte[(npages << kNumPageOffsetBits)])
@@ -37,10 +55,20 @@ Memory::~Memory ()
     }
 }
 
+void Memory::read_block (word address, byte *data, word n)
+{
+    std::memcpy (data, host_address (address), n);
+}
+
+void Memory::write_block (word address, const byte *data, word n)
+{
+    std::memcpy (host_address (address), data, n);
+}
+
 void Memory::reset ()
 {
     for (word addr = m_start_page << kNumPageOffsetBits;
-         addr < get_hi_page () << kNumPageOffsetBits; addr++)
+         addr < (get_hi_page () + 1) << kNumPageOffsetBits; addr++)
     {
         Memory::write_byte (addr, 0);
     }
@@ -0,0 +1,151 @@
+#include "emulator32bit/mmio.h"
+
+#include "emulator32bit/timer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+MMIODevice::MMIODevice (word npages, word start_page) :
+    BaseMemory (npages, start_page)
+{
+}
+
+byte MMIODevice::read_byte (word address)
+{
+    address -= m_start_addr;
+    return read_register (address & ~word (3)) >> ((address & 3) * 8);
+}
+
+hword MMIODevice::read_hword (word address)
+{
+    address -= m_start_addr;
+    return read_register (address & ~word (3)) >> ((address & 3) * 8);
+}
+
+word MMIODevice::read_word (word address)
+{
+    return read_register ((address - m_start_addr) & ~word (3));
+}
+
+void MMIODevice::write_byte (word address, byte value)
+{
+    write_register ((address - m_start_addr) & ~word (3), value);
+}
+
+void MMIODevice::write_hword (word address, hword value)
+{
+    write_register ((address - m_start_addr) & ~word (3), value);
+}
+
+void MMIODevice::write_word (word address, word value)
+{
+    write_register ((address - m_start_addr) & ~word (3), value);
+}
+
+/*
+    Console
+*/
+ConsoleDevice::ConsoleDevice (word start_page, Sink sink) :
+    MMIODevice (1, start_page),
+    m_sink (sink)
+{
+    if (!m_sink)
+    {
+        m_sink = [] (const char *data, size_t n)
+        {
+            std::fwrite (data, 1, n, stdout);
+            std::fflush (stdout);
+        };
+    }
+}
+
+ConsoleDevice::~ConsoleDevice ()
+{
+    flush ();
+}
+
+word ConsoleDevice::read_register (word offset)
+{
+    return offset == kStatusRegister ? kStatusTxReady : 0;
+}
+
+void ConsoleDevice::write_register (word offset, word value)
+{
+    if (offset != kDataRegister)
+    {
+        return;
+    }
+
+    m_buffer.push_back ((char) value);
+    if ((char) value == '\n' || m_buffer.size () >= kBufferSize)
+    {
+        flush ();
+    }
+}
+
+void ConsoleDevice::write_block (word address, const byte *data, word n)
+{
+    /* only the data register takes a stream of bytes */
+    if (((address - m_start_addr) & ~word (3)) != kDataRegister)
+    {
+        MMIODevice::write_block (address, data, n);
+        return;
+    }
+
+    m_buffer.append ((const char *) data, n);
+    if (m_buffer.size () >= kBufferSize || std::find (data, data + n, '\n') != data + n)
+    {
+        flush ();
+    }
+}
+
+void ConsoleDevice::flush ()
+{
+    if (!m_buffer.empty ())
+    {
+        m_sink (m_buffer.data (), m_buffer.size ());
+        m_buffer.clear ();
+    }
+}
+
+/*
+    Timer
+*/
+TimerDevice::TimerDevice (word start_page, Timer *timer) :
+    MMIODevice (1, start_page),
+    m_timer (timer)
+{
+}
+
+word TimerDevice::read_register (word offset)
+{
+    switch (offset)
+    {
+    case kTimeLowRegister:
+        return m_timer->time ();
+    case kTimeHighRegister:
+        return m_timer->time () >> 32;
+    case kIntervalRegister:
+        return m_interval;
+    case kStatusRegister:
+        return m_timer->expired ();
+    default:
+        return 0;
+    }
+}
+
+void TimerDevice::write_register (word offset, word value)
+{
+    switch (offset)
+    {
+    case kIntervalRegister:
+        m_interval = value;
+        m_timer->set_interval (value);
+        break;
+    case kStatusRegister:
+        m_timer->acknowledge ();
+        break;
+    default:
+        break;
+    }
+}
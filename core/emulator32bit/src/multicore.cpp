@@ -0,0 +1,210 @@
+#include "emulator32bit/multicore.h"
+
+#include "emulator32bit/system_bus.h"
+#include "emulator32bit/timer.h"
+
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+Multicore::Multicore (SystemBus *system_bus, word ncores, Emulator32bit::Backend backend) :
+    system_bus (system_bus),
+    m_deferred_ipi (ncores)
+{
+    system_bus->reset ();
+    for (word id = 0; id < ncores; id++)
+    {
+        m_cores.push_back (new Emulator32bit (system_bus, id, backend));
+    }
+}
+
+Multicore::~Multicore ()
+{
+    /* the buses of the cores unregister from the shared bus */
+    for (Emulator32bit *core : m_cores)
+    {
+        delete core;
+    }
+    delete system_bus;
+}
+
+std::vector<Emulator32bit::StopReason> Multicore::run (U64 budget)
+{
+    std::vector<Emulator32bit::StopReason> reasons (m_cores.size ());
+    std::vector<std::thread> threads;
+    threads.reserve (m_cores.size ());
+
+    for (word id = 0; id < m_cores.size (); id++)
+    {
+        threads.emplace_back ([this, id, budget, &reasons] ()
+                              { m_cores[id]->run_until (budget, reasons[id]); });
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join ();
+    }
+    return reasons;
+}
+
+std::vector<Emulator32bit::StopReason> Multicore::run_quanta (U64 budget, U64 quantum,
+                                                             word nworkers)
+{
+    const word ncores = m_cores.size ();
+    if (nworkers == 0)
+    {
+        nworkers = std::thread::hardware_concurrency ();
+    }
+    nworkers = std::clamp<word> (nworkers, 1, std::max<word> (ncores, 1));
+
+    std::vector<Emulator32bit::StopReason> reasons (ncores);
+    std::vector<Emulator32bit::StopReason> slices (ncores);
+    std::vector<byte> running (ncores, true);
+    U64 executed = 0;
+    U64 step = budget == 0 ? quantum : std::min (quantum, budget);
+    bool done = ncores == 0 || quantum == 0;
+
+    /* state of each core at the start of the quantum, to run it again if isolation breaks */
+    std::vector<Emulator32bit::Context> contexts (ncores);
+    std::vector<Timer> timers;
+    timers.reserve (ncores);
+    for (Emulator32bit *core : m_cores)
+    {
+        timers.push_back (*core->timer);
+    }
+
+    /*
+     * Runs on one thread once every worker finished the quantum, before any starts the next.
+     * The cores take their turn in order: what a core did in isolation is written to the shared
+     * memory, or the core runs its quantum again now if it needed state the cores share.
+     */
+    const auto end_quantum = [&] () noexcept
+    {
+        for (word id = 0; id < ncores; id++)
+        {
+            if (!running[id])
+            {
+                continue;
+            }
+
+            Emulator32bit &core = *m_cores[id];
+            if (core.system_bus->isolation_broken ())
+            {
+                core.system_bus->discard_isolation ();
+                core.load_context (contexts[id]);
+                *core.timer = timers[id];
+                core.run_until (step, slices[id]);
+            }
+            else
+            {
+                core.system_bus->commit_isolation ();
+            }
+
+            const U64 total = reasons[id].instructions;
+            if (slices[id].status != Emulator32bit::RunStatus::BUDGET_EXHAUSTED)
+            {
+                reasons[id] = slices[id];
+                running[id] = false;
+            }
+            reasons[id].instructions = total + slices[id].instructions;
+        }
+
+        executed += step;
+        m_time += step;
+        deliver_deferred_ipis ();
+
+        step = budget == 0 ? quantum : std::min (quantum, budget - executed);
+        done = step == 0 || std::find (running.begin (), running.end (), true) == running.end ();
+    };
+    std::barrier sync (nworkers, end_quantum);
+
+    const auto worker = [&] (word first)
+    {
+        while (!done)
+        {
+            for (word id = first; id < ncores; id += nworkers)
+            {
+                if (!running[id])
+                {
+                    continue;
+                }
+
+                Emulator32bit &core = *m_cores[id];
+                contexts[id] = core.save_context ();
+                timers[id] = *core.timer;
+                core.system_bus->begin_isolation ();
+                core.run_until (step, slices[id]);
+            }
+            sync.arrive_and_wait ();
+        }
+    };
+
+    m_in_quanta = true;
+    std::vector<std::thread> threads;
+    threads.reserve (nworkers - 1);
+    for (word first = 1; first < nworkers; first++)
+    {
+        threads.emplace_back (worker, first);
+    }
+    worker (0);
+
+    for (std::thread &thread : threads)
+    {
+        thread.join ();
+    }
+    m_in_quanta = false;
+    deliver_deferred_ipis ();
+    return reasons;
+}
+
+void Multicore::send_ipi (word core_id, word bits)
+{
+    if (core_id >= m_cores.size ())
+    {
+        return;
+    }
+
+    if (m_in_quanta)
+    {
+        m_deferred_ipi[core_id].fetch_or (bits, std::memory_order_relaxed);
+    }
+    else
+    {
+        m_cores[core_id]->raise_ipi (bits);
+    }
+}
+
+void Multicore::deliver_deferred_ipis ()
+{
+    for (word id = 0; id < m_cores.size (); id++)
+    {
+        const word bits = m_deferred_ipi[id].exchange (0, std::memory_order_relaxed);
+        if (bits != 0)
+        {
+            m_cores[id]->raise_ipi (bits);
+        }
+    }
+}
+
+/*
+    Guest registers
+*/
+IPIDevice::IPIDevice (word start_page, Multicore *multicore) :
+    MMIODevice (1, start_page),
+    m_multicore (multicore)
+{
+}
+
+word IPIDevice::read_register (word offset)
+{
+    UNUSED (offset);
+    return 0;
+}
+
+void IPIDevice::write_register (word offset, word value)
+{
+    if (offset == kSendRegister)
+    {
+        m_multicore->send_ipi (value & 0xFF, value >> 8);
+    }
+}
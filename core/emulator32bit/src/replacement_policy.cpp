@@ -0,0 +1,495 @@
+#include "emulator32bit/replacement_policy.h"
+
+#include <algorithm>
+
+void PageRing::insert_before (word ppage, word before)
+{
+    if (ppage >= m_links.size ())
+    {
+        m_links.resize (ppage + 1);
+    }
+
+    Link &link = m_links[ppage];
+    if (m_front == kNone)
+    {
+        link.prev = ppage;
+        link.next = ppage;
+        m_front = ppage;
+    }
+    else
+    {
+        link.next = before;
+        link.prev = m_links[before].prev;
+        m_links[link.prev].next = ppage;
+        m_links[before].prev = ppage;
+    }
+    m_size++;
+}
+
+void PageRing::erase (word ppage)
+{
+    Link &link = m_links[ppage];
+    if (link.next == ppage)
+    {
+        m_front = kNone;
+    }
+    else
+    {
+        m_links[link.prev].next = link.next;
+        m_links[link.next].prev = link.prev;
+        if (m_front == ppage)
+        {
+            m_front = link.next;
+        }
+    }
+
+    link = Link ();
+    m_size--;
+}
+
+void PageRing::clear ()
+{
+    while (m_front != kNone)
+    {
+        erase (m_front);
+    }
+}
+
+const char *LRUPolicy::name () const
+{
+    return "LRU";
+}
+
+void LRUPolicy::insert (word ppage, U64)
+{
+    access (ppage);
+    if (!m_pages.contains (ppage))
+    {
+        m_pages.push_back (ppage);
+    }
+}
+
+void LRUPolicy::access (word ppage)
+{
+    /* the most recently used page is the one before the front */
+    if (m_pages.contains (ppage) && m_pages.prev (m_pages.front ()) != ppage)
+    {
+        m_pages.erase (ppage);
+        m_pages.push_back (ppage);
+    }
+}
+
+void LRUPolicy::remove (word ppage)
+{
+    if (m_pages.contains (ppage))
+    {
+        m_pages.erase (ppage);
+    }
+}
+
+bool LRUPolicy::select_victim (const std::function<bool (word)> &evictable, word &ppage)
+{
+    word page = m_pages.front ();
+    for (word i = 0; i < m_pages.size (); i++, page = m_pages.next (page))
+    {
+        if (evictable (page))
+        {
+            m_pages.erase (page);
+            ppage = page;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<word> LRUPolicy::pages () const
+{
+    std::vector<word> pages;
+    word page = m_pages.front ();
+    for (word i = 0; i < m_pages.size (); i++, page = m_pages.next (page))
+    {
+        pages.push_back (page);
+    }
+    return pages;
+}
+
+std::vector<U64> LRUPolicy::save () const
+{
+    const std::vector<word> order = pages ();
+    return std::vector<U64> (order.begin (), order.end ());
+}
+
+void LRUPolicy::restore (const std::vector<U64> &state)
+{
+    m_pages.clear ();
+    for (U64 ppage : state)
+    {
+        m_pages.push_back (word (ppage));
+    }
+}
+
+const char *ClockPolicy::name () const
+{
+    return "CLOCK";
+}
+
+void ClockPolicy::insert (word ppage, U64)
+{
+    if (ppage >= m_referenced.size ())
+    {
+        m_referenced.resize (ppage + 1);
+    }
+
+    if (!m_pages.contains (ppage))
+    {
+        /* behind the hand, so it is the last page the hand reaches */
+        m_pages.insert_before (ppage, m_hand);
+        if (m_hand == PageRing::kNone)
+        {
+            m_hand = ppage;
+        }
+    }
+    m_referenced[ppage] = true;
+}
+
+void ClockPolicy::access (word ppage)
+{
+    if (m_pages.contains (ppage))
+    {
+        m_referenced[ppage] = true;
+    }
+}
+
+void ClockPolicy::remove (word ppage)
+{
+    if (!m_pages.contains (ppage))
+    {
+        return;
+    }
+
+    if (m_hand == ppage)
+    {
+        m_hand = m_pages.size () == 1 ? PageRing::kNone : m_pages.next (ppage);
+    }
+    m_pages.erase (ppage);
+    m_referenced[ppage] = false;
+}
+
+bool ClockPolicy::select_victim (const std::function<bool (word)> &evictable, word &ppage)
+{
+    /* the second pass finds every evictable page cleared by the first */
+    const word steps = 2 * m_pages.size ();
+    for (word step = 0; step < steps; step++)
+    {
+        const word page = m_hand;
+        m_hand = m_pages.next (page);
+        if (!evictable (page))
+        {
+            continue;
+        }
+
+        if (m_referenced[page])
+        {
+            m_referenced[page] = false;
+            continue;
+        }
+
+        remove (page);
+        ppage = page;
+        return true;
+    }
+    return false;
+}
+
+std::vector<word> ClockPolicy::pages () const
+{
+    std::vector<word> pages;
+    word page = m_hand;
+    for (word i = 0; i < m_pages.size (); i++, page = m_pages.next (page))
+    {
+        pages.push_back (page);
+    }
+    return pages;
+}
+
+std::vector<U64> ClockPolicy::save () const
+{
+    std::vector<U64> state;
+    for (word page : pages ())
+    {
+        state.push_back (page | (U64 (m_referenced[page]) << 32));
+    }
+    return state;
+}
+
+void ClockPolicy::restore (const std::vector<U64> &state)
+{
+    while (m_hand != PageRing::kNone)
+    {
+        remove (m_hand);
+    }
+
+    for (U64 saved : state)
+    {
+        insert (word (saved), 0);
+        m_referenced[word (saved)] = saved >> 32;
+    }
+}
+
+ClockProPolicy::ClockProPolicy (U8 ghost_bits) :
+    m_ghost_bits (ghost_bits),
+    m_ghosts (U64 (1) << ghost_bits)
+{
+}
+
+const char *ClockProPolicy::name () const
+{
+    return "CLOCK-Pro";
+}
+
+void ClockProPolicy::insert (word ppage, U64 key)
+{
+    if (m_pages.contains (ppage))
+    {
+        access (ppage);
+        return;
+    }
+
+    if (ppage >= m_flags.size ())
+    {
+        m_flags.resize (ppage + 1);
+        m_keys.resize (ppage + 1);
+    }
+
+    /*
+     * A page evicted in its test period and brought back within as many evictions as there
+     * are pages in memory would have stayed with more room for cold pages.
+     */
+    bool reused = false;
+    if (Ghost &evicted = ghost (key); evicted.evicted != 0 && evicted.key == key)
+    {
+        reused = m_evicted - evicted.evicted < m_pages.size ();
+        if (reused)
+        {
+            m_cold_target = std::min (m_cold_target + 1, std::max (m_pages.size (), word (1)));
+        }
+        else if (m_cold_target > 1)
+        {
+            m_cold_target--;
+        }
+        evicted = Ghost ();
+    }
+
+    /* behind the cold hand, so it gets a whole turn before the hand considers it */
+    m_pages.insert_before (ppage, m_hand_cold);
+    if (m_hand_cold == PageRing::kNone)
+    {
+        m_hand_cold = ppage;
+        m_hand_hot = ppage;
+    }
+    m_keys[ppage] = key;
+    m_flags[ppage] = reused ? kHot : kTest;
+
+    if (reused)
+    {
+        m_hot++;
+        run_hand_hot ();
+    }
+}
+
+void ClockProPolicy::access (word ppage)
+{
+    if (m_pages.contains (ppage))
+    {
+        m_flags[ppage] |= kReferenced;
+    }
+}
+
+void ClockProPolicy::remove (word ppage)
+{
+    if (!m_pages.contains (ppage))
+    {
+        return;
+    }
+
+    const word next = m_pages.size () == 1 ? PageRing::kNone : m_pages.next (ppage);
+    if (m_hand_cold == ppage)
+    {
+        m_hand_cold = next;
+    }
+    if (m_hand_hot == ppage)
+    {
+        m_hand_hot = next;
+    }
+
+    m_hot -= (m_flags[ppage] & kHot) != 0;
+    m_flags[ppage] = 0;
+    m_pages.erase (ppage);
+}
+
+bool ClockProPolicy::select_victim (const std::function<bool (word)> &evictable, word &ppage)
+{
+    /*
+     * The first round only considers cold pages. The second turns the hot pages it passes
+     * cold, in case every evictable page is hot.
+     */
+    for (int round = 0; round < 2; round++)
+    {
+        const word steps = 2 * m_pages.size ();
+        for (word step = 0; step < steps; step++)
+        {
+            const word page = m_hand_cold;
+            m_hand_cold = m_pages.next (page);
+
+            U8 &flags = m_flags[page];
+            if (!evictable (page))
+            {
+                continue;
+            }
+
+            if (flags & kHot)
+            {
+                if (round == 1)
+                {
+                    flags = 0;
+                    m_hot--;
+                }
+                continue;
+            }
+
+            if (flags & kReferenced)
+            {
+                /* accessed again in its test period, otherwise it gets a new one */
+                if (flags & kTest)
+                {
+                    flags = kHot;
+                    m_hot++;
+                    run_hand_hot ();
+                }
+                else
+                {
+                    flags = kTest;
+                }
+                continue;
+            }
+
+            m_evicted++;
+            if (flags & kTest)
+            {
+                ghost (m_keys[page]) = Ghost{m_keys[page], m_evicted};
+            }
+
+            remove (page);
+            ppage = page;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ClockProPolicy::run_hand_hot ()
+{
+    if (m_hot == 0 || m_hot + m_cold_target <= m_pages.size ())
+    {
+        return;
+    }
+
+    /* the second pass finds every hot page cleared by the first */
+    const word steps = 2 * m_pages.size ();
+    for (word step = 0; step < steps; step++)
+    {
+        const word page = m_hand_hot;
+        m_hand_hot = m_pages.next (page);
+
+        U8 &flags = m_flags[page];
+        if (!(flags & kHot))
+        {
+            flags &= ~kTest;
+        }
+        else if (flags & kReferenced)
+        {
+            flags &= ~kReferenced;
+        }
+        else
+        {
+            flags = 0;
+            m_hot--;
+            return;
+        }
+    }
+}
+
+std::vector<word> ClockProPolicy::pages () const
+{
+    std::vector<word> pages;
+    word page = m_hand_cold;
+    for (word i = 0; i < m_pages.size (); i++, page = m_pages.next (page))
+    {
+        pages.push_back (page);
+    }
+    return pages;
+}
+
+std::vector<U64> ClockProPolicy::save () const
+{
+    const std::vector<word> order = pages ();
+    std::vector<U64> state = {m_cold_target, m_evicted, order.size (), 0};
+    for (word i = 0; i < order.size (); i++)
+    {
+        if (order[i] == m_hand_hot)
+        {
+            state[3] = i;
+        }
+        state.push_back (order[i] | (U64 (m_flags[order[i]]) << 32));
+        state.push_back (m_keys[order[i]]);
+    }
+
+    for (U64 slot = 0; slot < m_ghosts.size (); slot++)
+    {
+        if (m_ghosts[slot].evicted != 0)
+        {
+            state.insert (state.end (), {slot, m_ghosts[slot].key, m_ghosts[slot].evicted});
+        }
+    }
+    return state;
+}
+
+void ClockProPolicy::restore (const std::vector<U64> &state)
+{
+    while (m_hand_cold != PageRing::kNone)
+    {
+        remove (m_hand_cold);
+    }
+    std::fill (m_ghosts.begin (), m_ghosts.end (), Ghost ());
+
+    m_cold_target = word (state[0]);
+    m_evicted = state[1];
+    const U64 npages = state[2];
+    for (U64 i = 0; i < npages; i++)
+    {
+        const word page = word (state[4 + 2 * i]);
+        if (page >= m_flags.size ())
+        {
+            m_flags.resize (page + 1);
+            m_keys.resize (page + 1);
+        }
+
+        m_pages.push_back (page);
+        m_flags[page] = U8 (state[4 + 2 * i] >> 32);
+        m_keys[page] = state[5 + 2 * i];
+        m_hot += (m_flags[page] & kHot) != 0;
+        if (i == 0)
+        {
+            m_hand_cold = page;
+        }
+        if (i == state[3])
+        {
+            m_hand_hot = page;
+        }
+    }
+
+    for (U64 i = 4 + 2 * npages; i + 2 < state.size (); i += 3)
+    {
+        m_ghosts[state[i]] = Ghost{state[i + 1], state[i + 2]};
+    }
+}
@@ -5,6 +5,7 @@
 #define AEMU_ONLY_CRITICAL_LOG
 #include "util/logger.h"
 
+#include <cstring>
 #include <iostream>
 
 void Emulator32bit::_emu_print ()
@@ -17,34 +18,37 @@ void Emulator32bit::_emu_printr (byte reg_id)
     printf ("REG: %d = %x\n", reg_id, read_reg (reg_id));
 }
 
-void Emulator32bit::_emu_printm (word mem_addr, byte size, bool little_endian)
+/**
+ * @internal
+ * @brief                   Read a value of the given size for the memory syscalls, in one bus
+ *                          access. The first byte is the most significant if little_endian is set.
+ *
+ */
+static word read_syscall_value (SystemBus *system_bus, word mem_addr, byte size, bool little_endian)
 {
+    byte bytes[UINT8_MAX];
+    system_bus->read_block (mem_addr, bytes, size);
+
     word val = 0;
-    if (little_endian)
+    for (int i = 0; i < size; i++)
     {
-        for (byte i = 0; i < size; i++)
-        {
-            val <<= 8;
-            val += system_bus->read_byte (mem_addr + i);
-        }
-    }
-    else
-    {
-        for (int i = size - 1; i >= 0; i--)
-        {
-            val <<= 8;
-            val += system_bus->read_byte (mem_addr + i);
-        }
+        val = (val << 8) + bytes[little_endian ? i : size - 1 - i];
     }
+    return val;
+}
 
+void Emulator32bit::_emu_printm (word mem_addr, byte size, bool little_endian)
+{
+    const word val = read_syscall_value (system_bus, mem_addr, size, little_endian);
     printf ("MEM: %x = %.2x", mem_addr, val);
 }
 
 void Emulator32bit::_emu_printp ()
 {
-    printf ("PSTATE: N=%u,Z=%u,C=%u,V=%u", test_bit (m_pstate, kNFlagBit),
-            test_bit (m_pstate, kZFlagBit), test_bit (m_pstate, kCFlagBit),
-            test_bit (m_pstate, kVFlagBit));
+    const word pstate = get_pstate ();
+    printf ("PSTATE: N=%u,Z=%u,C=%u,V=%u", test_bit (pstate, kNFlagBit),
+            test_bit (pstate, kZFlagBit), test_bit (pstate, kCFlagBit),
+            test_bit (pstate, kVFlagBit));
 }
 
 void Emulator32bit::_emu_assertr (byte reg_id, word min_value, word max_value)
@@ -67,24 +71,7 @@ void Emulator32bit::_emu_assertr (byte reg_id, word min_value, word max_value)
 void Emulator32bit::_emu_assertm (word mem_addr, byte size, bool little_endian, word min_value,
                                   word max_value)
 {
-    word val = 0;
-    if (little_endian)
-    {
-        for (byte i = 0; i < size; i++)
-        {
-            val <<= 8;
-            val += system_bus->read_byte (mem_addr + i);
-        }
-    }
-    else
-    {
-        for (int i = size - 1; i >= 0; i--)
-        {
-            val <<= 8;
-            val += system_bus->read_byte (mem_addr + i);
-        }
-    }
-
+    const word val = read_syscall_value (system_bus, mem_addr, size, little_endian);
     if (val < min_value || val > max_value)
     {
         throw Exception (InterruptType::FAILED_ASSERT,
@@ -96,7 +83,7 @@ void Emulator32bit::_emu_assertm (word mem_addr, byte size, bool little_endian,
 
 void Emulator32bit::_emu_assertp (byte p_state_id, bool expected_value)
 {
-    bool val = test_bit (m_pstate, p_state_id);
+    bool val = test_bit (get_pstate (), p_state_id);
 
     if (val != expected_value)
     {
@@ -110,11 +97,21 @@ void Emulator32bit::_emu_assertp (byte p_state_id, bool expected_value)
 
 void Emulator32bit::_emu_log (word str)
 {
+    /* read up to the end of each page at once, the rest of a page is as mapped as the string */
     std::string msg;
-    while (system_bus->read_byte (str) != '\0')
+    char chunk[kPageSize];
+    while (true)
     {
-        msg += (char) system_bus->read_byte (str);
-        str++;
+        const word n = kPageSize - (str & (kPageSize - 1));
+        system_bus->read_block (str, (byte *) chunk, n);
+
+        const char *end = (const char *) std::memchr (chunk, '\0', n);
+        msg.append (chunk, end == nullptr ? n : end - chunk);
+        if (end != nullptr)
+        {
+            break;
+        }
+        str += n;
     }
 
     std::cout << msg << "\n";
@@ -133,6 +130,13 @@ void Emulator32bit::_emu_err (word err)
     std::cerr << msg << "\n";
 }
 
+void Emulator32bit::_emu_exit (word code)
+{
+    m_stop = true;
+    m_stop_status = RunStatus::EXIT;
+    m_exit_code = code;
+}
+
 /**
  * @brief                   System Calls
  *                          https://chromium.googlesource.com/chromiumos/docs/+/master/constants/syscalls.md#arm64-64_bit
@@ -187,6 +191,10 @@ void Emulator32bit::_emu_err (word err)
  * |
  * |    prints error to console and halts program
  * |
+ **|1030: emu_exit          word code               -                       -                       -                           -                                       -
+ * |
+ * |    stops the emulator, run_until returns the code
+ * |
  * |
  * |
  * |======================= I/O Operations ==========================
@@ -265,16 +273,19 @@ void Emulator32bit::_emu_err (word err)
  * @param instr
  * @param exception
  */
-void Emulator32bit::_swi (word instr)
+void Emulator32bit::_swi (const DecodedInstr &instr)
 {
-    byte cond = bitfield_unsigned (instr, 22, 4);
+    byte cond = instr.cond;
     DEBUG ("swi {}", cond);
 
-    if (!check_cond (m_pstate, cond))
+    if (!check_cond (cond))
     {
         return;
     }
 
+    /* system calls reach the console, disk and MMU the cores share */
+    system_bus->require_shared ();
+
     // software interrupts.. perfect to add functionality to this like console print,
     // file operations, ports, etc
     word id = read_reg (Register::SYSCALL);
@@ -309,6 +320,10 @@ void Emulator32bit::_swi (word instr)
     case 1012:
         _emu_assertp (arg0, arg1);
         break;
+
+    case 1030:
+        _emu_exit (arg0);
+        break;
     default:
         throw Exception (InterruptType::BAD_INSTR, "Invalid syscall number " + std::to_string (id));
     }
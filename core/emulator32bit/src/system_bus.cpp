@@ -1,28 +1,74 @@
 #include "emulator32bit/system_bus.h"
 
+#include "emulator32bit/decode_cache.h"
+#include "emulator32bit/kernel/better_virtual_memory.h"
+#include "emulator32bit/timer.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
 SystemBus::SystemBus (RAM *ram, ROM *rom) :
     ram (ram),
     rom (rom),
     disk (new MockDisk ()),
-    mmu (new VirtualMemory (disk))
+    mmu (new VirtualMemory (disk)),
+    dma (new DMAController (this)),
+    m_code_pages (ram->get_hi_page () + 1, false)
 {
+    map_physical_pages ();
+    mmu->restrict_ppages (ram->get_lo_page (), ram->get_hi_page ());
 }
 
 SystemBus::SystemBus (RAM *ram, ROM *rom, Disk *disk, VirtualMemory *mmu) :
     ram (ram),
     rom (rom),
     disk (disk),
-    mmu (mmu)
+    mmu (mmu),
+    dma (new DMAController (this)),
+    m_code_pages (ram->get_hi_page () + 1, false)
+{
+    map_physical_pages ();
+    mmu->restrict_ppages (ram->get_lo_page (), ram->get_hi_page ());
+}
+
+SystemBus::SystemBus (SystemBus *shared) :
+    ram (shared->ram),
+    rom (shared->rom),
+    disk (shared->disk),
+    mmu (shared->mmu),
+    dma (shared->dma),
+    m_page_map (shared->m_page_map),
+    m_root (shared),
+    m_code_pages (shared->m_code_pages.size (), false)
 {
+    if (shared->page_table_mmu != nullptr)
+    {
+        throw Exception ("Cores cannot share a bus that walks page tables.");
+    }
+    shared->m_cores.push_back (this);
 }
 
 SystemBus::~SystemBus ()
 {
+    if (m_root != this)
+    {
+        std::erase (m_root->m_cores, this);
+        return;
+    }
+
     disk->save ();
+    delete page_table_mmu;
     delete ram;
     delete rom;
     delete disk;
     delete mmu;
+    delete dma;
+
+    for (MMIODevice *device : m_devices)
+    {
+        delete device;
+    }
 }
 
 SystemBus::Exception::Exception (const std::string &msg) :
@@ -35,7 +81,614 @@ const char *SystemBus::Exception::what () const noexcept
     return message.c_str ();
 }
 
+void SystemBus::map_physical_pages ()
+{
+    BaseMemory *const memories[] = {disk, rom, ram};
+
+    word npages = 0;
+    for (BaseMemory *memory : memories)
+    {
+        npages = std::max (npages, memory->get_lo_page () + memory->get_mem_pages ());
+    }
+    m_page_map.assign (npages, PhysicalPage ());
+
+    /* later memories overwrite earlier ones, in the order routing used to try them */
+    for (BaseMemory *memory : memories)
+    {
+        Memory *direct = memory == disk ? nullptr : static_cast<Memory *> (memory);
+        for (word i = 0; i < memory->get_mem_pages (); i++)
+        {
+            const word ppage = memory->get_lo_page () + i;
+            m_page_map[ppage].memory = memory;
+            m_page_map[ppage].host =
+                direct == nullptr ? nullptr : direct->host_address (ppage << kNumPageOffsetBits);
+        }
+    }
+}
+
+void SystemBus::read_block (word address, byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       if (const byte *host = lookup_tlb (m_read_tlb, page_addr); host != nullptr)
+                       {
+                           std::memcpy (data + done, host, chunk);
+                           return;
+                       }
+                       read_physical_block (translate_and_fill_tlb (page_addr, false), data + done,
+                                            chunk);
+                   });
+}
+
+void SystemBus::write_block (word address, const byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       if (byte *host = lookup_tlb (m_write_tlb, page_addr); host != nullptr)
+                       {
+                           std::memcpy (host, data + done, chunk);
+                           return;
+                       }
+                       write_physical_block (translate_and_fill_tlb (page_addr, true), data + done,
+                                             chunk);
+                   });
+}
+
+void SystemBus::fill (word address, byte value, word n)
+{
+    for_each_page (address, n,
+                   [this, value] (word page_addr, word, word chunk)
+                   {
+                       if (byte *host = lookup_tlb (m_write_tlb, page_addr); host != nullptr)
+                       {
+                           std::memset (host, value, chunk);
+                           return;
+                       }
+                       fill_physical_page (translate_and_fill_tlb (page_addr, true), value, chunk);
+                   });
+}
+
+void SystemBus::read_unmapped_block (word address, byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       ensure_unmapped_mapping (page_addr);
+                       read_physical_block (page_addr, data + done, chunk);
+                   });
+}
+
+void SystemBus::write_unmapped_block (word address, const byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       ensure_unmapped_mapping (page_addr);
+                       write_physical_block (page_addr, data + done, chunk);
+                   });
+}
+
+void SystemBus::fill_unmapped (word address, byte value, word n)
+{
+    for_each_page (address, n,
+                   [this, value] (word page_addr, word, word chunk)
+                   {
+                       ensure_unmapped_mapping (page_addr);
+                       fill_physical_page (page_addr, value, chunk);
+                   });
+}
+
+void SystemBus::fill_physical_page (word address, byte value, word n)
+{
+    const PhysicalPage &page = route_page (address);
+    notify_write (address, n);
+    if (page.host != nullptr)
+    {
+        std::memset (page.host + (address & (kPageSize - 1)), value, n);
+        return;
+    }
+
+    const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+    for (word i = 0; i < n; i++)
+    {
+        page.memory->write_byte (address + i, value);
+    }
+}
+
+void SystemBus::map_device (MMIODevice *device)
+{
+    if (m_root != this)
+    {
+        m_root->map_device (device);
+        return;
+    }
+
+    const word hi_page = device->get_lo_page () + device->get_mem_pages ();
+    const word mapped = std::min<size_t> (hi_page, m_page_map.size ());
+    for (word ppage = device->get_lo_page (); ppage < mapped; ppage++)
+    {
+        if (m_page_map[ppage].memory != nullptr)
+        {
+            throw Exception ("Could not map device over physical page " + std::to_string (ppage)
+                             + ", it is already mapped.");
+        }
+    }
+
+    if (hi_page > m_page_map.size ())
+    {
+        m_page_map.resize (hi_page);
+    }
+    for (word ppage = device->get_lo_page (); ppage < hi_page; ppage++)
+    {
+        m_page_map[ppage].memory = device;
+    }
+    m_devices.push_back (device);
+
+    for (SystemBus *core : m_cores)
+    {
+        core->m_page_map = m_page_map;
+    }
+}
+
+void SystemBus::read_physical_block (word address, byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       const PhysicalPage &page = route_page (page_addr);
+                       if (page.host != nullptr)
+                       {
+                           std::memcpy (data + done, page.host + (page_addr & (kPageSize - 1)),
+                                        chunk);
+                       }
+                       else
+                       {
+                           const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+                           page.memory->read_block (page_addr, data + done, chunk);
+                       }
+                   });
+}
+
+void SystemBus::write_physical_block (word address, const byte *data, word n)
+{
+    for_each_page (address, n,
+                   [this, data] (word page_addr, word done, word chunk)
+                   {
+                       const PhysicalPage &page = route_page (page_addr);
+                       notify_write (page_addr, chunk);
+                       if (page.host != nullptr)
+                       {
+                           std::memcpy (page.host + (page_addr & (kPageSize - 1)), data + done,
+                                        chunk);
+                       }
+                       else
+                       {
+                           const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+                           page.memory->write_block (page_addr, data + done, chunk);
+                       }
+                   });
+}
+
 void SystemBus::reset ()
 {
-    ram->reset ();
-}
\ No newline at end of file
+    /* the memories of cores belong to the shared bus */
+    if (m_root == this)
+    {
+        for (word ppage = 0; ppage < m_snapshot_pages.size (); ppage++)
+        {
+            if (m_snapshot_pages[ppage])
+            {
+                save_snapshot_page (ppage);
+            }
+        }
+        ram->reset ();
+        if (page_table_mmu != nullptr)
+        {
+            page_table_mmu->reset ();
+        }
+    }
+    flush_tlb ();
+
+    std::fill (m_code_pages.begin (), m_code_pages.end (), false);
+    if (decode_cache != nullptr)
+    {
+        decode_cache->invalidate_all ();
+    }
+}
+
+void SystemBus::watch_code_page (word ppage)
+{
+    if (ppage >= m_code_pages.size ())
+    {
+        return;
+    }
+
+    m_code_pages[ppage] = true;
+
+    /*
+     * The first core to decode a page drops the write translations every other core cached.
+     * Isolated cores only write their own copies, so that waits until isolation ends.
+     */
+    if (m_root != this
+        && !std::atomic_ref<byte> (m_root->m_code_pages[ppage]).exchange (true))
+    {
+        if (m_isolated)
+        {
+            m_watched_while_isolated = true;
+        }
+        else
+        {
+            mmu->bump_generation ();
+        }
+    }
+
+    for (SoftTLBEntry &entry : m_write_tlb)
+    {
+        if (entry.ppage == ppage)
+        {
+            entry.tag = kInvalidTag;
+        }
+    }
+}
+
+void SystemBus::invalidate_code_page (word ppage)
+{
+    /* with cores, the flags of the shared bus are the union of theirs and stay set */
+    if (m_root != this || m_cores.empty ())
+    {
+        m_code_pages[ppage] = false;
+    }
+    if (decode_cache != nullptr)
+    {
+        decode_cache->invalidate_page (ppage);
+    }
+
+    /* the other cores are running, leave them a note to check at their next block */
+    for (SystemBus *core : m_root->m_cores)
+    {
+        if (core == this)
+        {
+            continue;
+        }
+
+        const std::lock_guard<std::mutex> lock (core->m_invalidation_lock);
+        core->m_invalidations.push_back (ppage);
+        core->m_has_invalidations.store (true, std::memory_order_release);
+    }
+}
+
+void SystemBus::snapshot_memory ()
+{
+    if (m_root != this || !m_cores.empty ())
+    {
+        throw Exception ("Cannot snapshot the memory shared by several cores.");
+    }
+
+    /* the page tables and their free lists are written straight to RAM, which is not tracked */
+    if (page_table_mmu != nullptr)
+    {
+        throw Exception ("Cannot snapshot the memory holding page tables.");
+    }
+
+    m_snapshot_pages.assign (m_code_pages.size (), false);
+    for (word ppage = ram->get_lo_page (); ppage <= ram->get_hi_page (); ppage++)
+    {
+        m_snapshot_pages[ppage] = m_page_map[ppage].memory == ram;
+    }
+    m_snapshot_dirty.clear ();
+    m_snapshot_data.clear ();
+
+    /* cached write translations would skip saving the pages */
+    std::fill (std::begin (m_write_tlb), std::end (m_write_tlb), SoftTLBEntry ());
+}
+
+void SystemBus::restore_memory ()
+{
+    for (size_t i = 0; i < m_snapshot_dirty.size (); i++)
+    {
+        const word ppage = m_snapshot_dirty[i];
+        std::memcpy (m_page_map[ppage].host, m_snapshot_data.data () + i * kPageSize, kPageSize);
+        m_snapshot_pages[ppage] = true;
+        if (is_code_page (ppage))
+        {
+            invalidate_code_page (ppage);
+        }
+    }
+
+    /* the restored pages are write protected again, capacity is kept for the next run */
+    if (!m_snapshot_dirty.empty ())
+    {
+        std::fill (std::begin (m_write_tlb), std::end (m_write_tlb), SoftTLBEntry ());
+    }
+    m_snapshot_dirty.clear ();
+    m_snapshot_data.clear ();
+}
+
+void SystemBus::save_snapshot_page (word ppage)
+{
+    const byte *host = m_page_map[ppage].host;
+    m_snapshot_data.insert (m_snapshot_data.end (), host, host + kPageSize);
+    m_snapshot_dirty.push_back (ppage);
+    m_snapshot_pages[ppage] = false;
+}
+
+void SystemBus::drain_invalidations ()
+{
+    std::vector<word> ppages;
+    {
+        const std::lock_guard<std::mutex> lock (m_invalidation_lock);
+        ppages.swap (m_invalidations);
+        m_has_invalidations.store (false, std::memory_order_relaxed);
+    }
+
+    for (word ppage : ppages)
+    {
+        m_code_pages[ppage] = false;
+        if (decode_cache != nullptr)
+        {
+            decode_cache->invalidate_page (ppage);
+        }
+    }
+}
+
+void SystemBus::begin_isolation ()
+{
+    if (m_private_index.empty ())
+    {
+        m_private_index.assign (m_page_map.size (), kNotPrivate);
+    }
+    m_isolated = true;
+    m_isolation_broken = false;
+
+    /* writes through the TLB would go straight to the shared pages */
+    std::fill (std::begin (m_write_tlb), std::end (m_write_tlb), SoftTLBEntry ());
+}
+
+void SystemBus::break_isolation ()
+{
+    m_isolation_broken = true;
+    throw Exception ("An isolated core cannot use state shared with the other cores.");
+}
+
+void SystemBus::isolate_write (word ppage)
+{
+    if (ppage < m_code_pages.size () && m_code_pages[ppage])
+    {
+        m_code_pages[ppage] = false;
+        if (decode_cache != nullptr)
+        {
+            decode_cache->invalidate_page (ppage);
+        }
+    }
+
+    if (ppage < m_private_index.size () && m_private_index[ppage] != kNotPrivate)
+    {
+        return;
+    }
+    if (ppage >= m_page_map.size () || m_page_map[ppage].memory != ram)
+    {
+        break_isolation ();
+    }
+
+    if (m_nprivate == m_private_pages.size ())
+    {
+        m_private_pages.push_back (std::make_unique<PrivatePage> ());
+    }
+    PrivatePage &copy = *m_private_pages[m_nprivate];
+    copy.ppage = ppage;
+    std::memcpy (copy.twin, m_page_map[ppage].host, kPageSize);
+    std::memcpy (copy.data, copy.twin, kPageSize);
+    m_private_index[ppage] = m_nprivate++;
+    m_page_map[ppage].host = copy.data;
+
+    /* reads cached before the first write still point at the shared page */
+    for (SoftTLBEntry &entry : m_read_tlb)
+    {
+        if (entry.ppage == ppage)
+        {
+            entry.tag = kInvalidTag;
+        }
+    }
+}
+
+void SystemBus::commit_isolation ()
+{
+    for (word i = 0; i < m_nprivate; i++)
+    {
+        const PrivatePage &copy = *m_private_pages[i];
+        const word base = copy.ppage << kNumPageOffsetBits;
+
+        /* only the runs of bytes the core changed, so writes of other cores to the rest stay */
+        const byte *const end = copy.data + kPageSize;
+        const byte *first = copy.data;
+        while (true)
+        {
+            first = std::mismatch (first, end, copy.twin + (first - copy.data)).first;
+            if (first == end)
+            {
+                break;
+            }
+
+            const byte *last = std::mismatch (first, end, copy.twin + (first - copy.data),
+                                              std::not_equal_to<byte> ())
+                                   .first;
+            m_root->write_physical_block (base + word (first - copy.data), first,
+                                          word (last - first));
+            first = last;
+        }
+    }
+    end_isolation ();
+}
+
+void SystemBus::discard_isolation ()
+{
+    /* instructions decoded since the page was copied came from the copy */
+    for (word i = 0; i < m_nprivate; i++)
+    {
+        const word ppage = m_private_pages[i]->ppage;
+        if (ppage < m_code_pages.size () && m_code_pages[ppage])
+        {
+            m_code_pages[ppage] = false;
+            if (decode_cache != nullptr)
+            {
+                decode_cache->invalidate_page (ppage);
+            }
+        }
+    }
+    end_isolation ();
+}
+
+void SystemBus::end_isolation ()
+{
+    for (SoftTLBEntry &entry : m_read_tlb)
+    {
+        if (entry.tag != kInvalidTag && m_private_index[entry.ppage] != kNotPrivate)
+        {
+            entry.tag = kInvalidTag;
+        }
+    }
+    std::fill (std::begin (m_write_tlb), std::end (m_write_tlb), SoftTLBEntry ());
+
+    for (word i = 0; i < m_nprivate; i++)
+    {
+        const word ppage = m_private_pages[i]->ppage;
+        m_page_map[ppage].host = m_root->m_page_map[ppage].host;
+        m_private_index[ppage] = kNotPrivate;
+    }
+    m_nprivate = 0;
+    m_isolated = false;
+
+    if (m_watched_while_isolated)
+    {
+        m_watched_while_isolated = false;
+        mmu->bump_generation ();
+    }
+}
+
+void SystemBus::charge_disk_page ()
+{
+    if (timer != nullptr)
+    {
+        timer->advance (Timer::kDiskPageCycles);
+    }
+}
+
+void SystemBus::handle_mmu_exception (VirtualMemory::Exception &exception)
+{
+    /* the evicted page has to reach disk before the fetched page overwrites it */
+    if (exception.type == VirtualMemory::Exception::Type::DISK_RETURN_AND_FETCH_SUCCESS
+        || exception.type == VirtualMemory::Exception::Type::DISK_RETURN_AND_COPY)
+    {
+        dma->transfer ({DMAController::Direction::MEMORY_TO_DISK,
+                        exception.ppage_return << kNumPageOffsetBits, exception.disk_page_return,
+                        1});
+        exception.type = exception.type == VirtualMemory::Exception::Type::DISK_RETURN_AND_COPY
+                             ? VirtualMemory::Exception::Type::COPY_ON_WRITE
+                             : VirtualMemory::Exception::Type::DISK_FETCH_SUCCESS;
+    }
+
+    if (exception.type == VirtualMemory::Exception::Type::COPY_ON_WRITE)
+    {
+        byte data[kPageSize];
+        read_physical_block (exception.ppage_copy << kNumPageOffsetBits, data, kPageSize);
+        write_physical_block (exception.ppage_fetch << kNumPageOffsetBits, data, kPageSize);
+    }
+
+    if (exception.type == VirtualMemory::Exception::Type::DISK_FETCH_SUCCESS)
+    {
+        dma->transfer ({DMAController::Direction::DISK_TO_MEMORY,
+                        exception.ppage_fetch << kNumPageOffsetBits, exception.disk_page_fetch,
+                        1});
+    }
+}
+
+void SystemBus::flush_tlb ()
+{
+    std::fill (std::begin (m_read_tlb), std::end (m_read_tlb), SoftTLBEntry ());
+    std::fill (std::begin (m_write_tlb), std::end (m_write_tlb), SoftTLBEntry ());
+    m_tlb_generation = mmu->generation ();
+}
+
+void SystemBus::invalidate_tlb_pages (word address, word npages)
+{
+    if (npages == 0)
+    {
+        return;
+    }
+
+    constexpr word kLastVPage = ~word (0) >> kNumPageOffsetBits;
+    const word asid = mmu->current_asid ();
+    const word first = address >> kNumPageOffsetBits;
+    const word last = first + std::min (npages - 1, kLastVPage - first);
+
+    /* the pages of an address space have consecutive tags */
+    const auto in_range = [first = soft_tlb_tag (asid, first),
+                           last = soft_tlb_tag (asid, last)] (const SoftTLBEntry &entry)
+    { return entry.tag >= first && entry.tag <= last; };
+    std::replace_if (std::begin (m_read_tlb), std::end (m_read_tlb), in_range, SoftTLBEntry ());
+    std::replace_if (std::begin (m_write_tlb), std::end (m_write_tlb), in_range, SoftTLBEntry ());
+
+    const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+    if (mmu->current_process () != -1)
+    {
+        mmu->invalidate_tlb (mmu->current_process (), first, last);
+    }
+}
+
+void SystemBus::invalidate_tlb_process ()
+{
+    invalidate_tlb_pages (0, (~word (0) >> kNumPageOffsetBits) + 1);
+}
+
+void SystemBus::invalidate_tlb_all ()
+{
+    flush_tlb ();
+
+    const std::unique_lock<std::recursive_mutex> lock = lock_shared ();
+    mmu->flush_tlb ();
+}
+
+word SystemBus::walk_page_table (word address, bool write, bool execute, bool &cacheable)
+{
+    const MMU::AccessMode mode = write     ? MMU::WRITE_ACCESSMODE
+                                 : execute ? MMU::EXECUTE_ACCESSMODE
+                                           : MMU::READ_ACCESSMODE;
+    return page_table_mmu->map_address (address, mode, cacheable);
+}
+
+word SystemBus::translate_and_fill_tlb (word address, bool write)
+{
+    bool cacheable = true;
+    const word paddr = page_table_mmu != nullptr
+                           ? walk_page_table (address, write, false, cacheable)
+                           : translate_address (address, write);
+
+    /* translating can page in, which changes the mappings */
+    if (m_tlb_generation != mmu->generation ())
+    {
+        flush_tlb ();
+    }
+
+    const word ppage = paddr >> kNumPageOffsetBits;
+    if (!cacheable || ppage >= m_page_map.size () || m_page_map[ppage].host == nullptr)
+    {
+        return paddr;
+    }
+
+    /* rom is never written through the TLB so protecting it later only touches the slow path */
+    const PhysicalPage &page = m_page_map[ppage];
+    if (write && (page.memory != ram || is_code_page (ppage) || is_snapshot_page (ppage)))
+    {
+        return paddr;
+    }
+
+    const word vpage = address >> kNumPageOffsetBits;
+    const word asid = mmu->current_asid ();
+    SoftTLBEntry &entry = (write ? m_write_tlb : m_read_tlb)[soft_tlb_index (asid, vpage)];
+    entry.tag = soft_tlb_tag (asid, vpage);
+    entry.ppage = ppage;
+    entry.host = page.host;
+    return paddr;
+}
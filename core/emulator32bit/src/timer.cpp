@@ -3,4 +3,101 @@
 Timer::Timer (Emulator32bit *processor) :
     m_processor (processor)
 {
-}
\ No newline at end of file
+}
+
+U8 Timer::instruction_cycles (word raw)
+{
+    switch (bitfield_unsigned (raw, 26, 6))
+    {
+    case Emulator32bit::_op_special_instructions:
+        switch (bitfield_unsigned (raw, 22, 4))
+        {
+        case Emulator32bit::kSpecialOpId_msr:
+        case Emulator32bit::kSpecialOpId_mrs:
+            return kBaseCycles + 1;
+        case Emulator32bit::kSpecialOpId_atomic:
+            /* read and write back */
+            return kBaseCycles + 2 * kMemoryAccessCycles;
+        default:
+            return kBaseCycles;
+        }
+
+    case Emulator32bit::_op_mul:
+        return kBaseCycles + 2;
+    case Emulator32bit::_op_umull:
+    case Emulator32bit::_op_smull:
+        return kBaseCycles + 3;
+
+    case Emulator32bit::_op_vsqrt:
+    case Emulator32bit::_op_vdiv:
+        return kBaseCycles + 13;
+    case Emulator32bit::_op_vabs:
+    case Emulator32bit::_op_vneg:
+    case Emulator32bit::_op_vadd:
+    case Emulator32bit::_op_vsub:
+    case Emulator32bit::_op_vmul:
+    case Emulator32bit::_op_vcmp:
+    case Emulator32bit::_op_vsel:
+    case Emulator32bit::_op_vcint:
+    case Emulator32bit::_op_vcflo:
+    case Emulator32bit::_op_vmov:
+        return kBaseCycles + 3;
+
+    case Emulator32bit::_op_ldr:
+    case Emulator32bit::_op_ldrb:
+    case Emulator32bit::_op_ldrh:
+    case Emulator32bit::_op_str:
+    case Emulator32bit::_op_strb:
+    case Emulator32bit::_op_strh:
+        return kBaseCycles + kMemoryAccessCycles;
+
+    case Emulator32bit::_op_b:
+    case Emulator32bit::_op_bl:
+    case Emulator32bit::_op_bx:
+    case Emulator32bit::_op_blx:
+        return kBaseCycles + kBranchCycles;
+
+    case Emulator32bit::_op_swi:
+        /* trap into the handler and back */
+        return kBaseCycles + 2 * kBranchCycles;
+
+    default:
+        return kBaseCycles;
+    }
+}
+
+void Timer::set_deadline (U64 cycle)
+{
+    m_deadline = cycle;
+    m_interval = 0;
+}
+
+void Timer::set_interval (U64 cycles)
+{
+    m_interval = cycles;
+    m_deadline = cycles == 0 ? kNoDeadline : m_clock + cycles;
+}
+
+void Timer::acknowledge ()
+{
+    if (!expired ())
+    {
+        return;
+    }
+
+    if (m_interval == 0)
+    {
+        m_deadline = kNoDeadline;
+        return;
+    }
+
+    /* skip the slices that already went by, a long block can overshoot more than one */
+    m_deadline += (m_clock - m_deadline) / m_interval * m_interval + m_interval;
+}
+
+void Timer::reset ()
+{
+    m_clock = 0;
+    m_deadline = kNoDeadline;
+    m_interval = 0;
+}
@@ -3,6 +3,7 @@
 #define AEMU_ONLY_CRITICAL_LOG
 #include "util/logger.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 VirtualMemory::VirtualMemory (Disk *disk) :
@@ -18,13 +19,13 @@ VirtualMemory::VirtualMemory (Disk *disk) :
 
 VirtualMemory::~VirtualMemory ()
 {
-    LRU_Node *cur = m_lru_head;
-    while (cur != nullptr)
+    delete m_replacement;
+
+    for (std::pair<const long long, PageTable *> &pair : m_process_ptable_map)
     {
-        LRU_Node *next = cur->next;
-        delete cur;
-        cur = next;
+        delete pair.second;
     }
+    delete[] m_physical_memory_map;
 }
 
 VirtualMemory::VirtualMemoryException::VirtualMemoryException (const std::string &msg) :
@@ -85,25 +86,13 @@ word VirtualMemory::InvalidVPageException::get_vpage () const noexcept
     return vpage;
 }
 
-VirtualMemory::PageTableEntry::PageTableEntry (long long pid, word vpage, word diskpage, bool write,
-                                               bool execute) :
-    pid (pid),
-    vpage (vpage),
-    ppage (0),
-    disk (true),
-    diskpage (diskpage),
-    mapped (false),
-    mapped_ppage (0),
-    write (write),
-    execute (execute)
-{
-}
-
 VirtualMemory::PhysicalPage::PhysicalPage () :
-    mapped_vpages (std::vector<PageTableEntry *> ()),
+    mapped_vpages (std::vector<MappedVPage> ()),
     ppage (0),
     used (false),
     swappable (true),
+    superpage (false),
+    dirty (false),
     kernel_locked (false)
 {
 }
@@ -118,7 +107,8 @@ void VirtualMemory::set_process (long long pid)
         return;
     }
 
-    m_cur_ptable = m_process_ptable_map.at (pid);
+    /* cached translations are tagged with the pid, so they are kept */
+    switch_table (m_process_ptable_map.at (pid));
     DEBUG ("Setting memory map to process {}.", pid);
 }
 
@@ -139,12 +129,79 @@ long long VirtualMemory::begin_process (bool kernel_privilege)
     };
 
     m_process_ptable_map.insert (std::make_pair (pid, new_pagetable));
-    m_cur_ptable = new_pagetable;
+    switch_table (new_pagetable);
+    m_generation++;
+    touch_tables ();
 
     DEBUG ("Beginning process {}.", pid);
     return pid;
 }
 
+long long VirtualMemory::fork_process (long long pid)
+{
+    if (m_process_ptable_map.find (pid) == m_process_ptable_map.end ())
+    {
+        throw InvalidPIDException ("Cannot fork process " + std::to_string (pid)
+                                       + " since it does not exist.",
+                                   pid);
+    }
+
+    PageTable *parent = m_process_ptable_map.at (pid);
+    PageTable *current = m_cur_ptable;
+    const long long child_pid = begin_process (parent->kernel_privilege);
+    PageTable *child = m_process_ptable_map.at (child_pid);
+    switch_table (current);
+
+    std::vector<byte> data;
+    child->mapped_ppages = parent->mapped_ppages;
+    for_each_entry (parent,
+                    [&] (word vpage, PageTableEntry &entry)
+                    {
+                        PageTableEntry &copy = *insert_entry (child, vpage);
+                        copy = entry;
+
+                        if (entry.disk)
+                        {
+                            copy.frame = m_disk->get_free_page ();
+                            data.resize (kPageSize);
+                            m_disk->read_page (entry.frame, data.data ());
+                            m_disk->write_page (copy.frame, data.data ());
+                            return;
+                        }
+
+                        /* forcibly mapped pages stay shared, like the device they usually map */
+                        m_physical_memory_map[entry.frame].mapped_vpages.push_back (
+                            MappedVPage{child_pid, vpage});
+                        if (!entry.mapped)
+                        {
+                            if (!entry.cow)
+                            {
+                                entry.cow = true;
+                                m_cow_entries++;
+                            }
+                            copy.cow = true;
+                            m_cow_entries++;
+                        }
+                    });
+
+    /* superpages are never copied a page at a time, so they stay shared */
+    for_each_superpage (parent,
+                        [&] (word vpage, const PageTableEntry &entry)
+                        {
+                            child->superpages[vpage >> kNumPageTableBits] = entry;
+                            m_physical_memory_map[entry.frame].mapped_vpages.push_back (
+                                MappedVPage{child_pid, vpage});
+                            m_superpages++;
+                        });
+
+    /* cached write translations of the parent must not bypass the copy */
+    m_generation++;
+    touch_tables ();
+
+    DEBUG ("Forking process {} into {}.", pid, child_pid);
+    return child_pid;
+}
+
 void VirtualMemory::end_process (long long pid)
 {
     if (m_process_ptable_map.find (pid) == m_process_ptable_map.end ())
@@ -156,29 +213,27 @@ void VirtualMemory::end_process (long long pid)
         return;
     }
 
-    /*
-     * Store into a temporary array because when vpage entry is removed, it will also be removed
-     * from the process PageTableEntry map. This would have caused a concurrent modification error.
-     */
-    std::vector<word> vpages;
-    for (std::pair<const word, PageTableEntry *> &pair : m_process_ptable_map.at (pid)->entries)
-    {
-        vpages.push_back (pair.first);
-    }
+    /* the whole table goes, so its entries are not cleared one by one */
+    PageTable *ptable = m_process_ptable_map.at (pid);
+    for_each_entry (ptable,
+                    [&] (word vpage, PageTableEntry &entry) { release_vpage (pid, vpage, entry); });
+    for_each_superpage (ptable, [&] (word vpage, const PageTableEntry &entry)
+                        { release_superpage (pid, vpage, entry); });
+    release_tables (ptable);
 
-    for (word vpage : vpages)
-    {
-        remove_vpage (pid, vpage);
-    }
+    /* the pid may be handed out again, with other pages at the same addresses */
+    invalidate_tlb (pid);
 
-    if (m_cur_ptable == m_process_ptable_map.at (pid))
+    if (m_cur_ptable == ptable)
     {
-        m_cur_ptable = nullptr;
+        switch_table (nullptr);
     }
 
-    delete m_process_ptable_map.at (pid);
+    delete ptable;
     m_process_ptable_map.erase (pid);
     m_freepids.return_block (pid, 1);
+    m_generation++;
+    touch_tables ();
     DEBUG ("Ending process {}.", pid);
 }
 
@@ -200,6 +255,26 @@ void VirtualMemory::set_ppage_permissions (word ppage_begin, word ppage_end, wor
         m_physical_memory_map[i].swappable = swappable;
         m_physical_memory_map[i].kernel_locked = kernel_locked;
     }
+    m_permissions.push_back (PermissionRange{ppage_begin, ppage_end, swappable, kernel_locked});
+    touch_tables ();
+}
+
+void VirtualMemory::restrict_ppages (word ppage_begin, word ppage_end)
+{
+    for (const std::pair<word, word> &block : m_freelist.get_blocks ())
+    {
+        const word block_end = block.first + block.second;
+        if (block.first < ppage_begin)
+        {
+            m_freelist.remove_block (block.first, std::min (block_end, ppage_begin) - block.first);
+        }
+        if (block_end > ppage_end + 1)
+        {
+            const word first = std::max (block.first, ppage_end + 1);
+            m_freelist.remove_block (first, block_end - first);
+        }
+    }
+    touch_tables ();
 }
 
 void VirtualMemory::set_vpage_permissions (long long pid, word vpage_begin, word vpage_end,
@@ -211,15 +286,16 @@ void VirtualMemory::set_vpage_permissions (long long pid, word vpage_begin, word
     }
 
     PageTable *ptable = m_process_ptable_map.at (pid);
+    touch_tables ();
     for (word vpage = vpage_begin; vpage <= vpage_end; vpage++)
     {
-        if (ptable->entries.find (vpage) == ptable->entries.end ())
+        PageTableEntry *entry = find_mapping (ptable, vpage);
+        if (entry == nullptr)
         {
             add_vpage (pid, vpage, 1, write, execute);
         }
         else
         {
-            PageTableEntry *entry = ptable->entries.at (vpage);
             entry->write = write;
             entry->execute = execute;
         }
@@ -234,12 +310,8 @@ bool VirtualMemory::can_write_vpage (long long pid, word vpage)
             "Cannot check write permission of virtual page because pid is invalid.", pid);
     }
 
-    PageTable *ptable = m_process_ptable_map.at (pid);
-    if (ptable->entries.find (vpage) == ptable->entries.end ())
-    {
-        return false;
-    }
-    return ptable->entries.at (vpage)->write;
+    PageTableEntry *entry = find_mapping (m_process_ptable_map.at (pid), vpage);
+    return entry != nullptr && entry->write;
 }
 
 bool VirtualMemory::can_execute_vpage (long long pid, word vpage)
@@ -250,12 +322,8 @@ bool VirtualMemory::can_execute_vpage (long long pid, word vpage)
             "Cannot check execute permission of virtual page because pid is invalid.", pid);
     }
 
-    PageTable *ptable = m_process_ptable_map.at (pid);
-    if (ptable->entries.find (vpage) == ptable->entries.end ())
-    {
-        return false;
-    }
-    return ptable->entries.at (vpage)->execute;
+    PageTableEntry *entry = find_mapping (m_process_ptable_map.at (pid), vpage);
+    return entry != nullptr && entry->execute;
 }
 
 bool VirtualMemory::can_access_ppage (long long pid, word ppage)
@@ -270,7 +338,8 @@ bool VirtualMemory::can_access_ppage (long long pid, word ppage)
     return !m_physical_memory_map[ppage].kernel_locked || ptable->kernel_privilege;
 }
 
-void VirtualMemory::add_vpage (long long pid, word vpage, word length, bool write, bool execute)
+void VirtualMemory::add_vpage (long long pid, word vpage, word length, bool write, bool execute,
+                               bool superpages)
 {
     if (UNLIKELY (m_process_ptable_map.find (pid) == m_process_ptable_map.end ()))
     {
@@ -280,10 +349,23 @@ void VirtualMemory::add_vpage (long long pid, word vpage, word length, bool writ
     DEBUG ("Adding vpages from {} to {}.", vpage, vpage + length - 1);
 
     PageTable *ptable = m_process_ptable_map.at (pid);
+    if (superpages)
+    {
+        add_superpages (ptable, vpage, length, write, execute);
+        return;
+    }
+
     word last_vpage = vpage + length - 1;
     for (; vpage <= last_vpage; vpage++)
     {
-        if (ptable->entries.find (vpage) != ptable->entries.end ())
+        if (vpage >= kNumVPages)
+        {
+            throw InvalidVPageException ("Cannot add virtual page " + std::to_string (vpage)
+                                             + " because it is outside of the address space.",
+                                         vpage);
+        }
+
+        if (find_mapping (ptable, vpage) != nullptr)
         {
             throw InvalidVPageException ("Cannot add virtual page " + std::to_string (vpage)
                                              + " because it is already mapped to process "
@@ -292,13 +374,97 @@ void VirtualMemory::add_vpage (long long pid, word vpage, word length, bool writ
             return;
         }
 
-        ptable->entries.insert (std::make_pair (
-            vpage, new PageTableEntry (pid, vpage, m_disk->get_free_page (), write, execute)));
+        PageTableEntry *entry = insert_entry (ptable, vpage);
+        entry->valid = true;
+        entry->disk = true;
+        entry->write = write;
+        entry->execute = execute;
+        entry->frame = m_disk->get_free_page ();
+        touch_tables ();
 
         DEBUG ("Adding virtual page {} to process {}.", vpage, pid);
     }
 }
 
+void VirtualMemory::add_superpages (PageTable *ptable, word vpage, word length, bool write,
+                                    bool execute)
+{
+    if (vpage % kSuperpagePages != 0 || length % kSuperpagePages != 0)
+    {
+        throw InvalidVPageException ("Cannot add superpages from virtual page "
+                                         + std::to_string (vpage)
+                                         + " because they are not aligned to superpages.",
+                                     vpage);
+    }
+
+    for (word first = vpage; first - vpage < length; first += kSuperpagePages)
+    {
+        if (first >= kNumVPages)
+        {
+            throw InvalidVPageException ("Cannot add superpage " + std::to_string (first)
+                                             + " because it is outside of the address space.",
+                                         first);
+        }
+
+        const word dir = first >> kNumPageTableBits;
+        if (ptable->directory[dir] != nullptr || ptable->superpages[dir].valid)
+        {
+            throw InvalidVPageException ("Cannot add superpage " + std::to_string (first)
+                                             + " because some of its pages are already mapped "
+                                               "to process "
+                                             + std::to_string (ptable->pid),
+                                         first);
+        }
+
+        if (!m_freelist.can_fit (kSuperpagePages))
+        {
+            throw VirtualMemoryException ("Cannot add superpage " + std::to_string (first)
+                                          + " because no consecutive physical pages are free.");
+        }
+
+        const word ppage = m_freelist.get_free_block (kSuperpagePages);
+        mark_superpage (ppage, true);
+        m_physical_memory_map[ppage].mapped_vpages.push_back (MappedVPage{ptable->pid, first});
+
+        PageTableEntry &entry = ptable->superpages[dir];
+        entry.valid = true;
+        entry.write = write;
+        entry.execute = execute;
+        entry.frame = ppage;
+        m_superpages++;
+        touch_tables ();
+
+        DEBUG ("Adding superpage {} to process {}.", first, ptable->pid);
+    }
+}
+
+void VirtualMemory::release_superpage (long long pid, word vpage, const PageTableEntry &entry)
+{
+    m_superpages--;
+
+    /* forks share the superpage, its first physical page keeps every mapping */
+    PhysicalPage &first = m_physical_memory_map[entry.frame];
+    std::erase (first.mapped_vpages, MappedVPage{pid, vpage});
+    if (!first.mapped_vpages.empty ())
+    {
+        return;
+    }
+
+    mark_superpage (entry.frame, false);
+    m_freelist.return_block (entry.frame, kSuperpagePages);
+
+    DEBUG ("Returning physical pages of superpage {} of process {}.", vpage, pid);
+}
+
+void VirtualMemory::mark_superpage (word ppage, bool used)
+{
+    for (word i = 0; i < kSuperpagePages; i++)
+    {
+        m_physical_memory_map[ppage + i].used = used;
+        m_physical_memory_map[ppage + i].superpage = used;
+    }
+}
+
 void VirtualMemory::map_ppage (long long pid, word vpage, word ppage, Exception &exception)
 {
     if (UNLIKELY (m_process_ptable_map.find (pid) == m_process_ptable_map.end ()))
@@ -308,14 +474,21 @@ void VirtualMemory::map_ppage (long long pid, word vpage, word ppage, Exception
     }
 
     PageTable *ptable = m_process_ptable_map.at (pid);
-    if (ptable->entries.find (vpage) != ptable->entries.end ())
+    if (find_mapping (ptable, vpage) != nullptr)
     {
         throw InvalidVPageException (
             "Cannot map virtual page to physical page because virtual page has already been added.",
             vpage);
     }
 
-    add_vpage (vpage, 1, true, true, true);
+    if (m_physical_memory_map[ppage].superpage)
+    {
+        throw VirtualMemoryException ("Cannot map virtual page to physical page "
+                                      + std::to_string (ppage)
+                                      + " because it belongs to a superpage.");
+    }
+
+    add_vpage (pid, vpage, 1, true, true);
 
     if (m_physical_memory_map[ppage].used)
     {
@@ -323,11 +496,11 @@ void VirtualMemory::map_ppage (long long pid, word vpage, word ppage, Exception
     }
 
     m_freelist.remove_block (ppage, 1);
-    map_vpage_to_ppage (pid, vpage, ppage, exception);
+    map_vpage_to_ppage (ptable, vpage, ppage, exception);
 
-    PageTableEntry *entry = ptable->entries.at (vpage);
-    entry->mapped = true;
-    entry->mapped_ppage = ppage;
+    find_entry (ptable, vpage)->mapped = true;
+    ptable->mapped_ppages[vpage] = ppage;
+    touch_tables ();
 }
 
 void VirtualMemory::remove_vpage (long long pid, word vpage)
@@ -338,34 +511,215 @@ void VirtualMemory::remove_vpage (long long pid, word vpage)
     }
 
     PageTable *ptable = m_process_ptable_map.at (pid);
-
-    if (ptable->entries.find (vpage) == ptable->entries.end ())
+    PageTableEntry *entry = find_entry (ptable, vpage);
+    if (entry == nullptr)
     {
         throw InvalidVPageException (
             "Cannot remove virtual page because it is not mapped to process.", vpage);
         return;
     }
 
-    PageTableEntry *entry = ptable->entries.at (vpage);
-    ptable->entries.erase (vpage);
+    release_vpage (pid, vpage, *entry);
+    ptable->mapped_ppages.erase (vpage);
+    *entry = PageTableEntry ();
+    m_generation++;
+    touch_tables ();
 
-    if (entry->disk)
+    /* the pid may be handed out again, with other pages at the same addresses */
+    invalidate_tlb (pid, vpage, vpage);
+}
+
+void VirtualMemory::release_vpage (long long pid, word vpage, PageTableEntry &entry)
+{
+    m_cow_entries -= entry.cow;
+
+    if (entry.disk)
     {
-        m_disk->return_page (entry->diskpage);
+        m_disk->return_page (entry.frame);
 
-        DEBUG ("Returning disk page {} coressponding to virtual page {}.", entry->diskpage, vpage);
+        DEBUG ("Returning disk page {} coressponding to virtual page {}.", word (entry.frame),
+               vpage);
+        return;
     }
-    else
+
+    PhysicalPage &ppage = m_physical_memory_map[entry.frame];
+    std::erase (ppage.mapped_vpages, MappedVPage{pid, vpage});
+
+    /* other processes may still share the page */
+    if (ppage.mapped_vpages.empty ())
     {
-        m_physical_memory_map[entry->ppage].used = false;
+        ppage.used = false;
+        m_replacement->remove (entry.frame);
 
         /* add back to free list */
-        m_freelist.return_block (entry->ppage, 1);
+        m_freelist.return_block (entry.frame, 1);
+
+        DEBUG ("Returning physical page {} corresponding to virtual page {}.", word (entry.frame),
+               vpage);
+    }
+}
+
+VirtualMemory::PageTableEntry *VirtualMemory::insert_entry (PageTable *ptable, word vpage)
+{
+    PageTableEntry *&table = ptable->directory[vpage >> kNumPageTableBits];
+    if (table == nullptr)
+    {
+        table = m_ptable_pool.allocate ();
+    }
+    return &table[vpage & (kPageTableSize - 1)];
+}
+
+void VirtualMemory::release_tables (PageTable *ptable)
+{
+    for (PageTableEntry *&table : ptable->directory)
+    {
+        if (table != nullptr)
+        {
+            m_ptable_pool.release (table);
+            table = nullptr;
+        }
+    }
+}
+
+word VirtualMemory::page_table_pages () const
+{
+    return m_ptable_pool.in_use ();
+}
+
+VirtualMemory::PageTableEntry *VirtualMemory::PageTablePool::allocate ()
+{
+    if (m_free.empty ())
+    {
+        const word nentries = kTablesPerChunk * kPageTableSize;
+        PageTableEntry *chunk =
+            m_chunks.emplace_back (std::make_unique<PageTableEntry[]> (nentries)).get ();
+        for (word i = kTablesPerChunk; i-- > 0;)
+        {
+            m_free.push_back (&chunk[i * kPageTableSize]);
+        }
+    }
+
+    PageTableEntry *table = m_free.back ();
+    m_free.pop_back ();
+    m_in_use++;
+    return table;
+}
+
+void VirtualMemory::PageTablePool::release (PageTableEntry *table)
+{
+    std::fill (table, table + kPageTableSize, PageTableEntry ());
+    m_free.push_back (table);
+    m_in_use--;
+}
+
+void VirtualMemory::fill_tlb (word asid, word vpage, word ppage, bool superpage)
+{
+    /* a superpage entry translates the first page of the superpage */
+    if (superpage)
+    {
+        ppage -= vpage & (kSuperpagePages - 1);
+        vpage >>= kNumPageTableBits;
+    }
+
+    TLB_Entry *set = superpage ? super_tlb_set (asid, vpage) : tlb_set (asid, vpage);
+
+    TLB_Entry *victim = &set[0];
+    for (word way = 0; way < kNumTLBWays; way++)
+    {
+        if (!set[way].valid)
+        {
+            victim = &set[way];
+            break;
+        }
+
+        if (set[way].last_use < victim->last_use)
+        {
+            victim = &set[way];
+        }
+    }
+
+    m_tlb_stats.evictions += victim->valid;
+    *victim = TLB_Entry{
+        .valid = true,
+        .asid = asid,
+        .vpage = vpage,
+        .ppage = ppage,
+        .last_use = ++m_tlb_clock,
+    };
+}
 
-        DEBUG ("Returning physical page {} corresponding to virtual page {}.", entry->ppage, vpage);
+void VirtualMemory::invalidate_tlb (long long pid, word vpage_begin, word vpage_end)
+{
+    for (TLB_Entry &entry : m_super_tlb)
+    {
+        if (entry.asid == pid && entry.vpage >= vpage_begin >> kNumPageTableBits
+            && entry.vpage <= vpage_end >> kNumPageTableBits)
+        {
+            entry.valid = false;
+        }
+    }
+
+    /* a small range is looked up set by set, a large one checks every entry */
+    if (vpage_end - vpage_begin < kNumTLBSets)
+    {
+        for (word i = 0; i <= vpage_end - vpage_begin; i++)
+        {
+            const word vpage = vpage_begin + i;
+            TLB_Entry *set = tlb_set (pid, vpage);
+            for (word way = 0; way < kNumTLBWays; way++)
+            {
+                if (set[way].asid == pid && set[way].vpage == vpage)
+                {
+                    set[way].valid = false;
+                }
+            }
+        }
+        return;
     }
 
-    delete entry;
+    for (TLB_Entry &entry : m_tlb)
+    {
+        if (entry.asid == pid && entry.vpage >= vpage_begin && entry.vpage <= vpage_end)
+        {
+            entry.valid = false;
+        }
+    }
+}
+
+void VirtualMemory::invalidate_tlb (long long pid)
+{
+    for (TLB_Entry &entry : m_tlb)
+    {
+        if (entry.asid == pid)
+        {
+            entry.valid = false;
+        }
+    }
+    for (TLB_Entry &entry : m_super_tlb)
+    {
+        if (entry.asid == pid)
+        {
+            entry.valid = false;
+        }
+    }
+}
+
+void VirtualMemory::flush_tlb ()
+{
+    for (TLB_Entry &entry : m_tlb)
+    {
+        entry.valid = false;
+    }
+    for (TLB_Entry &entry : m_super_tlb)
+    {
+        entry.valid = false;
+    }
+}
+
+void VirtualMemory::switch_table (PageTable *ptable)
+{
+    m_cur_ptable = ptable;
+    m_cur_asid.store (ptable == nullptr ? kNoASID : word (ptable->pid), std::memory_order_relaxed);
 }
 
 void VirtualMemory::check_vm ()
@@ -376,15 +730,21 @@ void VirtualMemory::check_vm ()
 
         EXPECT_TRUE (word (i) == ppage.ppage, "Expected physical memory to match");
 
-        if (ppage.mapped_vpages.size () > 0)
+        for (const MappedVPage &mapped : ppage.mapped_vpages)
         {
-            word diskpage = ppage.mapped_vpages.at (0)->diskpage;
-            for (PageTableEntry *entry : ppage.mapped_vpages)
+            if (ppage.superpage)
             {
-                EXPECT_TRUE (entry->diskpage == diskpage,
-                             "Expected all virtual pages mapped to the "
-                             "physical page to have same diskpage location.");
+                PageTableEntry *super =
+                    find_superpage (m_process_ptable_map.at (mapped.pid), mapped.vpage);
+                EXPECT_TRUE (super != nullptr && super->frame == i,
+                             "Expected all superpages mapped to the physical page to start at it.");
+                continue;
             }
+
+            PageTableEntry *entry = find_entry (m_process_ptable_map.at (mapped.pid), mapped.vpage);
+            EXPECT_TRUE (entry != nullptr && !entry->disk && entry->frame == i,
+                         "Expected all virtual pages mapped to the physical page to be in memory "
+                         "at it.");
         }
     }
 
@@ -392,12 +752,6 @@ void VirtualMemory::check_vm ()
     {
         DEBUG ("Checking process {}.", pair.first);
         EXPECT_TRUE (pair.second->pid == pair.first, "Expected Process ID to match");
-        for (std::pair<word, PageTableEntry *> entry : pair.second->entries)
-        {
-            DEBUG ("Checking page entry at vpage {}.", entry.first);
-
-            EXPECT_TRUE (entry.second->vpage == entry.first, "Expected virtual memory to match");
-        }
     }
 }
 
@@ -411,61 +765,104 @@ void VirtualMemory::evict_ppage (word ppage, Exception &exception)
      */
     PhysicalPage &evicted_ppage = m_physical_memory_map[ppage];
     evicted_ppage.used = false;
-
-    for (PageTableEntry *removed_entry : evicted_ppage.mapped_vpages)
+    m_replacement->remove (ppage);
+    m_replacement->count_eviction (evicted_ppage.dirty);
+    evicted_ppage.dirty = false;
+    m_generation++;
+    touch_tables ();
+
+    // there MUST be a mapped vpage or else we should not be evicting this ppage.
+    const MappedVPage &first = evicted_ppage.mapped_vpages.at (0);
+    for (const MappedVPage &mapped : evicted_ppage.mapped_vpages)
     {
+        PageTableEntry *removed_entry =
+            find_entry (m_process_ptable_map.at (mapped.pid), mapped.vpage);
+        m_cow_entries -= removed_entry->cow;
+        removed_entry->cow = false;
         removed_entry->disk = true;
-        removed_entry->diskpage = m_disk->get_free_page ();
-        word tlb_addr = removed_entry->vpage & (kMaxTLBSize - 1);
-        TLB_Entry &tlb_entry = m_tlb[tlb_addr];
-        if (tlb_entry.valid && tlb_entry.ppage == ppage
-            && tlb_entry.vpage == removed_entry->vpage) // todo, this should check for pid i think.
-        {
-            tlb_entry.valid = false;
-        }
+        removed_entry->frame = m_disk->get_free_page ();
+        invalidate_tlb (mapped.pid, mapped.vpage, mapped.vpage);
     }
-    evicted_ppage.mapped_vpages.clear ();
 
     // exception to tell system bus to write to disk
     exception.disk_page_return =
-        evicted_ppage.mapped_vpages.at (0)->diskpage; // there MUST be a mapped vpage or else we
-                                                      // should not be evicting this ppage.
+        find_entry (m_process_ptable_map.at (first.pid), first.vpage)->frame;
     exception.ppage_return = ppage;
+    evicted_ppage.mapped_vpages.clear ();
     exception.type = Exception::Type::DISK_RETURN_AND_FETCH_SUCCESS;
 
     m_freelist.return_block (ppage, 1);
 }
 
-void VirtualMemory::map_vpage_to_ppage (long long pid, word vpage, word ppage, Exception &exception)
+word VirtualMemory::copy_on_write (long long pid, word vpage, PageTableEntry *entry,
+                                   Exception &exception)
 {
-    if (UNLIKELY (m_process_ptable_map.find (pid) == m_process_ptable_map.end ()))
+    entry->cow = false;
+    m_cow_entries--;
+    touch_tables ();
+
+    PhysicalPage &shared = m_physical_memory_map[entry->frame];
+    if (shared.mapped_vpages.size () == 1)
     {
-        throw InvalidPIDException (
-            "Cannot map virtual page to physical page because pid is invalid.", pid);
+        return entry->frame;
     }
 
-    PageTable *ptable = m_process_ptable_map.at (pid);
+    /* the shared page is about to be read, keep it from being evicted for its own copy */
+    m_replacement->access (entry->frame);
+    if (UNLIKELY (!m_freelist.can_fit (1)))
+    {
+        evict_ppage (select_victim (), exception);
+    }
+
+    exception.type = exception.type == Exception::Type::DISK_RETURN_AND_FETCH_SUCCESS
+                         ? Exception::Type::DISK_RETURN_AND_COPY
+                         : Exception::Type::COPY_ON_WRITE;
+    exception.ppage_copy = entry->frame;
+
+    invalidate_tlb (pid, vpage, vpage);
+
+    std::erase (shared.mapped_vpages, MappedVPage{pid, vpage});
+    entry->frame = m_freelist.get_free_block (1);
+    exception.ppage_fetch = entry->frame;
+    m_generation++;
 
-    PageTableEntry *entry = ptable->entries.at (vpage);
-    exception.disk_fetch = m_disk->read_page (entry->diskpage);
+    PhysicalPage &copy = m_physical_memory_map[entry->frame];
+    copy.mapped_vpages.push_back (MappedVPage{pid, vpage});
+    copy.used = true;
+    m_replacement->insert (entry->frame, replacement_key (copy));
+
+    DEBUG ("Copying physical page {} to {} on write to virtual page {} of process {}.",
+           exception.ppage_copy, word (entry->frame), vpage, pid);
+    return entry->frame;
+}
+
+void VirtualMemory::map_vpage_to_ppage (PageTable *ptable, word vpage, word ppage,
+                                        Exception &exception)
+{
+    PageTableEntry *entry = find_entry (ptable, vpage);
+    exception.disk_page_fetch = entry->frame;
 
-    DEBUG ("Disk Fetch from page {} to physical page {}.", entry->diskpage, ppage);
+    DEBUG ("Disk Fetch from page {} to physical page {}.", word (entry->frame), ppage);
 
-    m_disk->return_page (entry->diskpage);
+    m_disk->return_page (entry->frame);
 
     if (exception.type != Exception::Type::DISK_RETURN_AND_FETCH_SUCCESS)
     {
         exception.type = Exception::Type::DISK_FETCH_SUCCESS;
     }
     exception.ppage_fetch = ppage;
-    entry->ppage = ppage;
+    entry->frame = ppage;
     entry->disk = false;
+    m_generation++;
+    touch_tables ();
 
     PhysicalPage &mapped_ppage = m_physical_memory_map[ppage];
-    mapped_ppage.mapped_vpages.push_back (entry);
+    mapped_ppage.mapped_vpages.push_back (MappedVPage{ptable->pid, vpage});
     mapped_ppage.used = true;
+    mapped_ppage.dirty = false;
 
-    add_lru (ppage);
+    m_replacement->insert (ppage, replacement_key (mapped_ppage));
+    m_replacement->count_fault ();
 }
 
 void VirtualMemory::ensure_physical_page_mapping (long long pid, word vpage, word ppage,
@@ -487,12 +884,14 @@ void VirtualMemory::ensure_physical_page_mapping (long long pid, word vpage, wor
      * It is likely that the virtual page has already been mapped since this is a temporary
      * way to allow the emulator to load a program at a specific physical address.
      */
-    if (LIKELY (ptable->entries.find (vpage) != ptable->entries.end ()))
+    if (const PageTableEntry *entry = find_entry (ptable, vpage); LIKELY (entry != nullptr))
     {
+        const word mapped_ppage = entry->mapped ? ptable->mapped_ppages.at (vpage) : entry->frame;
+
         /*
          * It is likely that the virtual page maps to the same physical page.
          */
-        if (LIKELY (ptable->entries.at (vpage)->ppage == ppage))
+        if (LIKELY (mapped_ppage == ppage && (entry->mapped || !entry->disk)))
         {
             return;
         }
@@ -500,9 +899,24 @@ void VirtualMemory::ensure_physical_page_mapping (long long pid, word vpage, wor
         throw VPageRemapException ("Virtual page " + std::to_string (vpage)
                                        + " is already "
                                          "mapped to a different physical page "
-                                       + std::to_string (ptable->entries.at (vpage)->ppage)
-                                       + " of process " + std::to_string (pid),
-                                   vpage, ptable->entries.at (vpage)->ppage, ppage);
+                                       + std::to_string (mapped_ppage) + " of process "
+                                       + std::to_string (pid),
+                                   vpage, mapped_ppage, ppage);
+    }
+
+    if (const PageTableEntry *super = find_superpage (ptable, vpage); UNLIKELY (super != nullptr))
+    {
+        const word mapped_ppage = super->frame + (vpage & (kSuperpagePages - 1));
+        if (mapped_ppage == ppage)
+        {
+            return;
+        }
+
+        throw VPageRemapException ("Virtual page " + std::to_string (vpage)
+                                       + " is in a superpage mapped to a different physical page "
+                                       + std::to_string (mapped_ppage) + " of process "
+                                       + std::to_string (pid),
+                                   vpage, mapped_ppage, ppage);
     }
 
     DEBUG ("Mapping physical page {} to virtual page {}.", ppage, vpage);
@@ -510,126 +924,203 @@ void VirtualMemory::ensure_physical_page_mapping (long long pid, word vpage, wor
     map_ppage (pid, vpage, ppage, exception);
 }
 
-void VirtualMemory::check_lru ()
+word VirtualMemory::select_victim ()
 {
-    DEBUG ("Checking LRU");
+    const auto unshared = [this] (word ppage)
+    { return m_physical_memory_map[ppage].mapped_vpages.size () <= 1; };
 
-    if (m_lru_head == nullptr || m_lru_tail == nullptr)
+    word ppage;
+    if (!m_replacement->select_victim (unshared, ppage))
     {
-        EXPECT_TRUE (m_lru_head == m_lru_tail, "Expected list to be empty");
-        EXPECT_TRUE (m_lru_map.size () == 0, "Expected lru map to be empty since list is empty");
-        return;
+        throw VirtualMemoryException ("Cannot evict a physical page since all are shared.");
     }
+    return ppage;
+}
 
-    LRU_Node *cur = m_lru_head;
-    std::unordered_set<word> mapped_ppages;
-    while (cur->next != nullptr)
+void VirtualMemory::set_replacement_policy (ReplacementPolicy *policy)
+{
+    for (word ppage : m_replacement->pages ())
     {
-        EXPECT_TRUE (cur == cur->next->prev, "Expected the next node's previous to point back");
-        EXPECT_TRUE (m_lru_map.at (cur->ppage) == cur, "Expected lru map to match list");
-        mapped_ppages.insert (cur->ppage);
-        cur = cur->next;
+        policy->insert (ppage, replacement_key (m_physical_memory_map[ppage]));
     }
-    mapped_ppages.insert (cur->ppage);
-
-    EXPECT_TRUE (cur == m_lru_tail, "Expected list to end at tail");
+    delete m_replacement;
+    m_replacement = policy;
+}
 
-    for (std::pair<word, LRU_Node *> pair : m_lru_map)
+std::vector<word> VirtualMemory::mapped_ppages ()
+{
+    std::unordered_set<word> ppages;
+    for (const std::pair<const long long, PageTable *> &pair : m_process_ptable_map)
     {
-        EXPECT_TRUE_SS (mapped_ppages.find (pair.first) != mapped_ppages.end (),
-                        std::stringstream ()
-                            << "Expected LRU map to correspond to the LRU list. "
-                            << std::to_string (pair.first) << " is not in the lru list");
+        for_each_entry (pair.second,
+                        [&] (word, const PageTableEntry &entry)
+                        {
+                            if (!entry.disk)
+                            {
+                                ppages.insert (entry.frame);
+                            }
+                        });
+
+        /* the first page of a superpage keeps its mappings, the others only its flags */
+        for_each_superpage (pair.second, [&] (word, const PageTableEntry &entry)
+                            { ppages.insert (entry.frame); });
     }
+
+    std::vector<word> sorted (ppages.begin (), ppages.end ());
+    std::sort (sorted.begin (), sorted.end ());
+    return sorted;
 }
 
-/* Move an lru list node respective to a physical page address back to the tail */
-void VirtualMemory::add_lru (word ppage)
+VirtualMemory::State VirtualMemory::save_state ()
 {
-    // check_lru();
+    State state;
+    state.version = m_version;
+    state.enabled = enabled;
+    state.current_pid = current_process ();
 
-    /* this node exists in the lru list, so access it */
-    if (m_lru_map.find (ppage) != m_lru_map.end ())
+    for (const std::pair<const long long, PageTable *> &pair : m_process_ptable_map)
     {
-        LRU_Node *node = m_lru_map.at (ppage);
+        State::Table &table = state.tables.emplace_back (State::Table{
+            pair.first, pair.second->kernel_privilege, {}, pair.second->mapped_ppages, {}});
+        for_each_entry (pair.second, [&] (word vpage, const PageTableEntry &entry)
+                        { table.entries.emplace_back (vpage, entry); });
+        for_each_superpage (pair.second, [&] (word vpage, const PageTableEntry &entry)
+                            { table.superpages.emplace_back (vpage, entry); });
+    }
 
-        if (node == m_lru_tail)
+    std::vector<word> disk_pages;
+    for (const State::Table &table : state.tables)
+    {
+        for (const std::pair<word, PageTableEntry> &entry : table.entries)
         {
-            return;
+            if (entry.second.disk)
+            {
+                disk_pages.push_back (entry.second.frame);
+            }
         }
+    }
+    std::sort (disk_pages.begin (), disk_pages.end ());
+    disk_pages.erase (std::unique (disk_pages.begin (), disk_pages.end ()), disk_pages.end ());
+    for (word page : disk_pages)
+    {
+        state.disk_pages.emplace_back (page, m_disk->read_page (page));
+    }
+    state.free_disk_pages = m_disk->get_free_pages ();
+
+    for (word ppage : mapped_ppages ())
+    {
+        const PhysicalPage &page = m_physical_memory_map[ppage];
+        state.mapped_pages.push_back (
+            State::MappedPage{ppage, page.used, page.dirty, page.mapped_vpages});
+    }
+    state.replacement = m_replacement->save ();
+
+    state.free_pids = m_freepids.get_blocks ();
+    state.free_ppages = m_freelist.get_blocks ();
+    state.permissions = m_permissions;
+    return state;
+}
 
-        /* Update new list head */
-        if (node == m_lru_head)
+void VirtualMemory::restore_state (const State &state)
+{
+    enabled = state.enabled;
+    if (state.version == m_version)
+    {
+        if (current_process () != state.current_pid)
         {
-            m_lru_head = m_lru_head->next;
+            switch_table (state.current_pid == -1 ? nullptr
+                                                  : m_process_ptable_map.at (state.current_pid));
         }
-        else
+        return;
+    }
+
+    /* clear the bookkeeping of every page the current tables touch */
+    for (word ppage : mapped_ppages ())
+    {
+        m_physical_memory_map[ppage].mapped_vpages.clear ();
+        m_physical_memory_map[ppage].used = false;
+        m_physical_memory_map[ppage].dirty = false;
+    }
+    for (std::pair<const long long, PageTable *> &pair : m_process_ptable_map)
+    {
+        for_each_superpage (pair.second, [&] (word, const PageTableEntry &entry)
+                            { mark_superpage (entry.frame, false); });
+    }
+    for (const PermissionRange &range : m_permissions)
+    {
+        for (word ppage = range.ppage_begin; ppage <= range.ppage_end; ppage++)
         {
-            node->prev->next = node->next;
+            m_physical_memory_map[ppage].swappable = true;
+            m_physical_memory_map[ppage].kernel_locked = false;
         }
-        /* make the next node point back to the correct node */
-        node->next->prev = node->prev;
-
-        /* add node at the tail */
-        m_lru_tail->next = node;
-        node->prev = m_lru_tail;
-        node->next = nullptr;
-        m_lru_tail = node;
+    }
+    m_permissions.clear ();
 
-        // check_lru();
-        return;
+    for (std::pair<const long long, PageTable *> &pair : m_process_ptable_map)
+    {
+        release_tables (pair.second);
+        delete pair.second;
     }
+    m_process_ptable_map.clear ();
 
-    /* Empty list, just add it */
-    if (m_lru_head == nullptr)
+    /* rebuild from the copy */
+    for (const State::Table &table : state.tables)
     {
-        m_lru_head = new LRU_Node{
-            .ppage = ppage,
-            .next = nullptr,
-            .prev = nullptr,
+        PageTable *ptable = new PageTable{
+            .pid = table.pid,
+            .kernel_privilege = table.kernel_privilege,
+            .mapped_ppages = table.mapped_ppages,
         };
-        m_lru_tail = m_lru_head;
-        m_lru_map.insert (std::make_pair (ppage, m_lru_head));
-
-        // check_lru();
-        return;
+        for (const std::pair<word, PageTableEntry> &entry : table.entries)
+        {
+            *insert_entry (ptable, entry.first) = entry.second;
+        }
+        for (const std::pair<word, PageTableEntry> &entry : table.superpages)
+        {
+            ptable->superpages[entry.first >> kNumPageTableBits] = entry.second;
+            mark_superpage (entry.second.frame, true);
+        }
+        m_process_ptable_map.insert (std::make_pair (table.pid, ptable));
     }
 
-    /* Add node at the end since it does not already exist in the list */
-    LRU_Node *new_node = new LRU_Node{
-        .ppage = ppage,
-        .next = nullptr,
-        .prev = m_lru_tail,
-    };
-    m_lru_tail->next = new_node;
-    m_lru_tail = new_node;
-
-    /* Update the node map to maintain O(1) */
-    m_lru_map.insert (std::make_pair (ppage, m_lru_tail));
+    for (const State::MappedPage &mapped : state.mapped_pages)
+    {
+        PhysicalPage &page = m_physical_memory_map[mapped.ppage];
+        page.used = mapped.used;
+        page.dirty = mapped.dirty;
+        page.mapped_vpages = mapped.vpages;
+    }
+    m_replacement->restore (state.replacement);
 
-    // check_lru();
-}
+    for (const PermissionRange &range : state.permissions)
+    {
+        set_ppage_permissions (range.ppage_begin, range.ppage_end, range.swappable,
+                               range.kernel_locked);
+    }
 
-word VirtualMemory::remove_lru ()
-{
-    LRU_Node *removed_node = m_lru_head;
-    m_lru_head = m_lru_head->next;
+    m_freepids.restore_blocks (state.free_pids);
+    m_freelist.restore_blocks (state.free_ppages);
 
-    /* Checks if it was the last node meaning tail pointer has to be updated */
-    if (m_lru_head == nullptr)
+    m_disk->restore_free_pages (state.free_disk_pages);
+    for (const std::pair<word, std::vector<byte>> &page : state.disk_pages)
     {
-        m_lru_tail = nullptr;
+        m_disk->write_page (page.first, page.second.data ());
     }
-    else
+
+    flush_tlb ();
+
+    m_cow_entries = 0;
+    m_superpages = 0;
+    for (const State::Table &table : state.tables)
     {
-        /* remove dangling pointer */
-        m_lru_head->prev = nullptr;
+        for (const std::pair<word, PageTableEntry> &entry : table.entries)
+        {
+            m_cow_entries += entry.second.cow;
+        }
+        m_superpages += table.superpages.size ();
     }
 
-    word lru_ppage = removed_node->ppage;
-    m_lru_map.erase (lru_ppage);
-    delete removed_node;
-
-    // check_lru();
-    return lru_ppage;
-}
\ No newline at end of file
+    switch_table (state.current_pid == -1 ? nullptr : m_process_ptable_map.at (state.current_pid));
+    m_version = state.version;
+    m_generation++;
+}
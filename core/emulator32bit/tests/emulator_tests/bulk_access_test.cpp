@@ -0,0 +1,57 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <numeric>
+
+TEST (bulk_access, block_across_scattered_pages)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    constexpr word kAddr = (0x11 << kNumPageOffsetBits) - 6;
+
+    /* a page mapped in between so the two virtual pages are not physically adjacent */
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, 0x10, 1, true, false);
+    mmu->add_vpage (pid, 0x30, 1, true, false);
+    mmu->add_vpage (pid, 0x11, 1, true, false);
+
+    byte data[12];
+    std::iota (std::begin (data), std::end (data), 1);
+    cpu.system_bus->write_block (kAddr, data, sizeof (data));
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0x04030201);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 4), 0x08070605);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 8), 0x0C0B0A09);
+
+    byte read[12] = {};
+    cpu.system_bus->read_block (kAddr, read, sizeof (read));
+    EXPECT_TRUE (std::equal (std::begin (data), std::end (data), std::begin (read)));
+
+    cpu.system_bus->fill (kAddr + 2, 0xEE, 8);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xEEEE0201);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 8), 0x0C0BEEEE);
+
+    mmu->end_process (pid);
+}
+
+TEST_F (EmulatorFixture, bulk_access_write_block_to_code_page)
+{
+    // add x0, x0, #1; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+    cpu->run (0);
+
+    // add x0, x0, #4
+    const word add = Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 4);
+    cpu->system_bus->write_block (0, (const byte *) &add, sizeof (add));
+    cpu->set_pc (0);
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 5) << "a block write should invalidate decoded instructions";
+
+    cpu->system_bus->fill (0, 0, 4);
+    cpu->set_pc (0);
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (reason.instructions, 1) << "the filled add should have been decoded again";
+    EXPECT_EQ (cpu->read_reg (0), 5);
+}
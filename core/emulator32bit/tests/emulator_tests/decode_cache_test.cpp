@@ -0,0 +1,123 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST_F (EmulatorFixture, decode_cache_rewritten_instruction)
+{
+    // add x0, x0, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->set_pc (0);
+    cpu->run (1);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+
+    // sub x0, x0, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_sub, false, 0,
+                                                                 0, 1));
+    cpu->set_pc (0);
+    cpu->run (1);
+    EXPECT_EQ (cpu->read_reg (0), 0)
+        << "writing over a decoded instruction should cause it to be decoded again";
+}
+
+TEST_F (EmulatorFixture, decode_cache_self_modifying_code)
+{
+    // str x1, [x2]
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_str, false, 1, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    // add x0, x0, #1
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->set_pc (4);
+    cpu->run (1);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+
+    // The store replaces the already decoded instruction with add x0, x0, #5.
+    cpu->write_reg (1, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 5));
+    cpu->write_reg (2, 4);
+    cpu->set_pc (0);
+    cpu->run (2);
+    EXPECT_EQ (cpu->read_reg (0), 6)
+        << "an instruction stored by the program should be executed instead of the stale decode";
+}
+
+TEST_F (EmulatorFixture, decode_shift_amount)
+{
+    // add x0, x1, x2, lsl #17
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (
+                                        Emulator32bit::_op_add, false, 0, 1, 2,
+                                        Emulator32bit::ShiftType::SHIFT_LSL, 17));
+    cpu->write_reg (1, 1);
+    cpu->write_reg (2, 1);
+    cpu->set_pc (0);
+    cpu->run (1);
+    EXPECT_EQ (cpu->read_reg (0), (1U << 17) + 1)
+        << "all 5 bits of the shift amount should be decoded";
+}
+
+TEST_F (EmulatorFixture, block_loop)
+{
+    // mov x0, #0
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false,
+                                                                  0, 0));
+    // add x0, x0, #1
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    // cmp x0, #10
+    cpu->system_bus->write_word (8, Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0,
+                                                                 0, 10));
+    // b.ne #-8
+    cpu->system_bus->write_word (12, Emulator32bit::asm_format_b1 (
+                                         Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE,
+                                         -2));
+    cpu->system_bus->write_word (16, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+
+    cpu->run (0);
+
+    EXPECT_EQ (cpu->read_reg (0), 10);
+    EXPECT_EQ (cpu->get_pc (), 16) << "execution should halt at the hlt instruction";
+}
+
+TEST_F (EmulatorFixture, block_budget_and_fault_pc)
+{
+    // add x0, x0, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    // ldr x1, [x2]
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_ldr, false, 1, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (2, 0x100000);
+    cpu->set_pc (0);
+
+    cpu->run (1);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+    EXPECT_EQ (cpu->get_pc (), 4) << "the block should stop when the instruction budget runs out";
+
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+    EXPECT_EQ (cpu->get_pc (), 4) << "the pc should point at the instruction that faulted";
+}
+
+TEST_F (EmulatorFixture, decode_xzr_destination)
+{
+    // add xzr, x1, #5
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 31,
+                                                                 1, 5));
+    // add x0, xzr, #1
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 31, 1));
+    // str xzr, [x2]
+    cpu->system_bus->write_word (8, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_str, false, 31, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (0x100, 0xFFFFFFFF);
+    cpu->write_reg (2, 0x100);
+    cpu->set_pc (0);
+    cpu->run (3);
+
+    EXPECT_EQ (cpu->read_reg (31), 0) << "writes to xzr should be discarded";
+    EXPECT_EQ (cpu->read_reg (0), 1) << "xzr should read as zero after being written to";
+    EXPECT_EQ (cpu->system_bus->read_word (0x100), 0) << "storing xzr should store zero";
+}
@@ -0,0 +1,136 @@
+#include <emulator32bit/timer.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <cstring>
+#include <map>
+
+/**
+ * @brief                   Disk kept in host memory so transfers can be checked.
+ *
+ */
+class HostDisk : public MockDisk
+{
+  public:
+    std::map<word, std::vector<byte>> pages;
+
+    void read_page (word page, byte *data) override
+    {
+        pages.try_emplace (page, kPageSize, 0);
+        std::memcpy (data, pages.at (page).data (), kPageSize);
+    }
+
+    void write_page (word page, const byte *data) override
+    {
+        pages[page].assign (data, data + kPageSize);
+    }
+};
+
+class DMAFixture : public ::testing::Test
+{
+  protected:
+    HostDisk *disk = new HostDisk ();
+    Emulator32bit *cpu = new Emulator32bit (new RAM (4, 0), new ROM (0, 4), disk);
+
+    ~DMAFixture () override
+    {
+        delete cpu;
+    }
+};
+
+TEST_F (DMAFixture, dma_round_trip)
+{
+    constexpr word kPage = 2 << kNumPageOffsetBits;
+    for (word i = 0; i < 2 * kPageSize; i += 4)
+    {
+        cpu->system_bus->write_word (kPage + i, i * 7);
+    }
+
+    int completions = 0;
+    cpu->system_bus->dma->set_completion_handler ([&completions] (
+                                                      const DMAController::Descriptor &)
+                                                  { completions++; });
+    cpu->system_bus->dma->submit ({DMAController::Direction::MEMORY_TO_DISK, kPage, 10, 2});
+    EXPECT_EQ (completions, 0) << "a submitted descriptor should wait for run";
+    cpu->system_bus->dma->run ();
+    EXPECT_EQ (completions, 1);
+    EXPECT_EQ (cpu->system_bus->dma->pending (), 0);
+    EXPECT_EQ (disk->pages.at (11)[4], 7 * (kPageSize + 4) & 0xFF);
+
+    for (word i = 0; i < 2 * kPageSize; i += 4)
+    {
+        cpu->system_bus->write_word (kPage + i, 0);
+    }
+    cpu->system_bus->dma->transfer ({DMAController::Direction::DISK_TO_MEMORY, kPage, 10, 2});
+    for (word i = 0; i < 2 * kPageSize; i += 4)
+    {
+        ASSERT_EQ (cpu->system_bus->read_word (kPage + i), i * 7) << "at " << i;
+    }
+    EXPECT_EQ (cpu->timer->time (), 4 * Timer::kDiskPageCycles);
+}
+
+TEST_F (DMAFixture, dma_invalidates_decoded_instructions)
+{
+    // add x0, x0, #1; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+    cpu->run (0);
+
+    // disk page 3 holds add x0, x0, #5; hlt
+    std::vector<byte> code (kPageSize, 0);
+    const word add = Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 5);
+    const word hlt = Emulator32bit::asm_hlt ();
+    std::memcpy (code.data (), &add, 4);
+    std::memcpy (code.data () + 4, &hlt, 4);
+    disk->pages[3] = code;
+
+    cpu->system_bus->dma->transfer ({DMAController::Direction::DISK_TO_MEMORY, 0, 3, 1});
+    cpu->set_pc (0);
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 6);
+}
+
+TEST_F (DMAFixture, dma_device)
+{
+    constexpr word kRegs = 8 << kNumPageOffsetBits;
+    cpu->system_bus->map_device (new DMADevice (8, cpu->system_bus->dma));
+    cpu->system_bus->write_word (kPageSize, 0x12345678);
+
+    cpu->system_bus->write_word (kRegs + DMADevice::kAddressRegister, kPageSize);
+    cpu->system_bus->write_word (kRegs + DMADevice::kDiskPageRegister, 5);
+    cpu->system_bus->write_word (kRegs + DMADevice::kPageCountRegister, 1);
+    cpu->system_bus->write_word (kRegs + DMADevice::kControlRegister, DMADevice::kControlToDisk);
+
+    EXPECT_EQ (cpu->system_bus->read_word (kRegs + DMADevice::kStatusRegister), 1);
+    EXPECT_EQ (disk->pages.at (5)[0], 0x78);
+
+    cpu->system_bus->write_word (kRegs + DMADevice::kStatusRegister, 0);
+    EXPECT_EQ (cpu->system_bus->read_word (kRegs + DMADevice::kStatusRegister), 0);
+}
+
+TEST_F (DMAFixture, dma_rejects_unaligned_address)
+{
+    constexpr word kRegs = 8 << kNumPageOffsetBits;
+    cpu->system_bus->map_device (new DMADevice (8, cpu->system_bus->dma));
+    disk->pages[5].assign (kPageSize, 0xAB);
+
+    cpu->system_bus->write_word (kRegs + DMADevice::kAddressRegister, kPageSize + 4);
+    cpu->system_bus->write_word (kRegs + DMADevice::kDiskPageRegister, 5);
+    cpu->system_bus->write_word (kRegs + DMADevice::kPageCountRegister, 1);
+    cpu->system_bus->write_word (kRegs + DMADevice::kControlRegister, 0);
+
+    EXPECT_EQ (cpu->system_bus->read_word (kRegs + DMADevice::kStatusRegister),
+               DMADevice::kStatusError);
+    EXPECT_EQ (cpu->system_bus->read_word (kPageSize + 4), 0) << "nothing should be transferred";
+    EXPECT_EQ (cpu->system_bus->dma->completed (), 0);
+
+    cpu->system_bus->write_word (kRegs + DMADevice::kStatusRegister, 0);
+    EXPECT_EQ (cpu->system_bus->read_word (kRegs + DMADevice::kStatusRegister), 0);
+
+    const DMAController::Descriptor descriptor = {DMAController::Direction::DISK_TO_MEMORY,
+                                                  kPageSize + 4, 5, 1};
+    EXPECT_THROW (cpu->system_bus->dma->transfer (descriptor), SystemBus::Exception);
+    EXPECT_THROW (cpu->system_bus->dma->submit (descriptor), SystemBus::Exception);
+    EXPECT_EQ (cpu->system_bus->dma->pending (), 0);
+}
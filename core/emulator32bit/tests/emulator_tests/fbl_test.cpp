@@ -90,4 +90,19 @@ TEST (fbl, out_of_order)
     fbl.return_block (b3, 1);
     ASSERT_EQ (fbl.size (), 4);
     ASSERT_EQ (fbl.get_blocks ().size (), 1);
-}
\ No newline at end of file
+}
+
+TEST (fbl, restore_blocks)
+{
+    FreeBlockList fbl (4, 16);
+    const std::vector<std::pair<word, word>> blocks = {{6, 2}, {12, 8}};
+    fbl.restore_blocks (blocks);
+    ASSERT_EQ (fbl.get_blocks (), blocks);
+    ASSERT_EQ (fbl.size (), 10);
+
+    fbl.get_free_block (2);
+    fbl.restore_blocks ({});
+    ASSERT_TRUE (fbl.empty ());
+    fbl.restore_blocks ({{4, 16}});
+    ASSERT_EQ (fbl.size (), 16);
+}
@@ -0,0 +1,87 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+/**
+ * @brief                   Condition code evaluated from materialized flags, as written in the
+ *                          @ref Emulator32bit::ConditionCode documentation.
+ *
+ */
+static bool expected_cond (Emulator32bit &cpu, U8 cond)
+{
+    const bool N = cpu.get_flag (Emulator32bit::kNFlagBit);
+    const bool Z = cpu.get_flag (Emulator32bit::kZFlagBit);
+    const bool C = cpu.get_flag (Emulator32bit::kCFlagBit);
+    const bool V = cpu.get_flag (Emulator32bit::kVFlagBit);
+    const bool conds[] = {
+        Z,       !Z,      C,      !C,     N,            !N,          V,    !V,
+        C && !Z, !C || Z, N == V, N != V, !Z && N == V, Z || N != V, true, false,
+    };
+    return conds[cond];
+}
+
+TEST_F (EmulatorFixture, lazy_flags_compare_and_branch)
+{
+    const word operands[] = {0, 1, 2, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF};
+    for (U8 cond = 0; cond < 16; cond++)
+    {
+        // cmp x0, x1; b.cond #2; hlt; hlt
+        cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (
+                                            Emulator32bit::_op_cmp, true, 0, 0, 1,
+                                            Emulator32bit::ShiftType::SHIFT_LSL, 0));
+        cpu->system_bus->write_word (4, Emulator32bit::asm_format_b1 (
+                                            Emulator32bit::_op_b,
+                                            Emulator32bit::ConditionCode (cond), 2));
+        cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+        cpu->system_bus->write_word (12, Emulator32bit::asm_hlt ());
+
+        for (word op1 : operands)
+        {
+            for (word op2 : operands)
+            {
+                cpu->write_reg (0, op1);
+                cpu->write_reg (1, op2);
+                cpu->set_pc (0);
+                cpu->run (2);
+
+                const word expected_pc = expected_cond (*cpu, cond) ? 12 : 8;
+                EXPECT_EQ (cpu->get_pc (), expected_pc)
+                    << "cond " << int (cond) << " with " << op1 << ", " << op2;
+            }
+        }
+    }
+}
+
+TEST_F (EmulatorFixture, lazy_flags_logic_keeps_carry)
+{
+    // cmp x0, #2; ands x1, x0, #0
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0,
+                                                                 0, 2));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o (Emulator32bit::_op_and, true, 1,
+                                                                 0, 0));
+    cpu->write_reg (0, 1);
+    cpu->set_pc (0);
+    cpu->run (2);
+
+    EXPECT_TRUE (cpu->get_flag (Emulator32bit::kZFlagBit));
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kNFlagBit));
+    EXPECT_TRUE (cpu->get_flag (Emulator32bit::kCFlagBit))
+        << "the borrow of the compare should survive the logical instruction";
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kVFlagBit));
+}
+
+TEST_F (EmulatorFixture, mrs_msr_pstate)
+{
+    // cmp x0, #1; mrs x1, pstate; msr pstate, #0b1000
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_mrs (1, Emulator32bit::kSysregId_pstate));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_msr (Emulator32bit::kSysregId_pstate, true,
+                                                            0b1000));
+    cpu->write_reg (0, 0);
+    cpu->set_pc (0);
+    cpu->run (3);
+
+    EXPECT_EQ (cpu->read_reg (1),
+               word (1 << Emulator32bit::kNFlagBit | 1 << Emulator32bit::kCFlagBit))
+        << "mrs should read the flags of the compare";
+    EXPECT_EQ (cpu->get_pstate (), 0b1000);
+}
@@ -0,0 +1,113 @@
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+static constexpr word kVPage = 0x10;
+static constexpr word kAddr = kVPage << kNumPageOffsetBits;
+
+TEST (fork, copies_pages_on_write)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+
+    const long long b = mmu->fork_process (a);
+    EXPECT_EQ (mmu->current_process (), a);
+    VirtualMemory::Exception exception;
+    EXPECT_EQ (mmu->translate_address (a, kAddr, exception),
+               mmu->translate_address (b, kAddr, exception));
+
+    // the page is in the write TLB from before the fork
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+    EXPECT_NE (mmu->translate_address (a, kAddr, exception),
+               mmu->translate_address (b, kAddr, exception));
+
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+    cpu.system_bus->write_word (kAddr, 0xCCCC);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xCCCC);
+
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+}
+
+TEST (fork, shared_pages_outlive_a_process)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+    const long long b = mmu->fork_process (a);
+
+    mmu->end_process (a);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+
+    // the remaining process owns the page and writes it in place
+    VirtualMemory::Exception exception;
+    const word paddr = mmu->translate_address (b, kAddr, exception);
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+    EXPECT_EQ (mmu->translate_address (b, kAddr, exception), paddr);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+
+    // its freed page is handed out again
+    const long long c = mmu->begin_process ();
+    mmu->add_vpage (c, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xCCCC);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+}
+
+TEST (fork, keeps_shared_pages_in_memory)
+{
+    Emulator32bit cpu (3, 0, {}, 0, 3);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, 3, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+    const long long b = mmu->fork_process (a);
+    cpu.system_bus->write_word (kAddr + kPageSize, 1);
+    mmu->set_process (b);
+    cpu.system_bus->read_word (kAddr + kPageSize);
+
+    // every page of RAM is in use and the shared one is the least recently used
+    mmu->set_process (a);
+    cpu.system_bus->write_word (kAddr + 2 * kPageSize, 2);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 2 * kPageSize), 2);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+}
+
+TEST (fork, reused_pid_drops_old_translations)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+    const long long b = mmu->fork_process (a);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+    mmu->end_process (b);
+
+    const long long c = mmu->begin_process ();
+    EXPECT_EQ (c, b);
+    mmu->add_vpage (c, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xCCCC);
+
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+}
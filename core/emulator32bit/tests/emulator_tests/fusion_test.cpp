@@ -0,0 +1,96 @@
+#include <emulator32bit/timer.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST_F (EmulatorFixture, fuse_common_pairs)
+{
+    const word pairs[][2] = {
+        {Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0, 0, 1),
+         Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -1)},
+        {Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 0, 0, 1),
+         Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0, 0, 1)},
+        {Emulator32bit::asm_format_m1 (Emulator32bit::_op_adrp, 0, 1),
+         Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 16)},
+        {Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 0, 5),
+         Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, 7)},
+    };
+
+    for (const auto &pair : pairs)
+    {
+        Emulator32bit::DecodedInstr instrs[2];
+        cpu->decode (pair[0], instrs[0]);
+        cpu->decode (pair[1], instrs[1]);
+        cpu->fuse (instrs[0], instrs[1]);
+        EXPECT_NE (instrs[0].fused, nullptr) << std::hex << pair[0] << " " << pair[1];
+    }
+
+    Emulator32bit::DecodedInstr instrs[2];
+    cpu->decode (Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 1), instrs[0]);
+    cpu->decode (Emulator32bit::asm_hlt (), instrs[1]);
+    cpu->fuse (instrs[0], instrs[1]);
+    EXPECT_EQ (instrs[0].fused, nullptr);
+}
+
+TEST_F (EmulatorFixture, fused_pair_split_by_budget)
+{
+    // cmp x0, #1; b.eq #2; hlt; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_b1 (
+                                        Emulator32bit::_op_b, Emulator32bit::ConditionCode::EQ,
+                                        2));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->system_bus->write_word (12, Emulator32bit::asm_hlt ());
+    cpu->write_reg (0, 1);
+    cpu->set_pc (0);
+
+    cpu->run (1);
+    EXPECT_EQ (cpu->get_pc (), 4) << "only the compare of the fused pair fits in the budget";
+    EXPECT_TRUE (cpu->get_flag (Emulator32bit::kZFlagBit));
+
+    cpu->run (1);
+    EXPECT_EQ (cpu->get_pc (), 12);
+
+    cpu->set_pc (0);
+    cpu->run (2);
+    EXPECT_EQ (cpu->get_pc (), 12) << "the fused pair should branch like the separate instructions";
+}
+
+TEST_F (EmulatorFixture, fused_sub_cmp_flags)
+{
+    // subs x0, x0, #1; cmp x0, #0x7FFFFFFF
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o (
+                                        Emulator32bit::_op_cmp, true, 0, 0, 1,
+                                        Emulator32bit::ShiftType::SHIFT_LSL, 0));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (0, 0x80000000);
+    cpu->write_reg (1, 0x7FFFFFFF);
+    cpu->set_pc (0);
+
+    cpu->run (2);
+    EXPECT_EQ (cpu->read_reg (0), 0x7FFFFFFF);
+    EXPECT_EQ (cpu->get_pc (), 8);
+    EXPECT_TRUE (cpu->get_flag (Emulator32bit::kZFlagBit));
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kNFlagBit));
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kCFlagBit));
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kVFlagBit));
+}
+
+TEST_F (EmulatorFixture, fault_after_fused_pair_counts_it)
+{
+    // mov x0, #5; mov x1, #7 followed by an unassigned opcode in the same block
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 0,
+                                                                  5));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1,
+                                                                  7));
+    cpu->system_bus->write_word (8, 0b111111U << 26);
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::FAULT);
+    EXPECT_EQ (cpu->get_pc (), 8);
+    EXPECT_EQ (reason.instructions, 2) << "the fused pair ran before the fault";
+    EXPECT_EQ (cpu->timer->time (), 2 * Timer::kBaseCycles)
+        << "the instructions before the fault should be charged";
+}
@@ -0,0 +1,173 @@
+#include <emulator32bit/jit.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <fstream>
+#include <random>
+#include <string>
+
+/**
+ * @brief                   Random data processing instruction on registers x0 to x7. A few of them
+ *                          (adc, muls) are not compiled, so some blocks are only partially
+ *                          compiled.
+ *
+ */
+static word random_alu_instr (std::mt19937 &rng)
+{
+    static constexpr U8 kFormatO[] = {
+        Emulator32bit::_op_add, Emulator32bit::_op_sub, Emulator32bit::_op_rsb,
+        Emulator32bit::_op_and, Emulator32bit::_op_orr, Emulator32bit::_op_eor,
+        Emulator32bit::_op_bic, Emulator32bit::_op_cmp, Emulator32bit::_op_cmn,
+        Emulator32bit::_op_tst, Emulator32bit::_op_teq, Emulator32bit::_op_mul,
+    };
+    static constexpr U8 kShifts[] = {
+        Emulator32bit::_op_lsl,
+        Emulator32bit::_op_lsr,
+        Emulator32bit::_op_asr,
+        Emulator32bit::_op_ror,
+    };
+
+    auto reg = [&rng] () { return int (rng () % 8); };
+    const bool s = rng () % 2;
+    if (rng () % 64 == 0)
+    {
+        return Emulator32bit::asm_format_o (rng () % 2 ? Emulator32bit::_op_adc
+                                                       : Emulator32bit::_op_mul,
+                                            true, reg (), reg (), rng () % (1 << 14));
+    }
+
+    switch (rng () % 4)
+    {
+    case 0:
+    {
+        const U8 opcode = kShifts[rng () % 4];
+        return Emulator32bit::asm_format_o1 (opcode, reg (), reg (), true, 0, 1 + rng () % 31);
+    }
+    case 1:
+        return Emulator32bit::asm_format_o3 (rng () % 2 ? Emulator32bit::_op_mov
+                                                        : Emulator32bit::_op_mvn,
+                                             s, reg (), reg (), rng () % (1 << 14));
+    case 2:
+    {
+        const U8 opcode = kFormatO[rng () % std::size (kFormatO)];
+        return Emulator32bit::asm_format_o (opcode, s && opcode != Emulator32bit::_op_mul, reg (),
+                                            reg (), rng () % (1 << 14));
+    }
+    default:
+    {
+        const auto shift = Emulator32bit::ShiftType (rng () % 4);
+        const int amount = shift == Emulator32bit::ShiftType::SHIFT_ROR ? 1 + rng () % 31
+                                                                        : rng () % 32;
+        const U8 opcode = kFormatO[rng () % std::size (kFormatO)];
+        return Emulator32bit::asm_format_o (opcode, s && opcode != Emulator32bit::_op_mul, reg (),
+                                            reg (), reg (), shift, amount);
+    }
+    }
+}
+
+TEST (jit, matches_interpreter)
+{
+    if (!JIT::supported ())
+    {
+        GTEST_SKIP () << "the host cannot run compiled code";
+    }
+
+    std::mt19937 rng (0x32b17);
+    for (int program = 0; program < 64; program++)
+    {
+        Emulator32bit interpreter (1, 0, {}, 0, 1, Emulator32bit::Backend::INTERPRETER);
+        Emulator32bit jit (1, 0, {}, 0, 1, Emulator32bit::Backend::JIT);
+
+        const word ninstrs = 1 + rng () % 32;
+        for (word i = 0; i < ninstrs; i++)
+        {
+            const word instr = random_alu_instr (rng);
+            interpreter.system_bus->write_word (i * 4, instr);
+            jit.system_bus->write_word (i * 4, instr);
+        }
+        interpreter.system_bus->write_word (ninstrs * 4, Emulator32bit::asm_nop ());
+        jit.system_bus->write_word (ninstrs * 4, Emulator32bit::asm_nop ());
+
+        for (U8 reg = 0; reg < 8; reg++)
+        {
+            const word val = rng ();
+            interpreter.write_reg (reg, val);
+            jit.write_reg (reg, val);
+        }
+
+        for (word run = 0; run < 2 * JIT::kHotThreshold; run++)
+        {
+            interpreter.set_pc (0);
+            interpreter.run (ninstrs + 1);
+            jit.set_pc (0);
+            jit.run (ninstrs + 1);
+
+            ASSERT_EQ (jit.get_pc (), interpreter.get_pc ());
+            for (U8 reg = 0; reg < 8; reg++)
+            {
+                ASSERT_EQ (jit.read_reg (reg), interpreter.read_reg (reg))
+                    << "x" << int (reg) << " differs in program " << program << " run " << run;
+            }
+            for (U8 flag = 0; flag < 4; flag++)
+            {
+                ASSERT_EQ (jit.get_flag (flag), interpreter.get_flag (flag))
+                    << "flag " << int (flag) << " differs in program " << program << " run "
+                    << run;
+            }
+        }
+    }
+}
+
+TEST (jit, code_is_never_writable_and_executable)
+{
+    if (!JIT::supported ())
+    {
+        GTEST_SKIP () << "the host cannot run compiled code";
+    }
+
+    Emulator32bit cpu (1, 0, {}, 0, 1, Emulator32bit::Backend::JIT);
+    cpu.set_jit_threshold (0);
+    // add x0, x0, x1
+    cpu.system_bus->write_word (0, Emulator32bit::asm_format_o (
+                                       Emulator32bit::_op_add, false, 0, 0, 1,
+                                       Emulator32bit::ShiftType::SHIFT_LSL, 0));
+    cpu.write_reg (1, 3);
+    cpu.run (1);
+    ASSERT_EQ (cpu.read_reg (0), 3);
+
+    std::ifstream maps ("/proc/self/maps");
+    std::string line;
+    while (std::getline (maps, line))
+    {
+        EXPECT_EQ (line.find (" rwx"), std::string::npos) << line;
+    }
+}
+
+TEST (jit, code_buffer_wraps_between_linked_blocks)
+{
+    if (!JIT::supported ())
+    {
+        GTEST_SKIP () << "the host cannot run compiled code";
+    }
+
+    // a: add x0, x0, #1; b b
+    // b: add x1, x1, #1; b a
+    const word program[] = {
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::AL, 1),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::AL, -3),
+    };
+
+    // only one of the two blocks fits, so compiling either drops the other and its link
+    Emulator32bit cpu (1, 0, {}, 0, 1, Emulator32bit::Backend::JIT);
+    cpu.set_jit_threshold (0);
+    cpu.set_jit_code_buffer_size (48);
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cpu.system_bus->write_word (i * 4, program[i]);
+    }
+
+    cpu.run (400);
+    EXPECT_EQ (cpu.read_reg (0), 100);
+    EXPECT_EQ (cpu.read_reg (1), 100);
+}
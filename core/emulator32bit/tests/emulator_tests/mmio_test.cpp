@@ -0,0 +1,71 @@
+#include <emulator32bit/timer.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+static constexpr word kConsolePage = 4;
+static constexpr word kConsoleAddr = kConsolePage << kNumPageOffsetBits;
+
+TEST_F (EmulatorFixture, mmio_console_store_bytes)
+{
+    std::string out;
+    cpu->system_bus->map_device (new ConsoleDevice (
+        kConsolePage, [&out] (const char *data, size_t n) { out.append (data, n); }));
+
+    // strb x1, [x2]; strb x3, [x2]; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_strb, false, 1, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_strb, false, 3, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (1, 'A');
+    cpu->write_reg (2, kConsoleAddr + ConsoleDevice::kDataRegister);
+    cpu->write_reg (3, '\n');
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED) << reason.fault;
+    EXPECT_EQ (out, "A\n");
+    EXPECT_EQ (cpu->system_bus->read_word (kConsoleAddr + ConsoleDevice::kStatusRegister),
+               ConsoleDevice::kStatusTxReady);
+}
+
+TEST_F (EmulatorFixture, mmio_console_block_write)
+{
+    std::string out;
+    cpu->system_bus->map_device (new ConsoleDevice (
+        kConsolePage, [&out] (const char *data, size_t n) { out.append (data, n); }));
+
+    const char msg[] = "hello";
+    cpu->system_bus->write_physical_block (kConsoleAddr, (const byte *) msg, 5);
+    EXPECT_EQ (out, "") << "the console should buffer until a newline";
+
+    cpu->system_bus->write_physical_block (kConsoleAddr, (const byte *) "\n", 1);
+    EXPECT_EQ (out, "hello\n");
+}
+
+TEST_F (EmulatorFixture, mmio_timer)
+{
+    constexpr word kTimerAddr = 5 << kNumPageOffsetBits;
+    cpu->system_bus->map_device (new TimerDevice (5, cpu->timer));
+
+    cpu->timer->advance (0x100000005);
+    EXPECT_EQ (cpu->system_bus->read_word (kTimerAddr + TimerDevice::kTimeLowRegister), 5);
+    EXPECT_EQ (cpu->system_bus->read_word (kTimerAddr + TimerDevice::kTimeHighRegister), 1);
+
+    cpu->system_bus->write_word (kTimerAddr + TimerDevice::kIntervalRegister, 10);
+    EXPECT_EQ (cpu->timer->deadline (), 0x100000005 + 10);
+    EXPECT_EQ (cpu->system_bus->read_word (kTimerAddr + TimerDevice::kStatusRegister), 0);
+
+    cpu->timer->advance (10);
+    EXPECT_EQ (cpu->system_bus->read_word (kTimerAddr + TimerDevice::kStatusRegister), 1);
+    cpu->system_bus->write_word (kTimerAddr + TimerDevice::kStatusRegister, 1);
+    EXPECT_EQ (cpu->system_bus->read_word (kTimerAddr + TimerDevice::kStatusRegister), 0);
+}
+
+TEST_F (EmulatorFixture, mmio_map_over_memory)
+{
+    ConsoleDevice console (0);
+    EXPECT_THROW (cpu->system_bus->map_device (&console), SystemBus::Exception)
+        << "a device should not replace ram";
+}
@@ -0,0 +1,307 @@
+#include <emulator32bit/kernel/better_virtual_memory.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <cstring>
+#include <map>
+
+/**
+ * @brief                   Disk kept in host memory that hands out a new page every time.
+ *
+ */
+class PagingDisk : public MockDisk
+{
+  public:
+    std::map<word, std::vector<byte>> pages;
+    word next_page = 0;
+
+    word get_free_page () override
+    {
+        return next_page++;
+    }
+
+    void return_page (word page) override
+    {
+        pages.erase (page);
+    }
+
+    void read_page (word page, byte *data) override
+    {
+        pages.try_emplace (page, kPageSize, 0);
+        std::memcpy (data, pages.at (page).data (), kPageSize);
+    }
+
+    void write_page (word page, const byte *data) override
+    {
+        pages[page].assign (data, data + kPageSize);
+    }
+};
+
+/* 16 pages of RAM leave pages 1 to 3 for the tables and 4 to 15 for virtual pages */
+static constexpr word kUserPages = 12;
+
+class MMUFixture : public ::testing::Test
+{
+  protected:
+    PagingDisk *disk = new PagingDisk ();
+    Emulator32bit *cpu = new Emulator32bit (new RAM (16, 0), new ROM (0, 16), disk,
+                                            Emulator32bit::Backend::INTERPRETER,
+                                            Emulator32bit::Paging::PAGE_TABLE_WALK);
+    MMU *mmu = cpu->system_bus->page_table_mmu;
+
+    ~MMUFixture () override
+    {
+        delete cpu;
+    }
+};
+
+TEST_F (MMUFixture, translates_and_checks_permissions)
+{
+    mmu->create_pagedir ();
+    mmu->add_vpage (0x100, false, true, false, false);
+    mmu->add_vpage (0x101, false, false, true, false);
+
+    cpu->system_bus->write_word (0x100 << kNumPageOffsetBits, 0xCAFE);
+    EXPECT_EQ (cpu->system_bus->read_word (0x100 << kNumPageOffsetBits), 0xCAFE);
+    EXPECT_EQ (cpu->system_bus->read_word (0x101 << kNumPageOffsetBits), 0)
+        << "added pages should be zeroed";
+
+    EXPECT_THROW (cpu->system_bus->write_word (0x101 << kNumPageOffsetBits, 1),
+                  Emulator32bit::Exception);
+    EXPECT_THROW (cpu->system_bus->translate_fetch_address (0x100 << kNumPageOffsetBits),
+                  Emulator32bit::Exception);
+    EXPECT_NO_THROW (cpu->system_bus->translate_fetch_address (0x101 << kNumPageOffsetBits));
+    EXPECT_THROW (cpu->system_bus->read_word (0x102 << kNumPageOffsetBits),
+                  Emulator32bit::Exception);
+    EXPECT_THROW (mmu->add_vpage (0x100, false, true, false, false), Emulator32bit::Exception);
+
+    mmu->remove_vpage (0x100);
+    EXPECT_THROW (cpu->system_bus->read_word (0x100 << kNumPageOffsetBits),
+                  Emulator32bit::Exception)
+        << "removing a page should drop its cached translation";
+}
+
+TEST_F (MMUFixture, kernel_pages_need_kernel_mode)
+{
+    mmu->create_pagedir ();
+    mmu->add_vpage (0x200, true, true, false, false);
+    cpu->system_bus->write_word (0x200 << kNumPageOffsetBits, 7);
+    cpu->system_bus->write_word (2 << kNumPageOffsetBits, 9);
+
+    cpu->set_flag (Emulator32bit::kUserModeFlagBit, true);
+    EXPECT_THROW (cpu->system_bus->read_word (0x200 << kNumPageOffsetBits),
+                  Emulator32bit::Exception)
+        << "translations of kernel pages should not be cached";
+    EXPECT_THROW (cpu->system_bus->read_word (2 << kNumPageOffsetBits), Emulator32bit::Exception);
+
+    cpu->set_flag (Emulator32bit::kUserModeFlagBit, false);
+    EXPECT_EQ (cpu->system_bus->read_word (0x200 << kNumPageOffsetBits), 7);
+    EXPECT_EQ (cpu->system_bus->read_word (2 << kNumPageOffsetBits), 9)
+        << "kernel memory should be mapped to itself";
+}
+
+TEST_F (MMUFixture, evicts_and_pages_in)
+{
+    constexpr word kPages = kUserPages + 4;
+    mmu->create_pagedir ();
+    for (word page = 0; page < kPages; page++)
+    {
+        mmu->add_vpage (0x300 + page, false, true, false, false);
+        cpu->system_bus->write_word ((0x300 + page) << kNumPageOffsetBits, page * 3);
+    }
+    EXPECT_EQ (mmu->stats ().evictions, kPages - kUserPages);
+
+    for (word page = 0; page < kPages; page++)
+    {
+        EXPECT_EQ (cpu->system_bus->read_word ((0x300 + page) << kNumPageOffsetBits), page * 3);
+    }
+    EXPECT_GT (mmu->stats ().page_ins, 0);
+    EXPECT_EQ (mmu->stats ().evictions - mmu->stats ().page_ins, kPages - kUserPages);
+}
+
+TEST_F (MMUFixture, remove_pagedir_returns_pages)
+{
+    for (int round = 0; round < 2; round++)
+    {
+        mmu->create_pagedir ();
+        for (word page = 0; page < kUserPages; page++)
+        {
+            mmu->add_vpage (0x300 + page, false, true, false, false);
+        }
+        mmu->remove_pagedir ();
+    }
+    EXPECT_EQ (mmu->stats ().evictions, 0) << "pages of a removed directory should be reused";
+    EXPECT_EQ (cpu->pagedir, 0);
+}
+
+TEST_F (MMUFixture, leaving_real_mode_drops_untranslated_accesses)
+{
+    mmu->create_pagedir ();
+    cpu->set_flag (Emulator32bit::kRealModeFlagBit, true);
+    cpu->system_bus->write_word (5 << kNumPageOffsetBits, 3);
+    EXPECT_EQ (cpu->system_bus->read_word (5 << kNumPageOffsetBits), 3);
+
+    // msr pstate, #0 leaves real mode
+    cpu->system_bus->write_word (0, Emulator32bit::asm_msr (Emulator32bit::kSysregId_pstate, true,
+                                                            0));
+    cpu->set_pc (0);
+    cpu->run (1);
+    EXPECT_FALSE (cpu->get_flag (Emulator32bit::kRealModeFlagBit));
+    EXPECT_THROW (cpu->system_bus->read_word (5 << kNumPageOffsetBits), Emulator32bit::Exception)
+        << "addresses accessed in real mode should be translated once it is left";
+}
+
+TEST_F (MMUFixture, page_directory_must_be_in_kernel_pages)
+{
+    mmu->set_pagedir (5 << kNumPageOffsetBits);
+    EXPECT_THROW (cpu->system_bus->read_word (0x400 << kNumPageOffsetBits),
+                  Emulator32bit::Exception);
+
+    mmu->set_pagedir (0);
+    cpu->system_bus->write_word (5 << kNumPageOffsetBits, 3);
+    EXPECT_EQ (cpu->system_bus->read_word (5 << kNumPageOffsetBits), 3)
+        << "no page directory should leave addresses untranslated";
+}
+
+TEST_F (MMUFixture, snapshot_refuses_removed_vpage)
+{
+    mmu->create_pagedir ();
+    mmu->add_vpage (0x100, false, true, false, false);
+    cpu->system_bus->write_word (0x100 << kNumPageOffsetBits, 1);
+    EXPECT_THROW (cpu->snapshot (), SystemBus::Exception);
+    EXPECT_FALSE (cpu->has_snapshot ());
+
+    // refusing leaves the tables and the RAM they are in as they were
+    EXPECT_EQ (cpu->system_bus->read_word (0x100 << kNumPageOffsetBits), 1);
+    mmu->remove_vpage (0x100);
+    EXPECT_THROW (cpu->system_bus->read_word (0x100 << kNumPageOffsetBits),
+                  Emulator32bit::Exception);
+    mmu->add_vpage (0x100, false, true, false, false);
+    EXPECT_EQ (cpu->system_bus->read_word (0x100 << kNumPageOffsetBits), 0);
+}
+
+TEST_F (MMUFixture, snapshot_refuses_removed_pagedir)
+{
+    const word pagedir = mmu->create_pagedir ();
+    mmu->add_vpage (0x100, false, true, false, false);
+    EXPECT_THROW (cpu->snapshot (), SystemBus::Exception);
+    EXPECT_FALSE (cpu->has_snapshot ());
+
+    mmu->remove_pagedir ();
+    EXPECT_EQ (cpu->pagedir, 0);
+    EXPECT_EQ (mmu->create_pagedir (), pagedir) << "the removed directory should be free again";
+}
+
+TEST (mmu, superpages_stay_in_memory)
+{
+    /* 1600 pages of RAM leave pages 400 to 1599 for virtual pages */
+    constexpr word kSmallPages = 1200 - kSuperpagePages + 8;
+    constexpr word kSuperVPage = 2 * kSuperpagePages;
+    Emulator32bit cpu (new RAM (1600, 0), new ROM (0, 1600), new PagingDisk (),
+                       Emulator32bit::Backend::INTERPRETER, Emulator32bit::Paging::PAGE_TABLE_WALK);
+    MMU *mmu = cpu.system_bus->page_table_mmu;
+    mmu->create_pagedir ();
+
+    mmu->add_vpage (kSuperVPage, false, true, false, false, true);
+    for (word page = 0; page < kSuperpagePages; page += 64)
+    {
+        cpu.system_bus->write_word ((kSuperVPage + page) << kNumPageOffsetBits, page);
+    }
+    EXPECT_THROW (mmu->add_vpage (kSuperVPage + 1, false, true, false, false),
+                  Emulator32bit::Exception);
+    EXPECT_THROW (mmu->add_vpage (3 * kSuperpagePages, false, true, false, false, true),
+                  FBL_InMemory::Exception);
+
+    for (word page = 0; page < kSmallPages; page++)
+    {
+        mmu->add_vpage (0x10000 + page, false, true, false, false);
+        cpu.system_bus->write_word ((0x10000 + page) << kNumPageOffsetBits, page);
+    }
+    EXPECT_EQ (mmu->stats ().evictions, 8) << "only pages outside the superpage should be evicted";
+    for (word page = 0; page < kSuperpagePages; page += 64)
+    {
+        EXPECT_EQ (cpu.system_bus->read_word ((kSuperVPage + page) << kNumPageOffsetBits), page);
+    }
+
+    mmu->remove_vpage (kSuperVPage + 7);
+    EXPECT_THROW (cpu.system_bus->read_word (kSuperVPage << kNumPageOffsetBits),
+                  Emulator32bit::Exception);
+    EXPECT_NO_THROW (mmu->add_vpage (3 * kSuperpagePages, false, true, false, false, true))
+        << "removing a page of a superpage should return all of its pages";
+}
+
+/* 64 pages of RAM leave pages 1 to 15 for the tables, enough for a few page directories */
+class SharingFixture : public ::testing::Test
+{
+  protected:
+    static constexpr word kUserPages = 48;
+    static constexpr word kAddr = 0x300 << kNumPageOffsetBits;
+
+    Emulator32bit *cpu = new Emulator32bit (new RAM (64, 0), new ROM (0, 64), new PagingDisk (),
+                                            Emulator32bit::Backend::INTERPRETER,
+                                            Emulator32bit::Paging::PAGE_TABLE_WALK);
+    MMU *mmu = cpu->system_bus->page_table_mmu;
+
+    ~SharingFixture () override
+    {
+        delete cpu;
+    }
+};
+
+TEST_F (SharingFixture, shared_pages_are_copied_on_write)
+{
+    const word a = mmu->create_pagedir ();
+    mmu->add_vpage (0x300, false, true, false, false);
+    cpu->system_bus->write_word (kAddr, 1);
+    const word b = mmu->create_pagedir ();
+    mmu->share_vpage (a, 0x300);
+    const word c = mmu->create_pagedir ();
+    mmu->share_vpage (a, 0x300);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 1);
+
+    // the entry that added the page writes to a copy of its own while the others share it
+    mmu->set_pagedir (a);
+    cpu->system_bus->write_word (kAddr, 2);
+    mmu->set_pagedir (b);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 1);
+    cpu->system_bus->write_word (kAddr, 3);
+    mmu->set_pagedir (c);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 1);
+    cpu->system_bus->write_word (kAddr, 4);
+
+    mmu->set_pagedir (a);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 2);
+    mmu->set_pagedir (b);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 3);
+    mmu->set_pagedir (c);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 4);
+    EXPECT_THROW (mmu->share_vpage (a, 0x301), Emulator32bit::Exception);
+}
+
+TEST_F (SharingFixture, shared_pages_stay_in_memory)
+{
+    constexpr word kPages = kUserPages + 4;
+    const word a = mmu->create_pagedir ();
+    mmu->add_vpage (0x300, false, true, false, false);
+    cpu->system_bus->write_word (kAddr, 7);
+    const word b = mmu->create_pagedir ();
+    mmu->share_vpage (a, 0x300);
+
+    for (word page = 1; page < kPages; page++)
+    {
+        mmu->add_vpage (0x300 + page, false, true, false, false);
+        cpu->system_bus->write_word (kAddr + (page << kNumPageOffsetBits), page);
+    }
+    EXPECT_EQ (mmu->stats ().evictions, kPages - kUserPages);
+
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 7);
+    mmu->set_pagedir (a);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 7)
+        << "evictions should not move a page other entries still map";
+
+    // once one of the entries is removed the other owns the page and writes it in place
+    mmu->set_pagedir (b);
+    mmu->remove_pagedir ();
+    mmu->set_pagedir (a);
+    cpu->system_bus->write_word (kAddr, 8);
+    EXPECT_EQ (cpu->system_bus->read_word (kAddr), 8);
+}
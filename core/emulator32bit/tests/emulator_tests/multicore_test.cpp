@@ -0,0 +1,278 @@
+#include <emulator32bit/multicore.h>
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <thread>
+
+static constexpr word kCounterAddr = 0x1000;
+
+static SystemBus *create_bus ()
+{
+    return new SystemBus (new RAM (4, 0), new ROM ({}, 0, 4));
+}
+
+TEST (multicore, atomic_counter)
+{
+    constexpr word kCores = 4;
+    constexpr word kIterations = 20000;
+    Multicore cores (create_bus (), kCores);
+
+    // mov x1, #kIterations; mov x2, #kCounterAddr; mov x3, #1
+    // loop: ldadd x4, x3, [x2]; subs x1, x1, #1; b.ne loop; hlt
+    const word program[] = {
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, kIterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, kCounterAddr),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 3, 1),
+        Emulator32bit::asm_atomic (4, 3, 2, Emulator32bit::kAtomicWidth_word,
+                                   Emulator32bit::kAtomicId_ldadd),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -3),
+        Emulator32bit::asm_hlt (),
+    };
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cores.system_bus->write_word (i * 4, program[i]);
+    }
+
+    for (const Emulator32bit::StopReason &reason : cores.run (0))
+    {
+        EXPECT_EQ (reason.status, Emulator32bit::RunStatus::HALTED) << reason.fault;
+    }
+    EXPECT_EQ (cores.system_bus->read_word (kCounterAddr), kCores * kIterations)
+        << "concurrent ldadd should not lose updates";
+}
+
+TEST (multicore, core_sysreg)
+{
+    Multicore cores (create_bus (), 3);
+
+    // mrs x0, core; hlt
+    cores.system_bus->write_word (0, Emulator32bit::asm_mrs (0, Emulator32bit::kSysregId_core));
+    cores.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+
+    cores.run (0);
+    for (word id = 0; id < cores.ncores (); id++)
+    {
+        EXPECT_EQ (cores.core (id).read_reg (0), id);
+    }
+}
+
+TEST (multicore, ipi_stops_core)
+{
+    Multicore cores (create_bus (), 2);
+
+    // loop: b loop
+    const word loop = Emulator32bit::asm_format_b1 (Emulator32bit::_op_b,
+                                                    Emulator32bit::ConditionCode::AL, 0);
+    cores.system_bus->write_word (0, loop);
+
+    Emulator32bit::StopReason reason;
+    std::thread runner ([&cores, &reason] () { cores.core (1).run_until (0, reason); });
+    cores.send_ipi (1, 0x4);
+    runner.join ();
+
+    EXPECT_EQ (reason.status, Emulator32bit::RunStatus::IPI);
+    EXPECT_EQ (reason.ipi, 0x4);
+}
+
+TEST (multicore, ipi_device)
+{
+    constexpr word kIPIPage = 8;
+    Multicore cores (create_bus (), 2);
+    cores.system_bus->map_device (new IPIDevice (kIPIPage, &cores));
+
+    // str x1, [x2]; hlt
+    cores.system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                         Emulator32bit::_op_str, false, 1, 2, 0,
+                                         Emulator32bit::AddrType::ADDR_OFFSET));
+    cores.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cores.core (0).write_reg (1, 1 | (0x10 << 8));
+    cores.core (0).write_reg (2, kIPIPage << kNumPageOffsetBits);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cores.core (0).run_until (0, reason), Emulator32bit::RunStatus::HALTED)
+        << reason.fault;
+
+    // loop: b loop
+    const word loop = Emulator32bit::asm_format_b1 (Emulator32bit::_op_b,
+                                                    Emulator32bit::ConditionCode::AL, 0);
+    cores.system_bus->write_word (8, loop);
+    cores.core (1).set_pc (8);
+    EXPECT_EQ (cores.core (1).run_until (0, reason), Emulator32bit::RunStatus::IPI);
+    EXPECT_EQ (reason.ipi, 0x10);
+}
+
+TEST (multicore, code_write_invalidates_other_cores)
+{
+    Multicore cores (create_bus (), 2);
+
+    // add x0, x0, #1; hlt
+    cores.system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false,
+                                                                  0, 0, 1));
+    cores.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cores.core (0).run (0);
+    EXPECT_EQ (cores.core (0).read_reg (0), 1);
+
+    // add x0, x0, #2, stored by the other core
+    cores.core (1).system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add,
+                                                                           false, 0, 0, 2));
+    cores.core (0).set_pc (0);
+    cores.core (0).run (0);
+    EXPECT_EQ (cores.core (0).read_reg (0), 3)
+        << "a core should drop the decoded instructions another core wrote over";
+}
+
+/**
+ * @brief                   Every core increments the counter with a plain load and store, racing
+ *                          with the others, then halts.
+ *
+ */
+static void write_racy_counter (Multicore &cores, word iterations)
+{
+    // mov x1, #iterations; mov x2, #kCounterAddr
+    // loop: ldr x3, [x2]; add x3, x3, #1; str x3, [x2]; subs x1, x1, #1; b.ne loop; hlt
+    const word program[] = {
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, iterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, kCounterAddr),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 3, 2, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 3, 3, 1),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 3, 2, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -4),
+        Emulator32bit::asm_hlt (),
+    };
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cores.system_bus->write_word (i * 4, program[i]);
+    }
+}
+
+TEST (multicore, quanta_reproduce_races)
+{
+    constexpr word kIterations = 1000;
+    const word workers[] = {1, 2, 4, 1};
+    word counters[std::size (workers)];
+    for (word i = 0; i < std::size (workers); i++)
+    {
+        Multicore cores (create_bus (), 4);
+        write_racy_counter (cores, kIterations);
+
+        for (const Emulator32bit::StopReason &reason : cores.run_quanta (0, 3, workers[i]))
+        {
+            EXPECT_EQ (reason.status, Emulator32bit::RunStatus::HALTED) << reason.fault;
+            EXPECT_EQ (reason.instructions, 3 + 5 * kIterations);
+        }
+        counters[i] = cores.system_bus->read_word (kCounterAddr);
+    }
+
+    EXPECT_LT (counters[0], 4 * kIterations) << "quanta splitting the increments should lose some";
+    for (word i = 1; i < std::size (workers); i++)
+    {
+        EXPECT_EQ (counters[i], counters[0])
+            << "the same quanta should lose the same increments on " << workers[i] << " workers";
+    }
+}
+
+TEST (multicore, quanta_keep_atomics_atomic)
+{
+    constexpr word kCores = 4;
+    constexpr word kIterations = 500;
+
+    // mrs x5, core; mov x1, #kIterations; mov x2, #kCounterAddr; mov x3, #1
+    // loop: ldadd x4, x3, [x2]; add x5, x5, x4; str x5, [x2, #4]; subs x1, x1, #1; b.ne loop
+    // hlt
+    const word program[] = {
+        Emulator32bit::asm_mrs (5, Emulator32bit::kSysregId_core),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, kIterations),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, kCounterAddr),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 3, 1),
+        Emulator32bit::asm_atomic (4, 3, 2, Emulator32bit::kAtomicWidth_word,
+                                   Emulator32bit::kAtomicId_ldadd),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 5, 5, 4),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 5, 2, 4,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -4),
+        Emulator32bit::asm_hlt (),
+    };
+
+    // the values each core fetched, and so its registers, depend on the order of the cores
+    word sums[2][kCores];
+    word last[2];
+    const word workers[] = {1, kCores};
+    for (word i = 0; i < std::size (workers); i++)
+    {
+        Multicore cores (create_bus (), kCores);
+        for (word j = 0; j < std::size (program); j++)
+        {
+            cores.system_bus->write_word (j * 4, program[j]);
+        }
+
+        for (const Emulator32bit::StopReason &reason : cores.run_quanta (0, 7, workers[i]))
+        {
+            EXPECT_EQ (reason.status, Emulator32bit::RunStatus::HALTED) << reason.fault;
+        }
+        EXPECT_EQ (cores.system_bus->read_word (kCounterAddr), kCores * kIterations)
+            << "ldadd should not lose updates on " << workers[i] << " workers";
+
+        for (word id = 0; id < kCores; id++)
+        {
+            sums[i][id] = cores.core (id).read_reg (5);
+        }
+        last[i] = cores.system_bus->read_word (kCounterAddr + 4);
+    }
+
+    for (word id = 0; id < kCores; id++)
+    {
+        EXPECT_EQ (sums[1][id], sums[0][id]) << "core " << id;
+    }
+    EXPECT_EQ (last[1], last[0]);
+}
+
+TEST (multicore, quanta_budget_and_clock)
+{
+    Multicore cores (create_bus (), 3);
+
+    // loop: b loop
+    const word loop = Emulator32bit::asm_format_b1 (Emulator32bit::_op_b,
+                                                    Emulator32bit::ConditionCode::AL, 0);
+    cores.system_bus->write_word (0, loop);
+
+    for (const Emulator32bit::StopReason &reason : cores.run_quanta (100, 16, 2))
+    {
+        EXPECT_EQ (reason.status, Emulator32bit::RunStatus::BUDGET_EXHAUSTED);
+        EXPECT_EQ (reason.instructions, 100);
+    }
+    EXPECT_EQ (cores.time (), 100);
+}
+
+TEST (multicore, quanta_deliver_ipis_at_barrier)
+{
+    constexpr word kIPIPage = 8;
+    constexpr word kQuantum = 10;
+    Multicore cores (create_bus (), 2);
+    cores.system_bus->map_device (new IPIDevice (kIPIPage, &cores));
+
+    // core 0: str x1, [x2]; hlt
+    cores.system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                         Emulator32bit::_op_str, false, 1, 2, 0,
+                                         Emulator32bit::AddrType::ADDR_OFFSET));
+    cores.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cores.core (0).write_reg (1, 1 | (0x2 << 8));
+    cores.core (0).write_reg (2, kIPIPage << kNumPageOffsetBits);
+
+    // core 1: loop: b loop
+    const word loop = Emulator32bit::asm_format_b1 (Emulator32bit::_op_b,
+                                                    Emulator32bit::ConditionCode::AL, 0);
+    cores.system_bus->write_word (8, loop);
+    cores.core (1).set_pc (8);
+
+    const std::vector<Emulator32bit::StopReason> reasons = cores.run_quanta (0, kQuantum, 2);
+    EXPECT_EQ (reasons[0].status, Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (reasons[1].status, Emulator32bit::RunStatus::IPI);
+    EXPECT_EQ (reasons[1].ipi, 0x2);
+    EXPECT_EQ (reasons[1].instructions, kQuantum + 1)
+        << "the interrupt should be raised at the end of the quantum it was sent in";
+}
@@ -0,0 +1,19 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST (page_map, value_across_ram_and_rom)
+{
+    const byte rom_data[kPageSize] = {0x55, 0x66};
+    Emulator32bit cpu (1, 0, rom_data, 1, 1);
+
+    cpu.system_bus->write_hword (kPageSize - 2, 0x2211);
+    EXPECT_EQ (cpu.system_bus->read_word (kPageSize - 2), 0x66552211)
+        << "a word crossing the end of ram should be read from both memories";
+    EXPECT_EQ (cpu.system_bus->read_physical_word (kPageSize), 0x6655);
+}
+
+TEST (page_map, unrouted_address)
+{
+    Emulator32bit cpu (1, 0, {}, 0, 1);
+    EXPECT_THROW (cpu.system_bus->read_physical_word (kPageSize), SystemBus::Exception);
+    EXPECT_THROW (cpu.system_bus->read_physical_word (~word (0) - 3), SystemBus::Exception);
+}
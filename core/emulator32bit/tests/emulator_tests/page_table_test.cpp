@@ -0,0 +1,68 @@
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST (page_table, walks_pages_of_every_table)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const word tables = mmu->page_table_pages ();
+
+    // the last page of the first table, the first of the second and the last page of all
+    const word vpages[] = {kPageTableSize - 1, kPageTableSize, kNumVPages - 1};
+    const long long pid = mmu->begin_process ();
+    for (word vpage : vpages)
+    {
+        mmu->add_vpage (pid, vpage, 1, true, false);
+        cpu.system_bus->write_word (vpage << kNumPageOffsetBits, vpage);
+    }
+    EXPECT_EQ (mmu->page_table_pages (), tables + 3);
+
+    for (word vpage : vpages)
+    {
+        EXPECT_EQ (cpu.system_bus->read_word (vpage << kNumPageOffsetBits), vpage);
+        EXPECT_TRUE (mmu->can_write_vpage (pid, vpage));
+    }
+    EXPECT_FALSE (mmu->can_write_vpage (pid, kPageTableSize + 1))
+        << "pages next to added ones should not be mapped";
+    EXPECT_THROW (mmu->add_vpage (pid, kNumVPages, 1, true, false),
+                  VirtualMemory::InvalidVPageException);
+}
+
+TEST (page_table, end_process_returns_tables)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const word tables = mmu->page_table_pages ();
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, 0, 4, true, false);
+    mmu->add_vpage (a, 5 * kPageTableSize, 1, true, false);
+    cpu.system_bus->write_word (0, 0x1234);
+    const long long b = mmu->fork_process (a);
+    EXPECT_EQ (mmu->page_table_pages (), tables + 4);
+
+    mmu->end_process (a);
+    EXPECT_EQ (mmu->page_table_pages (), tables + 2);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (0), 0x1234)
+        << "the pages of a fork should outlive the tables of its parent";
+
+    mmu->end_process (b);
+    EXPECT_EQ (mmu->page_table_pages (), tables);
+}
+
+TEST (page_table, maps_virtual_page_to_fixed_physical_page)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long pid = mmu->begin_process ();
+
+    VirtualMemory::Exception exception;
+    mmu->ensure_physical_page_mapping (pid, 0x20, 3, exception);
+    EXPECT_EQ (mmu->translate_address (pid, (0x20 << kNumPageOffsetBits) + 4, exception),
+               (3 << kNumPageOffsetBits) + 4);
+
+    mmu->ensure_physical_page_mapping (pid, 0x20, 3, exception);
+    EXPECT_THROW (mmu->ensure_physical_page_mapping (pid, 0x20, 4, exception),
+                  VirtualMemory::VPageRemapException);
+}
@@ -0,0 +1,174 @@
+#include <emulator32bit/replacement_policy.h>
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <memory>
+
+static const auto kAnyPage = [] (word) { return true; };
+
+static word victim (ReplacementPolicy &policy,
+                    const std::function<bool (word)> &evictable = kAnyPage)
+{
+    word ppage = PageRing::kNone;
+    EXPECT_TRUE (policy.select_victim (evictable, ppage));
+    return ppage;
+}
+
+TEST (replacement_policy, lru_evicts_least_recently_used)
+{
+    LRUPolicy lru;
+    for (word ppage : {5, 1, 9})
+    {
+        lru.insert (ppage, ppage);
+    }
+    lru.access (5);
+    lru.access (42);
+    EXPECT_EQ (lru.pages (), (std::vector<word>{1, 9, 5}));
+
+    EXPECT_EQ (victim (lru, [] (word ppage) { return ppage != 1; }), 9)
+        << "rejected pages should be skipped and stay tracked";
+    EXPECT_EQ (lru.pages (), (std::vector<word>{1, 5}));
+
+    lru.remove (1);
+    EXPECT_EQ (victim (lru), 5);
+    word ppage;
+    EXPECT_FALSE (lru.select_victim (kAnyPage, ppage));
+}
+
+TEST (replacement_policy, clock_gives_referenced_pages_another_turn)
+{
+    ClockPolicy clock;
+    for (word ppage = 0; ppage < 4; ppage++)
+    {
+        clock.insert (ppage, ppage);
+    }
+
+    // the first sweep clears the bits set when the pages were brought in
+    EXPECT_EQ (victim (clock), 0);
+    clock.access (1);
+    EXPECT_EQ (victim (clock), 2);
+    clock.insert (7, 7);
+    EXPECT_EQ (clock.pages (), (std::vector<word>{3, 1, 7}));
+    EXPECT_EQ (victim (clock), 3);
+
+    word ppage;
+    EXPECT_FALSE (clock.select_victim ([] (word) { return false; }, ppage));
+}
+
+TEST (replacement_policy, clock_pro_keeps_hot_pages_through_a_scan)
+{
+    constexpr word kPages = 8;
+    ClockProPolicy clock_pro;
+    LRUPolicy lru;
+    for (ReplacementPolicy *policy : std::initializer_list<ReplacementPolicy *>{&clock_pro, &lru})
+    {
+        for (word ppage = 0; ppage < kPages; ppage++)
+        {
+            policy->insert (ppage, ppage);
+        }
+
+        // pages 0 and 1 are used while others come and go, then a scan passes over memory
+        word key = kPages;
+        for (word i = 0; i < kPages; i++)
+        {
+            policy->access (0);
+            policy->access (1);
+            policy->insert (victim (*policy), key++);
+        }
+
+        bool evicted_hot = false;
+        for (word i = 0; i < 4 * kPages; i++)
+        {
+            const word ppage = victim (*policy);
+            evicted_hot |= ppage <= 1;
+            policy->insert (ppage, key++);
+        }
+        EXPECT_EQ (evicted_hot, policy == &lru) << policy->name ();
+    }
+    EXPECT_EQ (clock_pro.hot_pages (), 2);
+}
+
+TEST (replacement_policy, clock_pro_promotes_pages_brought_back_soon)
+{
+    ClockProPolicy clock_pro;
+    for (word ppage = 0; ppage < 4; ppage++)
+    {
+        clock_pro.insert (ppage, 100 + ppage);
+    }
+    EXPECT_EQ (clock_pro.cold_target (), 1);
+
+    const word evicted = victim (clock_pro);
+    EXPECT_EQ (evicted, 0);
+    clock_pro.insert (evicted, 100);
+    EXPECT_EQ (clock_pro.hot_pages (), 1) << "a page in its test period should come back hot";
+    EXPECT_EQ (clock_pro.cold_target (), 2);
+
+    // another page brought in at the same physical page is a new page
+    clock_pro.remove (1);
+    clock_pro.insert (1, 200);
+    EXPECT_EQ (clock_pro.hot_pages (), 1);
+}
+
+TEST (replacement_policy, restores_saved_state)
+{
+    std::unique_ptr<ReplacementPolicy> policies[] = {
+        std::make_unique<LRUPolicy> (),
+        std::make_unique<ClockPolicy> (),
+        std::make_unique<ClockProPolicy> (),
+    };
+
+    for (std::unique_ptr<ReplacementPolicy> &policy : policies)
+    {
+        for (word ppage = 0; ppage < 6; ppage++)
+        {
+            policy->insert (ppage, ppage);
+        }
+        policy->access (3);
+        policy->insert (victim (*policy), 50);
+
+        const std::vector<U64> state = policy->save ();
+        const std::vector<word> pages = policy->pages ();
+        const word next = victim (*policy);
+        policy->insert (next, 51);
+        policy->access (4);
+        policy->remove (2);
+
+        policy->restore (state);
+        EXPECT_EQ (policy->pages (), pages) << policy->name ();
+        EXPECT_EQ (victim (*policy), next) << policy->name ();
+    }
+}
+
+TEST (replacement_policy, counts_disk_traffic_of_virtual_memory)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, 0, 6, true, false);
+
+    // four pages fill RAM, the reads of the last two evict the first two written
+    for (word vpage = 0; vpage < 4; vpage++)
+    {
+        cpu.system_bus->write_word (vpage << kNumPageOffsetBits, vpage);
+    }
+    cpu.system_bus->read_word (4 << kNumPageOffsetBits);
+    cpu.system_bus->read_word (5 << kNumPageOffsetBits);
+
+    const ReplacementPolicy::Stats &stats = mmu->replacement_policy ()->stats ();
+    EXPECT_EQ (stats.faults, 6);
+    EXPECT_EQ (stats.evictions, 2);
+    EXPECT_EQ (stats.dirty_writebacks, 2);
+
+    // the written pages are evicted first, then the ones that were only read
+    mmu->set_replacement_policy (new ClockProPolicy ());
+    EXPECT_EQ (mmu->replacement_policy ()->pages ().size (), 4);
+    for (word vpage = 0; vpage < 4; vpage++)
+    {
+        cpu.system_bus->read_word (vpage << kNumPageOffsetBits);
+    }
+
+    const ReplacementPolicy::Stats &clock_pro = mmu->replacement_policy ()->stats ();
+    EXPECT_EQ (clock_pro.faults, 4);
+    EXPECT_EQ (clock_pro.evictions, 4);
+    EXPECT_EQ (clock_pro.dirty_writebacks, 2);
+}
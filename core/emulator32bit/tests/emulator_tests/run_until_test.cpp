@@ -0,0 +1,118 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+/**
+ * @brief                   Write add x0, x0, #1 at 0, 4 and 8 followed by a hlt at 12.
+ *
+ */
+static void write_counting_program (Emulator32bit *cpu)
+{
+    for (word addr = 0; addr < 12; addr += 4)
+    {
+        cpu->system_bus->write_word (addr, Emulator32bit::asm_format_o (Emulator32bit::_op_add,
+                                                                        false, 0, 0, 1));
+    }
+    cpu->system_bus->write_word (12, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+}
+
+TEST_F (EmulatorFixture, run_until_halted)
+{
+    write_counting_program (cpu);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (reason.status, Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (reason.instructions, 4);
+    EXPECT_EQ (cpu->read_reg (0), 3);
+    EXPECT_EQ (cpu->get_pc (), 12) << "the pc should stay on the hlt instruction";
+
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED)
+        << "running again from a hlt should halt again";
+    EXPECT_EQ (cpu->read_reg (0), 3);
+}
+
+TEST_F (EmulatorFixture, run_until_budget_exhausted)
+{
+    write_counting_program (cpu);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (2, reason), Emulator32bit::RunStatus::BUDGET_EXHAUSTED);
+    EXPECT_EQ (reason.instructions, 2);
+    EXPECT_EQ (cpu->get_pc (), 8);
+
+    EXPECT_EQ (cpu->run_until (2, reason), Emulator32bit::RunStatus::HALTED)
+        << "a run should continue where the previous one ran out of budget";
+    EXPECT_EQ (cpu->read_reg (0), 3);
+}
+
+TEST_F (EmulatorFixture, run_until_fault)
+{
+    // ldr x1, [x2]
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_ldr, false, 1, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->write_reg (2, 0x100000);
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::FAULT);
+    EXPECT_FALSE (reason.fault.empty ());
+    EXPECT_EQ (cpu->get_pc (), 0) << "the pc should point at the faulting instruction";
+}
+
+TEST_F (EmulatorFixture, run_until_undefined_opcode_faults)
+{
+    // add x0, x0, #1 followed by an unassigned opcode in the same block
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, 0b111111U << 26);
+    cpu->system_bus->write_word (8, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::FAULT);
+    EXPECT_EQ (cpu->read_reg (0), 1) << "nothing after the undefined instruction should run";
+    EXPECT_EQ (cpu->get_pc (), 4);
+}
+
+TEST_F (EmulatorFixture, run_until_breakpoint)
+{
+    write_counting_program (cpu);
+    cpu->add_breakpoint (8);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::BREAKPOINT);
+    EXPECT_EQ (reason.instructions, 2);
+    EXPECT_EQ (cpu->read_reg (0), 2);
+    EXPECT_EQ (cpu->get_pc (), 8) << "the instruction at the breakpoint should not execute";
+
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED)
+        << "resuming should execute the instruction at the breakpoint";
+    EXPECT_EQ (cpu->read_reg (0), 3);
+
+    cpu->remove_breakpoint (8);
+    cpu->set_pc (0);
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (cpu->read_reg (0), 6);
+}
+
+TEST_F (EmulatorFixture, run_until_exit)
+{
+    // mov x8, #1030; mov x0, #42; swi
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false,
+                                                                  8, 1030));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false,
+                                                                  0, 42));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_format_b1 (
+                                        Emulator32bit::_op_swi, Emulator32bit::ConditionCode::AL,
+                                        0));
+    cpu->system_bus->write_word (12, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::EXIT);
+    EXPECT_EQ (reason.exit_code, 42);
+    EXPECT_EQ (reason.instructions, 3);
+    EXPECT_EQ (cpu->get_pc (), 12);
+}
@@ -0,0 +1,178 @@
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+#include <cstring>
+#include <map>
+
+static constexpr word kDataAddr = 0x800;
+
+TEST_F (EmulatorFixture, snapshot_restores_registers_and_memory)
+{
+    // add x0, x0, #1; str x0, [x1]; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, true, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_str, false, 0, 1, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (0, 41);
+    cpu->write_reg (1, kDataAddr);
+    cpu->system_bus->write_word (kDataAddr, 7);
+    cpu->set_pc (0);
+    cpu->snapshot ();
+
+    Emulator32bit::StopReason reason;
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED) << reason.fault;
+        EXPECT_EQ (cpu->read_reg (0), 42);
+        EXPECT_EQ (cpu->system_bus->read_word (kDataAddr), 42);
+        EXPECT_EQ (cpu->system_bus->snapshot_dirty_pages (), 1);
+
+        cpu->restore ();
+        EXPECT_EQ (cpu->read_reg (0), 41);
+        EXPECT_EQ (cpu->get_pc (), 0);
+        EXPECT_EQ (cpu->get_pstate (), 0);
+        EXPECT_EQ (cpu->system_bus->read_word (kDataAddr), 7);
+        EXPECT_EQ (cpu->system_bus->snapshot_dirty_pages (), 0);
+    }
+}
+
+TEST_F (EmulatorFixture, snapshot_protects_cached_write_translations)
+{
+    cpu->system_bus->write_word (kDataAddr, 1);
+    cpu->snapshot ();
+
+    // the page is in the write TLB from before the snapshot
+    cpu->system_bus->write_word (kDataAddr, 2);
+    cpu->system_bus->write_word (kDataAddr + 4, 3);
+    EXPECT_EQ (cpu->system_bus->snapshot_dirty_pages (), 1);
+
+    cpu->restore ();
+    EXPECT_EQ (cpu->system_bus->read_word (kDataAddr), 1);
+    EXPECT_EQ (cpu->system_bus->read_word (kDataAddr + 4), 0);
+}
+
+TEST_F (EmulatorFixture, snapshot_restores_decoded_code)
+{
+    // add x0, x0, #1; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+    cpu->snapshot ();
+
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+
+    // add x0, x0, #5
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 5));
+    cpu->restore ();
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 1)
+        << "restoring a code page should drop its decoded instructions";
+}
+
+TEST (snapshot, restores_page_tables)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    constexpr word kAddr = 0x10 << kNumPageOffsetBits;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, 0x10, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+    cpu.snapshot ();
+
+    const long long b = mmu->begin_process ();
+    mmu->add_vpage (b, 0x10, 1, true, false);
+    mmu->add_vpage (a, 0x20, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+    EXPECT_EQ (mmu->current_process (), b);
+
+    cpu.restore ();
+    EXPECT_EQ (mmu->current_process (), a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+    EXPECT_FALSE (mmu->can_write_vpage (a, 0x20));
+    EXPECT_THROW (mmu->set_process (b), VirtualMemory::InvalidPIDException);
+
+    // the tables are usable after being rebuilt
+    const long long c = mmu->begin_process ();
+    mmu->add_vpage (c, 0x10, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xCCCC);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xCCCC);
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+}
+
+/**
+ * @brief                   Disk kept in host memory that hands out the lowest free page, so pages
+ *                          returned to it are reused.
+ *
+ */
+class MemoryDisk : public MockDisk
+{
+  public:
+    std::map<word, std::vector<byte>> pages;
+    FreeBlockList free_list{0, 64};
+
+    word get_free_page () override
+    {
+        return free_list.get_free_block (1);
+    }
+
+    void return_page (word page) override
+    {
+        free_list.return_block (page, 1);
+    }
+
+    std::vector<std::pair<word, word>> get_free_pages () override
+    {
+        return free_list.get_blocks ();
+    }
+
+    void restore_free_pages (const std::vector<std::pair<word, word>> &blocks) override
+    {
+        free_list.restore_blocks (blocks);
+    }
+
+    void read_page (word page, byte *data) override
+    {
+        pages.try_emplace (page, kPageSize, 0);
+        std::memcpy (data, pages.at (page).data (), kPageSize);
+    }
+
+    void write_page (word page, const byte *data) override
+    {
+        pages[page].assign (data, data + kPageSize);
+    }
+};
+
+TEST (snapshot, restores_pages_on_disk)
+{
+    Emulator32bit cpu (new RAM (4, 0), new ROM (0, 4), new MemoryDisk ());
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    constexpr word kPages = 8;
+
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, 0, kPages, true, false);
+    for (word vpage = 0; vpage < kPages; vpage++)
+    {
+        cpu.system_bus->write_word (vpage << kNumPageOffsetBits, vpage);
+    }
+    cpu.snapshot ();
+
+    // bringing the pages on disk back in frees their disk pages for the pages evicted next
+    for (word vpage = 0; vpage < kPages; vpage++)
+    {
+        cpu.system_bus->write_word (vpage << kNumPageOffsetBits, 0x100 + vpage);
+    }
+
+    cpu.restore ();
+    for (word vpage = 0; vpage < kPages; vpage++)
+    {
+        EXPECT_EQ (cpu.system_bus->read_word (vpage << kNumPageOffsetBits), vpage)
+            << "virtual page " << vpage;
+    }
+}
@@ -0,0 +1,68 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST (soft_tlb, process_switch)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    constexpr word kAddr = 0x10 << kNumPageOffsetBits;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, 0x10, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+
+    const long long b = mmu->begin_process ();
+    mmu->add_vpage (b, 0x10, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA)
+        << "cached translations of one process should not be used by another";
+
+    mmu->end_process (b);
+    mmu->end_process (a);
+}
+
+TEST_F (EmulatorFixture, soft_tlb_unaligned_and_partial_accesses)
+{
+    cpu->system_bus->write_word (0x101, 0x44332211);
+    EXPECT_EQ (cpu->system_bus->read_byte (0x101), 0x11);
+    EXPECT_EQ (cpu->system_bus->read_hword (0x102), 0x3322);
+    EXPECT_EQ (cpu->system_bus->read_word (0x101), 0x44332211);
+
+    cpu->system_bus->write_hword (0x103, 0xBEEF);
+    EXPECT_EQ (cpu->system_bus->read_word (0x101), 0xBEEF2211);
+}
+
+TEST_F (EmulatorFixture, soft_tlb_write_to_code_page)
+{
+    // add x0, x0, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cpu->set_pc (0);
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 1);
+
+    // add x0, x0, #2, written through the bus after the page was decoded
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 2));
+    cpu->set_pc (0);
+    cpu->run (0);
+    EXPECT_EQ (cpu->read_reg (0), 3)
+        << "a cached write translation should not skip invalidating decoded instructions";
+}
+
+TEST_F (EmulatorFixture, tlbi)
+{
+    // tlbi x1; tlbi #0; hlt
+    cpu->system_bus->write_word (0, Emulator32bit::asm_tlbi (1, true, 0));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_tlbi (0, false, 0));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (1, 0x100);
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::HALTED) << reason.fault;
+    EXPECT_EQ (reason.instructions, 3);
+}
@@ -0,0 +1,105 @@
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+/* RAM for two superpages, the first one added at a superpage aligned virtual page */
+static constexpr word kRAMPages = 2 * kSuperpagePages;
+static constexpr word kVPage = 4 * kSuperpagePages;
+static constexpr word kAddr = kVPage << kNumPageOffsetBits;
+
+static word translate (VirtualMemory *mmu, long long pid, word vpage)
+{
+    VirtualMemory::Exception exception;
+    return mmu->translate_address (pid, vpage << kNumPageOffsetBits, exception)
+           >> kNumPageOffsetBits;
+}
+
+TEST (superpage, translates_with_one_tlb_entry)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, kVPage, kSuperpagePages, true, false, true);
+    mmu->reset_tlb_stats ();
+
+    const word first = translate (mmu, pid, kVPage);
+    for (word page = 1; page < kSuperpagePages; page++)
+    {
+        ASSERT_EQ (translate (mmu, pid, kVPage + page), first + page);
+    }
+    EXPECT_EQ (mmu->tlb_stats ().misses, 1);
+    EXPECT_EQ (mmu->tlb_stats ().superpage_hits, kSuperpagePages - 1);
+    EXPECT_EQ (mmu->tlb_stats ().evictions, 0);
+}
+
+TEST (superpage, rejects_overlapping_pages)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, kVPage, kSuperpagePages, true, false, true);
+    mmu->add_vpage (pid, kVPage + kSuperpagePages, 1, true, false);
+
+    EXPECT_THROW (mmu->add_vpage (pid, kVPage + 3, 1, true, false),
+                  VirtualMemory::InvalidVPageException);
+    EXPECT_THROW (
+        mmu->add_vpage (pid, kVPage + kSuperpagePages, kSuperpagePages, true, false, true),
+        VirtualMemory::InvalidVPageException);
+    EXPECT_THROW (mmu->add_vpage (pid, kVPage + 1, kSuperpagePages, true, false, true),
+                  VirtualMemory::InvalidVPageException);
+
+    VirtualMemory::Exception exception;
+    const word ppage = translate (mmu, pid, kVPage + 3);
+    EXPECT_NO_THROW (mmu->ensure_physical_page_mapping (pid, kVPage + 3, ppage, exception));
+    EXPECT_THROW (mmu->ensure_physical_page_mapping (pid, kVPage + 3, ppage + 1, exception),
+                  VirtualMemory::VPageRemapException);
+    EXPECT_TRUE (mmu->can_write_vpage (pid, kVPage + 3));
+}
+
+TEST (superpage, forks_share_superpages)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, kSuperpagePages, true, false, true);
+    cpu.system_bus->write_word (kAddr + 5 * kPageSize, 0x1234);
+
+    const long long b = mmu->fork_process (a);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 5 * kPageSize), 0x1234);
+    cpu.system_bus->write_word (kAddr + 5 * kPageSize, 0x5678);
+    mmu->set_process (a);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 5 * kPageSize), 0x5678)
+        << "forks should share superpages instead of copying them on write";
+
+    mmu->end_process (a);
+    mmu->set_process (b);
+    EXPECT_EQ (cpu.system_bus->read_word (kAddr + 5 * kPageSize), 0x5678)
+        << "a superpage should outlive the process that added it while a fork maps it";
+    mmu->end_process (b);
+
+    const long long c = mmu->begin_process ();
+    EXPECT_NO_THROW (mmu->add_vpage (c, 0, kRAMPages, true, false, true))
+        << "ending every process mapping a superpage should return its physical pages";
+    EXPECT_THROW (mmu->add_vpage (c, kVPage, kSuperpagePages, true, false, true),
+                  VirtualMemory::VirtualMemoryException);
+}
+
+TEST (superpage, restores_saved_superpages)
+{
+    Emulator32bit cpu (kRAMPages, 0, {}, 0, kRAMPages);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+    const long long pid = mmu->begin_process ();
+    mmu->add_vpage (pid, kVPage, kSuperpagePages, true, false, true);
+    const word ppage = translate (mmu, pid, kVPage + 9);
+
+    const VirtualMemory::State state = mmu->save_state ();
+    mmu->end_process (pid);
+    mmu->restore_state (state);
+
+    EXPECT_EQ (translate (mmu, pid, kVPage + 9), ppage);
+    mmu->add_vpage (pid, 0, kSuperpagePages, true, false, true);
+    EXPECT_THROW (mmu->add_vpage (pid, kVPage + kSuperpagePages, kSuperpagePages, true, false,
+                                  true),
+                  VirtualMemory::VirtualMemoryException)
+        << "the physical pages of a restored superpage should stay in use";
+}
@@ -0,0 +1,144 @@
+#include <emulator32bit/multicore.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+/**
+ * @brief                   Sum of an array of 16 words written by the program itself, so the
+ *                          loop goes through loads, stores, flag setting and conditional branches.
+ *
+ */
+static void write_sum_program (Emulator32bit &cpu)
+{
+    const word program[] = {
+        // mov x0, #0x400; mov x1, #0; mov x2, #0
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 0, 0x400),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 1, 0),
+        Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 2, 0),
+        // loop: str x1, [x0, #0]; add x0, x0, #4; add x1, x1, #1
+        Emulator32bit::asm_format_m (Emulator32bit::_op_str, false, 1, 0, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 4),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 1, 1, 1),
+        // cmp x1, #16; b.ne loop
+        Emulator32bit::asm_format_o (Emulator32bit::_op_cmp, true, 0, 1, 16),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -4),
+        // sum: sub x0, x0, #4; ldr x3, [x0, #0]; add x2, x2, x3; subs x1, x1, #1; b.ne sum
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, false, 0, 0, 4),
+        Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 3, 0, 0,
+                                     Emulator32bit::AddrType::ADDR_OFFSET),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 2, 2, 3,
+                                     Emulator32bit::ShiftType::SHIFT_LSL, 0),
+        Emulator32bit::asm_format_o (Emulator32bit::_op_sub, true, 1, 1, 1),
+        Emulator32bit::asm_format_b1 (Emulator32bit::_op_b, Emulator32bit::ConditionCode::NE, -4),
+        Emulator32bit::asm_hlt (),
+    };
+
+    for (word i = 0; i < std::size (program); i++)
+    {
+        cpu.system_bus->write_word (i * 4, program[i]);
+    }
+    cpu.set_pc (0);
+}
+
+TEST (threaded, matches_run)
+{
+    Emulator32bit table (1, 0, {}, 0, 1);
+    Emulator32bit threaded (1, 0, {}, 0, 1);
+    write_sum_program (table);
+    write_sum_program (threaded);
+
+    Emulator32bit::StopReason table_reason;
+    Emulator32bit::StopReason threaded_reason;
+    table.run_until (0, table_reason);
+    EXPECT_EQ (threaded.run_threaded (0, threaded_reason), Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (threaded_reason.instructions, table_reason.instructions);
+
+    EXPECT_EQ (threaded.read_reg (2), 120);
+    EXPECT_EQ (threaded.get_pc (), table.get_pc ()) << "both should halt at the hlt instruction";
+    for (U8 reg = 0; reg < 4; reg++)
+    {
+        EXPECT_EQ (threaded.read_reg (reg), table.read_reg (reg)) << "x" << int (reg);
+    }
+}
+
+TEST (threaded, instruction_budget)
+{
+    Emulator32bit cpu (1, 0, {}, 0, 1);
+    write_sum_program (cpu);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu.run_threaded (5, reason), Emulator32bit::RunStatus::BUDGET_EXHAUSTED);
+    EXPECT_EQ (reason.instructions, 5);
+    EXPECT_EQ (cpu.get_pc (), 20) << "the run should stop once the instruction budget runs out";
+    EXPECT_EQ (cpu.read_reg (0), 0x404);
+    EXPECT_EQ (cpu.read_reg (1), 0);
+
+    cpu.run_threaded (0, reason);
+    EXPECT_EQ (cpu.read_reg (2), 120);
+}
+
+TEST (threaded, reports_faults)
+{
+    Emulator32bit cpu (1, 0, {}, 0, 1);
+    // ldr x0, [x1, #0] with x1 past the end of memory
+    const word ldr = Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 0,
+                                                  Emulator32bit::AddrType::ADDR_OFFSET);
+    cpu.system_bus->write_word (0, ldr);
+    cpu.write_reg (1, 0x10000);
+    cpu.set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu.run_threaded (0, reason), Emulator32bit::RunStatus::FAULT);
+    EXPECT_EQ (reason.instructions, 0);
+    EXPECT_FALSE (reason.fault.empty ());
+    EXPECT_EQ (cpu.get_pc (), 0) << "the pc should point at the faulting instruction";
+}
+
+TEST (threaded, self_modifying_code)
+{
+    Emulator32bit cpu (1, 0, {}, 0, 1);
+    // str x1, [x2, #0] over the second add; add x0, x0, #1; add x0, x0, #1; hlt
+    cpu.system_bus->write_word (0, Emulator32bit::asm_format_m (
+                                       Emulator32bit::_op_str, false, 1, 2, 0,
+                                       Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu.system_bus->write_word (4, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                0, 1));
+    cpu.system_bus->write_word (8, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                0, 1));
+    cpu.system_bus->write_word (12, Emulator32bit::asm_hlt ());
+    // add x0, x0, #5
+    cpu.write_reg (1, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 5));
+    cpu.write_reg (2, 8);
+    cpu.set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    EXPECT_EQ (cpu.run_threaded (0, reason), Emulator32bit::RunStatus::HALTED);
+    EXPECT_EQ (cpu.read_reg (0), 6) << "the add written by the block itself should run";
+    EXPECT_EQ (reason.instructions, 4);
+
+    cpu.set_pc (0);
+    cpu.write_reg (0, 0);
+    cpu.write_reg (1, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0, 0, 9));
+    cpu.run_threaded (0, reason);
+    EXPECT_EQ (cpu.read_reg (0), 10) << "decoded code written over again should be dropped again";
+}
+
+TEST (threaded, code_written_by_other_core)
+{
+    Multicore cores (new SystemBus (new RAM (4, 0), new ROM ({}, 0, 4)), 2);
+    Emulator32bit::StopReason reason;
+
+    // add x0, x0, #1; hlt
+    cores.system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false,
+                                                                  0, 0, 1));
+    cores.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cores.core (0).run_threaded (0, reason);
+    EXPECT_EQ (cores.core (0).read_reg (0), 1);
+
+    // add x0, x0, #2, stored by the other core
+    cores.core (1).system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add,
+                                                                           false, 0, 0, 2));
+    cores.core (0).set_pc (0);
+    cores.core (0).run_threaded (0, reason);
+    EXPECT_EQ (cores.core (0).read_reg (0), 3)
+        << "a core should drop the decoded instructions another core wrote over";
+}
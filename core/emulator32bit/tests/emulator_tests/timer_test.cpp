@@ -0,0 +1,53 @@
+#include <emulator32bit/timer.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST_F (EmulatorFixture, timer_counts_instruction_cycles)
+{
+    // add x0, x0, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    // ldr x1, [x2]
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_ldr, false, 1, 2, 0,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_hlt ());
+    cpu->write_reg (2, 0x100);
+    cpu->set_pc (0);
+
+    Emulator32bit::StopReason reason;
+    cpu->run_until (0, reason);
+    const U64 expected = Timer::kBaseCycles + (Timer::kBaseCycles + Timer::kMemoryAccessCycles)
+                         + Timer::kBaseCycles;
+    EXPECT_EQ (cpu->timer->time (), expected);
+
+    cpu->set_pc (0);
+    cpu->run_until (1, reason);
+    EXPECT_EQ (cpu->timer->time (), expected + Timer::kBaseCycles)
+        << "a block cut short by the budget should only be charged for what ran";
+}
+
+TEST_F (EmulatorFixture, timer_interval_preempts)
+{
+    // loop: add x0, x0, #1; b loop
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_b1 (
+                                        Emulator32bit::_op_b, Emulator32bit::ConditionCode::AL,
+                                        -1));
+    cpu->set_pc (0);
+
+    const U64 iteration = Timer::kBaseCycles + Timer::kBaseCycles + Timer::kBranchCycles;
+    cpu->timer->set_interval (10 * iteration);
+
+    Emulator32bit::StopReason reason;
+    for (int slice = 1; slice <= 3; slice++)
+    {
+        EXPECT_EQ (cpu->run_until (0, reason), Emulator32bit::RunStatus::TIMER);
+        EXPECT_EQ (reason.instructions, 20);
+        EXPECT_EQ (cpu->read_reg (0), 10 * slice);
+        EXPECT_EQ (cpu->timer->deadline (), (slice + 1) * 10 * iteration);
+    }
+
+    cpu->timer->set_interval (0);
+    EXPECT_EQ (cpu->run_until (100, reason), Emulator32bit::RunStatus::BUDGET_EXHAUSTED);
+}
@@ -0,0 +1,133 @@
+#include <emulator32bit/system_bus.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+static constexpr word kVPage = 0x10;
+static constexpr word kAddr = kVPage << kNumPageOffsetBits;
+
+static void translate (VirtualMemory *mmu, long long pid, word vpage)
+{
+    VirtualMemory::Exception exception;
+    mmu->translate_address (pid, vpage << kNumPageOffsetBits, exception);
+}
+
+TEST (tlb, keeps_translations_across_process_switch)
+{
+    Emulator32bit cpu (4, 0, {}, 0, 4);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xAAAA);
+    const long long b = mmu->begin_process ();
+    mmu->add_vpage (b, kVPage, 1, true, false);
+    cpu.system_bus->write_word (kAddr, 0xBBBB);
+
+    const U64 generation = mmu->generation ();
+    mmu->reset_tlb_stats ();
+    for (int i = 0; i < 4; i++)
+    {
+        mmu->set_process (a);
+        EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xAAAA);
+        mmu->set_process (b);
+        EXPECT_EQ (cpu.system_bus->read_word (kAddr), 0xBBBB);
+    }
+
+    // only the first read of each process misses the software TLB, and hits the MMU TLB
+    EXPECT_EQ (mmu->generation (), generation);
+    EXPECT_EQ (mmu->tlb_stats ().hits, 2);
+    EXPECT_EQ (mmu->tlb_stats ().misses, 0);
+}
+
+TEST (tlb, replaces_least_recently_used_way)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    // pages kNumTLBSets apart share a set
+    const long long a = mmu->begin_process ();
+    for (word way = 0; way <= kNumTLBWays; way++)
+    {
+        mmu->add_vpage (a, kVPage + way * kNumTLBSets, 1, true, false);
+    }
+    for (word way = 0; way < kNumTLBWays; way++)
+    {
+        translate (mmu, a, kVPage + way * kNumTLBSets);
+    }
+    mmu->reset_tlb_stats ();
+
+    translate (mmu, a, kVPage);
+    translate (mmu, a, kVPage + kNumTLBWays * kNumTLBSets);
+    EXPECT_EQ (mmu->tlb_stats ().evictions, 1);
+
+    translate (mmu, a, kVPage);
+    translate (mmu, a, kVPage + kNumTLBSets);
+    EXPECT_EQ (mmu->tlb_stats ().hits, 2);
+    EXPECT_EQ (mmu->tlb_stats ().misses, 2);
+    EXPECT_EQ (mmu->tlb_stats ().evictions, 2);
+}
+
+TEST (tlb, invalidates_by_process_and_range)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    const long long b = mmu->begin_process ();
+    for (long long pid : {a, b})
+    {
+        mmu->add_vpage (pid, kVPage, 2, true, false);
+        translate (mmu, pid, kVPage);
+        translate (mmu, pid, kVPage + 1);
+    }
+    mmu->reset_tlb_stats ();
+
+    mmu->invalidate_tlb (a, kVPage + 1, kVPage + 1);
+    translate (mmu, a, kVPage);
+    translate (mmu, b, kVPage + 1);
+    EXPECT_EQ (mmu->tlb_stats ().misses, 0);
+    translate (mmu, a, kVPage + 1);
+    EXPECT_EQ (mmu->tlb_stats ().misses, 1);
+
+    mmu->invalidate_tlb (b);
+    translate (mmu, a, kVPage);
+    translate (mmu, b, kVPage);
+    EXPECT_EQ (mmu->tlb_stats ().hits, 3);
+    EXPECT_EQ (mmu->tlb_stats ().misses, 2);
+}
+
+TEST (tlb, tlbi_drops_pages_of_the_current_process)
+{
+    Emulator32bit cpu (8, 0, {}, 0, 8);
+    VirtualMemory *mmu = cpu.system_bus->mmu;
+
+    const long long a = mmu->begin_process ();
+    mmu->add_vpage (a, 0, 1, true, true);
+    mmu->add_vpage (a, kVPage, 3, true, false);
+
+    // tlbi x1, #2; hlt; tlbi #1; hlt
+    cpu.system_bus->write_word (0, Emulator32bit::asm_tlbi (1, true, 2));
+    cpu.system_bus->write_word (4, Emulator32bit::asm_hlt ());
+    cpu.system_bus->write_word (8, Emulator32bit::asm_tlbi (0, false, Emulator32bit::kTLBIProcess));
+    cpu.system_bus->write_word (12, Emulator32bit::asm_hlt ());
+    cpu.write_reg (1, kAddr);
+
+    const auto read_pages = [&] ()
+    {
+        mmu->reset_tlb_stats ();
+        for (word page = 0; page < 3; page++)
+        {
+            cpu.system_bus->read_word (kAddr + page * kPageSize);
+        }
+        return mmu->tlb_stats ().misses;
+    };
+    read_pages ();
+
+    Emulator32bit::StopReason reason;
+    cpu.set_pc (0);
+    EXPECT_EQ (cpu.run_until (0, reason), Emulator32bit::RunStatus::HALTED) << reason.fault;
+    EXPECT_EQ (read_pages (), 2);
+
+    cpu.set_pc (8);
+    EXPECT_EQ (cpu.run_until (0, reason), Emulator32bit::RunStatus::HALTED) << reason.fault;
+    EXPECT_EQ (read_pages (), 3);
+}
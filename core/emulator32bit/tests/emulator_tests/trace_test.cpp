@@ -0,0 +1,55 @@
+#include <emulator32bit/trace.h>
+#include <emulator32bit_test/emulator32bit_test.h>
+
+TEST_F (EmulatorFixture, trace_records)
+{
+    // mov x0, #0x400; str x0, [x0, #8]; ldr x1, [x0, #8]!; add x2, x1, #1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false,
+                                                                  0, 0x400));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_str, false, 0, 0, 8,
+                                        Emulator32bit::AddrType::ADDR_OFFSET));
+    cpu->system_bus->write_word (8, Emulator32bit::asm_format_m (
+                                        Emulator32bit::_op_ldr, false, 1, 0, 8,
+                                        Emulator32bit::AddrType::ADDR_PRE_INC));
+    cpu->system_bus->write_word (12, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 2,
+                                                                  1, 1));
+    cpu->set_pc (0);
+
+    TraceBuffer trace;
+    cpu->run (4, trace);
+
+    ASSERT_EQ (trace.size (), 4);
+    for (word i = 0; i < 4; i++)
+    {
+        EXPECT_EQ (trace[i].pc, i * 4);
+        EXPECT_EQ (trace[i].instr, cpu->system_bus->read_word (i * 4));
+    }
+    EXPECT_EQ (trace[0].rd_value, 0x400);
+    EXPECT_EQ (trace[0].mem_addr, 0);
+    EXPECT_EQ (trace[1].mem_addr, 0x408);
+    EXPECT_EQ (trace[2].rd_value, 0x400);
+    EXPECT_EQ (trace[2].mem_addr, 0x408) << "the address should be taken before the writeback";
+    EXPECT_EQ (trace[3].rd_value, 0x401);
+}
+
+TEST_F (EmulatorFixture, trace_ring_buffer)
+{
+    // add x0, x0, #1; b #-1
+    cpu->system_bus->write_word (0, Emulator32bit::asm_format_o (Emulator32bit::_op_add, false, 0,
+                                                                 0, 1));
+    cpu->system_bus->write_word (4, Emulator32bit::asm_format_b1 (
+                                        Emulator32bit::_op_b, Emulator32bit::ConditionCode::AL,
+                                        -1));
+    cpu->set_pc (0);
+
+    TraceBuffer trace (2);
+    cpu->run (10, trace);
+
+    EXPECT_EQ (trace.count (), 10);
+    ASSERT_EQ (trace.size (), 4) << "only the most recent records should be kept";
+    EXPECT_EQ (trace[0].pc, 0);
+    EXPECT_EQ (trace[0].rd_value, 4);
+    EXPECT_EQ (trace[3].pc, 4);
+    EXPECT_EQ (cpu->read_reg (0), 5);
+}
@@ -10,4 +10,30 @@ class EmulatorFixture : public ::testing::Test
 {
   protected:
     Emulator32bit *cpu = new Emulator32bit (1, 0, {}, 0, 1);
-};
\ No newline at end of file
+};
+
+inline void PrintTo (Emulator32bit::Backend backend, std::ostream *os)
+{
+    *os << (backend == Emulator32bit::Backend::JIT ? "jit" : "interpreter");
+}
+
+///
+/// @brief              @ref EmulatorFixture run once per backend. The JIT compiles every block the
+///                     first time it executes, so the registers and flags the compiled code leaves
+///                     are checked against the same expectations as the interpreter.
+///
+class BackendFixture : public EmulatorFixture,
+                       public ::testing::WithParamInterface<Emulator32bit::Backend>
+{
+  protected:
+    ///
+    /// @brief          Construct @ref cpu again on the backend of the test, with a page of RAM at
+    ///                 page 0 and ROM at page 1.
+    ///
+    void reset_cpu (const byte rom_data[] = {}, word rom_npages = 0)
+    {
+        cpu->~Emulator32bit ();
+        cpu = new (cpu) Emulator32bit (1, 0, rom_data, rom_npages, 1, GetParam ());
+        cpu->set_jit_threshold (0);
+    }
+};
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, adc_register_adc_immediate)
+TEST_P (BackendFixture, adc_register_adc_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, #9
     // x1: 1
     // carry: 1
@@ -26,9 +26,9 @@ TEST_F (EmulatorFixture, adc_register_adc_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_register_adc_register)
+TEST_P (BackendFixture, adc_register_adc_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: 1
     // x2: 9
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, adc_register_adc_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_register_adc_register_shifted)
+TEST_P (BackendFixture, adc_register_adc_register_shifted)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2, lsl #3
     // x1: 1
     // x2: 1
@@ -86,9 +86,9 @@ TEST_F (EmulatorFixture, adc_register_adc_register_shifted)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_negative_flag)
+TEST_P (BackendFixture, adc_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: -3
     // x2: 1
@@ -116,9 +116,9 @@ TEST_F (EmulatorFixture, adc_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_zero_flag)
+TEST_P (BackendFixture, adc_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: -1
     // x2: 0
@@ -145,9 +145,9 @@ TEST_F (EmulatorFixture, adc_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_carry_flag_1)
+TEST_P (BackendFixture, adc_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: -1
     // x2: -2
@@ -174,9 +174,9 @@ TEST_F (EmulatorFixture, adc_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_carry_flag_2)
+TEST_P (BackendFixture, adc_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: -4
     // x2: -5
@@ -203,9 +203,9 @@ TEST_F (EmulatorFixture, adc_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, adc_overflow_flag__neg_to_pos)
+TEST_P (BackendFixture, adc_overflow_flag__neg_to_pos)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: 1<<31
     // x2: 1<<31
@@ -232,9 +232,9 @@ TEST_F (EmulatorFixture, adc_overflow_flag__neg_to_pos)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, adc_overflow_flag__pos_to_neg)
+TEST_P (BackendFixture, adc_overflow_flag__pos_to_neg)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // adc x0, x1, x2
     // x1: (1<<31) - 1
     // x2: 0
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, add_register_add_immediate)
+TEST_P (BackendFixture, add_register_add_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, #10
     // x1: 1
     cpu->system_bus->write_word (
@@ -23,9 +23,9 @@ TEST_F (EmulatorFixture, add_register_add_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_register_add_register)
+TEST_P (BackendFixture, add_register_add_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: 1
     // x2: 10
@@ -52,9 +52,9 @@ TEST_F (EmulatorFixture, add_register_add_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_register_add_register_shifted)
+TEST_P (BackendFixture, add_register_add_register_shifted)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2, lsl #3
     // x1: 1
     // x2: 2
@@ -81,9 +81,9 @@ TEST_F (EmulatorFixture, add_register_add_register_shifted)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_negative_flag)
+TEST_P (BackendFixture, add_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: -2
     // x2: 1
@@ -109,9 +109,9 @@ TEST_F (EmulatorFixture, add_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_zero_flag)
+TEST_P (BackendFixture, add_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: 0
     // x2: 0
@@ -137,9 +137,9 @@ TEST_F (EmulatorFixture, add_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_carry_flag_1)
+TEST_P (BackendFixture, add_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: 0
     // x2: 0
@@ -164,9 +164,9 @@ TEST_F (EmulatorFixture, add_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_carry_flag_2)
+TEST_P (BackendFixture, add_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: 0
     // x2: 0
@@ -191,9 +191,9 @@ TEST_F (EmulatorFixture, add_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, add_overflow_flag__neg_to_pos)
+TEST_P (BackendFixture, add_overflow_flag__neg_to_pos)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: 1<<31
     // x2: 1<<31
@@ -217,9 +217,9 @@ TEST_F (EmulatorFixture, add_overflow_flag__neg_to_pos)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, add_overflow_flag__pos_to_neg)
+TEST_P (BackendFixture, add_overflow_flag__pos_to_neg)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // add x0, x1, x2
     // x1: (1<<31) - 1
     // x2: 1
@@ -0,0 +1,7 @@
+#include <emulator32bit_test/emulator32bit_test.h>
+
+INSTANTIATE_TEST_SUITE_P (backends, BackendFixture,
+                          ::testing::Values (Emulator32bit::Backend::INTERPRETER,
+                                             Emulator32bit::Backend::JIT),
+                          [] (const ::testing::TestParamInfo<Emulator32bit::Backend> &info)
+                          { return ::testing::PrintToString (info.param); });
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, cmn_register_cmn_immediate)
+TEST_P (BackendFixture, cmn_register_cmn_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, #10
     // x1: 1
     cpu->system_bus->write_word (
@@ -23,9 +23,9 @@ TEST_F (EmulatorFixture, cmn_register_cmn_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_register_cmn_register)
+TEST_P (BackendFixture, cmn_register_cmn_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: 1
     // x2: 10
@@ -50,9 +50,9 @@ TEST_F (EmulatorFixture, cmn_register_cmn_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_register_cmn_register_shifted)
+TEST_P (BackendFixture, cmn_register_cmn_register_shifted)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2, lsl #3
     // x1: 1
     // x2: 2
@@ -77,9 +77,9 @@ TEST_F (EmulatorFixture, cmn_register_cmn_register_shifted)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_negative_flag)
+TEST_P (BackendFixture, cmn_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: -2
     // x2: 1
@@ -103,9 +103,9 @@ TEST_F (EmulatorFixture, cmn_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_zero_flag)
+TEST_P (BackendFixture, cmn_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: 0
     // x2: 0
@@ -129,9 +129,9 @@ TEST_F (EmulatorFixture, cmn_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_carry_flag_1)
+TEST_P (BackendFixture, cmn_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: 0
     // x2: 0
@@ -154,9 +154,9 @@ TEST_F (EmulatorFixture, cmn_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_carry_flag_2)
+TEST_P (BackendFixture, cmn_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: 0
     // x2: 0
@@ -179,9 +179,9 @@ TEST_F (EmulatorFixture, cmn_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmn_overflow_flag__neg_to_pos)
+TEST_P (BackendFixture, cmn_overflow_flag__neg_to_pos)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: 1<<31
     // x2: 1<<31
@@ -203,9 +203,9 @@ TEST_F (EmulatorFixture, cmn_overflow_flag__neg_to_pos)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, cmn_overflow_flag__pos_to_neg)
+TEST_P (BackendFixture, cmn_overflow_flag__pos_to_neg)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmn x0, x1, x2
     // x1: (1<<31) - 1
     // x2: 1
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, cmp_register_cmp_immediate)
+TEST_P (BackendFixture, cmp_register_cmp_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, #10
     // x1: 11
     cpu->system_bus->write_word (
@@ -23,9 +23,9 @@ TEST_F (EmulatorFixture, cmp_register_cmp_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_register_cmp_register)
+TEST_P (BackendFixture, cmp_register_cmp_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: 11
     // x2: 10
@@ -50,9 +50,9 @@ TEST_F (EmulatorFixture, cmp_register_cmp_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_negative_flag)
+TEST_P (BackendFixture, cmp_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: 1
     // x2: 2
@@ -75,9 +75,9 @@ TEST_F (EmulatorFixture, cmp_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_zero_flag)
+TEST_P (BackendFixture, cmp_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: 1
     // x2: 1
@@ -100,9 +100,9 @@ TEST_F (EmulatorFixture, cmp_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_carry_flag_1)
+TEST_P (BackendFixture, cmp_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: -3
     // x2: -2
@@ -125,9 +125,9 @@ TEST_F (EmulatorFixture, cmp_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_carry_flag_2)
+TEST_P (BackendFixture, cmp_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: 1
     // x2: -2
@@ -151,9 +151,9 @@ TEST_F (EmulatorFixture, cmp_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, cmp_overflow_flag__positive_to_negative)
+TEST_P (BackendFixture, cmp_overflow_flag__positive_to_negative)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: (1<<31)-1
     // x2: -1
@@ -176,9 +176,9 @@ TEST_F (EmulatorFixture, cmp_overflow_flag__positive_to_negative)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, cmp_overflow_flag__negative_to_positive)
+TEST_P (BackendFixture, cmp_overflow_flag__negative_to_positive)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // cmp x0, x1, x2
     // x1: 1U<<31
     // x2: 1
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, eor_register_and_register)
+TEST_P (BackendFixture, eor_register_and_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // eor x0, x1, x2
     // x1: 0b0011
     // x2: 0b1010
@@ -28,9 +28,9 @@ TEST_F (EmulatorFixture, eor_register_and_register)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, eor_negative_flag)
+TEST_P (BackendFixture, eor_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // eor x0, x1, x2
     // x1: (1<<31) - 1
     // x2: ~0
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, eor_negative_flag)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, eor_zero_flag)
+TEST_P (BackendFixture, eor_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // eor x0, x1, x2
     // x1: ~0
     // x2: ~0
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, hlt_test_execution_halting)
+TEST_P (BackendFixture, hlt_test_execution_halting)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     cpu->system_bus->write_word (0, Emulator32bit::asm_hlt ());
     cpu->set_pc (0);
 
@@ -4,9 +4,9 @@
 
 static const byte data[kPageSize] = {9U, 0U, 0U, 0U};
 
-TEST_F (EmulatorFixture, ldr_offset_positive_constant)
+TEST_P (BackendFixture, ldr_offset_positive_constant)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, #3]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 3,
@@ -30,9 +30,9 @@ TEST_F (EmulatorFixture, ldr_offset_positive_constant)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_offset_negative_constant)
+TEST_P (BackendFixture, ldr_offset_negative_constant)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, #-3]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, -3,
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, ldr_offset_negative_constant)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_offset_reg)
+TEST_P (BackendFixture, ldr_offset_reg)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, x2]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 2,
@@ -85,9 +85,9 @@ TEST_F (EmulatorFixture, ldr_offset_reg)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_offset_reg_lsl)
+TEST_P (BackendFixture, ldr_offset_reg_lsl)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, x2]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 2,
@@ -114,9 +114,9 @@ TEST_F (EmulatorFixture, ldr_offset_reg_lsl)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_offset_reg_lsr)
+TEST_P (BackendFixture, ldr_offset_reg_lsr)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, x2]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 2,
@@ -143,9 +143,9 @@ TEST_F (EmulatorFixture, ldr_offset_reg_lsr)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_pre_indexed)
+TEST_P (BackendFixture, ldr_pre_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 3,
@@ -169,9 +169,9 @@ TEST_F (EmulatorFixture, ldr_pre_indexed)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldr_post_indexed)
+TEST_P (BackendFixture, ldr_post_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldr x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldr, false, 0, 1, 3,
@@ -4,9 +4,9 @@
 
 static const byte data[kPageSize] = {9U, 1U, 2U, 3U};
 
-TEST_F (EmulatorFixture, ldrb_offset)
+TEST_P (BackendFixture, ldrb_offset)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrb x0, [x1, #3]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrb, false, 0, 1, 3,
@@ -30,9 +30,9 @@ TEST_F (EmulatorFixture, ldrb_offset)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldrb_pre_indexed)
+TEST_P (BackendFixture, ldrb_pre_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrb x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrb, false, 0, 1, 3,
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, ldrb_pre_indexed)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldrb_post_indexed)
+TEST_P (BackendFixture, ldrb_post_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrb x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrb, false, 0, 1, 3,
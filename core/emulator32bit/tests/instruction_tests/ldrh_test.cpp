@@ -4,9 +4,9 @@
 
 static const byte data[kPageSize] = {9U, 0U, 2U, 3U};
 
-TEST_F (EmulatorFixture, ldrh_offset)
+TEST_P (BackendFixture, ldrh_offset)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrh x0, [x1, #3]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrh, false, 0, 1, 3,
@@ -30,9 +30,9 @@ TEST_F (EmulatorFixture, ldrh_offset)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldrh_pre_indexed)
+TEST_P (BackendFixture, ldrh_pre_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrh x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrh, false, 0, 1, 3,
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, ldrh_pre_indexed)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, ldrh_post_indexed)
+TEST_P (BackendFixture, ldrh_post_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // ldrh x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_ldrh, false, 0, 1, 3,
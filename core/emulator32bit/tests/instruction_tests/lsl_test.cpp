@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, lsl_imm5_shift)
+TEST_P (BackendFixture, lsl_imm5_shift)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_o1 (Emulator32bit::_op_lsl, 0, 1, true, 2, 5));
     cpu->set_pc (0);
@@ -19,9 +19,9 @@ TEST_F (EmulatorFixture, lsl_imm5_shift)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, lsl_reg_shift)
+TEST_P (BackendFixture, lsl_reg_shift)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_o1 (Emulator32bit::_op_lsl, 0, 1, false, 2, 0));
     cpu->set_pc (0);
@@ -41,9 +41,9 @@ TEST_F (EmulatorFixture, lsl_reg_shift)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, lsl_reg_shift_low_byte)
+TEST_P (BackendFixture, lsl_reg_shift_low_byte)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_o1 (Emulator32bit::_op_lsl, 0, 1, false, 2, 0));
     cpu->set_pc (0);
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, mov_register_mov_immediate)
+TEST_P (BackendFixture, mov_register_mov_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mov x0, #9
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, false, 0, 9));
@@ -21,9 +21,9 @@ TEST_F (EmulatorFixture, mov_register_mov_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, mov_zero_flag)
+TEST_P (BackendFixture, mov_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mov x0, #0
     cpu->system_bus->write_word (0,
                                  Emulator32bit::asm_format_o3 (Emulator32bit::_op_mov, true, 0, 0));
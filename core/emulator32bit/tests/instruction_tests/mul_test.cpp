@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, mul_register_mul_immediate)
+TEST_P (BackendFixture, mul_register_mul_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mul x0, x1, #9
     // x1: 2
     cpu->system_bus->write_word (
@@ -24,9 +24,9 @@ TEST_F (EmulatorFixture, mul_register_mul_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, mul_register_mul_register)
+TEST_P (BackendFixture, mul_register_mul_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mul x0, x1, x2
     // x1: 2
     // x2: 4
@@ -53,9 +53,9 @@ TEST_F (EmulatorFixture, mul_register_mul_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, mul_register_mul_register_shift)
+TEST_P (BackendFixture, mul_register_mul_register_shift)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mul x0, x1, x2, lsr #1
     // x1: 2
     // x2: 4
@@ -82,9 +82,9 @@ TEST_F (EmulatorFixture, mul_register_mul_register_shift)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, mul_negative_flag)
+TEST_P (BackendFixture, mul_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mul x0, x1, x2
     // x1: -2
     // x2: 4
@@ -110,9 +110,9 @@ TEST_F (EmulatorFixture, mul_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, mul_zero_flag)
+TEST_P (BackendFixture, mul_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mul x0, x1, x2
     // x1: 0
     // x2: 4
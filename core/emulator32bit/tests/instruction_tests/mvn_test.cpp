@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, mvn_register_mvn_immediate)
+TEST_P (BackendFixture, mvn_register_mvn_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // mvn x0, #0
     cpu->system_bus->write_word (0,
                                  Emulator32bit::asm_format_o3 (Emulator32bit::_op_mvn, true, 0, 0));
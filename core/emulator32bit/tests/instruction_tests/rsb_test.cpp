@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, rsb_register_rsb_immediate)
+TEST_P (BackendFixture, rsb_register_rsb_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, #11
     // x1: 10
     cpu->system_bus->write_word (
@@ -24,9 +24,9 @@ TEST_F (EmulatorFixture, rsb_register_rsb_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_register_rsb_register)
+TEST_P (BackendFixture, rsb_register_rsb_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: 10
     // x2: 11
@@ -53,9 +53,9 @@ TEST_F (EmulatorFixture, rsb_register_rsb_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_negative_flag)
+TEST_P (BackendFixture, rsb_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: 2
     // x2: 1
@@ -80,9 +80,9 @@ TEST_F (EmulatorFixture, rsb_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_zero_flag)
+TEST_P (BackendFixture, rsb_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: 1
     // x2: 1
@@ -107,9 +107,9 @@ TEST_F (EmulatorFixture, rsb_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_carry_flag_1)
+TEST_P (BackendFixture, rsb_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: -2
     // x2: -3
@@ -134,9 +134,9 @@ TEST_F (EmulatorFixture, rsb_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_carry_flag_2)
+TEST_P (BackendFixture, rsb_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: -2
     // x2: 1
@@ -162,9 +162,9 @@ TEST_F (EmulatorFixture, rsb_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsb_overflow_flag__positive_to_negative)
+TEST_P (BackendFixture, rsb_overflow_flag__positive_to_negative)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: -1
     // x2: (1<<31)-1
@@ -189,9 +189,9 @@ TEST_F (EmulatorFixture, rsb_overflow_flag__positive_to_negative)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, rsb_overflow_flag__negative_to_positive)
+TEST_P (BackendFixture, rsb_overflow_flag__negative_to_positive)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsb x0, x1, x2
     // x1: 1
     // x2: 1<<31
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, rsc_register_rsc_immediate)
+TEST_P (BackendFixture, rsc_register_rsc_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, #11
     // x1: 9
     // carry: 1
@@ -26,9 +26,9 @@ TEST_F (EmulatorFixture, rsc_register_rsc_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_register_rsc_register)
+TEST_P (BackendFixture, rsc_register_rsc_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: 9
     // x2: 11
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, rsc_register_rsc_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_negative_flag)
+TEST_P (BackendFixture, rsc_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: 2
     // x2: 2
@@ -85,9 +85,9 @@ TEST_F (EmulatorFixture, rsc_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_zero_flag)
+TEST_P (BackendFixture, rsc_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: 1
     // x2: 2
@@ -114,9 +114,9 @@ TEST_F (EmulatorFixture, rsc_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_carry_flag_1)
+TEST_P (BackendFixture, rsc_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: -2
     // x2: -2
@@ -143,9 +143,9 @@ TEST_F (EmulatorFixture, rsc_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_carry_flag_2)
+TEST_P (BackendFixture, rsc_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: -2
     // x2: 2
@@ -173,9 +173,9 @@ TEST_F (EmulatorFixture, rsc_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, rsc_overflow_flag__positive_to_negative)
+TEST_P (BackendFixture, rsc_overflow_flag__positive_to_negative)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: -2
     // x2: (1<<31)-1
@@ -202,9 +202,9 @@ TEST_F (EmulatorFixture, rsc_overflow_flag__positive_to_negative)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, rsc_overflow_flag__negative_to_positive)
+TEST_P (BackendFixture, rsc_overflow_flag__negative_to_positive)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // rsc x0, x1, x2
     // x1: 0
     // x2: 1<<31
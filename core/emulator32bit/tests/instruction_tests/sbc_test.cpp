@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, sbc_register_sbc_immediate)
+TEST_P (BackendFixture, sbc_register_sbc_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, #9
     // x1: 11
     // carry: 1
@@ -26,9 +26,9 @@ TEST_F (EmulatorFixture, sbc_register_sbc_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_register_sbc_register)
+TEST_P (BackendFixture, sbc_register_sbc_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: 11
     // x2: 9
@@ -56,9 +56,9 @@ TEST_F (EmulatorFixture, sbc_register_sbc_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_negative_flag)
+TEST_P (BackendFixture, sbc_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: 2
     // x2: 2
@@ -85,9 +85,9 @@ TEST_F (EmulatorFixture, sbc_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_zero_flag)
+TEST_P (BackendFixture, sbc_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: 2
     // x2: 1
@@ -114,9 +114,9 @@ TEST_F (EmulatorFixture, sbc_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_carry_flag_1)
+TEST_P (BackendFixture, sbc_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: -2
     // x2: -2
@@ -143,9 +143,9 @@ TEST_F (EmulatorFixture, sbc_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_carry_flag_2)
+TEST_P (BackendFixture, sbc_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: 2
     // x2: -2
@@ -173,9 +173,9 @@ TEST_F (EmulatorFixture, sbc_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sbc_overflow_flag__positive_to_negative)
+TEST_P (BackendFixture, sbc_overflow_flag__positive_to_negative)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: (1<<31)-1
     // x2: -2
@@ -202,9 +202,9 @@ TEST_F (EmulatorFixture, sbc_overflow_flag__positive_to_negative)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, sbc_overflow_flag__negative_to_positive)
+TEST_P (BackendFixture, sbc_overflow_flag__negative_to_positive)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sbc x0, x1, x2
     // x1: 1U<<31
     // x2: 0
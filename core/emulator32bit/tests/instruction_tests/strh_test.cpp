@@ -2,9 +2,9 @@
 
 #include <iostream>
 
-TEST_F (EmulatorFixture, strh_offset)
+TEST_P (BackendFixture, strh_offset)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // strh x0, [x1, #3]
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_strh, false, 0, 1, 3,
@@ -31,9 +31,9 @@ TEST_F (EmulatorFixture, strh_offset)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, strh_pre_indexed)
+TEST_P (BackendFixture, strh_pre_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // strh x0, [x1, #3]!
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_strh, false, 0, 1, 3,
@@ -60,9 +60,9 @@ TEST_F (EmulatorFixture, strh_pre_indexed)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, strh_post_indexed)
+TEST_P (BackendFixture, strh_post_indexed)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // strh x0, [x1], #3
     cpu->system_bus->write_word (
         0, Emulator32bit::asm_format_m (Emulator32bit::_op_strh, false, 0, 1, 3,
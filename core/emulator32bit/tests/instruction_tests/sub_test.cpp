@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, sub_register_sub_immediate)
+TEST_P (BackendFixture, sub_register_sub_immediate)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, #10
     // x1: 11
     cpu->system_bus->write_word (
@@ -24,9 +24,9 @@ TEST_F (EmulatorFixture, sub_register_sub_immediate)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_register_sub_register)
+TEST_P (BackendFixture, sub_register_sub_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: 11
     // x2: 10
@@ -53,9 +53,9 @@ TEST_F (EmulatorFixture, sub_register_sub_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_negative_flag)
+TEST_P (BackendFixture, sub_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: 1
     // x2: 2
@@ -80,9 +80,9 @@ TEST_F (EmulatorFixture, sub_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_zero_flag)
+TEST_P (BackendFixture, sub_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: 1
     // x2: 1
@@ -107,9 +107,9 @@ TEST_F (EmulatorFixture, sub_zero_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_carry_flag_1)
+TEST_P (BackendFixture, sub_carry_flag_1)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: -3
     // x2: -2
@@ -134,9 +134,9 @@ TEST_F (EmulatorFixture, sub_carry_flag_1)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_carry_flag_2)
+TEST_P (BackendFixture, sub_carry_flag_2)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: 1
     // x2: -2
@@ -162,9 +162,9 @@ TEST_F (EmulatorFixture, sub_carry_flag_2)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, sub_overflow_flag__positive_to_negative)
+TEST_P (BackendFixture, sub_overflow_flag__positive_to_negative)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: (1<<31)-1
     // x2: -1
@@ -189,9 +189,9 @@ TEST_F (EmulatorFixture, sub_overflow_flag__positive_to_negative)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "V flag should be set";
 }
 
-TEST_F (EmulatorFixture, sub_overflow_flag__negative_to_positive)
+TEST_P (BackendFixture, sub_overflow_flag__negative_to_positive)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // sub x0, x1, x2
     // x1: 1U<<31
     // x2: 1
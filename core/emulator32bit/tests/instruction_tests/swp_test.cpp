@@ -4,9 +4,9 @@
 
 static const byte data[kPageSize] = {0x07, 0x16, 0x25, 0x34};
 
-TEST_F (EmulatorFixture, swp_basic)
+TEST_P (BackendFixture, swp_basic)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, data, 1, 1);
+    reset_cpu (data, 1);
     // swp x0, x1, [x2]
     cpu->system_bus->write_word (0, Emulator32bit::asm_atomic (0, 1, 2,
                                                                Emulator32bit::kAtomicWidth_word,
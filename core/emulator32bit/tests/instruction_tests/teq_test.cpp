@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, teq_register_and_register)
+TEST_P (BackendFixture, teq_register_and_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // teq x0, x1, x2
     // x1: 0b0011
     // x2: 0b1010
@@ -26,9 +26,9 @@ TEST_F (EmulatorFixture, teq_register_and_register)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, teq_negative_flag)
+TEST_P (BackendFixture, teq_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // teq x0, x1, x2
     // x1: (1<<31) - 1
     // x2: ~0
@@ -52,9 +52,9 @@ TEST_F (EmulatorFixture, teq_negative_flag)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, teq_zero_flag)
+TEST_P (BackendFixture, teq_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // teq x0, x1, x2
     // x1: ~0
     // x2: ~0
@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, tst_register_tst_register)
+TEST_P (BackendFixture, tst_register_tst_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // tst x0, x1, x2
     // x1: 0b0011
     // x2: 0b1010
@@ -26,9 +26,9 @@ TEST_F (EmulatorFixture, tst_register_tst_register)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, tst_negative_flag)
+TEST_P (BackendFixture, tst_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // tst x0, x1, x2
     // x1: ~0
     // x2: 1<<31
@@ -51,9 +51,9 @@ TEST_F (EmulatorFixture, tst_negative_flag)
     EXPECT_EQ (cpu->get_flag (Emulator32bit::kVFlagBit), 1) << "operation should not alter V flag";
 }
 
-TEST_F (EmulatorFixture, tst_zero_flag)
+TEST_P (BackendFixture, tst_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // tst x0, x1, x2
     // x1: ~0
     // x2: 0
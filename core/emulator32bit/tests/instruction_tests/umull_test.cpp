@@ -1,8 +1,8 @@
 #include <emulator32bit_test/emulator32bit_test.h>
 
-TEST_F (EmulatorFixture, umull_register_umull_register)
+TEST_P (BackendFixture, umull_register_umull_register)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // umull x0, x1, x2, x3
     // x2: 2
     // x3: 4
@@ -30,9 +30,9 @@ TEST_F (EmulatorFixture, umull_register_umull_register)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, umull_negative_flag)
+TEST_P (BackendFixture, umull_negative_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // umull x0, x1, x2, x3
     // x2: 1<<31
     // x3: 1<<31
@@ -59,9 +59,9 @@ TEST_F (EmulatorFixture, umull_negative_flag)
         << "operation should not cause V flag to be set";
 }
 
-TEST_F (EmulatorFixture, umull_zero_flag)
+TEST_P (BackendFixture, umull_zero_flag)
 {
-    cpu = new (cpu) Emulator32bit (1, 0, {}, 0, 1);
+    reset_cpu ();
     // umull x0, x1, x2, x3
     // x2: 0
     // x3: 4
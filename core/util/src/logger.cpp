@@ -64,13 +64,14 @@ struct ProfileLog
     std::vector<Log> logs = std::vector<Log> ();
 };
 
-static long long master_total_time = 0;
-static ProfileLog master_profile_log = {
+// profiles are kept per thread so that machines on different threads can be profiled at once
+static thread_local long long master_total_time = 0;
+static thread_local ProfileLog master_profile_log = {
     .tag = "MASTER",
 };
 
-static std::unordered_map<std::string, ProfileLog> profile_logs_map;
-static std::stack<std::string> current_clocks;
+static thread_local std::unordered_map<std::string, ProfileLog> profile_logs_map;
+static thread_local std::stack<std::string> current_clocks;
 
 template<typename... Args>
 static inline void log_profile (const char *format, const char *file, int line, const char *func,